@@ -4,17 +4,34 @@ out vec4 FragColor;
 
 uniform vec3  iResolution;
 uniform usampler3D uBrickMap;
+uniform usampler3D uBlockMap;
+uniform usampler3D uAirDistance;
 uniform sampler3D  uAtlas;
 uniform sampler3D uMaterial;
+uniform usampler3D uBrickMaterial;
 uniform sampler1D uPalette;
 
-uniform vec3  uBrickMapDim;
-uniform ivec3 uAtlasBrickDim;
+// Clipmap: level l covers twice the extent of level l - 1. The brick maps of all levels are
+// stacked along z in uBrickMap, their block maps along z in uBlockMap (0: every brick of the
+// block is air), their air distance maps along z in uAirDistance (one texel per brick, laid out like
+// uBrickMap) and their atlases along z in uAtlas (level l from brick layer uAtlasLayerStart[l]).
+// uBrickMaterial holds one texel per atlas brick: the material id of a single material brick or
+// MATERIAL_MIXED | slot of the brick in uMaterial, which only stores the mixed bricks (from uMaterialLayerStart[l]).
+const int MAX_LEVELS = 8;
+
+uniform int   uLevelCount;
+uniform int   uBrickMapDim;                   // Bricks per axis of every level
+uniform int   uBrickMapIndexBits;             // 16 (R16UI) or 32 (R32UI) bit brick map entries
 uniform vec3  uInvAtlasSize;
-uniform vec3  uGridStart;
-uniform float uCellSize;
-uniform float uTruncation;
-uniform vec3  uInvCellSize;
+uniform vec3  uInvMaterialSize;
+uniform vec3  uGridStart[MAX_LEVELS];
+uniform float uCellSize[MAX_LEVELS];
+uniform float uTruncation[MAX_LEVELS];
+uniform int   uAtlasBricksPerRow[MAX_LEVELS];
+uniform int   uAtlasBricksPerColumn[MAX_LEVELS];
+uniform int   uAtlasLayerStart[MAX_LEVELS];   // First atlas brick layer of the level
+uniform int   uMaterialLayerStart[MAX_LEVELS]; // First material atlas brick layer of the level
+uniform ivec3 uBrickMapOffset[MAX_LEVELS];    // Toroidal storage offset of the local brick (0, 0, 0)
 
 uniform vec3  camera_position;
 uniform vec3  camera_forward;
@@ -23,30 +40,71 @@ uniform vec3  camera_up;
 uniform vec3  camera_forward_scaled;
 
 const int   BRICK_SIZE = 8;
+const int   BLOCK_SIZE = 4;                   // Bricks per axis of a brick map block
 const float fBRICK_SIZE = 8.0;
 const float fPHYSICAL_BRICK_SIZE = 10.0;
 const float EPS = 0.01;
 const float INV_256 = 1.0 / 256.0;
+const uint  MATERIAL_MIXED = 0x80000000u;
+
+ivec3 brickStorage(int level, ivec3 brickCoord) {
+    return (clamp(brickCoord, ivec3(0), ivec3(uBrickMapDim - 1)) + uBrickMapOffset[level]) % uBrickMapDim;
+}
+
+uint fetchBrick(int level, ivec3 brickCoord) {
+    ivec3 storage = brickStorage(level, brickCoord);
+    storage.z += level * uBrickMapDim;
+    return texelFetch(uBrickMap, storage, 0).r;
+}
+
+bool blockEmpty(int level, ivec3 storage) {
+    int blockDim = uBrickMapDim / BLOCK_SIZE;
+    return texelFetch(uBlockMap, storage / BLOCK_SIZE + ivec3(0, 0, level * blockDim), 0).r == 0u;
+}
 
-vec3 getAtlasOffset(uint stored) {
-    uint atlasLinear = stored - 1u;
-    uint bricksPerRow = uint(uAtlasBrickDim.x);
-    vec2 offset;
-    offset.y = float(atlasLinear / bricksPerRow);
-    offset.x = float(atlasLinear - (offset.y * bricksPerRow));
-    return (vec3(offset * fPHYSICAL_BRICK_SIZE, 0.0) + 1.0) * uInvAtlasSize;
+// Chebyshev distance in bricks to the nearest brick that is not air, 0 for those
+int airDistance(int level, ivec3 storage) {
+    return int(texelFetch(uAirDistance, storage + ivec3(0, 0, level * uBrickMapDim), 0).r);
 }
 
-float sampleAtlas(vec3 gridPos, vec3 atlasOffset, ivec3 brickCoord) {
+// Ray distance to the faces of the box of boxSize bricks at boxMin, the exit is the smallest
+vec3 boxExit(ivec3 boxMin, int boxSize, vec3 gP, vec3 rdSign, float cellSize, vec3 invRd, float t) {
+    return ((vec3(boxMin) + max(rdSign, 0.0) * float(boxSize)) * fBRICK_SIZE - gP) * cellSize * invRd + t;
+}
+
+// Slots fill a row, then a layer of rows, then the next layer of the level
+ivec3 getAtlasBrick(uint slot, int level, int layerStart) {
+    uint bricksPerRow = uint(uAtlasBricksPerRow[level]);
+    uint bricksPerColumn = uint(uAtlasBricksPerColumn[level]);
+    uint row = slot / bricksPerRow;
+    uint layer = row / bricksPerColumn;
+    return ivec3(int(slot - row * bricksPerRow), int(row - layer * bricksPerColumn), int(layer) + layerStart);
+}
+
+vec3 getAtlasOffset(uint stored, int level) {
+    vec3 offset = vec3(getAtlasBrick(stored - 1u, level, uAtlasLayerStart[level]));
+    return (offset * fPHYSICAL_BRICK_SIZE + 1.0) * uInvAtlasSize;
+}
+
+float sampleAtlas(vec3 gridPos, vec3 atlasOffset, ivec3 brickCoord, int level) {
     vec3 localPos = gridPos - vec3(brickCoord * BRICK_SIZE);
     float d = texture(uAtlas, atlasOffset + localPos * uInvAtlasSize).r;
-    return d * uTruncation;
+    return d * uTruncation[level];
 }
 
-vec3 sampleMaterial(vec3 gridPos, vec3 atlasOffset, ivec3 brickCoord) {
-    vec3 localPos = gridPos - vec3(brickCoord * BRICK_SIZE);
-    float matIDNormalized = texture(uMaterial, atlasOffset + localPos * uInvAtlasSize).r;
-    float paletteCoord = (matIDNormalized * 255.0 + 0.5) * INV_256;
+vec3 sampleMaterial(vec3 gridPos, vec3 atlasOffset, ivec3 brickCoord, int level) {
+    ivec3 atlasBrick = ivec3(atlasOffset / (uInvAtlasSize * fPHYSICAL_BRICK_SIZE));
+    uint entry = texelFetch(uBrickMaterial, atlasBrick, 0).r;
+    float matID = float(entry);
+
+    if ((entry & MATERIAL_MIXED) != 0u) {
+        vec3 localPos = gridPos - vec3(brickCoord * BRICK_SIZE);
+        vec3 materialBrick = vec3(getAtlasBrick(entry & ~MATERIAL_MIXED, level, uMaterialLayerStart[level]));
+        vec3 materialOffset = (materialBrick * fPHYSICAL_BRICK_SIZE + 1.0) * uInvMaterialSize;
+        matID = texture(uMaterial, materialOffset + localPos * uInvMaterialSize).r * 255.0;
+    }
+
+    float paletteCoord = (matID + 0.5) * INV_256;
     return texture(uPalette, paletteCoord).rgb;
 }
 
@@ -59,109 +117,177 @@ vec3 debugColor(ivec3 p) {
     return vec3(v & 255u) / 255.0;
 }
 
+// Brick DDA through one level for t in [tStart, tEnd). Returns true on a hit.
+bool traceLevel(int level, vec3 ro, vec3 rd, vec3 invRd, float tStart, float tEnd, out float hitT, out ivec3 hitBrick, out vec3 hitAtlasOff) {
+    float cellSize = uCellSize[level];
+    float invCellSize = 1.0 / cellSize;
+    float t = tStart;
+
+    hitT = -1.0;
+    hitBrick = ivec3(0);
+    hitAtlasOff = vec3(0.0);
+
+    // DDA Setup for Brick Skipping
+    vec3 gridP = (ro + rd * t - uGridStart[level]) * invCellSize;
+    vec3 brickP = gridP / fBRICK_SIZE;
+    ivec3 brickCoord = ivec3(floor(brickP));
+
+    vec3 rdSign = sign(rd);
+    vec3 rdGrid = rd * invCellSize;
+    vec3 tDelta = abs((fBRICK_SIZE * cellSize) * invRd);
+    vec3 tMax = ((vec3(brickCoord) + max(rdSign, 0.0)) * fBRICK_SIZE - gridP) * cellSize * invRd + t;
+
+    uint solid = uBrickMapIndexBits == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+    // Brick Traversal (DDA)
+    for(int i = 0; i < 48; i++) {
+
+        uint stored = fetchBrick(level, brickCoord);
+
+        if (stored == solid) // Solid
+        {
+            hitT = t; hitBrick = brickCoord; return true;
+        }
+        else if (stored == 0u && all(greaterThanEqual(brickCoord, ivec3(0))) && all(lessThan(brickCoord, ivec3(uBrickMapDim))))
+        {
+            // Air: jump over the cube of air bricks around it (air distance map) or the whole block if it
+            // is air, whichever the ray leaves later. Blocks are aligned in storage, so the local corner of
+            // the block moves with the toroidal offset.
+            ivec3 storage = brickStorage(level, brickCoord);
+            int air = airDistance(level, storage);
+            bool empty = blockEmpty(level, storage);
+
+            if (air > 1 || empty) {
+                vec3 gP = (ro + rd * t - uGridStart[level]) * invCellSize;
+                ivec3 boxMin = brickCoord - (storage % BLOCK_SIZE);
+                int boxSize = BLOCK_SIZE;
+                vec3 tBox = boxExit(boxMin, boxSize, gP, rdSign, cellSize, invRd, t);
+
+                if (air > 1) {
+                    ivec3 cubeMin = brickCoord - (air - 1);
+                    vec3 tCube = boxExit(cubeMin, 2 * air - 1, gP, rdSign, cellSize, invRd, t);
+
+                    if (!empty || min(min(tCube.x, tCube.y), tCube.z) > min(min(tBox.x, tBox.y), tBox.z)) {
+                        boxMin = cubeMin;
+                        boxSize = 2 * air - 1;
+                        tBox = tCube;
+                    }
+                }
+
+                float tExit = min(min(tBox.x, tBox.y), tBox.z);
+
+                // Brick behind the exit face: inside the box on the other axes, one past it on the exit axis
+                vec3 exitBrick = (ro + rd * tExit - uGridStart[level]) * invCellSize / fBRICK_SIZE;
+                ivec3 next = clamp(ivec3(floor(exitBrick)), boxMin, boxMin + boxSize - 1);
+
+                if (tExit == tBox.x) next.x = rdSign.x > 0.0 ? boxMin.x + boxSize : boxMin.x - 1;
+                else if (tExit == tBox.y) next.y = rdSign.y > 0.0 ? boxMin.y + boxSize : boxMin.y - 1;
+                else next.z = rdSign.z > 0.0 ? boxMin.z + boxSize : boxMin.z - 1;
+
+                brickCoord = next;
+                tMax = ((vec3(brickCoord) + max(rdSign, 0.0)) * fBRICK_SIZE - gP) * cellSize * invRd + t;
+                t = tExit;
+
+                if (t > tEnd) break;
+                continue;
+            }
+        }
+        else if (stored > 0u) // SDF Occupied
+        {
+            vec3 atlasOff = getAtlasOffset(stored, level);
+            float localT = t;
+            float brickExitT = min(min(tMax.x, tMax.y), tMax.z);
+
+            // Inner Loop: Sphere Tracing inside one brick
+            vec3 pStart = (ro + rd * localT - uGridStart[level]) * invCellSize;
+
+            for(int j = 0; j < 32; j++) {
+                float d = sampleAtlas(pStart, atlasOff, brickCoord, level);
+                if (d < EPS) { hitT = localT; hitBrick = brickCoord; hitAtlasOff = atlasOff; return true; }
+                localT += d;
+                pStart += rdGrid * d;
+                if (localT > brickExitT) break;
+            }
+        }
+
+        // Standard DDA Step to next brick
+        if (tMax.x < tMax.y) {
+            if (tMax.x < tMax.z) { t = tMax.x; tMax.x += tDelta.x; brickCoord.x += int(rdSign.x); }
+            else { t = tMax.z; tMax.z += tDelta.z; brickCoord.z += int(rdSign.z); }
+        } else {
+            if (tMax.y < tMax.z) { t = tMax.y; tMax.y += tDelta.y; brickCoord.y += int(rdSign.y); }
+            else { t = tMax.z; tMax.z += tDelta.z; brickCoord.z += int(rdSign.z); }
+        }
+        if (t > tEnd) break;
+    }
+
+    return false;
+}
+
 void mainImage(out vec4 fragColor, in vec2 fragCoord) {
     vec2 uv = (2.0 * fragCoord - iResolution.xy) / iResolution.y;
     vec3 ro = camera_position; // ray origin
     vec3 rd = normalize(uv.x * camera_right + uv.y * camera_up + camera_forward_scaled); // ray direction
-
-    vec3 gridMin = uGridStart;
-    vec3 gridMax = uGridStart + uBrickMapDim * uCellSize;
-    
     vec3 invRd = 1.0 / rd;
-    vec3 t0 = (gridMin - ro) * invRd;
-    vec3 t1 = (gridMax - ro) * invRd;
-    float tNear = max(max(min(t0.x, t1.x), min(t0.y, t1.y)), min(t0.z, t1.z));
-    float tFar  = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), max(t0.z, t1.z));
 
     vec3 col = vec3(0.4, 0.75, 1.0) - 0.7 * rd.y; // Sky
 
-    if (tNear < tFar && tFar > 0.0) {
-        float t = max(0.0, tNear) + EPS;
-        float hitT = -1.0;
-        uint hitStored = 0u;
-        vec3 hitAtlasOff;
-
-        // DDA Setup for Brick Skipping
-        vec3 gridP = (ro + rd * t - uGridStart) * uInvCellSize;
-        vec3 brickP = gridP / fBRICK_SIZE;
-        ivec3 brickCoord = ivec3(floor(brickP));
-        
-        vec3 rdSign = sign(rd);
-        vec3 rdGrid = rd * uInvCellSize;
-        vec3 tDelta = abs((fBRICK_SIZE * uCellSize) * invRd);
-        vec3 tMax = ((vec3(brickCoord) + max(rdSign, 0.0)) * fBRICK_SIZE - gridP) * uCellSize * invRd + t;
-
-        // Brick Traversal (DDA)
-        for(int i = 0; i < 48; i++) {
-
-            hitStored = texelFetch(uBrickMap, brickCoord, 0).r;
-
-            if (hitStored == 65535u) // Solid
-            {
-                hitT = t; break;
-            } 
-            else if (hitStored > 0u) // SDF Occupied
-            {
-                hitAtlasOff = getAtlasOffset(hitStored);
-                float localT = t;
-                float brickExitT = min(min(tMax.x, tMax.y), tMax.z);
-                
-                // Inner Loop: Sphere Tracing inside one brick
-                vec3 pStart = (ro + rd * localT - uGridStart) * uInvCellSize;
-                 
-                for(int j = 0; j < 32; j++) {
-                    float d = sampleAtlas(pStart, hitAtlasOff, brickCoord);
-                    if (d < EPS) { hitT = localT; break; }
-                    localT += d;
-                    pStart += rdGrid * d;
-                    if (localT > brickExitT) break;
-                }
-                if (hitT > 0.0) break;
-            }
+    float t = 0.0;
+    float hitT = -1.0;
+    int hitLevel = 0;
+    ivec3 brickCoord;
+    vec3 hitAtlasOff;
+
+    // Finest level first: a ray sample is only handed to a coarser level once it left every finer one
+    for (int level = 0; level < uLevelCount; level++) {
+        vec3 gridMin = uGridStart[level];
+        vec3 gridMax = gridMin + float(uBrickMapDim * BRICK_SIZE) * uCellSize[level];
+
+        vec3 t0 = (gridMin - ro) * invRd;
+        vec3 t1 = (gridMax - ro) * invRd;
+        float tNear = max(max(min(t0.x, t1.x), min(t0.y, t1.y)), min(t0.z, t1.z));
+        float tFar  = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), max(t0.z, t1.z));
 
-            // Standard DDA Step to next brick
-            if (tMax.x < tMax.y) {
-                if (tMax.x < tMax.z) { t = tMax.x; tMax.x += tDelta.x; brickCoord.x += int(rdSign.x); }
-                else { t = tMax.z; tMax.z += tDelta.z; brickCoord.z += int(rdSign.z); }
-            } else {
-                if (tMax.y < tMax.z) { t = tMax.y; tMax.y += tDelta.y; brickCoord.y += int(rdSign.y); }
-                else { t = tMax.z; tMax.z += tDelta.z; brickCoord.z += int(rdSign.z); }
+        if (tNear < tFar && tFar > t) {
+            if (traceLevel(level, ro, rd, invRd, max(t, tNear) + EPS, tFar, hitT, brickCoord, hitAtlasOff)) {
+                hitLevel = level;
+                break;
             }
-            if (t > tFar) break;
+            t = tFar;
         }
+    }
 
-        if (hitT > 0.0) {
-            vec3 pos = ro + rd * hitT;
-            vec3 gP = (pos - uGridStart) * uInvCellSize;
-            
-            vec2 k = vec2(1.0, -1.0);
-            float e = 0.1;
-
-            vec3 normal = normalize(
-                k.xyy * sampleAtlas(gP + k.xyy*e, hitAtlasOff, brickCoord) +
-                k.yyx * sampleAtlas(gP + k.yyx*e, hitAtlasOff, brickCoord) +
-                k.yxy * sampleAtlas(gP + k.yxy*e, hitAtlasOff, brickCoord) +
-                k.xxx * sampleAtlas(gP + k.xxx*e, hitAtlasOff, brickCoord)
-            );
-
-            vec3 material = sampleMaterial(gP, hitAtlasOff, brickCoord);
-            float diffuse = clamp(dot(normal, normalize(vec3(0.7, 0.9, 0.3))), 0.0, 1.0);
-            vec3 ambient  = vec3(0.2, 0.3, 0.4);
-            vec3 sun      = vec3(0.8, 0.7, 0.5);
-
-            //col = material * (dif + 0.15);
-            //col = vec3(0.2, 0.3, 0.4) + dif * vec3(0.8, 0.7, 0.5);           
-            //col = material * (ambient + diffuse * sun);
-            col = ambient + diffuse * sun * normal;
-            //col = ambient + diffuse * sun;
-            
-            /* 
-            ivec3 voxelCoord = ivec3(floor((pos - uGridStart) * uInvCellSize));
-            vec3 brick_color = debugColor(brickCoord);
-            vec3 voxel_color = debugColor(voxelCoord);
-            col = brick_color * (0.6 + 0.3 * voxel_color);
-            */
-        }
+    if (hitT > 0.0) {
+        vec3 pos = ro + rd * hitT;
+        vec3 gP = (pos - uGridStart[hitLevel]) / uCellSize[hitLevel];
+
+        vec2 k = vec2(1.0, -1.0);
+        float e = 0.1;
+
+        vec3 normal = normalize(
+            k.xyy * sampleAtlas(gP + k.xyy*e, hitAtlasOff, brickCoord, hitLevel) +
+            k.yyx * sampleAtlas(gP + k.yyx*e, hitAtlasOff, brickCoord, hitLevel) +
+            k.yxy * sampleAtlas(gP + k.yxy*e, hitAtlasOff, brickCoord, hitLevel) +
+            k.xxx * sampleAtlas(gP + k.xxx*e, hitAtlasOff, brickCoord, hitLevel)
+        );
+
+        vec3 material = sampleMaterial(gP, hitAtlasOff, brickCoord, hitLevel);
+        float diffuse = clamp(dot(normal, normalize(vec3(0.7, 0.9, 0.3))), 0.0, 1.0);
+        vec3 ambient  = vec3(0.2, 0.3, 0.4);
+        vec3 sun      = vec3(0.8, 0.7, 0.5);
+
+        //col = material * (dif + 0.15);
+        //col = vec3(0.2, 0.3, 0.4) + dif * vec3(0.8, 0.7, 0.5);
+        //col = material * (ambient + diffuse * sun);
+        col = ambient + diffuse * sun * normal;
+        //col = ambient + diffuse * sun;
+
+        /*
+        ivec3 voxelCoord = ivec3(floor(gP));
+        vec3 brick_color = debugColor(brickCoord + hitLevel * 4096);
+        vec3 voxel_color = debugColor(voxelCoord);
+        col = brick_color * (0.6 + 0.3 * voxel_color);
+        */
     }
 
     fragColor = vec4(pow(col, vec3(0.4545)), 1.0);
@@ -2,6 +2,7 @@
 #define FATHOM_H
 
 #include "fathom_types.h"
+#include "fathom_job.h"
 
 /* #############################################################################
  * # [SECTION] Platform Input
@@ -88,6 +89,7 @@ typedef struct fathom_platform_window
 typedef u8 (*fathom_platform_api_io_print)(s8 *string);
 typedef u8 (*fathom_platform_api_io_file_size)(s8 *filename, u32 *file_size);
 typedef u8 (*fathom_platform_api_io_file_read)(s8 *filename, u8 *buffer, u32 buffer_size);
+typedef u32 (*fathom_platform_api_processor_count)(void);
 
 typedef struct fathom_platform_api
 {
@@ -95,6 +97,12 @@ typedef struct fathom_platform_api
     fathom_platform_api_io_file_size io_file_size;
     fathom_platform_api_io_file_read io_file_read;
 
+    /* Threading */
+    fathom_platform_api_processor_count processor_count;
+    fathom_job_thread_create thread_create;
+    fathom_job_thread_sleep thread_sleep;
+    fathom_job_system *job_system; /* Started by the platform with processor_count() workers */
+
 } fathom_platform_api;
 
 /* #############################################################################
@@ -108,6 +116,8 @@ u8 fathom_update_stub(fathom_platform_api *api, fathom_platform_window *window,
     api->io_print("  u8 fathom_update(fathom_platform_api *api, fathom_platform_window *window, fathom_platform_input *input)\n  {\n  /* your code */\n  }\n\n");
     api->io_print("[fathom][error]\n");
 
+    (void)input;
+
     window->window_clear_color_r = 1.0f;
     window->window_clear_color_g = 0.0f;
     window->window_clear_color_b = 0.0f;
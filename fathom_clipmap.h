@@ -0,0 +1,137 @@
+#ifndef FATHOM_CLIPMAP_H
+#define FATHOM_CLIPMAP_H
+
+#include "fathom_sparse_grid.h"
+
+/* #############################################################################
+ * # [SECTION] Clipmap
+ * #############################################################################
+ *
+ * Chain of nested sparse grids centred on the camera. Level l has the cell size
+ * cell_size * 2^l and the same number of cells as every other level, so each level
+ * covers twice the extent of the previous one at the same brick map memory.
+ *
+ * Every level is snapped to its own brick lattice (its start is a whole multiple of
+ * its brick size). Once the camera crosses a brick boundary of a level that level is
+ * scrolled by whole bricks and only the newly exposed slabs are evaluated.
+ */
+#define FATHOM_CLIPMAP_MAX_LEVELS 8
+
+#define FATHOM_CLIPMAP_LEVEL_UNCHANGED 0
+#define FATHOM_CLIPMAP_LEVEL_SCROLLED 1
+#define FATHOM_CLIPMAP_LEVEL_REBUILD 2 /* Out of atlas slots or brick map leaves: the level has to be initialized and built with the full passes */
+
+typedef struct fathom_clipmap
+{
+    fathom_sparse_grid levels[FATHOM_CLIPMAP_MAX_LEVELS];
+    i32 brick_origin[FATHOM_CLIPMAP_MAX_LEVELS][3]; /* Lattice coordinate of the local brick (0, 0, 0) per level */
+
+    u32 level_count;
+    u32 cell_count;  /* Cells per axis of every level */
+    f32 cell_size;   /* Cell size of level 0 */
+    u32 index_mode;  /* Brick map index width of every level, the levels share one brick map texture */
+    u32 atlas_max_texture_size; /* Atlas texture limit per axis in voxels, the atlases of all levels are stacked along z in one texture */
+
+} fathom_clipmap;
+
+FATHOM_API FATHOM_INLINE i32 fathom_clipmap_floor(f32 value)
+{
+    return (i32)-fathom_ceilf(-value);
+}
+
+/* Lattice coordinate of the local brick (0, 0, 0) for a level centred on position */
+FATHOM_API void fathom_clipmap_level_origin(fathom_sparse_grid *level, fathom_vec3 position, i32 origin[3])
+{
+    f32 brick_step_inverse = 1.0f / ((f32)FATHOM_BRICK_SIZE * level->cell_size);
+    i32 half = (i32)(level->brick_map_dimensions / 2);
+
+    origin[0] = fathom_clipmap_floor(position.x * brick_step_inverse) - half;
+    origin[1] = fathom_clipmap_floor(position.y * brick_step_inverse) - half;
+    origin[2] = fathom_clipmap_floor(position.z * brick_step_inverse) - half;
+}
+
+FATHOM_API u8 fathom_clipmap_initialize(fathom_clipmap *clipmap, u32 level_count, u32 grid_cell_count, f32 grid_cell_size, u32 index_mode, u32 atlas_max_texture_size)
+{
+    if (level_count < 1 || level_count > FATHOM_CLIPMAP_MAX_LEVELS)
+    {
+        return 0;
+    }
+
+    clipmap->level_count = level_count;
+    clipmap->cell_count = grid_cell_count;
+    clipmap->cell_size = grid_cell_size;
+    clipmap->index_mode = index_mode;
+    clipmap->atlas_max_texture_size = atlas_max_texture_size;
+
+    return 1;
+}
+
+/* Places a level around position. The brick map and atlas of the level still have to be
+ * allocated and filled with the two full passes afterwards.
+ * The brick map offset is the origin modulo the dimension so a brick always lands in the same
+ * storage, no matter if the level got there by scrolling or by a full build.
+ */
+FATHOM_API u8 fathom_clipmap_level_initialize(fathom_clipmap *clipmap, u32 level, fathom_vec3 position)
+{
+    fathom_sparse_grid *grid = &clipmap->levels[level];
+    i32 *origin = clipmap->brick_origin[level];
+    f32 brick_step;
+    u32 dim;
+    u32 axis;
+
+    if (!fathom_sparse_grid_initialize(grid, fathom_vec3_zero, clipmap->cell_count, clipmap->cell_size * (f32)(1u << level), clipmap->index_mode))
+    {
+        return 0;
+    }
+
+    /* Every level gets an equal share of the depth so the stacked atlases always fit */
+    fathom_sparse_grid_atlas_texture_limit(grid, clipmap->atlas_max_texture_size, clipmap->atlas_max_texture_size, clipmap->atlas_max_texture_size / clipmap->level_count);
+
+    fathom_clipmap_level_origin(grid, position, origin);
+
+    brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
+    dim = grid->brick_map_dimensions;
+
+    grid->start = fathom_vec3_init((f32)origin[0] * brick_step, (f32)origin[1] * brick_step, (f32)origin[2] * brick_step);
+    grid->center = fathom_vec3_addf(grid->start, (f32)grid->cell_count * grid->cell_size * 0.5f);
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        i32 remainder = origin[axis] % (i32)dim;
+        grid->brick_map_offset[axis] = (u32)(remainder < 0 ? remainder + (i32)dim : remainder);
+    }
+
+    return 1;
+}
+
+/* Scrolls the level so it is centred on position again, see fathom_sparse_grid_scroll */
+FATHOM_API u8 fathom_clipmap_level_update(fathom_clipmap *clipmap, u32 level, fathom_grid_distance *distance, fathom_vec3 position, fathom_job_system *jobs, fathom_sparse_grid_dirty *dirty)
+{
+    i32 *origin = clipmap->brick_origin[level];
+    i32 origin_new[3];
+    i32 shift[3];
+
+    fathom_clipmap_level_origin(&clipmap->levels[level], position, origin_new);
+
+    shift[0] = origin_new[0] - origin[0];
+    shift[1] = origin_new[1] - origin[1];
+    shift[2] = origin_new[2] - origin[2];
+
+    if (shift[0] == 0 && shift[1] == 0 && shift[2] == 0)
+    {
+        return FATHOM_CLIPMAP_LEVEL_UNCHANGED;
+    }
+
+    origin[0] = origin_new[0];
+    origin[1] = origin_new[1];
+    origin[2] = origin_new[2];
+
+    if (!fathom_sparse_grid_scroll(&clipmap->levels[level], distance, shift, jobs, dirty))
+    {
+        return FATHOM_CLIPMAP_LEVEL_REBUILD;
+    }
+
+    return FATHOM_CLIPMAP_LEVEL_SCROLLED;
+}
+
+#endif /* FATHOM_CLIPMAP_H */
@@ -0,0 +1,376 @@
+#ifndef FATHOM_JOB_H
+#define FATHOM_JOB_H
+
+#include "fathom_types.h"
+
+/* #############################################################################
+ * # [SECTION] Job System Atomics
+ * #############################################################################
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define FATHOM_JOB_ATOMIC_ADD(ptr, value) __sync_add_and_fetch((ptr), (value))
+#define FATHOM_JOB_ATOMIC_CAS(ptr, expected, desired) __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define FATHOM_JOB_ATOMIC_BARRIER() __sync_synchronize()
+#elif defined(_MSC_VER)
+long _InterlockedExchangeAdd(long volatile *addend, long value);
+long _InterlockedCompareExchange(long volatile *destination, long exchange, long comparand);
+void _ReadWriteBarrier(void);
+#pragma intrinsic(_InterlockedExchangeAdd)
+#pragma intrinsic(_InterlockedCompareExchange)
+#pragma intrinsic(_ReadWriteBarrier)
+#define FATHOM_JOB_ATOMIC_ADD(ptr, value) ((u32)_InterlockedExchangeAdd((long volatile *)(ptr), (long)(value)) + (u32)(value))
+#define FATHOM_JOB_ATOMIC_CAS(ptr, expected, desired) (_InterlockedCompareExchange((long volatile *)(ptr), (long)(desired), (long)(expected)) == (long)(expected))
+#define FATHOM_JOB_ATOMIC_BARRIER() _ReadWriteBarrier()
+#else
+#error "fathom_job.h: no atomic primitives available for this compiler"
+#endif
+
+/* Spin wait hint, keeps a waiting thread from starving its hyperthread sibling */
+#if defined(FATHOM_ARCH_X64) && (defined(__GNUC__) || defined(__clang__))
+#include <xmmintrin.h>
+#define FATHOM_JOB_PAUSE() _mm_pause()
+#elif defined(FATHOM_ARCH_X64) && defined(_MSC_VER)
+void _mm_pause(void);
+#pragma intrinsic(_mm_pause)
+#define FATHOM_JOB_PAUSE() _mm_pause()
+#else
+#define FATHOM_JOB_PAUSE()
+#endif
+
+/* #############################################################################
+ * # [SECTION] Job System Platform Callbacks
+ * #############################################################################
+ */
+typedef u32 (*fathom_job_thread_function)(void *argument);
+
+/* Provided by the platform layer (see fathom_platform_api) */
+typedef u8 (*fathom_job_thread_create)(fathom_job_thread_function function, void *argument);
+typedef void (*fathom_job_thread_sleep)(u32 milliseconds);
+
+/* #############################################################################
+ * # [SECTION] Job System
+ * #############################################################################
+ */
+#define FATHOM_JOB_MAX_WORKERS 64      /* Including the submitting (main) thread at index 0 */
+#define FATHOM_JOB_QUEUE_CAPACITY 256  /* Jobs per worker deque, must be a power of two     */
+#define FATHOM_JOB_IDLE_SPIN_COUNT 256 /* Failed steal attempts before a worker sleeps     */
+
+typedef void (*fathom_job_function)(void *data, u32 job_index, u32 worker_index);
+
+typedef struct fathom_job
+{
+    fathom_job_function function;
+    void *data;
+    u32 job_index;
+    volatile u32 *counter; /* Decremented once the job has finished */
+
+} fathom_job;
+
+/* Per worker double ended queue.
+ * The owner pushes and pops at the bottom (LIFO), other workers steal from the top (FIFO).
+ * Jobs are coarse (e.g. one brick slab) so a spin lock per deque is cheap enough.
+ */
+typedef struct fathom_job_queue
+{
+    volatile u32 lock;
+    volatile u32 top;
+    volatile u32 bottom;
+    fathom_job jobs[FATHOM_JOB_QUEUE_CAPACITY];
+
+} fathom_job_queue;
+
+struct fathom_job_system;
+
+typedef struct fathom_job_worker
+{
+    struct fathom_job_system *system;
+    u32 index;
+
+} fathom_job_worker;
+
+typedef struct fathom_job_system
+{
+    fathom_job_queue queues[FATHOM_JOB_MAX_WORKERS];
+    fathom_job_worker workers[FATHOM_JOB_MAX_WORKERS];
+    u32 worker_count; /* Total threads including the main thread */
+
+    volatile u32 running;
+    volatile u32 workers_running; /* Started worker threads that have not left fathom_job_worker_main yet */
+    volatile u32 jobs_pending;    /* Jobs pushed but not yet popped, lets idle workers go to sleep */
+
+    fathom_job_thread_sleep thread_sleep;
+
+} fathom_job_system;
+
+FATHOM_API FATHOM_INLINE void fathom_job_queue_lock(fathom_job_queue *queue)
+{
+    while (!FATHOM_JOB_ATOMIC_CAS(&queue->lock, 0u, 1u))
+    {
+        while (queue->lock)
+        {
+            FATHOM_JOB_PAUSE();
+        }
+    }
+}
+
+FATHOM_API FATHOM_INLINE void fathom_job_queue_unlock(fathom_job_queue *queue)
+{
+    FATHOM_JOB_ATOMIC_BARRIER();
+    queue->lock = 0;
+}
+
+FATHOM_API u8 fathom_job_queue_push(fathom_job_queue *queue, fathom_job *job)
+{
+    u8 pushed = 0;
+
+    fathom_job_queue_lock(queue);
+
+    if (queue->bottom - queue->top < FATHOM_JOB_QUEUE_CAPACITY)
+    {
+        queue->jobs[queue->bottom & (FATHOM_JOB_QUEUE_CAPACITY - 1)] = *job;
+        queue->bottom++;
+        pushed = 1;
+    }
+
+    fathom_job_queue_unlock(queue);
+
+    return pushed;
+}
+
+FATHOM_API u8 fathom_job_queue_pop(fathom_job_queue *queue, fathom_job *job)
+{
+    u8 popped = 0;
+
+    if (queue->bottom == queue->top)
+    {
+        return 0;
+    }
+
+    fathom_job_queue_lock(queue);
+
+    if (queue->bottom != queue->top)
+    {
+        queue->bottom--;
+        *job = queue->jobs[queue->bottom & (FATHOM_JOB_QUEUE_CAPACITY - 1)];
+        popped = 1;
+    }
+
+    fathom_job_queue_unlock(queue);
+
+    return popped;
+}
+
+FATHOM_API u8 fathom_job_queue_steal(fathom_job_queue *queue, fathom_job *job)
+{
+    u8 stolen = 0;
+
+    if (queue->bottom == queue->top)
+    {
+        return 0;
+    }
+
+    fathom_job_queue_lock(queue);
+
+    if (queue->bottom != queue->top)
+    {
+        *job = queue->jobs[queue->top & (FATHOM_JOB_QUEUE_CAPACITY - 1)];
+        queue->top++;
+        stolen = 1;
+    }
+
+    fathom_job_queue_unlock(queue);
+
+    return stolen;
+}
+
+FATHOM_API FATHOM_INLINE void fathom_job_execute(fathom_job *job, u32 worker_index)
+{
+    job->function(job->data, job->job_index, worker_index);
+    FATHOM_JOB_ATOMIC_ADD(job->counter, 0xFFFFFFFFu); /* counter -= 1 */
+}
+
+/* Pops a job from the own deque or steals one from the other workers. Returns 1 if a job was executed. */
+FATHOM_API u8 fathom_job_system_run_one(fathom_job_system *system, u32 worker_index)
+{
+    fathom_job job;
+    u32 i;
+
+    if (!system->jobs_pending)
+    {
+        return 0;
+    }
+
+    if (fathom_job_queue_pop(&system->queues[worker_index], &job))
+    {
+        FATHOM_JOB_ATOMIC_ADD(&system->jobs_pending, 0xFFFFFFFFu);
+        fathom_job_execute(&job, worker_index);
+        return 1;
+    }
+
+    for (i = 1; i < system->worker_count; ++i)
+    {
+        u32 victim = (worker_index + i) % system->worker_count;
+
+        if (fathom_job_queue_steal(&system->queues[victim], &job))
+        {
+            FATHOM_JOB_ATOMIC_ADD(&system->jobs_pending, 0xFFFFFFFFu);
+            fathom_job_execute(&job, worker_index);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+FATHOM_API u32 fathom_job_worker_main(void *argument)
+{
+    fathom_job_worker *worker = (fathom_job_worker *)argument;
+    fathom_job_system *system = worker->system;
+    u32 idle_count = 0;
+
+    while (system->running)
+    {
+        if (fathom_job_system_run_one(system, worker->index))
+        {
+            idle_count = 0;
+        }
+        else if (++idle_count >= FATHOM_JOB_IDLE_SPIN_COUNT)
+        {
+            system->thread_sleep(1);
+            idle_count = 0;
+        }
+        else
+        {
+            system->thread_sleep(0);
+        }
+    }
+
+    FATHOM_JOB_ATOMIC_ADD(&system->workers_running, 0xFFFFFFFFu); /* workers_running -= 1 */
+
+    return 0;
+}
+
+/* Starts worker_count - 1 threads, the calling thread acts as worker 0.
+ * If no threads can be created the system degrades to running every job on the calling thread.
+ */
+FATHOM_API u8 fathom_job_system_initialize(fathom_job_system *system, u32 worker_count, fathom_job_thread_create thread_create, fathom_job_thread_sleep thread_sleep)
+{
+    u32 i;
+
+    if (worker_count < 1)
+    {
+        worker_count = 1;
+    }
+
+    if (worker_count > FATHOM_JOB_MAX_WORKERS)
+    {
+        worker_count = FATHOM_JOB_MAX_WORKERS;
+    }
+
+    system->worker_count = 1;
+    system->running = 1;
+    system->workers_running = 0;
+    system->jobs_pending = 0;
+    system->thread_sleep = thread_sleep;
+
+    system->queues[0].lock = 0;
+    system->queues[0].top = 0;
+    system->queues[0].bottom = 0;
+
+    system->workers[0].system = system;
+    system->workers[0].index = 0;
+
+    if (!thread_create || !thread_sleep)
+    {
+        return 1;
+    }
+
+    for (i = 1; i < worker_count; ++i)
+    {
+        system->queues[i].lock = 0;
+        system->queues[i].top = 0;
+        system->queues[i].bottom = 0;
+
+        system->workers[i].system = system;
+        system->workers[i].index = i;
+
+        /* Publish the queue before the worker can observe it */
+        FATHOM_JOB_ATOMIC_ADD(&system->workers_running, 1u);
+        FATHOM_JOB_ATOMIC_BARRIER();
+
+        if (!thread_create(fathom_job_worker_main, &system->workers[i]))
+        {
+            FATHOM_JOB_ATOMIC_ADD(&system->workers_running, 0xFFFFFFFFu);
+            break;
+        }
+
+        system->worker_count++;
+    }
+
+    return 1;
+}
+
+/* Stops the workers and waits until every one of them has left fathom_job_worker_main.
+ * No parallel_for may be in flight. Afterwards every job runs on the calling thread until the system is initialized again.
+ */
+FATHOM_API void fathom_job_system_shutdown(fathom_job_system *system)
+{
+    system->running = 0;
+    FATHOM_JOB_ATOMIC_BARRIER();
+
+    while (system->workers_running)
+    {
+        system->thread_sleep(1);
+    }
+
+    system->worker_count = 1;
+}
+
+/* Runs function(data, job_index, worker_index) for job_index in [0, job_count) and blocks until all finished.
+ * The calling thread participates in the work. A NULL system runs every job inline.
+ */
+FATHOM_API void fathom_job_system_parallel_for(fathom_job_system *system, fathom_job_function function, void *data, u32 job_count)
+{
+    volatile u32 counter = job_count;
+    u32 i;
+
+    if (!system || system->worker_count < 2 || job_count < 2)
+    {
+        for (i = 0; i < job_count; ++i)
+        {
+            function(data, i, 0);
+        }
+
+        return;
+    }
+
+    for (i = 0; i < job_count; ++i)
+    {
+        fathom_job job;
+        job.function = function;
+        job.data = data;
+        job.job_index = i;
+        job.counter = &counter;
+
+        /* Distribute round robin so workers rarely have to steal on the first pass */
+        FATHOM_JOB_ATOMIC_ADD(&system->jobs_pending, 1u);
+
+        if (!fathom_job_queue_push(&system->queues[i % system->worker_count], &job))
+        {
+            FATHOM_JOB_ATOMIC_ADD(&system->jobs_pending, 0xFFFFFFFFu);
+            fathom_job_execute(&job, 0);
+        }
+    }
+
+    while (counter)
+    {
+        if (!fathom_job_system_run_one(system, 0))
+        {
+            system->thread_sleep(0);
+        }
+    }
+
+    FATHOM_JOB_ATOMIC_BARRIER();
+}
+
+#endif /* FATHOM_JOB_H */
@@ -160,6 +160,28 @@ FATHOM_API FATHOM_INLINE fathom_vec3 fathom_vec3_maxf(fathom_vec3 a, f32 value)
     return result;
 }
 
+FATHOM_API FATHOM_INLINE fathom_vec3 fathom_vec3_min(fathom_vec3 a, fathom_vec3 b)
+{
+    fathom_vec3 result;
+
+    result.x = fathom_minf(a.x, b.x);
+    result.y = fathom_minf(a.y, b.y);
+    result.z = fathom_minf(a.z, b.z);
+
+    return result;
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3 fathom_vec3_max(fathom_vec3 a, fathom_vec3 b)
+{
+    fathom_vec3 result;
+
+    result.x = fathom_maxf(a.x, b.x);
+    result.y = fathom_maxf(a.y, b.y);
+    result.z = fathom_maxf(a.z, b.z);
+
+    return result;
+}
+
 FATHOM_API FATHOM_INLINE f32 fathom_vec3_length(fathom_vec3 a)
 {
     return fathom_sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
@@ -210,6 +210,36 @@ FATHOM_API FATHOM_INLINE fathom_vec3 fathom_vec3_maxf(fathom_vec3 a, f32 value)
     return result;
 }
 
+FATHOM_API FATHOM_INLINE fathom_vec3 fathom_vec3_min(fathom_vec3 a, fathom_vec3 b)
+{
+    fathom_vec3 result;
+
+    __m128 va, vb, res;
+
+    va = _mm_load_ps((const f32 *)&a);
+    vb = _mm_load_ps((const f32 *)&b);
+    res = _mm_min_ps(va, vb);
+
+    _mm_store_ps((f32 *)&result, res);
+
+    return result;
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3 fathom_vec3_max(fathom_vec3 a, fathom_vec3 b)
+{
+    fathom_vec3 result;
+
+    __m128 va, vb, res;
+
+    va = _mm_load_ps((const f32 *)&a);
+    vb = _mm_load_ps((const f32 *)&b);
+    res = _mm_max_ps(va, vb);
+
+    _mm_store_ps((f32 *)&result, res);
+
+    return result;
+}
+
 FATHOM_API FATHOM_INLINE f32 fathom_vec3_dot(fathom_vec3 a, fathom_vec3 b)
 {
     __m128 va, vb, mul, mask, shuf1, sum1, shuf2, sum2;
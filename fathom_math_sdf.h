@@ -3,6 +3,14 @@
 
 #include "fathom_math_linear_algebra.h"
 
+/* #############################################################################
+ * # [SECTION] Signed Distance Functions (SIMD Detection)
+ * #############################################################################
+ */
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+#include "fathom_math_sdf_sse2.h"
+#endif
+
 /* #############################################################################
  * # [SECTION] Signed Distance Functions
  * #############################################################################
@@ -50,11 +58,19 @@ FATHOM_API FATHOM_INLINE f32 fathom_sdf_box_frame(fathom_vec3 position, fathom_v
     return fathom_minf(fathom_minf(l1 + m1, l2 + m2), l3 + m3);
 }
 
+/* Bound: outside k0 * (k0 - 1) / k1, inside (k0 - 1) * smallest radius. The outside term overshoots
+ * the distance towards the center of an elongated ellipsoid, the inside term keeps the gradient <= 1.
+ */
 FATHOM_API FATHOM_INLINE f32 fathom_sdf_ellipsoid(fathom_vec3 position, fathom_vec3 radius)
 {
     f32 k0 = fathom_vec3_length(fathom_vec3_div(position, radius));
     f32 k1 = fathom_vec3_length(fathom_vec3_div(position, fathom_vec3_mul(radius, radius)));
 
+    if (k0 < 1.0f)
+    {
+        return (k0 - 1.0f) * fathom_minf(radius.x, fathom_minf(radius.y, radius.z));
+    }
+
     return k0 * (k0 - 1.0f) / k1;
 }
 
@@ -133,6 +149,18 @@ FATHOM_API FATHOM_INLINE fathom_vec3 fathom_sdf_op_symmetric_xz(fathom_vec3 posi
     return position;
 }
 
+/* #############################################################################
+ * # [SECTION] Signed Distance Operations Rotation
+ * #############################################################################
+ */
+/* matrix: 9 floats, row major, position' = matrix position */
+FATHOM_API FATHOM_INLINE fathom_vec3 fathom_sdf_op_rotate(fathom_vec3 position, f32 *matrix)
+{
+    return fathom_vec3_init((position.x * matrix[0] + position.y * matrix[1]) + position.z * matrix[2],
+                            (position.x * matrix[3] + position.y * matrix[4]) + position.z * matrix[5],
+                            (position.x * matrix[6] + position.y * matrix[7]) + position.z * matrix[8]);
+}
+
 /* #############################################################################
  * # [SECTION] Signed Distance Operations Repetition
  * #############################################################################
@@ -235,4 +263,277 @@ FATHOM_API FATHOM_INLINE fathom_sdf_aabb fathom_sdf_aabb_sphere(fathom_vec3 cent
     return b;
 }
 
+/* #############################################################################
+ * # [SECTION] Signed Distance Intervals
+ * #############################################################################
+ *
+ * Interval arithmetic over a box of positions: every function returns a range [min, max] that
+ * holds the value of its point version for every position inside of the box. Lengths are widened
+ * by the error of fathom_sqrtf, nothing else is rounded outwards: callers that need a hard
+ * guarantee keep a small margin.
+ */
+#define FATHOM_SDF_INTERVAL_SQRT_ERROR 0.002f /* Relative error of fathom_sqrtf without SIMD (one Newton step) */
+
+typedef struct fathom_sdf_interval
+{
+    f32 min;
+    f32 max;
+
+} fathom_sdf_interval;
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_init(f32 min, f32 max)
+{
+    fathom_sdf_interval result;
+    result.min = min;
+    result.max = max;
+    return result;
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_hull(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_init(fathom_minf(a.min, b.min), fathom_maxf(a.max, b.max));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_add(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_init(a.min + b.min, a.max + b.max);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_addf(fathom_sdf_interval a, f32 b)
+{
+    return fathom_sdf_interval_init(a.min + b, a.max + b);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_negate(fathom_sdf_interval a)
+{
+    return fathom_sdf_interval_init(-a.max, -a.min);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_abs(fathom_sdf_interval a)
+{
+    if (a.min >= 0.0f)
+    {
+        return a;
+    }
+
+    if (a.max <= 0.0f)
+    {
+        return fathom_sdf_interval_negate(a);
+    }
+
+    return fathom_sdf_interval_init(0.0f, fathom_maxf(-a.min, a.max));
+}
+
+/* Product of a range and a factor of any sign */
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_mulf(fathom_sdf_interval a, f32 b)
+{
+    return b >= 0.0f ? fathom_sdf_interval_init(a.min * b, a.max * b) : fathom_sdf_interval_init(a.max * b, a.min * b);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_min(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_init(fathom_minf(a.min, b.min), fathom_minf(a.max, b.max));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_max(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_init(fathom_maxf(a.min, b.min), fathom_maxf(a.max, b.max));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_minf(fathom_sdf_interval a, f32 b)
+{
+    return fathom_sdf_interval_init(fathom_minf(a.min, b), fathom_minf(a.max, b));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_maxf(fathom_sdf_interval a, f32 b)
+{
+    return fathom_sdf_interval_init(fathom_maxf(a.min, b), fathom_maxf(a.max, b));
+}
+
+/* Product of two ranges that do not contain negative values */
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_mul_positive(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_init(a.min * b.min, a.max * b.max);
+}
+
+/* Length of a vector with non negative components, e.g. after fathom_sdf_interval_abs */
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_length(fathom_sdf_interval x, fathom_sdf_interval y, fathom_sdf_interval z)
+{
+    f32 min = fathom_sqrtf((x.min * x.min) + (y.min * y.min) + (z.min * z.min));
+    f32 max = fathom_sqrtf((x.max * x.max) + (y.max * y.max) + (z.max * z.max));
+
+    return fathom_sdf_interval_init(min * (1.0f - FATHOM_SDF_INTERVAL_SQRT_ERROR), max * (1.0f + FATHOM_SDF_INTERVAL_SQRT_ERROR));
+}
+
+/* |position| - base per axis of a box relative to the primitive */
+FATHOM_API FATHOM_INLINE void fathom_sdf_interval_abs_sub(fathom_sdf_aabb *box, fathom_vec3 base, fathom_sdf_interval q[3])
+{
+    q[0] = fathom_sdf_interval_addf(fathom_sdf_interval_abs(fathom_sdf_interval_init(box->min.x, box->max.x)), -base.x);
+    q[1] = fathom_sdf_interval_addf(fathom_sdf_interval_abs(fathom_sdf_interval_init(box->min.y, box->max.y)), -base.y);
+    q[2] = fathom_sdf_interval_addf(fathom_sdf_interval_abs(fathom_sdf_interval_init(box->min.z, box->max.z)), -base.z);
+}
+
+/* length(max(q, 0)) + min(max(q.x, max(q.y, q.z)), 0), the exterior and interior terms of the box distances */
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_interval_box_terms(fathom_sdf_interval x, fathom_sdf_interval y, fathom_sdf_interval z)
+{
+    fathom_sdf_interval outside = fathom_sdf_interval_length(fathom_sdf_interval_maxf(x, 0.0f), fathom_sdf_interval_maxf(y, 0.0f), fathom_sdf_interval_maxf(z, 0.0f));
+    fathom_sdf_interval inside = fathom_sdf_interval_minf(fathom_sdf_interval_max(x, fathom_sdf_interval_max(y, z)), 0.0f);
+
+    return fathom_sdf_interval_add(outside, inside);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_sphere_interval(fathom_sdf_aabb box, f32 radius)
+{
+    fathom_sdf_interval q[3];
+
+    fathom_sdf_interval_abs_sub(&box, fathom_vec3_zero, q);
+
+    return fathom_sdf_interval_addf(fathom_sdf_interval_length(q[0], q[1], q[2]), -radius);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_octahedron_interval(fathom_sdf_aabb box, f32 scale)
+{
+    fathom_sdf_interval q[3];
+
+    fathom_sdf_interval_abs_sub(&box, fathom_vec3_zero, q);
+
+    return fathom_sdf_interval_init((q[0].min + q[1].min + q[2].min - scale) * 0.57735027f, (q[0].max + q[1].max + q[2].max - scale) * 0.57735027f);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_box_interval(fathom_sdf_aabb box, fathom_vec3 base)
+{
+    fathom_sdf_interval q[3];
+
+    fathom_sdf_interval_abs_sub(&box, base, q);
+
+    return fathom_sdf_interval_box_terms(q[0], q[1], q[2]);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_box_frame_interval(fathom_sdf_aabb box, fathom_vec3 base, f32 edge_thickness)
+{
+    fathom_sdf_interval p[3];
+    fathom_sdf_interval q[3];
+    u32 axis;
+
+    fathom_sdf_interval_abs_sub(&box, base, p);
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        q[axis] = fathom_sdf_interval_addf(fathom_sdf_interval_abs(fathom_sdf_interval_addf(p[axis], edge_thickness)), -edge_thickness);
+    }
+
+    return fathom_sdf_interval_min(fathom_sdf_interval_min(fathom_sdf_interval_box_terms(p[0], q[1], q[2]),
+                                                           fathom_sdf_interval_box_terms(q[0], p[1], q[2])),
+                                   fathom_sdf_interval_box_terms(q[0], q[1], p[2]));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_ellipsoid_interval(fathom_sdf_aabb box, fathom_vec3 radius)
+{
+    fathom_sdf_interval q[3];
+    fathom_sdf_interval k0, k1;
+    fathom_sdf_interval inside, outside;
+    f32 radius_min = fathom_minf(radius.x, fathom_minf(radius.y, radius.z));
+
+    fathom_sdf_interval_abs_sub(&box, fathom_vec3_zero, q);
+
+    k0 = fathom_sdf_interval_length(fathom_sdf_interval_init(q[0].min / radius.x, q[0].max / radius.x),
+                                    fathom_sdf_interval_init(q[1].min / radius.y, q[1].max / radius.y),
+                                    fathom_sdf_interval_init(q[2].min / radius.z, q[2].max / radius.z));
+    k1 = fathom_sdf_interval_length(fathom_sdf_interval_init(q[0].min / (radius.x * radius.x), q[0].max / (radius.x * radius.x)),
+                                    fathom_sdf_interval_init(q[1].min / (radius.y * radius.y), q[1].max / (radius.y * radius.y)),
+                                    fathom_sdf_interval_init(q[2].min / (radius.z * radius.z), q[2].max / (radius.z * radius.z)));
+
+    /* Inside (k0 < 1): (k0 - 1) * smallest radius */
+    inside = fathom_sdf_interval_init((k0.min - 1.0f) * radius_min, (fathom_minf(k0.max, 1.0f) - 1.0f) * radius_min);
+
+    if (k0.max < 1.0f)
+    {
+        return inside;
+    }
+
+    /* Outside (k0 >= 1): k0 * (k0 - 1) / k1 with a non negative numerator. k1 >= k0 / largest radius
+     * keeps the denominator away from 0 once k0 >= 1.
+     */
+    k1.min = fathom_maxf(k1.min, 1.0f / fathom_maxf(radius.x, fathom_maxf(radius.y, radius.z)));
+    outside = fathom_sdf_interval_init(fathom_maxf(k0.min, 1.0f), k0.max);
+    outside = fathom_sdf_interval_mul_positive(outside, fathom_sdf_interval_addf(outside, -1.0f));
+    outside = fathom_sdf_interval_init(outside.min / k1.max, outside.max / k1.min);
+
+    return k0.min >= 1.0f ? outside : fathom_sdf_interval_hull(inside, outside);
+}
+
+/* The exact operations are min / max compositions. The smooth union never decreases when either
+ * argument grows, so its range comes from the lower and upper ends of the argument ranges.
+ */
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_union_interval(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_min(a, b);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_subtract_interval(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_max(fathom_sdf_interval_negate(a), b);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_intersect_interval(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_max(a, b);
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_xor_interval(fathom_sdf_interval a, fathom_sdf_interval b)
+{
+    return fathom_sdf_interval_max(fathom_sdf_interval_min(a, b), fathom_sdf_interval_negate(fathom_sdf_interval_max(a, b)));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_union_smooth_interval(fathom_sdf_interval a, fathom_sdf_interval b, f32 k)
+{
+    return fathom_sdf_interval_init(fathom_sdf_op_union_smooth(a.min, b.min, k), fathom_sdf_op_union_smooth(a.max, b.max, k));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_subtract_smooth_interval(fathom_sdf_interval a, fathom_sdf_interval b, f32 k)
+{
+    return fathom_sdf_interval_negate(fathom_sdf_op_union_smooth_interval(a, fathom_sdf_interval_negate(b), k));
+}
+
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_op_intersect_smooth_interval(fathom_sdf_interval a, fathom_sdf_interval b, f32 k)
+{
+    return fathom_sdf_interval_negate(fathom_sdf_op_union_smooth_interval(fathom_sdf_interval_negate(a), fathom_sdf_interval_negate(b), k));
+}
+
+/* Box around fathom_sdf_op_rotate of every position of box, each row summed in the same order */
+FATHOM_API FATHOM_INLINE fathom_sdf_aabb fathom_sdf_interval_rotate(fathom_sdf_aabb box, f32 *matrix)
+{
+    fathom_sdf_interval x = fathom_sdf_interval_init(box.min.x, box.max.x);
+    fathom_sdf_interval y = fathom_sdf_interval_init(box.min.y, box.max.y);
+    fathom_sdf_interval z = fathom_sdf_interval_init(box.min.z, box.max.z);
+    fathom_sdf_interval row[3];
+    fathom_sdf_aabb result;
+    u32 i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        row[i] = fathom_sdf_interval_add(fathom_sdf_interval_add(fathom_sdf_interval_mulf(x, matrix[i * 3 + 0]), fathom_sdf_interval_mulf(y, matrix[i * 3 + 1])), fathom_sdf_interval_mulf(z, matrix[i * 3 + 2]));
+    }
+
+    result.min = fathom_vec3_init(row[0].min, row[1].min, row[2].min);
+    result.max = fathom_vec3_init(row[0].max, row[1].max, row[2].max);
+
+    return result;
+}
+
+/* Range of fathom_sdf_aabb_distance (squared) over the positions of query */
+FATHOM_API FATHOM_INLINE fathom_sdf_interval fathom_sdf_aabb_distance_interval(fathom_sdf_aabb *query, fathom_sdf_aabb *box)
+{
+    /* Gap per axis: 0 where the ranges overlap, largest at one of the query ends */
+    f32 gap_min_x = fathom_maxf(fathom_maxf(box->min.x - query->max.x, query->min.x - box->max.x), 0.0f);
+    f32 gap_min_y = fathom_maxf(fathom_maxf(box->min.y - query->max.y, query->min.y - box->max.y), 0.0f);
+    f32 gap_min_z = fathom_maxf(fathom_maxf(box->min.z - query->max.z, query->min.z - box->max.z), 0.0f);
+    f32 gap_max_x = fathom_maxf(fathom_maxf(box->min.x - query->min.x, query->max.x - box->max.x), 0.0f);
+    f32 gap_max_y = fathom_maxf(fathom_maxf(box->min.y - query->min.y, query->max.y - box->max.y), 0.0f);
+    f32 gap_max_z = fathom_maxf(fathom_maxf(box->min.z - query->min.z, query->max.z - box->max.z), 0.0f);
+
+    return fathom_sdf_interval_init((gap_min_x * gap_min_x) + (gap_min_y * gap_min_y) + (gap_min_z * gap_min_z),
+                                    (gap_max_x * gap_max_x) + (gap_max_y * gap_max_y) + (gap_max_z * gap_max_z));
+}
+
 #endif /* FATHOM_MATH_SDF_H */
\ No newline at end of file
@@ -0,0 +1,286 @@
+#ifndef FATHOM_MATH_SDF_SSE2_H
+#define FATHOM_MATH_SDF_SSE2_H
+
+#include "fathom_math_linear_algebra.h"
+
+/* #############################################################################
+ * # [SECTION] Signed Distance Functions (SSE2, 4 points at once)
+ * #############################################################################
+ *
+ * Struct of arrays counterparts of the scalar functions in fathom_math_sdf.h.
+ * Every function performs the same operations in the same order as its scalar
+ * version so both produce bit identical distances.
+ * Primitive parameters are per lane: splatted for 4 points of one primitive,
+ * loaded from struct of arrays storage for one point and 4 primitives.
+ */
+#include <emmintrin.h>
+
+typedef struct fathom_vec3x4
+{
+    __m128 x;
+    __m128 y;
+    __m128 z;
+
+} fathom_vec3x4;
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_vec3x4_load(f32 *x, f32 *y, f32 *z)
+{
+    fathom_vec3x4 result;
+
+    result.x = _mm_loadu_ps(x);
+    result.y = _mm_loadu_ps(y);
+    result.z = _mm_loadu_ps(z);
+
+    return result;
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_vec3x4_set1(f32 x, f32 y, f32 z)
+{
+    fathom_vec3x4 result;
+
+    result.x = _mm_set1_ps(x);
+    result.y = _mm_set1_ps(y);
+    result.z = _mm_set1_ps(z);
+
+    return result;
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_vec3x4_sub_vec3(fathom_vec3x4 a, fathom_vec3 b)
+{
+    fathom_vec3x4 result;
+
+    result.x = _mm_sub_ps(a.x, _mm_set1_ps(b.x));
+    result.y = _mm_sub_ps(a.y, _mm_set1_ps(b.y));
+    result.z = _mm_sub_ps(a.z, _mm_set1_ps(b.z));
+
+    return result;
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_absf_x4(__m128 a)
+{
+    return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_negf_x4(__m128 a)
+{
+    return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32((i32)0x80000000)));
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_vec3x4_abs(fathom_vec3x4 a)
+{
+    a.x = fathom_absf_x4(a.x);
+    a.y = fathom_absf_x4(a.y);
+    a.z = fathom_absf_x4(a.z);
+
+    return a;
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_lengthf_x4(__m128 x, __m128 y, __m128 z)
+{
+    /* (x*x + y*y) + z*z like the horizontal add in fathom_vec3_length */
+    return _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_sphere_x4(fathom_vec3x4 position, __m128 radius)
+{
+    return _mm_sub_ps(fathom_lengthf_x4(position.x, position.y, position.z), radius);
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_octahedron_x4(fathom_vec3x4 position, __m128 scale)
+{
+    __m128 sum;
+
+    position = fathom_vec3x4_abs(position);
+    sum = _mm_add_ps(_mm_add_ps(position.x, position.y), position.z);
+
+    return _mm_mul_ps(_mm_sub_ps(sum, scale), _mm_set1_ps(0.57735027f));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_box_x4(fathom_vec3x4 position, fathom_vec3x4 base)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 qx = _mm_sub_ps(fathom_absf_x4(position.x), base.x);
+    __m128 qy = _mm_sub_ps(fathom_absf_x4(position.y), base.y);
+    __m128 qz = _mm_sub_ps(fathom_absf_x4(position.z), base.z);
+
+    __m128 l = fathom_lengthf_x4(_mm_max_ps(qx, zero), _mm_max_ps(qy, zero), _mm_max_ps(qz, zero));
+    __m128 m = _mm_min_ps(_mm_max_ps(qx, _mm_max_ps(qy, qz)), zero);
+
+    return _mm_add_ps(l, m);
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_box_frame_x4(fathom_vec3x4 position, fathom_vec3x4 base, __m128 edge_thickness)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 e = edge_thickness;
+
+    __m128 px = _mm_sub_ps(fathom_absf_x4(position.x), base.x);
+    __m128 py = _mm_sub_ps(fathom_absf_x4(position.y), base.y);
+    __m128 pz = _mm_sub_ps(fathom_absf_x4(position.z), base.z);
+
+    __m128 qx = _mm_sub_ps(fathom_absf_x4(_mm_add_ps(px, e)), e);
+    __m128 qy = _mm_sub_ps(fathom_absf_x4(_mm_add_ps(py, e)), e);
+    __m128 qz = _mm_sub_ps(fathom_absf_x4(_mm_add_ps(pz, e)), e);
+
+    __m128 l1 = fathom_lengthf_x4(_mm_max_ps(px, zero), _mm_max_ps(qy, zero), _mm_max_ps(qz, zero));
+    __m128 l2 = fathom_lengthf_x4(_mm_max_ps(qx, zero), _mm_max_ps(py, zero), _mm_max_ps(qz, zero));
+    __m128 l3 = fathom_lengthf_x4(_mm_max_ps(qx, zero), _mm_max_ps(qy, zero), _mm_max_ps(pz, zero));
+
+    __m128 m1 = _mm_min_ps(_mm_max_ps(px, _mm_max_ps(qy, qz)), zero);
+    __m128 m2 = _mm_min_ps(_mm_max_ps(qx, _mm_max_ps(py, qz)), zero);
+    __m128 m3 = _mm_min_ps(_mm_max_ps(qx, _mm_max_ps(qy, pz)), zero);
+
+    return _mm_min_ps(_mm_min_ps(_mm_add_ps(l1, m1), _mm_add_ps(l2, m2)), _mm_add_ps(l3, m3));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_ellipsoid_x4(fathom_vec3x4 position, fathom_vec3x4 radius)
+{
+    __m128 rx = radius.x;
+    __m128 ry = radius.y;
+    __m128 rz = radius.z;
+
+    __m128 k0 = fathom_lengthf_x4(_mm_div_ps(position.x, rx), _mm_div_ps(position.y, ry), _mm_div_ps(position.z, rz));
+    __m128 k1 = fathom_lengthf_x4(_mm_div_ps(position.x, _mm_mul_ps(rx, rx)), _mm_div_ps(position.y, _mm_mul_ps(ry, ry)), _mm_div_ps(position.z, _mm_mul_ps(rz, rz)));
+    __m128 k0_minus_one = _mm_sub_ps(k0, _mm_set1_ps(1.0f));
+
+    /* Inside: (k0 - 1) * smallest radius, see fathom_sdf_ellipsoid */
+    __m128 inside = _mm_cmplt_ps(k0, _mm_set1_ps(1.0f));
+    __m128 d_inside = _mm_mul_ps(k0_minus_one, _mm_min_ps(rx, _mm_min_ps(ry, rz)));
+    __m128 d_outside = _mm_div_ps(_mm_mul_ps(k0, k0_minus_one), k1);
+
+    return _mm_or_ps(_mm_and_ps(inside, d_inside), _mm_andnot_ps(inside, d_outside));
+}
+
+/* #############################################################################
+ * # [SECTION] Signed Distance Operations (SSE2, 4 points at once)
+ * #############################################################################
+ */
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_union_x4(__m128 a, __m128 b)
+{
+    return _mm_min_ps(a, b);
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_subtract_x4(__m128 a, __m128 b)
+{
+    return _mm_max_ps(fathom_negf_x4(a), b);
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_intersect_x4(__m128 a, __m128 b)
+{
+    return _mm_max_ps(a, b);
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_xor_x4(__m128 a, __m128 b)
+{
+    return _mm_max_ps(_mm_min_ps(a, b), fathom_negf_x4(_mm_max_ps(a, b)));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_union_smooth_x4(__m128 a, __m128 b, f32 k)
+{
+    __m128 vk = _mm_set1_ps(k);
+    __m128 h = _mm_div_ps(_mm_max_ps(_mm_sub_ps(vk, fathom_absf_x4(_mm_sub_ps(a, b))), _mm_setzero_ps()), vk);
+    __m128 hhhk = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(h, h), h), vk);
+
+    return _mm_sub_ps(_mm_min_ps(a, b), _mm_mul_ps(hhhk, _mm_set1_ps(1.0f / 6.0f)));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_subtract_smooth_x4(__m128 a, __m128 b, f32 k)
+{
+    return fathom_negf_x4(fathom_sdf_op_union_smooth_x4(a, fathom_negf_x4(b), k));
+}
+
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_op_intersect_smooth_x4(__m128 a, __m128 b, f32 k)
+{
+    return fathom_negf_x4(fathom_sdf_op_union_smooth_x4(fathom_negf_x4(a), fathom_negf_x4(b), k));
+}
+
+/* #############################################################################
+ * # [SECTION] Signed Distance Operations Symmetry, Rotation and Repetition (SSE2, 4 points at once)
+ * #############################################################################
+ */
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_sdf_op_symmetric_x_x4(fathom_vec3x4 position)
+{
+    position.x = fathom_absf_x4(position.x);
+    return position;
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_sdf_op_symmetric_xz_x4(fathom_vec3x4 position)
+{
+    position.x = fathom_absf_x4(position.x);
+    position.z = fathom_absf_x4(position.z);
+    return position;
+}
+
+/* matrix: 9 entries, row major (per lane like the primitive parameters) */
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_sdf_op_rotate_x4(fathom_vec3x4 position, __m128 *matrix)
+{
+    fathom_vec3x4 result;
+
+    result.x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(position.x, matrix[0]), _mm_mul_ps(position.y, matrix[1])), _mm_mul_ps(position.z, matrix[2]));
+    result.y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(position.x, matrix[3]), _mm_mul_ps(position.y, matrix[4])), _mm_mul_ps(position.z, matrix[5]));
+    result.z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(position.x, matrix[6]), _mm_mul_ps(position.y, matrix[7])), _mm_mul_ps(position.z, matrix[8]));
+
+    return result;
+}
+
+/* (f32)(i32)(ratio + (ratio >= 0 ? 0.5 : -0.5)) like fathom_sdf_op_repeat */
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_round_away_x4(__m128 ratio)
+{
+    __m128 positive = _mm_cmpge_ps(ratio, _mm_setzero_ps());
+    __m128 half = _mm_or_ps(_mm_and_ps(positive, _mm_set1_ps(0.5f)), _mm_andnot_ps(positive, _mm_set1_ps(-0.5f)));
+
+    return _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_add_ps(ratio, half)));
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_sdf_op_repeat_x4(fathom_vec3x4 position, fathom_vec3 spacing)
+{
+    __m128 sx = _mm_set1_ps(spacing.x);
+    __m128 sy = _mm_set1_ps(spacing.y);
+    __m128 sz = _mm_set1_ps(spacing.z);
+    fathom_vec3x4 q;
+
+    /* q = p - s * round(p / s) */
+    q.x = _mm_sub_ps(position.x, _mm_mul_ps(sx, fathom_sdf_round_away_x4(_mm_div_ps(position.x, sx))));
+    q.y = _mm_sub_ps(position.y, _mm_mul_ps(sy, fathom_sdf_round_away_x4(_mm_div_ps(position.y, sy))));
+    q.z = _mm_sub_ps(position.z, _mm_mul_ps(sz, fathom_sdf_round_away_x4(_mm_div_ps(position.z, sz))));
+
+    return q;
+}
+
+/* fathom_roundf and fathom_clampf of the SSE2 build: round to nearest even, then max before min */
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_round_clamp_x4(__m128 ratio, f32 limit)
+{
+    __m128 rounded = _mm_cvtepi32_ps(_mm_cvtps_epi32(ratio));
+
+    return _mm_min_ps(_mm_max_ps(rounded, _mm_set1_ps(-limit)), _mm_set1_ps(limit));
+}
+
+FATHOM_API FATHOM_INLINE fathom_vec3x4 fathom_sdf_op_repeat_limited_x4(fathom_vec3x4 position, f32 spacing, fathom_vec3 limits)
+{
+    __m128 s = _mm_set1_ps(spacing);
+    fathom_vec3x4 q;
+
+    /* q = p - s * clamp(round(p / s), -l, l) */
+    q.x = _mm_sub_ps(position.x, _mm_mul_ps(s, fathom_sdf_round_clamp_x4(_mm_div_ps(position.x, s), limits.x)));
+    q.y = _mm_sub_ps(position.y, _mm_mul_ps(s, fathom_sdf_round_clamp_x4(_mm_div_ps(position.y, s), limits.y)));
+    q.z = _mm_sub_ps(position.z, _mm_mul_ps(s, fathom_sdf_round_clamp_x4(_mm_div_ps(position.z, s), limits.z)));
+
+    return q;
+}
+
+/* #############################################################################
+ * # [SECTION] Signed Distance Axis Aligned Bounding Boxes (SSE2, 4 points at once)
+ * #############################################################################
+ */
+FATHOM_API FATHOM_INLINE __m128 fathom_sdf_aabb_distance_x4(fathom_vec3x4 position, fathom_vec3 box_min, fathom_vec3 box_max)
+{
+    __m128 zero = _mm_setzero_ps();
+
+    __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(box_min.x), position.x), _mm_sub_ps(position.x, _mm_set1_ps(box_max.x))), zero);
+    __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(box_min.y), position.y), _mm_sub_ps(position.y, _mm_set1_ps(box_max.y))), zero);
+    __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(box_min.z), position.z), _mm_sub_ps(position.z, _mm_set1_ps(box_max.z))), zero);
+
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+}
+
+#endif /* FATHOM_MATH_SDF_SSE2_H */
@@ -10,6 +10,7 @@
 #define GL_TRUE 1
 #define GL_FALSE 0
 #define GL_UNSIGNED_SHORT 0x1403
+#define GL_UNSIGNED_INT 0x1405
 #define GL_FLOAT 0x1406
 #define GL_TRIANGLES 0x0004
 #define GL_TRIANGLE_FAN 0x0006
@@ -45,6 +46,8 @@
 #define GL_CLAMP_TO_EDGE 0x812F
 #define GL_PACK_ALIGNMENT 0x0D05
 #define GL_UNPACK_ALIGNMENT 0x0CF5
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#define GL_UNPACK_IMAGE_HEIGHT 0x806E
 #define GL_RGB 0x1907
 #define GL_RGB8 0x8051
 #define GL_RED 0x1903
@@ -53,10 +56,14 @@
 #define GL_R8UI 0x8232
 #define GL_R8_SNORM 0x8F94
 #define GL_R16UI 0x8234
+#define GL_R32UI 0x8236
 #define GL_TEXTURE0 0x84C0
 #define GL_TEXTURE1 0x84C1
 #define GL_TEXTURE2 0x84C2
 #define GL_TEXTURE3 0x84C3
+#define GL_TEXTURE4 0x84C4
+#define GL_TEXTURE5 0x84C5
+#define GL_TEXTURE6 0x84C6
 #define GL_BLEND 0x0BE2
 #define GL_SRC_ALPHA 0x0302
 #define GL_ONE_MINUS_SRC_ALPHA 0x0303
@@ -166,12 +173,24 @@ static PFNGLUNIFORM1FPROC glUniform1f;
 typedef void (*PFNGLUNIFORM1IPROC)(i32 location, i32 v0);
 static PFNGLUNIFORM1IPROC glUniform1i;
 
+typedef void (*PFNGLUNIFORM1FVPROC)(i32 location, i32 count, f32 *value);
+static PFNGLUNIFORM1FVPROC glUniform1fv;
+
+typedef void (*PFNGLUNIFORM1IVPROC)(i32 location, i32 count, i32 *value);
+static PFNGLUNIFORM1IVPROC glUniform1iv;
+
 typedef void (*PFNGLUNIFORM3FPROC)(i32 location, f32 v0, f32 v1, f32 v2);
 static PFNGLUNIFORM3FPROC glUniform3f;
 
 typedef void (*PFNGLUNIFORM3IPROC)(i32 location, i32 v0, i32 v1, i32 v2);
 static PFNGLUNIFORM3IPROC glUniform3i;
 
+typedef void (*PFNGLUNIFORM3FVPROC)(i32 location, i32 count, f32 *value);
+static PFNGLUNIFORM3FVPROC glUniform3fv;
+
+typedef void (*PFNGLUNIFORM3IVPROC)(i32 location, i32 count, i32 *value);
+static PFNGLUNIFORM3IVPROC glUniform3iv;
+
 typedef void (*PFNGLUNIFORM4FPROC)(i32 location, f32 v0, f32 v1, f32 v2, f32 v3);
 static PFNGLUNIFORM4FPROC glUniform4f;
 
@@ -187,6 +206,9 @@ static PFNGLACTIVETEXTUREPROC glActiveTexture;
 typedef void (*PFNGLTEXIMAGE3DPROC)(u32 target, i32 level, i32 internalFormat, i32 width, i32 height, i32 depth, i32 border, u32 format, u32 type, void *data);
 static PFNGLTEXIMAGE3DPROC glTexImage3D;
 
+typedef void (*PFNGLTEXSUBIMAGE3DPROC)(u32 target, i32 level, i32 xoffset, i32 yoffset, i32 zoffset, i32 width, i32 height, i32 depth, u32 format, u32 type, void *data);
+static PFNGLTEXSUBIMAGE3DPROC glTexSubImage3D;
+
 typedef void (*PFNGLGENBUFFERSPROC)(i32 n, u32 *buffers);
 static PFNGLGENBUFFERSPROC glGenBuffers;
 
@@ -271,13 +293,18 @@ FATHOM_API FATHOM_INLINE u8 fathom_opengl_load_functions(fathom_opengl_function_
     glGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC)load("glGetUniformLocation");
     glUniform1f = (PFNGLUNIFORM1FPROC)load("glUniform1f");
     glUniform1i = (PFNGLUNIFORM1IPROC)load("glUniform1i");
+    glUniform1fv = (PFNGLUNIFORM1FVPROC)load("glUniform1fv");
+    glUniform1iv = (PFNGLUNIFORM1IVPROC)load("glUniform1iv");
     glUniform3f = (PFNGLUNIFORM3FPROC)load("glUniform3f");
     glUniform3i = (PFNGLUNIFORM3IPROC)load("glUniform3i");
+    glUniform3fv = (PFNGLUNIFORM3FVPROC)load("glUniform3fv");
+    glUniform3iv = (PFNGLUNIFORM3IVPROC)load("glUniform3iv");
     glUniform4f = (PFNGLUNIFORM4FPROC)load("glUniform4f");
     glUniform4fv = (PFNGLUNIFORM4FVPROC)load("glUniform4fv");
     glUniformMatrix4fv = (PFNGLUNIFORMMATRIX4FVPROC)load("glUniformMatrix4fv");
     glActiveTexture = (PFNGLACTIVETEXTUREPROC)load("glActiveTexture");
     glTexImage3D = (PFNGLTEXIMAGE3DPROC)load("glTexImage3D");
+    glTexSubImage3D = (PFNGLTEXSUBIMAGE3DPROC)load("glTexSubImage3D");
     glGenBuffers = (PFNGLGENBUFFERSPROC)load("glGenBuffers");
     glBindBuffer = (PFNGLBINDBUFFERPROC)load("glBindBuffer");
     glBufferData = (PFNGLBUFFERDATAPROC)load("glBufferData");
@@ -0,0 +1,1370 @@
+#ifndef FATHOM_RAYMARCH_H
+#define FATHOM_RAYMARCH_H
+
+#include "fathom_types.h"
+#include "fathom_clipmap.h"
+
+/* #############################################################################
+ * # [SECTION] Software Raymarcher
+ * #############################################################################
+ *
+ * CPU version of mainImage in fathom.fs for hosts without a GPU: renders a clipmap into an
+ * RGB framebuffer with the brick DDA, the empty block skipping and the sphere tracing of the
+ * shader, reading the brick maps and s8 atlases of the levels directly.
+ *
+ * The image is cut into tiles that run as jobs. Every ray is a small state machine that
+ * stops whenever it needs an atlas sample, so a packet of 2x2 rays can run its traversal
+ * lane by lane and evaluate the trilinear samples of all waiting lanes at once with SSE2.
+ * Packets and single rays produce the same image.
+ *
+ * The texture unit is mirrored as it is set up by the shader: the atlas coordinate of a
+ * sample is offset by the apron voxel, so after the half texel of linear filtering the
+ * voxel coordinate is local + 0.5 (the lattice point of voxel i is at local i - 1, see
+ * fathom_sparse_grid_trace_sample). A solid brick hit shades from the atlas origin of its
+ * level like the shader does. USEFUL entries (only seen while a level is being filled) count as air.
+ */
+#define FATHOM_RAYMARCH_TILE_SIZE 16         /* Pixels per tile side, a multiple of the 2x2 packets */
+#define FATHOM_RAYMARCH_BRICK_STEPS 48       /* Brick DDA iterations per level, as in the shader */
+#define FATHOM_RAYMARCH_SPHERE_STEPS 32      /* Sphere tracing steps per brick, as in the shader */
+#define FATHOM_RAYMARCH_EPSILON 0.01f        /* Hit distance and level entry offset (EPS of the shader) */
+#define FATHOM_RAYMARCH_NORMAL_OFFSET 0.1f   /* Tetrahedron offset of the normal in voxels */
+#define FATHOM_RAYMARCH_VOXEL_MAX 8.999f     /* Last voxel coordinate a trilinear sample may start at, its neighbour is the far apron */
+#define FATHOM_RAYMARCH_GAMMA_ENTRIES 1024   /* Gamma table indexed by the square root of the colour */
+
+#define FATHOM_RAYMARCH_STATE_LEVEL 0        /* Clip against the next level */
+#define FATHOM_RAYMARCH_STATE_BRICK 1        /* Read the brick of the DDA */
+#define FATHOM_RAYMARCH_STATE_SAMPLE 2       /* Waits for the atlas distance at position */
+#define FATHOM_RAYMARCH_STATE_STEP 3         /* Step into the next brick */
+#define FATHOM_RAYMARCH_STATE_HIT 4
+#define FATHOM_RAYMARCH_STATE_MISS 5
+
+typedef struct fathom_raymarch_camera
+{
+    fathom_vec3 position;
+    fathom_vec3 right;
+    fathom_vec3 up;
+    fathom_vec3 forward_scaled; /* Forward times the field of view factor */
+
+} fathom_raymarch_camera;
+
+/* Shader uniforms of one clipmap level */
+typedef struct fathom_raymarch_level
+{
+    fathom_sparse_grid *grid;
+    f32 start[3];
+    f32 extent;         /* Brick map dimension * FATHOM_BRICK_SIZE * cell_size */
+    f32 cell_size;
+    f32 cell_size_inverse;
+    f32 distance_scale; /* truncation_distance / 127: atlas value to distance */
+    u32 atlas_row;      /* Atlas voxels per row */
+    u32 atlas_slice;    /* Atlas voxels per slice */
+
+} fathom_raymarch_level;
+
+typedef struct fathom_raymarch_stats
+{
+    u32 rays;
+    u32 hits;
+    u32 bricks;        /* Brick map entries read by the DDA */
+    u32 samples;       /* Trilinear atlas samples while sphere tracing */
+    u32 brick_limits;  /* Traversals that ran out of iterations: the brick DDA of a level, or the whole march */
+    u32 sphere_limits; /* Bricks whose sphere tracing ran out of steps */
+
+    u32 padding[10]; /* One cache line per worker */
+
+} fathom_raymarch_stats;
+
+typedef struct fathom_raymarch_ray
+{
+    f32 origin[3];
+    f32 direction[3];
+    f32 direction_inverse[3];
+    f32 direction_sign[3];     /* -1, 0 or 1 */
+    f32 direction_positive[3]; /* max(sign, 0) */
+
+    /* Brick DDA through the current level */
+    f32 direction_grid[3];
+    f32 t_delta[3];
+    f32 t_max[3];
+    i32 brick[3];
+    f32 t;
+    f32 t_end;
+    f32 t_ray; /* Far end of the last traced level */
+    u32 level;
+    u32 brick_step;
+
+    /* Sphere tracing inside the current brick, the hit keeps the brick and atlas of the last sample */
+    f32 position[3]; /* Grid position of the pending sample */
+    f32 t_local;
+    f32 t_brick_exit;
+    u32 sphere_step;
+    s8 *atlas;       /* First voxel of the physical brick */
+    f32 atlas_bias;  /* Added to the local position: 0.5 for a brick, -0.5 for the atlas origin */
+    u32 atlas_row;
+    u32 atlas_slice;
+    f32 distance_scale;
+
+    f32 t_hit;
+    u32 state;
+    u8 skip_air; /* Jump over the cube of air bricks of the air distance map, empty blocks only otherwise */
+
+} fathom_raymarch_ray;
+
+typedef struct fathom_raymarch
+{
+    fathom_clipmap *clipmap;
+    fathom_raymarch_level levels[FATHOM_CLIPMAP_MAX_LEVELS];
+    fathom_raymarch_camera camera;
+
+    u8 *pixels; /* width * height * 3 bytes (RGB), top row first */
+    u32 width;
+    u32 height;
+    u32 tile_columns;
+    u32 tile_rows;
+    u8 packets; /* Trace 2x2 packets with SSE2, single rays otherwise or without SIMD */
+
+    f32 light[3]; /* normalize(0.7, 0.9, 0.3) */
+    u8 gamma[FATHOM_RAYMARCH_GAMMA_ENTRIES];
+
+    fathom_raymarch_stats worker_stats[FATHOM_JOB_MAX_WORKERS];
+    fathom_raymarch_stats stats; /* Totals of the last render */
+
+} fathom_raymarch;
+
+/* pixels holds width * height RGB pixels and is provided by the caller */
+FATHOM_API void fathom_raymarch_initialize(fathom_raymarch *raymarch, fathom_clipmap *clipmap, u8 *pixels, u32 width, u32 height)
+{
+    f32 light_length = fathom_sqrtf((0.7f * 0.7f) + (0.9f * 0.9f) + (0.3f * 0.3f));
+    u32 i;
+
+    raymarch->clipmap = clipmap;
+    raymarch->pixels = pixels;
+    raymarch->width = width;
+    raymarch->height = height;
+    raymarch->tile_columns = (width + FATHOM_RAYMARCH_TILE_SIZE - 1) / FATHOM_RAYMARCH_TILE_SIZE;
+    raymarch->tile_rows = (height + FATHOM_RAYMARCH_TILE_SIZE - 1) / FATHOM_RAYMARCH_TILE_SIZE;
+    raymarch->packets = 1;
+
+    raymarch->light[0] = 0.7f / light_length;
+    raymarch->light[1] = 0.9f / light_length;
+    raymarch->light[2] = 0.3f / light_length;
+
+    /* pow(c, 0.4545) with 0.4545 ~ 5 / 11: entry i holds (s^2)^(5 / 11) = y with y^11 = s^10 for s = i / (entries - 1).
+     * Newton from y = 1 decreases monotonically towards the root, it stops once a step no longer does.
+     */
+    for (i = 0; i < FATHOM_RAYMARCH_GAMMA_ENTRIES; ++i)
+    {
+        f32 s = (f32)i / (f32)(FATHOM_RAYMARCH_GAMMA_ENTRIES - 1);
+        f32 s10 = s * s * s * s * s * s * s * s * s * s;
+        f32 y = i ? 1.0f : 0.0f;
+        u32 k;
+
+        for (k = 0; k < 128 && y > 0.0f; ++k)
+        {
+            f32 y10 = y * y * y * y * y * y * y * y * y * y;
+            f32 next = y - (((y10 * y) - s10) / (11.0f * y10));
+
+            if (!(next < y))
+            {
+                break;
+            }
+
+            y = next;
+        }
+
+        raymarch->gamma[i] = (u8)((fathom_clampf(y, 0.0f, 1.0f) * 255.0f) + 0.5f);
+    }
+}
+
+/* Colour in [0, 1] (anything else is clamped, NaN turns black) to the gamma corrected byte */
+FATHOM_API FATHOM_INLINE u8 fathom_raymarch_gamma(fathom_raymarch *raymarch, f32 value)
+{
+    value = value > 0.0f ? value : 0.0f;
+    value = value < 1.0f ? value : 1.0f;
+
+    return raymarch->gamma[(u32)((fathom_sqrtf(value) * (f32)(FATHOM_RAYMARCH_GAMMA_ENTRIES - 1)) + 0.5f)];
+}
+
+/* Brick map index of the local brick clamped into the grid and moved by the toroidal offset (brickStorage of the shader) */
+FATHOM_API FATHOM_INLINE u32 fathom_raymarch_brick_index(fathom_sparse_grid *grid, i32 *brick, u32 *storage)
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        i32 clamped = brick[axis] < 0 ? 0 : (brick[axis] >= (i32)dim ? (i32)dim - 1 : brick[axis]);
+        u32 s = (u32)clamped + grid->brick_map_offset[axis];
+
+        storage[axis] = s >= dim ? s - dim : s;
+    }
+
+    return fathom_sparse_grid_brick_map_storage_index(grid, storage[0], storage[1], storage[2]);
+}
+
+/* Primary ray of the pixel centre (px, py) in fragment coordinates (y up) */
+FATHOM_API void fathom_raymarch_ray_initialize(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, f32 px, f32 py)
+{
+    fathom_raymarch_camera *camera = &raymarch->camera;
+    f32 u = ((2.0f * px) - (f32)raymarch->width) / (f32)raymarch->height;
+    f32 v = ((2.0f * py) - (f32)raymarch->height) / (f32)raymarch->height;
+    f32 x = ((u * camera->right.x) + (v * camera->up.x)) + camera->forward_scaled.x;
+    f32 y = ((u * camera->right.y) + (v * camera->up.y)) + camera->forward_scaled.y;
+    f32 z = ((u * camera->right.z) + (v * camera->up.z)) + camera->forward_scaled.z;
+    f32 length = fathom_sqrtf(((x * x) + (y * y)) + (z * z));
+    u32 axis;
+
+    ray->origin[0] = camera->position.x;
+    ray->origin[1] = camera->position.y;
+    ray->origin[2] = camera->position.z;
+    ray->direction[0] = x / length;
+    ray->direction[1] = y / length;
+    ray->direction[2] = z / length;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        ray->direction_inverse[axis] = 1.0f / ray->direction[axis];
+        ray->direction_sign[axis] = ray->direction[axis] > 0.0f ? 1.0f : (ray->direction[axis] < 0.0f ? -1.0f : 0.0f);
+        ray->direction_positive[axis] = ray->direction[axis] > 0.0f ? 1.0f : 0.0f;
+    }
+
+    ray->t_ray = 0.0f;
+    ray->t_hit = -1.0f;
+    ray->level = 0;
+    ray->atlas = FATHOM_NULL;
+    ray->state = FATHOM_RAYMARCH_STATE_LEVEL;
+    ray->skip_air = 1;
+}
+
+/* Sets up the brick DDA through level from t (traceLevel of the shader) */
+FATHOM_API FATHOM_INLINE void fathom_raymarch_ray_enter(fathom_raymarch_ray *ray, fathom_raymarch_level *level, f32 t, f32 t_end)
+{
+    u32 axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 grid_position = ((ray->origin[axis] + (ray->direction[axis] * t)) - level->start[axis]) * level->cell_size_inverse;
+
+        ray->brick[axis] = fathom_clipmap_floor(grid_position / (f32)FATHOM_BRICK_SIZE);
+        ray->direction_grid[axis] = ray->direction[axis] * level->cell_size_inverse;
+        ray->t_delta[axis] = fathom_absf(((f32)FATHOM_BRICK_SIZE * level->cell_size) * ray->direction_inverse[axis]);
+        ray->t_max[axis] = ((((((f32)ray->brick[axis] + ray->direction_positive[axis]) * (f32)FATHOM_BRICK_SIZE) - grid_position) * level->cell_size) * ray->direction_inverse[axis]) + t;
+    }
+
+    ray->t = t;
+    ray->t_end = t_end;
+    ray->brick_step = 0;
+    ray->atlas_row = level->atlas_row;
+    ray->atlas_slice = level->atlas_slice;
+    ray->distance_scale = level->distance_scale;
+    ray->state = FATHOM_RAYMARCH_STATE_BRICK;
+}
+
+/* The ray left the level without a hit: the next level continues from its far end */
+FATHOM_API FATHOM_INLINE void fathom_raymarch_ray_leave(fathom_raymarch_ray *ray)
+{
+    ray->t_ray = ray->t_end;
+    ray->level++;
+    ray->state = FATHOM_RAYMARCH_STATE_LEVEL;
+}
+
+/* Distance along the ray from t to the face the ray leaves the box of box_size bricks at box_min (local) through */
+FATHOM_API FATHOM_INLINE f32 fathom_raymarch_ray_box_exit(fathom_raymarch_ray *ray, fathom_raymarch_level *level, i32 *box_min, i32 box_size, f32 *t_box)
+{
+    u32 axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 grid_position = ((ray->origin[axis] + (ray->direction[axis] * ray->t)) - level->start[axis]) * level->cell_size_inverse;
+
+        t_box[axis] = ((((((f32)box_min[axis] + (ray->direction_positive[axis] * (f32)box_size)) * (f32)FATHOM_BRICK_SIZE) - grid_position) * level->cell_size) * ray->direction_inverse[axis]) + ray->t;
+    }
+
+    return fathom_minf(fathom_minf(t_box[0], t_box[1]), t_box[2]);
+}
+
+/* Every brick of the box of box_size bricks at box_min (local) is air: jump to the brick behind the face the ray leaves the box through */
+FATHOM_API void fathom_raymarch_ray_skip_box(fathom_raymarch_ray *ray, fathom_raymarch_level *level, i32 *box_min, i32 box_size)
+{
+    f32 grid_position[3];
+    f32 t_box[3];
+    i32 next[3];
+    f32 t_exit;
+    u32 exit_axis;
+    u32 axis;
+
+    t_exit = fathom_raymarch_ray_box_exit(ray, level, box_min, box_size, t_box);
+
+    /* Brick behind the exit face: inside the box on the other axes, one past it on the exit axis */
+    for (axis = 0; axis < 3; ++axis)
+    {
+        i32 exit_brick = fathom_clipmap_floor((((ray->origin[axis] + (ray->direction[axis] * t_exit)) - level->start[axis]) * level->cell_size_inverse) / (f32)FATHOM_BRICK_SIZE);
+        i32 last = box_min[axis] + box_size - 1;
+
+        grid_position[axis] = ((ray->origin[axis] + (ray->direction[axis] * ray->t)) - level->start[axis]) * level->cell_size_inverse;
+        next[axis] = exit_brick < box_min[axis] ? box_min[axis] : (exit_brick > last ? last : exit_brick);
+    }
+
+    exit_axis = t_exit == t_box[0] ? 0u : (t_exit == t_box[1] ? 1u : 2u);
+    next[exit_axis] = ray->direction_sign[exit_axis] > 0.0f ? box_min[exit_axis] + box_size : box_min[exit_axis] - 1;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        ray->brick[axis] = next[axis];
+        ray->t_max[axis] = ((((((f32)ray->brick[axis] + ray->direction_positive[axis]) * (f32)FATHOM_BRICK_SIZE) - grid_position[axis]) * level->cell_size) * ray->direction_inverse[axis]) + ray->t;
+    }
+
+    ray->t = t_exit;
+}
+
+/* The air brick at storage (inside of the grid) lies in an empty block or has an air distance above 1:
+ * skips the block or the cube of air bricks around it, whichever the ray leaves later. Returns 0 if
+ * there is nothing to skip and the DDA steps on.
+ */
+FATHOM_API u8 fathom_raymarch_ray_skip_air(fathom_raymarch_ray *ray, fathom_raymarch_level *level, u32 *storage, u8 block_empty)
+{
+    fathom_sparse_grid *grid = level->grid;
+    u32 dim = grid->brick_map_dimensions;
+    i32 block_min[3];
+    i32 cube_min[3];
+    i32 cube_size = 0;
+    f32 t_box[3];
+    u32 axis;
+
+    if (ray->skip_air)
+    {
+        i32 distance = (i32)grid->air_distance_data[storage[0] + (storage[1] * dim) + (storage[2] * dim * dim)];
+
+        cube_size = distance > 1 ? (2 * distance) - 1 : 0;
+
+        for (axis = 0; axis < 3; ++axis)
+        {
+            cube_min[axis] = ray->brick[axis] - (distance - 1);
+        }
+    }
+
+    /* Blocks are aligned in storage, so the local corner of the block moves with the toroidal offset */
+    for (axis = 0; axis < 3; ++axis)
+    {
+        block_min[axis] = ray->brick[axis] - (i32)(storage[axis] % FATHOM_SPARSE_GRID_LEAF_SIZE);
+    }
+
+    if (cube_size && (!block_empty || fathom_raymarch_ray_box_exit(ray, level, cube_min, cube_size, t_box) > fathom_raymarch_ray_box_exit(ray, level, block_min, FATHOM_SPARSE_GRID_LEAF_SIZE, t_box)))
+    {
+        fathom_raymarch_ray_skip_box(ray, level, cube_min, cube_size);
+        return 1;
+    }
+
+    if (block_empty)
+    {
+        fathom_raymarch_ray_skip_box(ray, level, block_min, FATHOM_SPARSE_GRID_LEAF_SIZE);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Runs the traversal of the ray until it needs an atlas sample (FATHOM_RAYMARCH_STATE_SAMPLE, see
+ * fathom_raymarch_ray_resolve), hit something or missed every level
+ */
+FATHOM_API void fathom_raymarch_ray_advance(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats)
+{
+    for (;;)
+    {
+        fathom_raymarch_level *level = &raymarch->levels[ray->level < FATHOM_CLIPMAP_MAX_LEVELS ? ray->level : 0];
+        fathom_sparse_grid *grid = level->grid;
+
+        switch (ray->state)
+        {
+        case FATHOM_RAYMARCH_STATE_LEVEL:
+        {
+            f32 t_near = -1e30f;
+            f32 t_far = 1e30f;
+            u32 axis;
+
+            if (ray->level >= raymarch->clipmap->level_count)
+            {
+                ray->state = FATHOM_RAYMARCH_STATE_MISS;
+                return;
+            }
+
+            /* Finest level first: a ray sample is only handed to a coarser level once it left every finer one */
+            for (axis = 0; axis < 3; ++axis)
+            {
+                f32 t0 = (level->start[axis] - ray->origin[axis]) * ray->direction_inverse[axis];
+                f32 t1 = ((level->start[axis] + level->extent) - ray->origin[axis]) * ray->direction_inverse[axis];
+
+                t_near = fathom_maxf(t_near, fathom_minf(t0, t1));
+                t_far = fathom_minf(t_far, fathom_maxf(t0, t1));
+            }
+
+            if (t_near < t_far && t_far > ray->t_ray)
+            {
+                fathom_raymarch_ray_enter(ray, level, fathom_maxf(ray->t_ray, t_near) + FATHOM_RAYMARCH_EPSILON, t_far);
+            }
+            else
+            {
+                ray->level++;
+            }
+
+            break;
+        }
+
+        case FATHOM_RAYMARCH_STATE_BRICK:
+        {
+            u32 storage[3];
+            u32 index;
+            u32 entry;
+
+            if (ray->brick_step == FATHOM_RAYMARCH_BRICK_STEPS)
+            {
+                stats->brick_limits++;
+                fathom_raymarch_ray_leave(ray);
+                break;
+            }
+
+            ray->brick_step++;
+
+            index = fathom_raymarch_brick_index(grid, ray->brick, storage);
+            entry = fathom_sparse_grid_brick_map_get(grid, index);
+            stats->bricks++;
+
+            if (entry == FATHOM_BRICK_MAP_INDEX_SOLID)
+            {
+                ray->t_hit = ray->t;
+                ray->atlas = grid->atlas_data;
+                ray->atlas_bias = -0.5f;
+                ray->state = FATHOM_RAYMARCH_STATE_HIT;
+                return;
+            }
+
+            if (entry == FATHOM_BRICK_MAP_INDEX_AIR &&
+                (u32)ray->brick[0] < grid->brick_map_dimensions && (u32)ray->brick[1] < grid->brick_map_dimensions && (u32)ray->brick[2] < grid->brick_map_dimensions &&
+                fathom_raymarch_ray_skip_air(ray, level, storage, grid->brick_map_top_data[index / FATHOM_SPARSE_GRID_LEAF_ENTRIES] == FATHOM_BRICK_MAP_INDEX_AIR))
+            {
+                if (ray->t > ray->t_end)
+                {
+                    fathom_raymarch_ray_leave(ray);
+                }
+
+                break;
+            }
+
+            if (fathom_sparse_grid_brick_map_is_index(entry))
+            {
+                u32 axis;
+
+                ray->atlas = grid->atlas_data + fathom_sparse_grid_atlas_slot_base(grid, entry - 1);
+                ray->atlas_bias = 0.5f;
+                ray->t_local = ray->t;
+                ray->t_brick_exit = fathom_minf(fathom_minf(ray->t_max[0], ray->t_max[1]), ray->t_max[2]);
+                ray->sphere_step = 0;
+
+                for (axis = 0; axis < 3; ++axis)
+                {
+                    ray->position[axis] = ((ray->origin[axis] + (ray->direction[axis] * ray->t_local)) - level->start[axis]) * level->cell_size_inverse;
+                }
+
+                ray->state = FATHOM_RAYMARCH_STATE_SAMPLE;
+                return;
+            }
+
+            ray->state = FATHOM_RAYMARCH_STATE_STEP;
+            break;
+        }
+
+        case FATHOM_RAYMARCH_STATE_STEP:
+        {
+            f32 *t_max = ray->t_max;
+            u32 axis = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0u : 2u) : (t_max[1] < t_max[2] ? 1u : 2u);
+
+            ray->t = t_max[axis];
+            t_max[axis] += ray->t_delta[axis];
+            ray->brick[axis] += (i32)ray->direction_sign[axis];
+
+            if (ray->t > ray->t_end)
+            {
+                fathom_raymarch_ray_leave(ray);
+            }
+            else
+            {
+                ray->state = FATHOM_RAYMARCH_STATE_BRICK;
+            }
+
+            break;
+        }
+
+        default:
+            return;
+        }
+    }
+}
+
+/* Continues the sphere tracing of a ray in FATHOM_RAYMARCH_STATE_SAMPLE with the distance at its position */
+FATHOM_API FATHOM_INLINE void fathom_raymarch_ray_resolve(fathom_raymarch_ray *ray, f32 distance, fathom_raymarch_stats *stats)
+{
+    stats->samples++;
+
+    if (distance < FATHOM_RAYMARCH_EPSILON)
+    {
+        ray->t_hit = ray->t_local;
+        ray->state = FATHOM_RAYMARCH_STATE_HIT;
+        return;
+    }
+
+    ray->t_local += distance;
+    ray->position[0] += ray->direction_grid[0] * distance;
+    ray->position[1] += ray->direction_grid[1] * distance;
+    ray->position[2] += ray->direction_grid[2] * distance;
+
+    if (ray->t_local > ray->t_brick_exit)
+    {
+        ray->state = FATHOM_RAYMARCH_STATE_STEP;
+    }
+    else if (++ray->sphere_step == FATHOM_RAYMARCH_SPHERE_STEPS)
+    {
+        stats->sphere_limits++;
+        ray->state = FATHOM_RAYMARCH_STATE_STEP;
+    }
+}
+
+/* Trilinear distance at the grid position of the brick and atlas of the ray, 0 without an atlas */
+FATHOM_API f32 fathom_raymarch_sample(fathom_raymarch_ray *ray, f32 *position)
+{
+    f32 weight[3];
+    u32 voxel[3];
+    s8 *atlas;
+    f32 c00, c10, c01, c11, c0, c1;
+    u32 axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 v = fathom_clampf((position[axis] - (f32)(ray->brick[axis] * FATHOM_BRICK_SIZE)) + ray->atlas_bias, 0.0f, FATHOM_RAYMARCH_VOXEL_MAX);
+
+        voxel[axis] = (u32)v;
+        weight[axis] = v - (f32)voxel[axis];
+    }
+
+    if (!ray->atlas)
+    {
+        return 0.0f;
+    }
+
+    atlas = ray->atlas + voxel[0] + (voxel[1] * ray->atlas_row) + (voxel[2] * ray->atlas_slice);
+
+    c00 = (f32)atlas[0] + (((f32)atlas[1] - (f32)atlas[0]) * weight[0]);
+    c10 = (f32)atlas[ray->atlas_row] + (((f32)atlas[ray->atlas_row + 1] - (f32)atlas[ray->atlas_row]) * weight[0]);
+    atlas += ray->atlas_slice;
+    c01 = (f32)atlas[0] + (((f32)atlas[1] - (f32)atlas[0]) * weight[0]);
+    c11 = (f32)atlas[ray->atlas_row] + (((f32)atlas[ray->atlas_row + 1] - (f32)atlas[ray->atlas_row]) * weight[0]);
+    c0 = c00 + ((c10 - c00) * weight[1]);
+    c1 = c01 + ((c11 - c01) * weight[1]);
+
+    return (c0 + ((c1 - c0) * weight[2])) * ray->distance_scale;
+}
+
+/* Writes the shaded colour of the finished ray to rgb */
+FATHOM_API void fathom_raymarch_ray_shade(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, u8 *rgb)
+{
+    f32 color[3];
+
+    /* Sky */
+    color[0] = 0.4f - (0.7f * ray->direction[1]);
+    color[1] = 0.75f - (0.7f * ray->direction[1]);
+    color[2] = 1.0f - (0.7f * ray->direction[1]);
+
+    if (ray->state == FATHOM_RAYMARCH_STATE_HIT && ray->t_hit > 0.0f)
+    {
+        fathom_raymarch_level *level = &raymarch->levels[ray->level];
+        f32 e = FATHOM_RAYMARCH_NORMAL_OFFSET;
+        f32 position[3];
+        f32 sample[3];
+        f32 d[4];
+        f32 normal[3];
+        f32 length;
+        f32 diffuse;
+        u32 axis;
+
+        for (axis = 0; axis < 3; ++axis)
+        {
+            position[axis] = ((ray->origin[axis] + (ray->direction[axis] * ray->t_hit)) - level->start[axis]) / level->cell_size;
+        }
+
+        /* Tetrahedron k.xyy, k.yyx, k.yxy, k.xxx with k = (1, -1) */
+        sample[0] = position[0] + e; sample[1] = position[1] - e; sample[2] = position[2] - e;
+        d[0] = fathom_raymarch_sample(ray, sample);
+        sample[0] = position[0] - e; sample[1] = position[1] - e; sample[2] = position[2] + e;
+        d[1] = fathom_raymarch_sample(ray, sample);
+        sample[0] = position[0] - e; sample[1] = position[1] + e; sample[2] = position[2] - e;
+        d[2] = fathom_raymarch_sample(ray, sample);
+        sample[0] = position[0] + e; sample[1] = position[1] + e; sample[2] = position[2] + e;
+        d[3] = fathom_raymarch_sample(ray, sample);
+
+        normal[0] = ((d[0] - d[1]) - d[2]) + d[3];
+        normal[1] = ((-d[0] - d[1]) + d[2]) + d[3];
+        normal[2] = ((-d[0] + d[1]) - d[2]) + d[3];
+        length = fathom_sqrtf(((normal[0] * normal[0]) + (normal[1] * normal[1])) + (normal[2] * normal[2]));
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+
+        diffuse = fathom_clampf(((normal[0] * raymarch->light[0]) + (normal[1] * raymarch->light[1])) + (normal[2] * raymarch->light[2]), 0.0f, 1.0f);
+
+        /* ambient + diffuse * sun * normal */
+        color[0] = 0.2f + ((diffuse * 0.8f) * normal[0]);
+        color[1] = 0.3f + ((diffuse * 0.7f) * normal[1]);
+        color[2] = 0.4f + ((diffuse * 0.5f) * normal[2]);
+    }
+
+    rgb[0] = fathom_raymarch_gamma(raymarch, color[0]);
+    rgb[1] = fathom_raymarch_gamma(raymarch, color[1]);
+    rgb[2] = fathom_raymarch_gamma(raymarch, color[2]);
+}
+
+/* Traces the initialized ray through the clipmap like fathom.fs, it ends in FATHOM_RAYMARCH_STATE_HIT or _MISS */
+FATHOM_API void fathom_raymarch_traverse(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats)
+{
+    for (;;)
+    {
+        fathom_raymarch_ray_advance(raymarch, ray, stats);
+
+        if (ray->state != FATHOM_RAYMARCH_STATE_SAMPLE)
+        {
+            break;
+        }
+
+        fathom_raymarch_ray_resolve(ray, fathom_raymarch_sample(ray, ray->position), stats);
+    }
+
+    stats->rays++;
+    stats->hits += ray->state == FATHOM_RAYMARCH_STATE_HIT;
+}
+
+/* Traces and shades the pixel (x, y) of the framebuffer (row 0 at the top) */
+FATHOM_API void fathom_raymarch_pixel(fathom_raymarch *raymarch, u32 x, u32 y, fathom_raymarch_stats *stats)
+{
+    fathom_raymarch_ray ray;
+
+    fathom_raymarch_ray_initialize(raymarch, &ray, (f32)x + 0.5f, (f32)(raymarch->height - y) - 0.5f);
+    fathom_raymarch_traverse(raymarch, &ray, stats);
+    fathom_raymarch_ray_shade(raymarch, &ray, raymarch->pixels + (((y * raymarch->width) + x) * 3));
+}
+
+/* #############################################################################
+ * # [SECTION] Software Raymarcher Packets (SSE2 - 4 Rays)
+ * #############################################################################
+ *
+ * The lanes of a 2x2 packet run their traversal one after another up to the next
+ * atlas sample, then the samples of all waiting lanes are filtered together.
+ * Every operation is the one of the single ray version in the same order.
+ */
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+
+/* fathom_raymarch_sample of the lanes in mask at the grid positions (x, y, z), 0 for the other lanes */
+FATHOM_API __m128 fathom_raymarch_sample_x4(fathom_raymarch_ray *rays, u32 mask, __m128 x, __m128 y, __m128 z)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 voxel_max = _mm_set1_ps(FATHOM_RAYMARCH_VOXEL_MAX);
+    __m128 bias = _mm_set_ps(rays[3].atlas_bias, rays[2].atlas_bias, rays[1].atlas_bias, rays[0].atlas_bias);
+    __m128 scale = _mm_set_ps(rays[3].distance_scale, rays[2].distance_scale, rays[1].distance_scale, rays[0].distance_scale);
+    __m128 position[3];
+    __m128 weight[3];
+    __m128 value[8];
+    __m128 c00, c10, c01, c11, c0, c1;
+    f32 lane_value[8][4];
+    i32 lane_voxel[3][4];
+    u32 axis;
+    u32 k;
+
+    position[0] = x;
+    position[1] = y;
+    position[2] = z;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        __m128 brick = _mm_set_ps((f32)(rays[3].brick[axis] * FATHOM_BRICK_SIZE), (f32)(rays[2].brick[axis] * FATHOM_BRICK_SIZE), (f32)(rays[1].brick[axis] * FATHOM_BRICK_SIZE), (f32)(rays[0].brick[axis] * FATHOM_BRICK_SIZE));
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_sub_ps(position[axis], brick), bias), zero), voxel_max);
+        __m128i voxel = _mm_cvttps_epi32(v);
+
+        weight[axis] = _mm_sub_ps(v, _mm_cvtepi32_ps(voxel));
+        _mm_storeu_si128((__m128i *)lane_voxel[axis], voxel);
+    }
+
+    /* The gathers stay scalar: every lane reads its own brick, possibly of another level */
+    for (k = 0; k < 4; ++k)
+    {
+        fathom_raymarch_ray *ray = &rays[k];
+        s8 *atlas;
+        u32 row = ray->atlas_row;
+        u32 slice = ray->atlas_slice;
+        u32 i;
+
+        if (!(mask & (1u << k)) || !ray->atlas)
+        {
+            for (i = 0; i < 8; ++i)
+            {
+                lane_value[i][k] = 0.0f;
+            }
+
+            continue;
+        }
+
+        atlas = ray->atlas + (u32)lane_voxel[0][k] + ((u32)lane_voxel[1][k] * row) + ((u32)lane_voxel[2][k] * slice);
+
+        lane_value[0][k] = (f32)atlas[0];
+        lane_value[1][k] = (f32)atlas[1];
+        lane_value[2][k] = (f32)atlas[row];
+        lane_value[3][k] = (f32)atlas[row + 1];
+        lane_value[4][k] = (f32)atlas[slice];
+        lane_value[5][k] = (f32)atlas[slice + 1];
+        lane_value[6][k] = (f32)atlas[slice + row];
+        lane_value[7][k] = (f32)atlas[slice + row + 1];
+    }
+
+    for (k = 0; k < 8; ++k)
+    {
+        value[k] = _mm_loadu_ps(lane_value[k]);
+    }
+
+    c00 = _mm_add_ps(value[0], _mm_mul_ps(_mm_sub_ps(value[1], value[0]), weight[0]));
+    c10 = _mm_add_ps(value[2], _mm_mul_ps(_mm_sub_ps(value[3], value[2]), weight[0]));
+    c01 = _mm_add_ps(value[4], _mm_mul_ps(_mm_sub_ps(value[5], value[4]), weight[0]));
+    c11 = _mm_add_ps(value[6], _mm_mul_ps(_mm_sub_ps(value[7], value[6]), weight[0]));
+    c0 = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), weight[1]));
+    c1 = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), weight[1]));
+
+    return _mm_mul_ps(_mm_add_ps(c0, _mm_mul_ps(_mm_sub_ps(c1, c0), weight[2])), scale);
+}
+
+/* Traces and shades the 2x2 pixels from (x, y), lanes outside of the framebuffer are skipped */
+FATHOM_API void fathom_raymarch_packet(fathom_raymarch *raymarch, u32 x, u32 y, fathom_raymarch_stats *stats)
+{
+    fathom_raymarch_camera *camera = &raymarch->camera;
+    fathom_raymarch_ray rays[4];
+    __m128 width = _mm_set1_ps((f32)raymarch->width);
+    __m128 height = _mm_set1_ps((f32)raymarch->height);
+    __m128 two = _mm_set1_ps(2.0f);
+    __m128 px = _mm_set_ps((f32)x + 1.5f, (f32)x + 0.5f, (f32)x + 1.5f, (f32)x + 0.5f);
+    __m128 py = _mm_set_ps((f32)(raymarch->height - y) - 1.5f, (f32)(raymarch->height - y) - 1.5f, (f32)(raymarch->height - y) - 0.5f, (f32)(raymarch->height - y) - 0.5f);
+    __m128 u = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(two, px), width), height);
+    __m128 v = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(two, py), height), height);
+    __m128 direction[3];
+    __m128 length;
+    f32 lane[3][4];
+    f32 lane_color[3][4];
+    u32 valid = 0;
+    u32 hit = 0;
+    u32 k;
+
+    direction[0] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, _mm_set1_ps(camera->right.x)), _mm_mul_ps(v, _mm_set1_ps(camera->up.x))), _mm_set1_ps(camera->forward_scaled.x));
+    direction[1] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, _mm_set1_ps(camera->right.y)), _mm_mul_ps(v, _mm_set1_ps(camera->up.y))), _mm_set1_ps(camera->forward_scaled.y));
+    direction[2] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(u, _mm_set1_ps(camera->right.z)), _mm_mul_ps(v, _mm_set1_ps(camera->up.z))), _mm_set1_ps(camera->forward_scaled.z));
+    length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], direction[0]), _mm_mul_ps(direction[1], direction[1])), _mm_mul_ps(direction[2], direction[2])));
+    _mm_storeu_ps(lane[0], _mm_div_ps(direction[0], length));
+    _mm_storeu_ps(lane[1], _mm_div_ps(direction[1], length));
+    _mm_storeu_ps(lane[2], _mm_div_ps(direction[2], length));
+
+    for (k = 0; k < 4; ++k)
+    {
+        fathom_raymarch_ray *ray = &rays[k];
+        u32 axis;
+
+        ray->origin[0] = camera->position.x;
+        ray->origin[1] = camera->position.y;
+        ray->origin[2] = camera->position.z;
+
+        for (axis = 0; axis < 3; ++axis)
+        {
+            ray->direction[axis] = lane[axis][k];
+            ray->direction_inverse[axis] = 1.0f / ray->direction[axis];
+            ray->direction_sign[axis] = ray->direction[axis] > 0.0f ? 1.0f : (ray->direction[axis] < 0.0f ? -1.0f : 0.0f);
+            ray->direction_positive[axis] = ray->direction[axis] > 0.0f ? 1.0f : 0.0f;
+        }
+
+        ray->t_ray = 0.0f;
+        ray->t_hit = -1.0f;
+        ray->level = 0;
+        ray->atlas = FATHOM_NULL;
+        ray->state = FATHOM_RAYMARCH_STATE_LEVEL;
+
+        if (x + (k & 1) < raymarch->width && y + (k >> 1) < raymarch->height)
+        {
+            valid |= 1u << k;
+        }
+        else
+        {
+            ray->state = FATHOM_RAYMARCH_STATE_MISS;
+        }
+    }
+
+    /* Traverse lane by lane up to the next sample, then filter the samples of all waiting lanes */
+    for (;;)
+    {
+        u32 waiting = 0;
+        f32 distance[4];
+
+        for (k = 0; k < 4; ++k)
+        {
+            fathom_raymarch_ray_advance(raymarch, &rays[k], stats);
+            waiting |= (u32)(rays[k].state == FATHOM_RAYMARCH_STATE_SAMPLE) << k;
+        }
+
+        if (!waiting)
+        {
+            break;
+        }
+
+        _mm_storeu_ps(distance, fathom_raymarch_sample_x4(rays, waiting,
+                                                          _mm_set_ps(rays[3].position[0], rays[2].position[0], rays[1].position[0], rays[0].position[0]),
+                                                          _mm_set_ps(rays[3].position[1], rays[2].position[1], rays[1].position[1], rays[0].position[1]),
+                                                          _mm_set_ps(rays[3].position[2], rays[2].position[2], rays[1].position[2], rays[0].position[2])));
+
+        for (k = 0; k < 4; ++k)
+        {
+            if (waiting & (1u << k))
+            {
+                fathom_raymarch_ray_resolve(&rays[k], distance[k], stats);
+            }
+        }
+    }
+
+    /* Sky */
+    direction[1] = _mm_loadu_ps(lane[1]);
+    _mm_storeu_ps(lane_color[0], _mm_sub_ps(_mm_set1_ps(0.4f), _mm_mul_ps(_mm_set1_ps(0.7f), direction[1])));
+    _mm_storeu_ps(lane_color[1], _mm_sub_ps(_mm_set1_ps(0.75f), _mm_mul_ps(_mm_set1_ps(0.7f), direction[1])));
+    _mm_storeu_ps(lane_color[2], _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.7f), direction[1])));
+
+    for (k = 0; k < 4; ++k)
+    {
+        fathom_raymarch_ray *ray = &rays[k];
+
+        if (ray->state == FATHOM_RAYMARCH_STATE_HIT && ray->t_hit > 0.0f)
+        {
+            fathom_raymarch_level *level = &raymarch->levels[ray->level];
+            u32 axis;
+
+            hit |= 1u << k;
+
+            for (axis = 0; axis < 3; ++axis)
+            {
+                lane[axis][k] = ((ray->origin[axis] + (ray->direction[axis] * ray->t_hit)) - level->start[axis]) / level->cell_size;
+            }
+        }
+        else
+        {
+            lane[0][k] = 0.0f;
+            lane[1][k] = 0.0f;
+            lane[2][k] = 0.0f;
+        }
+
+        stats->hits += ray->state == FATHOM_RAYMARCH_STATE_HIT;
+    }
+
+    if (hit)
+    {
+        __m128 e = _mm_set1_ps(FATHOM_RAYMARCH_NORMAL_OFFSET);
+        __m128 x0 = _mm_loadu_ps(lane[0]);
+        __m128 y0 = _mm_loadu_ps(lane[1]);
+        __m128 z0 = _mm_loadu_ps(lane[2]);
+        __m128 d0 = fathom_raymarch_sample_x4(rays, hit, _mm_add_ps(x0, e), _mm_sub_ps(y0, e), _mm_sub_ps(z0, e));
+        __m128 d1 = fathom_raymarch_sample_x4(rays, hit, _mm_sub_ps(x0, e), _mm_sub_ps(y0, e), _mm_add_ps(z0, e));
+        __m128 d2 = fathom_raymarch_sample_x4(rays, hit, _mm_sub_ps(x0, e), _mm_add_ps(y0, e), _mm_sub_ps(z0, e));
+        __m128 d3 = fathom_raymarch_sample_x4(rays, hit, _mm_add_ps(x0, e), _mm_add_ps(y0, e), _mm_add_ps(z0, e));
+        __m128 minus_d0 = _mm_sub_ps(_mm_setzero_ps(), d0);
+        __m128 normal[3];
+        __m128 diffuse;
+        __m128 hit_mask = _mm_castsi128_ps(_mm_set_epi32(-(i32)((hit >> 3) & 1u), -(i32)((hit >> 2) & 1u), -(i32)((hit >> 1) & 1u), -(i32)(hit & 1u)));
+        __m128 ambient[3];
+        __m128 sun[3];
+        u32 axis;
+
+        normal[0] = _mm_add_ps(_mm_sub_ps(_mm_sub_ps(d0, d1), d2), d3);
+        normal[1] = _mm_add_ps(_mm_add_ps(_mm_sub_ps(minus_d0, d1), d2), d3);
+        normal[2] = _mm_add_ps(_mm_sub_ps(_mm_add_ps(minus_d0, d1), d2), d3);
+        length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], normal[0]), _mm_mul_ps(normal[1], normal[1])), _mm_mul_ps(normal[2], normal[2])));
+        normal[0] = _mm_div_ps(normal[0], length);
+        normal[1] = _mm_div_ps(normal[1], length);
+        normal[2] = _mm_div_ps(normal[2], length);
+
+        diffuse = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], _mm_set1_ps(raymarch->light[0])), _mm_mul_ps(normal[1], _mm_set1_ps(raymarch->light[1]))), _mm_mul_ps(normal[2], _mm_set1_ps(raymarch->light[2])));
+        diffuse = _mm_min_ps(_mm_max_ps(diffuse, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+        ambient[0] = _mm_set1_ps(0.2f);
+        ambient[1] = _mm_set1_ps(0.3f);
+        ambient[2] = _mm_set1_ps(0.4f);
+        sun[0] = _mm_set1_ps(0.8f);
+        sun[1] = _mm_set1_ps(0.7f);
+        sun[2] = _mm_set1_ps(0.5f);
+
+        for (axis = 0; axis < 3; ++axis)
+        {
+            __m128 color = _mm_add_ps(ambient[axis], _mm_mul_ps(_mm_mul_ps(diffuse, sun[axis]), normal[axis]));
+            __m128 sky = _mm_loadu_ps(lane_color[axis]);
+
+            _mm_storeu_ps(lane_color[axis], _mm_or_ps(_mm_and_ps(hit_mask, color), _mm_andnot_ps(hit_mask, sky)));
+        }
+    }
+
+    for (k = 0; k < 4; ++k)
+    {
+        u8 *rgb;
+
+        if (!(valid & (1u << k)))
+        {
+            continue;
+        }
+
+        rgb = raymarch->pixels + ((((y + (k >> 1)) * raymarch->width) + x + (k & 1)) * 3);
+        rgb[0] = fathom_raymarch_gamma(raymarch, lane_color[0][k]);
+        rgb[1] = fathom_raymarch_gamma(raymarch, lane_color[1][k]);
+        rgb[2] = fathom_raymarch_gamma(raymarch, lane_color[2][k]);
+        stats->rays++;
+    }
+}
+
+#endif
+
+/* #############################################################################
+ * # [SECTION] Software Raymarcher Tiles
+ * #############################################################################
+ */
+FATHOM_API void fathom_raymarch_tile_job(void *data, u32 job_index, u32 worker_index)
+{
+    fathom_raymarch *raymarch = (fathom_raymarch *)data;
+    fathom_raymarch_stats *stats = &raymarch->worker_stats[worker_index];
+    u32 x_min = (job_index % raymarch->tile_columns) * FATHOM_RAYMARCH_TILE_SIZE;
+    u32 y_min = (job_index / raymarch->tile_columns) * FATHOM_RAYMARCH_TILE_SIZE;
+    u32 x_max = x_min + FATHOM_RAYMARCH_TILE_SIZE < raymarch->width ? x_min + FATHOM_RAYMARCH_TILE_SIZE : raymarch->width;
+    u32 y_max = y_min + FATHOM_RAYMARCH_TILE_SIZE < raymarch->height ? y_min + FATHOM_RAYMARCH_TILE_SIZE : raymarch->height;
+    u32 x, y;
+
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+    if (raymarch->packets)
+    {
+        for (y = y_min; y < y_max; y += 2)
+        {
+            for (x = x_min; x < x_max; x += 2)
+            {
+                fathom_raymarch_packet(raymarch, x, y, stats);
+            }
+        }
+
+        return;
+    }
+#endif
+
+    for (y = y_min; y < y_max; ++y)
+    {
+        for (x = x_min; x < x_max; ++x)
+        {
+            fathom_raymarch_pixel(raymarch, x, y, stats);
+        }
+    }
+}
+
+/* Takes the uniforms of the clipmap levels, they scroll and rebuild between frames */
+FATHOM_API void fathom_raymarch_levels_update(fathom_raymarch *raymarch)
+{
+    fathom_clipmap *clipmap = raymarch->clipmap;
+    u32 level;
+
+    for (level = 0; level < clipmap->level_count; ++level)
+    {
+        fathom_sparse_grid *grid = &clipmap->levels[level];
+        fathom_raymarch_level *uniforms = &raymarch->levels[level];
+
+        uniforms->grid = grid;
+        uniforms->start[0] = grid->start.x;
+        uniforms->start[1] = grid->start.y;
+        uniforms->start[2] = grid->start.z;
+        uniforms->extent = (f32)(grid->brick_map_dimensions * FATHOM_BRICK_SIZE) * grid->cell_size;
+        uniforms->cell_size = grid->cell_size;
+        uniforms->cell_size_inverse = 1.0f / grid->cell_size;
+        uniforms->distance_scale = grid->truncation_distance / 127.0f;
+        uniforms->atlas_row = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+        uniforms->atlas_slice = uniforms->atlas_row * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    }
+}
+
+FATHOM_API void fathom_raymarch_stats_reset(fathom_raymarch_stats *stats)
+{
+    stats->rays = 0;
+    stats->hits = 0;
+    stats->bricks = 0;
+    stats->samples = 0;
+    stats->brick_limits = 0;
+    stats->sphere_limits = 0;
+}
+
+/* Renders the clipmap from raymarch->camera into raymarch->pixels, one job per tile.
+ * jobs may be FATHOM_NULL to render on the calling thread only.
+ */
+FATHOM_API void fathom_raymarch_render(fathom_raymarch *raymarch, fathom_job_system *jobs)
+{
+    u32 i;
+
+    fathom_raymarch_levels_update(raymarch);
+
+    for (i = 0; i < FATHOM_JOB_MAX_WORKERS; ++i)
+    {
+        fathom_raymarch_stats_reset(&raymarch->worker_stats[i]);
+    }
+
+    fathom_job_system_parallel_for(jobs, fathom_raymarch_tile_job, raymarch, raymarch->tile_columns * raymarch->tile_rows);
+
+    fathom_raymarch_stats_reset(&raymarch->stats);
+
+    for (i = 0; i < FATHOM_JOB_MAX_WORKERS; ++i)
+    {
+        raymarch->stats.rays += raymarch->worker_stats[i].rays;
+        raymarch->stats.hits += raymarch->worker_stats[i].hits;
+        raymarch->stats.bricks += raymarch->worker_stats[i].bricks;
+        raymarch->stats.samples += raymarch->worker_stats[i].samples;
+        raymarch->stats.brick_limits += raymarch->worker_stats[i].brick_limits;
+        raymarch->stats.sphere_limits += raymarch->worker_stats[i].sphere_limits;
+    }
+}
+
+/* #############################################################################
+ * # [SECTION] Traversal Variants
+ * #############################################################################
+ *
+ * C ports of the traversals the shaders went through, to compare them on the same grid and rays:
+ *
+ *   fathom_raymarch_traverse              fathom.fs: every clipmap level, air distance and empty block skipping, 48 bricks per level
+ *   fathom_raymarch_traverse_blocks       fathom.fs before the air distance map: empty block skipping only
+ *   fathom_raymarch_traverse_step_march   fathom_proto_v0_step_march.fs: 80 steps of brick skips and atlas distances
+ *   fathom_raymarch_traverse_dda          fathom_proto_v1_dda.fs: 64 brick DDA steps, sphere tracing from the ray origin
+ *   fathom_raymarch_traverse_dda_improved fathom_proto_v2_dda_improved.fs: as v1, the sphere tracing advances the position
+ *
+ * The prototypes were written for the dense brick map and the 2D atlas, the ports read the brick
+ * map and atlas of the first clipmap level instead and keep the loops, limits and epsilons of the
+ * shader. A brick outside the grid reads as air (texelFetch outside the texture) where fathom.fs
+ * clamps it to the edge brick, so the ports miss the ground fathom.fs still hits at the faces of
+ * the grid. Every variant starts from a ray of fathom_raymarch_ray_initialize and ends it in
+ * FATHOM_RAYMARCH_STATE_HIT (with t_hit) or _MISS.
+ */
+#define FATHOM_RAYMARCH_STEP_MARCH_STEPS 80        /* Loop iterations of the v0 step march */
+#define FATHOM_RAYMARCH_STEP_MARCH_HIT 0.1f        /* v0 hit distance in cells */
+#define FATHOM_RAYMARCH_STEP_MARCH_SKIP 0.01f      /* v0 offset past an air brick in cells */
+#define FATHOM_RAYMARCH_DDA_BRICK_STEPS 64         /* Brick DDA iterations of v1 and v2 */
+
+typedef void (*fathom_raymarch_traversal)(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats);
+
+/* Brick map entry of a prototype, an index entry points the sampling state of the ray at its atlas brick */
+FATHOM_API FATHOM_INLINE u32 fathom_raymarch_proto_entry(fathom_raymarch_level *level, fathom_raymarch_ray *ray, i32 *brick, fathom_raymarch_stats *stats)
+{
+    fathom_sparse_grid *grid = level->grid;
+    u32 storage[3];
+    u32 entry;
+
+    stats->bricks++;
+
+    if ((u32)brick[0] >= grid->brick_map_dimensions || (u32)brick[1] >= grid->brick_map_dimensions || (u32)brick[2] >= grid->brick_map_dimensions)
+    {
+        return FATHOM_BRICK_MAP_INDEX_AIR;
+    }
+
+    entry = fathom_sparse_grid_brick_map_get(grid, fathom_raymarch_brick_index(grid, brick, storage));
+
+    if (fathom_sparse_grid_brick_map_is_index(entry))
+    {
+        ray->brick[0] = brick[0];
+        ray->brick[1] = brick[1];
+        ray->brick[2] = brick[2];
+        ray->atlas = grid->atlas_data + fathom_sparse_grid_atlas_slot_base(grid, entry - 1);
+        ray->atlas_bias = 0.5f;
+        ray->atlas_row = level->atlas_row;
+        ray->atlas_slice = level->atlas_slice;
+        ray->distance_scale = level->distance_scale;
+    }
+
+    return entry;
+}
+
+/* Clips the ray against the first level, 0 if it misses the grid */
+FATHOM_API FATHOM_INLINE u8 fathom_raymarch_proto_clip(fathom_raymarch_level *level, fathom_raymarch_ray *ray, f32 *t_near, f32 *t_far)
+{
+    u32 axis;
+
+    *t_near = -1e30f;
+    *t_far = 1e30f;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 t0 = (level->start[axis] - ray->origin[axis]) * ray->direction_inverse[axis];
+        f32 t1 = ((level->start[axis] + level->extent) - ray->origin[axis]) * ray->direction_inverse[axis];
+
+        *t_near = fathom_maxf(*t_near, fathom_minf(t0, t1));
+        *t_far = fathom_minf(*t_far, fathom_maxf(t0, t1));
+    }
+
+    return *t_near <= *t_far && *t_far >= 0.0f;
+}
+
+FATHOM_API FATHOM_INLINE void fathom_raymarch_proto_finish(fathom_raymarch_ray *ray, f32 t_hit, fathom_raymarch_stats *stats)
+{
+    ray->t_hit = t_hit;
+    ray->state = t_hit > 0.0f ? FATHOM_RAYMARCH_STATE_HIT : FATHOM_RAYMARCH_STATE_MISS;
+
+    stats->rays++;
+    stats->hits += ray->state == FATHOM_RAYMARCH_STATE_HIT;
+}
+
+/* v0: steps through air bricks to their exit and by the sampled distance through occupied ones */
+FATHOM_API void fathom_raymarch_traverse_step_march(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats)
+{
+    fathom_raymarch_level *level = &raymarch->levels[0];
+    f32 t_near, t_far, t;
+    u32 i;
+
+    if (!fathom_raymarch_proto_clip(level, ray, &t_near, &t_far))
+    {
+        fathom_raymarch_proto_finish(ray, -1.0f, stats);
+        return;
+    }
+
+    t = fathom_maxf(0.0f, t_near);
+
+    for (i = 0; i < FATHOM_RAYMARCH_STEP_MARCH_STEPS; ++i)
+    {
+        f32 grid_position[3];
+        i32 brick[3];
+        u32 entry;
+        u32 axis;
+
+        for (axis = 0; axis < 3; ++axis)
+        {
+            grid_position[axis] = ((ray->origin[axis] + (ray->direction[axis] * t)) - level->start[axis]) * level->cell_size_inverse;
+            brick[axis] = fathom_clipmap_floor(grid_position[axis] / (f32)FATHOM_BRICK_SIZE);
+        }
+
+        entry = fathom_raymarch_proto_entry(level, ray, brick, stats);
+
+        if (entry == FATHOM_BRICK_MAP_INDEX_SOLID)
+        {
+            fathom_raymarch_proto_finish(ray, t, stats);
+            return;
+        }
+
+        if (fathom_sparse_grid_brick_map_is_index(entry))
+        {
+            f32 distance = fathom_raymarch_sample(ray, grid_position);
+
+            stats->samples++;
+
+            if (distance < level->cell_size * FATHOM_RAYMARCH_STEP_MARCH_HIT)
+            {
+                fathom_raymarch_proto_finish(ray, t, stats);
+                return;
+            }
+
+            t += distance;
+        }
+        else
+        {
+            f32 t_skip = 1e30f;
+
+            for (axis = 0; axis < 3; ++axis)
+            {
+                f32 brick_min = (f32)(brick[axis] * FATHOM_BRICK_SIZE);
+                f32 t0 = (brick_min - grid_position[axis]) * ray->direction_inverse[axis];
+                f32 t1 = ((brick_min + (f32)FATHOM_BRICK_SIZE) - grid_position[axis]) * ray->direction_inverse[axis];
+
+                t_skip = fathom_minf(t_skip, fathom_maxf(t0, t1));
+            }
+
+            t += (t_skip + FATHOM_RAYMARCH_STEP_MARCH_SKIP) * level->cell_size;
+        }
+
+        if (t > t_far)
+        {
+            fathom_raymarch_proto_finish(ray, -1.0f, stats);
+            return;
+        }
+    }
+
+    stats->brick_limits++;
+    fathom_raymarch_proto_finish(ray, -1.0f, stats);
+}
+
+/* v1 and v2: brick DDA, occupied bricks are sphere traced up to their exit.
+ * incremental advances the grid position by the distance (v2), v1 recomputes it from the ray every step.
+ */
+FATHOM_API void fathom_raymarch_traverse_dda_variant(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats, u8 incremental)
+{
+    fathom_raymarch_level *level = &raymarch->levels[0];
+    f32 t_near, t_far, t;
+    f32 t_max[3];
+    f32 t_delta[3];
+    i32 brick[3];
+    u32 i;
+    u32 axis;
+
+    if (!fathom_raymarch_proto_clip(level, ray, &t_near, &t_far) || !(t_near < t_far))
+    {
+        fathom_raymarch_proto_finish(ray, -1.0f, stats);
+        return;
+    }
+
+    t = fathom_maxf(0.0f, t_near) + FATHOM_RAYMARCH_EPSILON;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 grid_position = ((ray->origin[axis] + (ray->direction[axis] * t)) - level->start[axis]) * level->cell_size_inverse;
+
+        brick[axis] = fathom_clipmap_floor(grid_position / (f32)FATHOM_BRICK_SIZE);
+        t_delta[axis] = fathom_absf(((f32)FATHOM_BRICK_SIZE * level->cell_size) * ray->direction_inverse[axis]);
+        t_max[axis] = ((((((f32)brick[axis] + ray->direction_positive[axis]) * (f32)FATHOM_BRICK_SIZE) - grid_position) * level->cell_size) * ray->direction_inverse[axis]) + t;
+    }
+
+    for (i = 0; i < FATHOM_RAYMARCH_DDA_BRICK_STEPS; ++i)
+    {
+        u32 entry = fathom_raymarch_proto_entry(level, ray, brick, stats);
+
+        if (entry == FATHOM_BRICK_MAP_INDEX_SOLID)
+        {
+            fathom_raymarch_proto_finish(ray, t, stats);
+            return;
+        }
+
+        if (fathom_sparse_grid_brick_map_is_index(entry))
+        {
+            f32 t_local = t;
+            f32 t_brick_exit = fathom_minf(fathom_minf(t_max[0], t_max[1]), t_max[2]);
+            f32 position[3];
+            u32 step;
+
+            for (axis = 0; axis < 3; ++axis)
+            {
+                position[axis] = ((ray->origin[axis] + (ray->direction[axis] * t_local)) - level->start[axis]) * level->cell_size_inverse;
+            }
+
+            for (step = 0; step < FATHOM_RAYMARCH_SPHERE_STEPS; ++step)
+            {
+                f32 distance;
+
+                if (!incremental)
+                {
+                    for (axis = 0; axis < 3; ++axis)
+                    {
+                        position[axis] = ((ray->origin[axis] + (ray->direction[axis] * t_local)) - level->start[axis]) * level->cell_size_inverse;
+                    }
+                }
+
+                distance = fathom_raymarch_sample(ray, position);
+                stats->samples++;
+
+                if (distance < FATHOM_RAYMARCH_EPSILON)
+                {
+                    fathom_raymarch_proto_finish(ray, t_local, stats);
+                    return;
+                }
+
+                t_local += distance;
+
+                if (incremental)
+                {
+                    for (axis = 0; axis < 3; ++axis)
+                    {
+                        position[axis] += (ray->direction[axis] * level->cell_size_inverse) * distance;
+                    }
+                }
+
+                if (t_local > t_brick_exit)
+                {
+                    break;
+                }
+            }
+
+            if (step == FATHOM_RAYMARCH_SPHERE_STEPS)
+            {
+                stats->sphere_limits++;
+            }
+        }
+
+        axis = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0u : 2u) : (t_max[1] < t_max[2] ? 1u : 2u);
+        t = t_max[axis];
+        t_max[axis] += t_delta[axis];
+        brick[axis] += (i32)ray->direction_sign[axis];
+
+        if (t > t_far)
+        {
+            fathom_raymarch_proto_finish(ray, -1.0f, stats);
+            return;
+        }
+    }
+
+    stats->brick_limits++;
+    fathom_raymarch_proto_finish(ray, -1.0f, stats);
+}
+
+FATHOM_API void fathom_raymarch_traverse_blocks(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats)
+{
+    ray->skip_air = 0;
+    fathom_raymarch_traverse(raymarch, ray, stats);
+}
+
+FATHOM_API void fathom_raymarch_traverse_dda(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats)
+{
+    fathom_raymarch_traverse_dda_variant(raymarch, ray, stats, 0);
+}
+
+FATHOM_API void fathom_raymarch_traverse_dda_improved(fathom_raymarch *raymarch, fathom_raymarch_ray *ray, fathom_raymarch_stats *stats)
+{
+    fathom_raymarch_traverse_dda_variant(raymarch, ray, stats, 1);
+}
+
+/* The variants in benchmark order, fathom.fs first as the reference of the others */
+#define FATHOM_RAYMARCH_TRAVERSAL_COUNT 5
+
+static fathom_raymarch_traversal fathom_raymarch_traversals[FATHOM_RAYMARCH_TRAVERSAL_COUNT] = {
+    fathom_raymarch_traverse,
+    fathom_raymarch_traverse_blocks,
+    fathom_raymarch_traverse_step_march,
+    fathom_raymarch_traverse_dda,
+    fathom_raymarch_traverse_dda_improved};
+
+static s8 *fathom_raymarch_traversal_names[FATHOM_RAYMARCH_TRAVERSAL_COUNT] = {
+    "fathom",
+    "fathom_block_skip",
+    "v0_step_march",
+    "v1_dda",
+    "v2_dda_improved"};
+
+/* Traces the primary ray of every pixel from raymarch->camera on the calling thread and writes its hit
+ * distance (-1 for a miss) to t_hit, width * height entries with the bottom row first. stats accumulates.
+ */
+FATHOM_API void fathom_raymarch_traversal_run(fathom_raymarch *raymarch, fathom_raymarch_traversal traversal, f32 *t_hit, fathom_raymarch_stats *stats)
+{
+    u32 x, y;
+
+    for (y = 0; y < raymarch->height; ++y)
+    {
+        for (x = 0; x < raymarch->width; ++x)
+        {
+            fathom_raymarch_ray ray;
+
+            fathom_raymarch_ray_initialize(raymarch, &ray, (f32)x + 0.5f, (f32)y + 0.5f);
+            traversal(raymarch, &ray, stats);
+
+            *t_hit++ = ray.state == FATHOM_RAYMARCH_STATE_HIT ? ray.t_hit : -1.0f;
+        }
+    }
+}
+
+/* Rays of two runs where one hits and the other misses, or both hit more than tolerance apart */
+FATHOM_API u32 fathom_raymarch_traversal_disagreements(f32 *t_hit, f32 *t_hit_reference, u32 count, f32 tolerance)
+{
+    u32 disagreements = 0;
+    u32 i;
+
+    for (i = 0; i < count; ++i)
+    {
+        disagreements += (t_hit[i] < 0.0f) != (t_hit_reference[i] < 0.0f) || fathom_absf(t_hit[i] - t_hit_reference[i]) > tolerance;
+    }
+
+    return disagreements;
+}
+
+#endif /* FATHOM_RAYMARCH_H */
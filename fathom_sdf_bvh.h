@@ -0,0 +1,616 @@
+#ifndef FATHOM_SDF_BVH_H
+#define FATHOM_SDF_BVH_H
+
+#include "fathom_types.h"
+#include "fathom_sdf_scene.h"
+
+/* #############################################################################
+ * # [SECTION] SDF BVH
+ * #############################################################################
+ *
+ * Bounding volume hierarchy over the primitives of a scene store for point queries,
+ * with the same distances and materials as fathom_sdf_scene bit for bit.
+ * Every node bounds the reach of the primitives below it (fathom_sdf_scene_primitive_reach),
+ * so a query skips each subtree whose primitives are further than the reach of the tree
+ * above the closest primitive found so far. The primitives left over are combined in
+ * store order as fathom_sdf_scene_tape does.
+ *
+ * A skipped union is exact where its primitive is a blend range above the running
+ * distance: the smooth union is the exact minimum there (a hard union has no blend
+ * range, the reach of a tree without smooth unions is a few margins). The running
+ * distance never rises and a chain of primitives at least m away blends down to no
+ * less than m - FATHOM_SDF_BVH_CHAIN times the blend range. So once a kept primitive
+ * is a blend range below every distance the chain can reach before it, the running
+ * distance is that primitive alone and everything skipped after it is exact. Queries
+ * that cannot show this run the primitives in store order up to the closest ones
+ * instead, fathom_sdf_bvh_query_stats counts them: only the ones whose own bounds are
+ * within a blend range of the running distance are evaluated.
+ *
+ * Only unions can be skipped (a subtraction or intersection changes the distance far
+ * away from its primitive): the primitives up to the last other operation are always
+ * evaluated in store order, the tree holds the unions after it.
+ * The node and index memory is provided by the caller, see fathom_sdf_bvh_initialize,
+ * and holds a tree over as many primitives as the store can.
+ */
+#define FATHOM_SDF_BVH_LEAF_PRIMITIVES 4
+#define FATHOM_SDF_BVH_CHAIN (7.0f / 6.0f) /* Blend ranges a smooth union chain lowers the distance below its closest primitive at most */
+#define FATHOM_SDF_BVH_REACH 2.5f           /* Blend ranges plus margins above the closest primitive a query keeps */
+#define FATHOM_SDF_BVH_ROUNDING 1e-6f /* Relative float error a step of the lower bound is allowed */
+#define FATHOM_SDF_BVH_STACK 64       /* Median splits keep the depth below 32 */
+#define FATHOM_SDF_BVH_CANDIDATES 256 /* Primitives within the reach of the closest one per query */
+
+typedef struct fathom_sdf_bvh_node
+{
+    fathom_sdf_aabb bounds; /* Reach of the primitives below */
+    f32 bound_scale;        /* Smallest fathom_sdf_scene_primitive_bound_scale below */
+    u32 first;              /* Leaf: first entry of index_data, inner node: right child (the left child follows the node) */
+    u32 count;              /* Primitives of a leaf, 0 for inner nodes */
+
+} fathom_sdf_bvh_node;
+
+typedef struct fathom_sdf_bvh_bound
+{
+    fathom_sdf_aabb bounds; /* fathom_sdf_scene_primitive_aabb */
+    f32 bound_scale;        /* fathom_sdf_scene_primitive_bound_scale */
+
+} fathom_sdf_bvh_bound;
+
+typedef struct fathom_sdf_bvh_tree
+{
+    fathom_sdf_scene_store *scene;
+    u32 primitive_count; /* Primitives of the scene at the last fathom_sdf_bvh_build */
+    u32 primitive_first; /* First primitive of the tree, the ones before it are evaluated in store order */
+    f32 blend;           /* FATHOM_SDF_SCENE_PRIMITIVE_BLEND, 0 if the tree holds no smooth union */
+    f32 reach;           /* Above the closest primitive the query keeps the primitives */
+
+    u32 node_count;
+    u32 node_depth;
+
+    u32 node_bytes;  /* Set by fathom_sdf_bvh_initialize */
+    u32 index_bytes; /* Set by fathom_sdf_bvh_initialize */
+    u32 bound_bytes; /* Set by fathom_sdf_bvh_initialize */
+    fathom_sdf_bvh_node *node_data;   /* node_bytes, nodes in depth first order */
+    u32 *index_data;                  /* index_bytes, primitives of the leaves in node order */
+    fathom_sdf_bvh_bound *bound_data; /* bound_bytes, bounds of the primitives of the tree in store order */
+
+} fathom_sdf_bvh_tree;
+
+/* Work of one query */
+typedef struct fathom_sdf_bvh_query_stats
+{
+    u32 nodes;
+    u32 primitives;
+    u32 fallbacks; /* Queries that ran the primitives in store order up to the closest ones */
+
+} fathom_sdf_bvh_query_stats;
+
+/* Sets the memory the caller has to provide in node_data, index_data and bound_data before fathom_sdf_bvh_build */
+FATHOM_API void fathom_sdf_bvh_initialize(fathom_sdf_bvh_tree *bvh, fathom_sdf_scene_store *scene)
+{
+    u32 capacity = scene->primitive_capacity;
+
+    bvh->scene = scene;
+    bvh->primitive_count = 0;
+    bvh->primitive_first = 0;
+    bvh->blend = 0.0f;
+    bvh->reach = 0.0f;
+    bvh->node_count = 0;
+    bvh->node_depth = 0;
+
+    /* A binary tree with at most one leaf per primitive */
+    bvh->node_bytes = (capacity ? 2 * capacity - 1 : 1) * (u32)sizeof(fathom_sdf_bvh_node);
+    bvh->index_bytes = (capacity ? capacity : 1) * (u32)sizeof(u32);
+    bvh->bound_bytes = (capacity ? capacity : 1) * (u32)sizeof(fathom_sdf_bvh_bound);
+    bvh->node_data = FATHOM_NULL;
+    bvh->index_data = FATHOM_NULL;
+    bvh->bound_data = FATHOM_NULL;
+}
+
+FATHOM_API FATHOM_INLINE f32 fathom_sdf_bvh_axis(fathom_sdf_scene_store *scene, u32 index, u32 axis)
+{
+    return axis == 0 ? scene->position_x[index] : (axis == 1 ? scene->position_y[index] : scene->position_z[index]);
+}
+
+/* Reorders indices so that the primitive at nth is where it would be sorted by position on axis,
+ * none before it lies above and none after it below.
+ */
+FATHOM_API void fathom_sdf_bvh_select(fathom_sdf_scene_store *scene, u32 *indices, u32 count, u32 nth, u32 axis)
+{
+    u32 lo = 0;
+    u32 hi = count - 1;
+
+    while (lo < hi)
+    {
+        f32 pivot = fathom_sdf_bvh_axis(scene, indices[lo + (hi - lo) / 2], axis);
+        u32 i = lo;
+        u32 j = hi;
+
+        while (i <= j)
+        {
+            while (fathom_sdf_bvh_axis(scene, indices[i], axis) < pivot)
+            {
+                ++i;
+            }
+
+            while (fathom_sdf_bvh_axis(scene, indices[j], axis) > pivot)
+            {
+                --j;
+            }
+
+            if (i <= j)
+            {
+                u32 swap = indices[i];
+                indices[i] = indices[j];
+                indices[j] = swap;
+
+                ++i;
+
+                if (j == 0)
+                {
+                    break;
+                }
+
+                --j;
+            }
+        }
+
+        if (nth <= j)
+        {
+            hi = j;
+        }
+        else if (nth >= i)
+        {
+            lo = i;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+/* Builds the subtree over index_data[first, first + count) and returns its node */
+FATHOM_API u32 fathom_sdf_bvh_build_node(fathom_sdf_bvh_tree *bvh, u32 first, u32 count, u32 depth)
+{
+    u32 node_index = bvh->node_count++;
+    fathom_sdf_bvh_node *node = &bvh->node_data[node_index];
+    fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(bvh->scene, bvh->index_data[first]);
+    fathom_sdf_aabb centers;
+    fathom_vec3 extent;
+    u32 axis;
+    u32 i;
+
+    centers.min = primitive.transform.position;
+    centers.max = centers.min;
+    node->bounds = fathom_sdf_scene_primitive_reach(&primitive, bvh->reach);
+    node->bound_scale = 1.0f;
+
+    for (i = 0; i < count; ++i)
+    {
+        fathom_sdf_aabb reach;
+
+        primitive = fathom_sdf_scene_store_primitive(bvh->scene, bvh->index_data[first + i]);
+        reach = fathom_sdf_scene_primitive_reach(&primitive, bvh->reach);
+
+        node->bounds.min = fathom_vec3_min(node->bounds.min, reach.min);
+        node->bounds.max = fathom_vec3_max(node->bounds.max, reach.max);
+        node->bound_scale = fathom_minf(node->bound_scale, fathom_sdf_scene_primitive_bound_scale(&primitive));
+        centers.min = fathom_vec3_min(centers.min, primitive.transform.position);
+        centers.max = fathom_vec3_max(centers.max, primitive.transform.position);
+    }
+
+    bvh->node_depth = depth > bvh->node_depth ? depth : bvh->node_depth;
+
+    if (count <= FATHOM_SDF_BVH_LEAF_PRIMITIVES)
+    {
+        node->first = first;
+        node->count = count;
+
+        return node_index;
+    }
+
+    /* Median split along the longest side of the primitive positions */
+    extent = fathom_vec3_sub(centers.max, centers.min);
+    axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+    fathom_sdf_bvh_select(bvh->scene, bvh->index_data + first, count, count / 2, axis);
+
+    node->count = 0;
+    fathom_sdf_bvh_build_node(bvh, first, count / 2, depth + 1);
+    node->first = fathom_sdf_bvh_build_node(bvh, first + count / 2, count - count / 2, depth + 1);
+
+    return node_index;
+}
+
+/* Builds the hierarchy over the primitives of the scene (again after any of them was added, removed or changed) */
+FATHOM_API void fathom_sdf_bvh_build(fathom_sdf_bvh_tree *bvh)
+{
+    u32 i;
+
+    bvh->primitive_count = bvh->scene->primitive_count;
+    bvh->primitive_first = 0;
+    bvh->blend = 0.0f;
+    bvh->node_count = 0;
+    bvh->node_depth = 0;
+
+    /* The tree starts after the last operation that is not a union */
+    for (i = 0; i < bvh->primitive_count; ++i)
+    {
+        u8 operation = bvh->scene->operation_ids[i];
+
+        if (operation != FATHOM_SDF_OPERATION_UNION_SMOOTH && operation != FATHOM_SDF_OPERATION_UNION)
+        {
+            bvh->primitive_first = i + 1;
+        }
+    }
+
+    for (i = bvh->primitive_first; i < bvh->primitive_count; ++i)
+    {
+        fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(bvh->scene, i);
+        fathom_sdf_bvh_bound *bound = &bvh->bound_data[i - bvh->primitive_first];
+
+        bvh->index_data[i - bvh->primitive_first] = i;
+        bound->bounds = fathom_sdf_scene_primitive_aabb(&primitive);
+        bound->bound_scale = fathom_sdf_scene_primitive_bound_scale(&primitive);
+
+        if (bvh->scene->operation_ids[i] == FATHOM_SDF_OPERATION_UNION_SMOOTH)
+        {
+            bvh->blend = FATHOM_SDF_SCENE_PRIMITIVE_BLEND;
+        }
+    }
+
+    bvh->reach = FATHOM_SDF_BVH_REACH * (bvh->blend + FATHOM_SDF_SCENE_PRUNE_MARGIN);
+
+    if (bvh->primitive_first < bvh->primitive_count)
+    {
+        fathom_sdf_bvh_build_node(bvh, 0, bvh->primitive_count - bvh->primitive_first, 1);
+    }
+}
+
+/* 1 if no primitive within bounds can be closer than distance at position: outside of the bounds the distance
+ * of each of them is at least the distance to the bounds times the bound scale (squared distances).
+ */
+FATHOM_API FATHOM_INLINE u8 fathom_sdf_bvh_bounds_skip(fathom_sdf_aabb *bounds, f32 bound_scale, fathom_vec3 position, f32 distance)
+{
+    f32 distance_squared = fathom_sdf_aabb_distance(position, bounds);
+
+    return distance_squared > 0.0f && (distance <= 0.0f || distance_squared * bound_scale * bound_scale >= distance * distance);
+}
+
+/* Drops the candidates further than the reach of the tree above closest, returns how many are left */
+FATHOM_API u32 fathom_sdf_bvh_candidates_compact(u32 *indices, f32 *distances, u32 count, f32 closest, f32 reach)
+{
+    u32 kept = 0;
+    u32 i;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (distances[i] < closest + reach + FATHOM_SDF_SCENE_PRUNE_MARGIN)
+        {
+            indices[kept] = indices[i];
+            distances[kept] = distances[i];
+            ++kept;
+        }
+    }
+
+    return kept;
+}
+
+/* fathom_sdf_scene at position. Visits the nodes closest first and evaluates only the primitives within the reach
+ * of the closest primitive so far, falls back to the primitives in store order if the skipped ones cannot be shown
+ * to leave the distance unchanged.
+ * stats is optional.
+ */
+FATHOM_API fathom_grid_data fathom_sdf_bvh_evaluate(fathom_sdf_bvh_tree *bvh, fathom_vec3 position, fathom_sdf_bvh_query_stats *stats)
+{
+    fathom_sdf_scene_store *scene = bvh->scene;
+    f32 ground = position.y - (-0.25f);
+    f32 closest = 1e30f;
+
+    u32 stack[FATHOM_SDF_BVH_STACK];
+    u32 stack_count = 0;
+
+    u32 candidate_indices[FATHOM_SDF_BVH_CANDIDATES];
+    f32 candidate_distances[FATHOM_SDF_BVH_CANDIDATES];
+    u32 candidate_count = 0;
+    u8 candidates_complete = 1;
+
+    f32 primitive_distance_total = 1e30f; /* very large start distance */
+    u8 primitive_material_total = 0;
+    f32 tree_distance_start;
+    u8 tree_material_start;
+    f32 skipped_min; /* Lower bound of every primitive the query did not keep */
+    f32 exact_min;   /* Lower bound of the running distance of the scene while it may differ */
+    u8 exact;        /* The running distance of the kept primitives is the one of the scene */
+
+    u32 nodes = 0;
+    u32 evaluated = 0;
+    u32 i;
+
+    fathom_grid_data d;
+    d.distance = ground;
+    d.material = 0;
+
+    /* The bounds test of fathom_sdf_scene_tape */
+    if (!bvh->primitive_count || fathom_sdf_aabb_distance(position, &scene->bounds) > d.distance)
+    {
+        return d;
+    }
+
+    for (i = 0; i < bvh->primitive_first; ++i)
+    {
+        fathom_sdf_scene_combine(&primitive_distance_total, &primitive_material_total, scene, i, fathom_sdf_scene_primitive_distance(scene, i, position));
+    }
+
+    evaluated = bvh->primitive_first;
+    tree_distance_start = primitive_distance_total;
+    tree_material_start = primitive_material_total;
+
+    if (bvh->node_count)
+    {
+        stack[stack_count++] = 0;
+    }
+
+    while (stack_count)
+    {
+        u32 node_index = stack[--stack_count];
+        fathom_sdf_bvh_node *node = &bvh->node_data[node_index];
+
+        ++nodes;
+
+        /* Closer primitives may have been found since the node was pushed, the bounds already hold the reach */
+        if (fathom_sdf_bvh_bounds_skip(&node->bounds, node->bound_scale, position, closest + FATHOM_SDF_SCENE_PRUNE_MARGIN))
+        {
+            continue;
+        }
+
+        if (node->count)
+        {
+            for (i = 0; i < node->count; ++i)
+            {
+                u32 index = bvh->index_data[node->first + i];
+                fathom_sdf_bvh_bound *bound = &bvh->bound_data[index - bvh->primitive_first];
+                f32 distance;
+
+                /* Skipped like the nodes, by the bounds of the primitive alone */
+                if (fathom_sdf_bvh_bounds_skip(&bound->bounds, bound->bound_scale, position, closest + bvh->reach + FATHOM_SDF_SCENE_PRUNE_MARGIN))
+                {
+                    continue;
+                }
+
+                distance = fathom_sdf_scene_primitive_distance(scene, index, position);
+
+                ++evaluated;
+                closest = fathom_minf(closest, distance);
+
+                if (distance >= closest + bvh->reach + FATHOM_SDF_SCENE_PRUNE_MARGIN)
+                {
+                    continue;
+                }
+
+                if (candidate_count == FATHOM_SDF_BVH_CANDIDATES)
+                {
+                    candidate_count = fathom_sdf_bvh_candidates_compact(candidate_indices, candidate_distances, candidate_count, closest, bvh->reach);
+                }
+
+                /* More primitives overlap than fit: the query runs every primitive */
+                if (candidate_count == FATHOM_SDF_BVH_CANDIDATES)
+                {
+                    candidates_complete = 0;
+                    continue;
+                }
+
+                candidate_indices[candidate_count] = index;
+                candidate_distances[candidate_count] = distance;
+                ++candidate_count;
+            }
+        }
+        else
+        {
+            u32 left = node_index + 1;
+            u32 right = node->first;
+
+            /* Closer child on top of the stack */
+            if (fathom_sdf_aabb_distance(position, &bvh->node_data[left].bounds) <= fathom_sdf_aabb_distance(position, &bvh->node_data[right].bounds))
+            {
+                stack[stack_count++] = right;
+                stack[stack_count++] = left;
+            }
+            else
+            {
+                stack[stack_count++] = left;
+                stack[stack_count++] = right;
+            }
+        }
+    }
+
+    candidate_count = fathom_sdf_bvh_candidates_compact(candidate_indices, candidate_distances, candidate_count, closest, bvh->reach);
+
+    /* Store order: the smooth unions of the linear scene */
+    for (i = 1; i < candidate_count; ++i)
+    {
+        u32 index = candidate_indices[i];
+        f32 distance = candidate_distances[i];
+        u32 j = i;
+
+        while (j > 0 && candidate_indices[j - 1] > index)
+        {
+            candidate_indices[j] = candidate_indices[j - 1];
+            candidate_distances[j] = candidate_distances[j - 1];
+            --j;
+        }
+
+        candidate_indices[j] = index;
+        candidate_distances[j] = distance;
+    }
+
+    /* The skipped primitives are at least skipped_min away. While the running distance is more than a blend range
+     * below that they leave it unchanged and the kept primitives give the exact distance. Above, they may lower the
+     * distance of the scene down to skipped_min - FATHOM_SDF_BVH_CHAIN blend ranges between any two kept primitives:
+     * the query follows the lowest distance the scene can have (exact_min) until a kept primitive is a blend range
+     * below both.
+     */
+    skipped_min = closest + bvh->reach + FATHOM_SDF_SCENE_PRUNE_MARGIN;
+    exact = 1;
+    exact_min = primitive_distance_total;
+
+    for (i = 0; i <= candidate_count; ++i)
+    {
+        f32 distance = i < candidate_count ? candidate_distances[i] : 0.0f;
+
+        if (exact && primitive_distance_total + bvh->blend + FATHOM_SDF_SCENE_PRUNE_MARGIN > skipped_min)
+        {
+            exact = 0;
+            exact_min = primitive_distance_total;
+        }
+
+        if (!exact)
+        {
+            exact_min = fathom_minf(exact_min, skipped_min - FATHOM_SDF_BVH_CHAIN * bvh->blend - FATHOM_SDF_SCENE_PRUNE_MARGIN);
+        }
+
+        if (i == candidate_count)
+        {
+            break;
+        }
+
+        /* Both the scene and the kept primitives become this primitive alone */
+        if (!exact && distance + bvh->blend + FATHOM_SDF_SCENE_PRUNE_MARGIN <= fathom_minf(exact_min, primitive_distance_total))
+        {
+            exact = 1;
+        }
+        else if (!exact)
+        {
+            /* The smooth union is monotonic in both distances, the rounding of each step is kept out of the bound */
+            exact_min = scene->operation_ids[candidate_indices[i]] == FATHOM_SDF_OPERATION_UNION_SMOOTH ? fathom_sdf_op_union_smooth(exact_min, distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND) : fathom_minf(exact_min, distance);
+            exact_min -= FATHOM_SDF_BVH_ROUNDING * (1.0f + fathom_absf(exact_min));
+        }
+
+        fathom_sdf_scene_combine(&primitive_distance_total, &primitive_material_total, scene, candidate_indices[i], distance);
+    }
+
+    /* Store order up to the first kept primitive a blend range below all skipped ones (the closest one is), the
+     * skipped primitives after it leave the distance unchanged. Without all candidates: every primitive. Of the
+     * skipped ones only those whose bounds reach within a blend range of the running distance are evaluated,
+     * the others leave it unchanged as well.
+     */
+    if (!exact || !candidates_complete)
+    {
+        u32 last = bvh->primitive_count - 1;
+        u32 next = 0;
+
+        if (candidates_complete && candidate_count)
+        {
+            for (; candidate_distances[next] + bvh->blend + FATHOM_SDF_SCENE_PRUNE_MARGIN > skipped_min; ++next)
+            {
+            }
+
+            last = candidate_indices[next];
+        }
+
+        primitive_distance_total = tree_distance_start;
+        primitive_material_total = tree_material_start;
+        next = 0;
+
+        for (i = bvh->primitive_first; i <= last; ++i)
+        {
+            fathom_sdf_bvh_bound *bound = &bvh->bound_data[i - bvh->primitive_first];
+            f32 blend_distance = primitive_distance_total + bvh->blend + FATHOM_SDF_SCENE_PRUNE_MARGIN;
+            f32 distance;
+
+            if (next < candidate_count && candidate_indices[next] == i)
+            {
+                distance = candidate_distances[next++];
+            }
+            else if ((candidates_complete && blend_distance <= skipped_min) || fathom_sdf_bvh_bounds_skip(&bound->bounds, bound->bound_scale, position, blend_distance))
+            {
+                continue;
+            }
+            else
+            {
+                distance = fathom_sdf_scene_primitive_distance(scene, i, position);
+                ++evaluated;
+            }
+
+            fathom_sdf_scene_combine(&primitive_distance_total, &primitive_material_total, scene, i, distance);
+        }
+
+        for (; next < candidate_count; ++next)
+        {
+            fathom_sdf_scene_combine(&primitive_distance_total, &primitive_material_total, scene, candidate_indices[next], candidate_distances[next]);
+        }
+
+        if (stats)
+        {
+            ++stats->fallbacks;
+        }
+    }
+
+    if (ground < primitive_distance_total)
+    {
+        primitive_material_total = 0; /* ground material id */
+    }
+
+    d.distance = fathom_sdf_op_union_smooth(ground, primitive_distance_total, FATHOM_SDF_SCENE_GROUND_BLEND);
+    d.material = primitive_material_total;
+
+    if (stats)
+    {
+        stats->nodes += nodes;
+        stats->primitives += evaluated;
+    }
+
+    return d;
+}
+
+/* fathom_grid_distance_function, user_data is the hierarchy */
+FATHOM_API fathom_grid_data fathom_sdf_bvh(fathom_vec3 position, void *user_data)
+{
+    return fathom_sdf_bvh_evaluate((fathom_sdf_bvh_tree *)user_data, position, FATHOM_NULL);
+}
+
+/* fathom_grid_distance_function_batch of the scene of the hierarchy: over whole rows the SIMD lanes of
+ * fathom_sdf_scene_batch are faster than one query of the hierarchy per position.
+ */
+FATHOM_API void fathom_sdf_bvh_batch(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, void *user_data)
+{
+    fathom_sdf_scene_batch(x, y, z, count, distances, materials, ((fathom_sdf_bvh_tree *)user_data)->scene);
+}
+
+/* fathom_grid_distance_function_interval of the scene of the hierarchy */
+FATHOM_API void fathom_sdf_bvh_interval(fathom_vec3 box_min, fathom_vec3 box_max, f32 *distance_min, f32 *distance_max, void *user_data)
+{
+    fathom_sdf_scene_interval(box_min, box_max, distance_min, distance_max, ((fathom_sdf_bvh_tree *)user_data)->scene);
+}
+
+/* fathom_grid_distance_function_prune and _tape of the scene of the hierarchy: a tape pruned to a brick
+ * already holds only the primitives near it, the brick fills run it instead of one query per voxel.
+ */
+FATHOM_API u8 fathom_sdf_bvh_prune(fathom_vec3 box_min, fathom_vec3 box_max, fathom_grid_tape *tape, void *user_data)
+{
+    return fathom_sdf_scene_prune(box_min, box_max, tape, ((fathom_sdf_bvh_tree *)user_data)->scene);
+}
+
+FATHOM_API void fathom_sdf_bvh_batch_tape(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, fathom_grid_tape *tape, void *user_data)
+{
+    fathom_sdf_scene_batch_tape(x, y, z, count, distances, materials, tape, ((fathom_sdf_bvh_tree *)user_data)->scene);
+}
+
+/* fathom_grid_distance with the hierarchy for the point queries, the passes over the whole grid run the batches
+ * and tapes of the scene.
+ */
+FATHOM_API fathom_grid_distance fathom_sdf_bvh_distance(fathom_sdf_bvh_tree *bvh)
+{
+    fathom_grid_distance distance;
+
+    distance.function = fathom_sdf_bvh;
+    distance.function_batch = fathom_sdf_bvh_batch;
+    distance.function_interval = fathom_sdf_bvh_interval;
+    distance.function_prune = fathom_sdf_bvh_prune;
+    distance.function_tape = fathom_sdf_bvh_batch_tape;
+    distance.user_data = bvh;
+
+    return distance;
+}
+
+#endif /* FATHOM_SDF_BVH_H */
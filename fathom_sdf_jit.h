@@ -0,0 +1,911 @@
+#ifndef FATHOM_SDF_JIT_H
+#define FATHOM_SDF_JIT_H
+
+#include "fathom_types.h"
+#include "fathom_profiler.h"
+#include "fathom_sdf_vm.h"
+
+/* #############################################################################
+ * # [SECTION] SDF JIT
+ * #############################################################################
+ *
+ * Translates a fathom_sdf_vm_program into x86-64 SSE2 machine code. The code runs
+ * the instructions of the interpreter without the dispatch: every instruction
+ * becomes a fixed sequence of SSE2 operations on both packets, the parameters
+ * are folded into a pool of splatted constants in front of the code (RIP relative),
+ * the registers of the program stay in a frame in memory.
+ * The operations are the ones of fathom_math_sdf_sse2.h in the same order, so the
+ * results are bit for bit those of fathom_sdf_vm_evaluate_batch.
+ *
+ * The caller provides the code memory (read and write while compiling, then
+ * executable). Without code memory, on other architectures and in the scalar
+ * build every evaluation runs on the interpreter instead.
+ * win32_fathom.c runs the code with the Microsoft x64 calling convention,
+ * linux_fathom.c (jit benchmark) with the System V one.
+ *
+ * The code always evaluates the whole program for 8 positions per call, so single
+ * positions run on the interpreter. It keeps the registers in memory and grows by
+ * about 1 KB per primitive: for scenes of a few hundred primitives it is about as
+ * fast as fathom_sdf_scene_batch and can be slower, fathom_sdf_jit_faster measures
+ * which of the two a caller should use.
+ */
+#define FATHOM_SDF_JIT_CODE_BYTES (4 * 1024 * 1024) /* The program of a scene store of 1024 primitives, see FATHOM_SDF_VM_MAX_INSTRUCTIONS */
+#define FATHOM_SDF_JIT_MAX_CONSTANTS 32768
+#define FATHOM_SDF_JIT_CONSTANT_HASH_BITS 16
+#define FATHOM_SDF_JIT_CONSTANT_HASH (1 << FATHOM_SDF_JIT_CONSTANT_HASH_BITS) /* Twice the constants */
+#define FATHOM_SDF_JIT_MEASURE_ROW 64 /* Positions per batch of fathom_sdf_jit_faster */
+#define FATHOM_SDF_JIT_MEASURE_ROWS 8 /* Rows along x per axis of fathom_sdf_jit_faster */
+
+typedef void (*fathom_sdf_jit_function)(void *frame);
+
+typedef struct fathom_sdf_jit_program
+{
+    fathom_sdf_vm_program *program; /* Source of the code, evaluated by the interpreter without code */
+    fathom_sdf_jit_function function; /* Compiled program, FATHOM_NULL if the interpreter runs */
+
+    u8 *code;
+    u32 code_capacity;
+    u32 code_size; /* Constant pool and code */
+
+    /* Assembler: pass 0 measures the code and collects the constants, pass 1 writes both */
+    u32 pass;
+    u32 position;   /* Next byte of code, relative to code_start */
+    u32 code_start; /* Bytes of the constant pool in front of the code */
+    u8 error;
+
+    u32 constants[FATHOM_SDF_JIT_MAX_CONSTANTS];
+    u32 constant_count;
+    u16 constant_hash[FATHOM_SDF_JIT_CONSTANT_HASH]; /* Constant index + 1, 0 is empty */
+    u32 instruction_offsets[FATHOM_SDF_VM_MAX_INSTRUCTIONS + 1];
+
+} fathom_sdf_jit_program;
+
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+/* Memory of one call: the registers of the program for both packets and the callee saved registers of the caller */
+typedef struct fathom_sdf_jit_frame
+{
+    fathom_sdf_vm_registers registers;
+    __m128 saved[10]; /* xmm6 to xmm15, callee saved on Windows x64 */
+
+} fathom_sdf_jit_frame;
+
+/* Byte offsets into fathom_sdf_jit_frame */
+#define FATHOM_SDF_JIT_POSITION(p, k, axis) (((((p) * FATHOM_SDF_VM_PACKETS) + (k)) * 3 + (axis)) * 16)
+#define FATHOM_SDF_JIT_DISTANCE(r, k) (FATHOM_SDF_JIT_POSITION(FATHOM_SDF_VM_POSITION_REGISTERS, 0, 0) + (((r) * FATHOM_SDF_VM_PACKETS) + (k)) * 16)
+#define FATHOM_SDF_JIT_MATERIAL(r, k) (FATHOM_SDF_JIT_DISTANCE(FATHOM_SDF_VM_REGISTERS, 0) + (((r) * FATHOM_SDF_VM_PACKETS) + (k)) * 16)
+#define FATHOM_SDF_JIT_SAVED(i) (FATHOM_SDF_JIT_MATERIAL(FATHOM_SDF_VM_REGISTERS, 0) + (i) * 16)
+
+/* Second opcode byte of the SSE instructions (after 0x0F) */
+#define FATHOM_SDF_JIT_MOVMSKPS 0x50
+#define FATHOM_SDF_JIT_SQRTPS 0x51
+#define FATHOM_SDF_JIT_ANDPS 0x54
+#define FATHOM_SDF_JIT_ANDNPS 0x55
+#define FATHOM_SDF_JIT_ORPS 0x56
+#define FATHOM_SDF_JIT_XORPS 0x57
+#define FATHOM_SDF_JIT_ADDPS 0x58
+#define FATHOM_SDF_JIT_MULPS 0x59
+#define FATHOM_SDF_JIT_CVT 0x5B /* cvtdq2ps, with 0x66 cvtps2dq, with 0xF3 cvttps2dq */
+#define FATHOM_SDF_JIT_SUBPS 0x5C
+#define FATHOM_SDF_JIT_MINPS 0x5D
+#define FATHOM_SDF_JIT_DIVPS 0x5E
+#define FATHOM_SDF_JIT_MAXPS 0x5F
+#define FATHOM_SDF_JIT_MOVAPS 0x28
+#define FATHOM_SDF_JIT_MOVAPS_STORE 0x29
+#define FATHOM_SDF_JIT_CMPPS 0xC2
+
+#define FATHOM_SDF_JIT_CMP_LT 1
+#define FATHOM_SDF_JIT_CMP_LE 2
+
+#define FATHOM_SDF_JIT_ABS_MASK 0x7FFFFFFF
+#define FATHOM_SDF_JIT_SIGN_MASK 0x80000000
+
+FATHOM_API void fathom_sdf_jit_byte(fathom_sdf_jit_program *jit, u32 value)
+{
+    if (jit->pass == 1)
+    {
+        if (jit->code_start + jit->position < jit->code_capacity)
+        {
+            jit->code[jit->code_start + jit->position] = (u8)value;
+        }
+        else
+        {
+            jit->error = 1;
+        }
+    }
+
+    jit->position++;
+}
+
+FATHOM_API void fathom_sdf_jit_u32(fathom_sdf_jit_program *jit, u32 value)
+{
+    fathom_sdf_jit_byte(jit, value & 0xFF);
+    fathom_sdf_jit_byte(jit, (value >> 8) & 0xFF);
+    fathom_sdf_jit_byte(jit, (value >> 16) & 0xFF);
+    fathom_sdf_jit_byte(jit, (value >> 24) & 0xFF);
+}
+
+/* Pool index of the splatted 32 bit value, added in pass 0 */
+FATHOM_API u32 fathom_sdf_jit_constant(fathom_sdf_jit_program *jit, u32 bits)
+{
+    u32 slot = (bits * 2654435761u) >> (32 - FATHOM_SDF_JIT_CONSTANT_HASH_BITS);
+
+    for (;;)
+    {
+        u32 entry = jit->constant_hash[slot & (FATHOM_SDF_JIT_CONSTANT_HASH - 1)];
+
+        if (entry == 0)
+        {
+            break;
+        }
+
+        if (jit->constants[entry - 1] == bits)
+        {
+            return entry - 1;
+        }
+
+        ++slot;
+    }
+
+    if (jit->pass != 0 || jit->constant_count >= FATHOM_SDF_JIT_MAX_CONSTANTS)
+    {
+        jit->error = 1;
+        return 0;
+    }
+
+    jit->constants[jit->constant_count] = bits;
+    jit->constant_hash[slot & (FATHOM_SDF_JIT_CONSTANT_HASH - 1)] = (u16)(jit->constant_count + 1);
+
+    return jit->constant_count++;
+}
+
+FATHOM_API u32 fathom_sdf_jit_f32_bits(f32 value)
+{
+    union
+    {
+        f32 f;
+        u32 u;
+    } bits;
+
+    bits.f = value;
+
+    return bits.u;
+}
+
+/* [prefix] [REX] 0F opcode with both operands in registers (xmm, or a general register for movmskps) */
+FATHOM_API void fathom_sdf_jit_sse(fathom_sdf_jit_program *jit, u32 prefix, u32 opcode, u32 dst, u32 src)
+{
+    if (prefix)
+    {
+        fathom_sdf_jit_byte(jit, prefix);
+    }
+
+    if (dst >= 8 || src >= 8)
+    {
+        fathom_sdf_jit_byte(jit, 0x40 | ((dst >> 3) << 2) | (src >> 3));
+    }
+
+    fathom_sdf_jit_byte(jit, 0x0F);
+    fathom_sdf_jit_byte(jit, opcode);
+    fathom_sdf_jit_byte(jit, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+/* Operand in the frame: [rax + offset] */
+FATHOM_API void fathom_sdf_jit_sse_frame(fathom_sdf_jit_program *jit, u32 opcode, u32 reg, u32 offset)
+{
+    if (reg >= 8)
+    {
+        fathom_sdf_jit_byte(jit, 0x44);
+    }
+
+    fathom_sdf_jit_byte(jit, 0x0F);
+    fathom_sdf_jit_byte(jit, opcode);
+    fathom_sdf_jit_byte(jit, 0x80 | ((reg & 7) << 3));
+    fathom_sdf_jit_u32(jit, offset);
+}
+
+/* Operand in the constant pool: [rip + displacement] */
+FATHOM_API void fathom_sdf_jit_sse_bits(fathom_sdf_jit_program *jit, u32 opcode, u32 reg, u32 bits)
+{
+    u32 index = fathom_sdf_jit_constant(jit, bits);
+
+    if (reg >= 8)
+    {
+        fathom_sdf_jit_byte(jit, 0x44);
+    }
+
+    fathom_sdf_jit_byte(jit, 0x0F);
+    fathom_sdf_jit_byte(jit, opcode);
+    fathom_sdf_jit_byte(jit, 0x05 | ((reg & 7) << 3));
+    fathom_sdf_jit_u32(jit, index * 16 - (jit->code_start + jit->position + 4));
+}
+
+FATHOM_API void fathom_sdf_jit_sse_f32(fathom_sdf_jit_program *jit, u32 opcode, u32 reg, f32 value)
+{
+    fathom_sdf_jit_sse_bits(jit, opcode, reg, fathom_sdf_jit_f32_bits(value));
+}
+
+FATHOM_API void fathom_sdf_jit_op(fathom_sdf_jit_program *jit, u32 opcode, u32 dst, u32 src)
+{
+    fathom_sdf_jit_sse(jit, 0, opcode, dst, src);
+}
+
+FATHOM_API void fathom_sdf_jit_load(fathom_sdf_jit_program *jit, u32 reg, u32 offset)
+{
+    fathom_sdf_jit_sse_frame(jit, FATHOM_SDF_JIT_MOVAPS, reg, offset);
+}
+
+FATHOM_API void fathom_sdf_jit_store(fathom_sdf_jit_program *jit, u32 offset, u32 reg)
+{
+    fathom_sdf_jit_sse_frame(jit, FATHOM_SDF_JIT_MOVAPS_STORE, reg, offset);
+}
+
+FATHOM_API void fathom_sdf_jit_cmp(fathom_sdf_jit_program *jit, u32 dst, u32 src, u32 predicate)
+{
+    fathom_sdf_jit_sse(jit, 0, FATHOM_SDF_JIT_CMPPS, dst, src);
+    fathom_sdf_jit_byte(jit, predicate);
+}
+
+FATHOM_API void fathom_sdf_jit_zero(fathom_sdf_jit_program *jit, u32 reg)
+{
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_XORPS, reg, reg);
+}
+
+/* xmm0..2 = position register p of packet k */
+FATHOM_API void fathom_sdf_jit_load_position(fathom_sdf_jit_program *jit, u32 p, u32 k)
+{
+    fathom_sdf_jit_load(jit, 0, FATHOM_SDF_JIT_POSITION(p, k, 0));
+    fathom_sdf_jit_load(jit, 1, FATHOM_SDF_JIT_POSITION(p, k, 1));
+    fathom_sdf_jit_load(jit, 2, FATHOM_SDF_JIT_POSITION(p, k, 2));
+}
+
+FATHOM_API void fathom_sdf_jit_store_position(fathom_sdf_jit_program *jit, u32 p, u32 k, u32 x, u32 y, u32 z)
+{
+    fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_POSITION(p, k, 0), x);
+    fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_POSITION(p, k, 1), y);
+    fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_POSITION(p, k, 2), z);
+}
+
+/* Distance register r of packet k = xmm d, material = e */
+FATHOM_API void fathom_sdf_jit_store_primitive(fathom_sdf_jit_program *jit, u32 r, u32 k, u32 d, u32 material)
+{
+    fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_DISTANCE(r, k), d);
+    fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_MOVAPS, 15, material);
+    fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_MATERIAL(r, k), 15);
+}
+
+/* dst = sqrt((a*a + b*b) + c*c) like fathom_lengthf_x4 */
+FATHOM_API void fathom_sdf_jit_length(fathom_sdf_jit_program *jit, u32 dst, u32 a, u32 b, u32 c, u32 temp)
+{
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, dst, a);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, dst, dst);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, temp, b);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, temp, temp);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, dst, temp);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, temp, c);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, temp, temp);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, dst, temp);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SQRTPS, dst, dst);
+}
+
+/* dst = length(max(a, 0), max(b, 0), max(c, 0)) + min(max(a, max(b, c)), 0), one term of fathom_sdf_box_x4
+ * and fathom_sdf_box_frame_x4. xmm6 holds zero, clobbers xmm7..11.
+ */
+FATHOM_API void fathom_sdf_jit_box_term(fathom_sdf_jit_program *jit, u32 dst, u32 a, u32 b, u32 c)
+{
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 7, a);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 7, 6);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 8, b);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 8, 6);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 9, c);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 9, 6);
+    fathom_sdf_jit_length(jit, 10, 7, 8, 9, 11);
+
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 11, b);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 11, c);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 7, a);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 7, 11);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MINPS, 7, 6);
+
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 10, 7);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, dst, 10);
+}
+
+/* xmm(axis) = |xmm(axis)| - base for x, y and z */
+FATHOM_API void fathom_sdf_jit_abs_sub(fathom_sdf_jit_program *jit, f32 *base)
+{
+    u32 axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, axis, FATHOM_SDF_JIT_ABS_MASK);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, axis, base[axis]);
+    }
+}
+
+/* xmm2 = fathom_sdf_op_union_smooth_x4(a, b, k), clobbers xmm3..5 */
+FATHOM_API void fathom_sdf_jit_union_smooth(fathom_sdf_jit_program *jit, u32 a, u32 b, f32 k)
+{
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3, a);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SUBPS, 3, b);
+    fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, 3, FATHOM_SDF_JIT_ABS_MASK);
+    fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MOVAPS, 4, k);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SUBPS, 4, 3);
+    fathom_sdf_jit_zero(jit, 5);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 4, 5);
+    fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_DIVPS, 4, k);
+
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 5, 4);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, 5, 4);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, 5, 4);
+    fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 5, k);
+    fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 5, 1.0f / 6.0f);
+
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 2, a);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MINPS, 2, b);
+    fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SUBPS, 2, 5);
+}
+
+/* Code of one instruction for packet k */
+FATHOM_API void fathom_sdf_jit_instruction(fathom_sdf_jit_program *jit, fathom_sdf_vm_instruction *in, f32 *c, u32 k)
+{
+    u32 axis;
+
+    switch (in->opcode)
+    {
+    case FATHOM_SDF_VM_OP_TRANSLATE:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, axis, c[axis]);
+        }
+        fathom_sdf_jit_store_position(jit, in->dst, k, 0, 1, 2);
+        break;
+    case FATHOM_SDF_VM_OP_ROTATE:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3 + axis, 0);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 3 + axis, c[axis * 3 + 0]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 6, 1);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 6, c[axis * 3 + 1]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3 + axis, 6);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 6, 2);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 6, c[axis * 3 + 2]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3 + axis, 6);
+        }
+        fathom_sdf_jit_store_position(jit, in->dst, k, 3, 4, 5);
+        break;
+    case FATHOM_SDF_VM_OP_SCALE:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_DIVPS, axis, c[0]);
+        }
+        fathom_sdf_jit_store_position(jit, in->dst, k, 0, 1, 2);
+        break;
+    case FATHOM_SDF_VM_OP_SYMMETRIC_X:
+    case FATHOM_SDF_VM_OP_SYMMETRIC_XZ:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, 0, FATHOM_SDF_JIT_ABS_MASK);
+        if (in->opcode == FATHOM_SDF_VM_OP_SYMMETRIC_XZ)
+        {
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, 2, FATHOM_SDF_JIT_ABS_MASK);
+        }
+        fathom_sdf_jit_store_position(jit, in->dst, k, 0, 1, 2);
+        break;
+    case FATHOM_SDF_VM_OP_REPEAT:
+        /* p - s * (f32)(i32)(p / s + (p / s >= 0 ? 0.5 : -0.5)), see fathom_sdf_round_away_x4 */
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3, axis);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_DIVPS, 3, c[axis]);
+            fathom_sdf_jit_zero(jit, 4);
+            fathom_sdf_jit_cmp(jit, 4, 3, FATHOM_SDF_JIT_CMP_LE);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 5, 4);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_ANDPS, 5, 0.5f);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_ANDNPS, 4, -0.5f);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ORPS, 5, 4);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3, 5);
+            fathom_sdf_jit_sse(jit, 0xF3, FATHOM_SDF_JIT_CVT, 3, 3);
+            fathom_sdf_jit_sse(jit, 0, FATHOM_SDF_JIT_CVT, 3, 3);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 3, c[axis]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SUBPS, axis, 3);
+        }
+        fathom_sdf_jit_store_position(jit, in->dst, k, 0, 1, 2);
+        break;
+    case FATHOM_SDF_VM_OP_REPEAT_LIMITED:
+        /* p - s * clamp(round(p / s), -l, l), see fathom_sdf_round_clamp_x4 */
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3, axis);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_DIVPS, 3, c[0]);
+            fathom_sdf_jit_sse(jit, 0x66, FATHOM_SDF_JIT_CVT, 3, 3);
+            fathom_sdf_jit_sse(jit, 0, FATHOM_SDF_JIT_CVT, 3, 3);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MAXPS, 3, -c[1 + axis]);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MINPS, 3, c[1 + axis]);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 3, c[0]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SUBPS, axis, 3);
+        }
+        fathom_sdf_jit_store_position(jit, in->dst, k, 0, 1, 2);
+        break;
+
+    case FATHOM_SDF_VM_OP_PLANE:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3, 0);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 3, c[0]);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 4, 1);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 4, c[1]);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3, 4);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 4, 2);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 4, c[2]);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3, 4);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 3, c[3]);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 3, in->e);
+        break;
+    case FATHOM_SDF_VM_OP_SPHERE:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        fathom_sdf_jit_length(jit, 3, 0, 1, 2, 4);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 3, c[0]);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 3, in->e);
+        break;
+    case FATHOM_SDF_VM_OP_BOX:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        fathom_sdf_jit_abs_sub(jit, c);
+        fathom_sdf_jit_zero(jit, 6);
+        fathom_sdf_jit_box_term(jit, 12, 0, 1, 2);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 12, in->e);
+        break;
+    case FATHOM_SDF_VM_OP_BOX_FRAME:
+        /* p in xmm0..2, q = |p + e| - e in xmm3..5 */
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        fathom_sdf_jit_abs_sub(jit, c);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3 + axis, axis);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_ADDPS, 3 + axis, c[3]);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, 3 + axis, FATHOM_SDF_JIT_ABS_MASK);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 3 + axis, c[3]);
+        }
+        fathom_sdf_jit_zero(jit, 6);
+        fathom_sdf_jit_box_term(jit, 12, 0, 4, 5);
+        fathom_sdf_jit_box_term(jit, 13, 3, 1, 5);
+        fathom_sdf_jit_box_term(jit, 14, 3, 4, 2);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MINPS, 12, 13);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MINPS, 12, 14);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 12, in->e);
+        break;
+    case FATHOM_SDF_VM_OP_ELLIPSOID:
+        /* k0 in xmm6, k1 in xmm8, k0 - 1 in xmm9 */
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3 + axis, axis);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_DIVPS, 3 + axis, c[axis]);
+        }
+        fathom_sdf_jit_length(jit, 6, 3, 4, 5, 7);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3 + axis, axis);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_DIVPS, 3 + axis, c[axis] * c[axis]);
+        }
+        fathom_sdf_jit_length(jit, 8, 3, 4, 5, 7);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 9, 6);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 9, 1.0f);
+
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 10, 6);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MOVAPS, 11, 1.0f);
+        fathom_sdf_jit_cmp(jit, 10, 11, FATHOM_SDF_JIT_CMP_LT);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 12, 9);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 12, fathom_minf(c[0], fathom_minf(c[1], c[2])));
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 13, 6);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, 13, 9);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_DIVPS, 13, 8);
+
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ANDPS, 12, 10);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ANDNPS, 10, 13);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ORPS, 12, 10);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 12, in->e);
+        break;
+    case FATHOM_SDF_VM_OP_OCTAHEDRON:
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, axis, FATHOM_SDF_JIT_ABS_MASK);
+        }
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3, 0);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3, 1);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 3, 2);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 3, c[0]);
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 3, 0.57735027f);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 3, in->e);
+        break;
+    case FATHOM_SDF_VM_OP_CONSTANT:
+        fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MOVAPS, 0, c[0]);
+        fathom_sdf_jit_store_primitive(jit, in->dst, k, 0, in->e);
+        break;
+
+    case FATHOM_SDF_VM_OP_UNION:
+    case FATHOM_SDF_VM_OP_SUBTRACT:
+    case FATHOM_SDF_VM_OP_INTERSECT:
+    case FATHOM_SDF_VM_OP_XOR:
+    case FATHOM_SDF_VM_OP_UNION_SMOOTH:
+    case FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH:
+    case FATHOM_SDF_VM_OP_INTERSECT_SMOOTH:
+        /* a in xmm0, b in xmm1, the distance ends up in xmm2 */
+        fathom_sdf_jit_load(jit, 0, FATHOM_SDF_JIT_DISTANCE(in->a, k));
+        fathom_sdf_jit_load(jit, 1, FATHOM_SDF_JIT_DISTANCE(in->b, k));
+
+        switch (in->opcode)
+        {
+        case FATHOM_SDF_VM_OP_UNION:
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 2, 0);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MINPS, 2, 1);
+            break;
+        case FATHOM_SDF_VM_OP_SUBTRACT:
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 2, 0);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 2, FATHOM_SDF_JIT_SIGN_MASK);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 2, 1);
+            break;
+        case FATHOM_SDF_VM_OP_INTERSECT:
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 2, 0);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 2, 1);
+            break;
+        case FATHOM_SDF_VM_OP_XOR:
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 2, 0);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MINPS, 2, 1);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 3, 0);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 3, 1);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 3, FATHOM_SDF_JIT_SIGN_MASK);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 2, 3);
+            break;
+        case FATHOM_SDF_VM_OP_UNION_SMOOTH:
+            fathom_sdf_jit_union_smooth(jit, 0, 1, c[0]);
+            break;
+        case FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH:
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 9, 1);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 9, FATHOM_SDF_JIT_SIGN_MASK);
+            fathom_sdf_jit_union_smooth(jit, 0, 9, c[0]);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 2, FATHOM_SDF_JIT_SIGN_MASK);
+            break;
+        default:
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 9, 1);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 9, FATHOM_SDF_JIT_SIGN_MASK);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 10, 0);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 10, FATHOM_SDF_JIT_SIGN_MASK);
+            fathom_sdf_jit_union_smooth(jit, 10, 9, c[0]);
+            fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_XORPS, 2, FATHOM_SDF_JIT_SIGN_MASK);
+            break;
+        }
+
+        /* Material of b where b < a, see fathom_sdf_vm_closer_x4 */
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 6, 1);
+        fathom_sdf_jit_cmp(jit, 6, 0, FATHOM_SDF_JIT_CMP_LT);
+        fathom_sdf_jit_load(jit, 7, FATHOM_SDF_JIT_MATERIAL(in->a, k));
+        fathom_sdf_jit_load(jit, 8, FATHOM_SDF_JIT_MATERIAL(in->b, k));
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ANDPS, 8, 6);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ANDNPS, 6, 7);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ORPS, 6, 8);
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_MATERIAL(in->dst, k), 6);
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_DISTANCE(in->dst, k), 2);
+        break;
+    case FATHOM_SDF_VM_OP_MUL:
+    case FATHOM_SDF_VM_OP_ROUND:
+    case FATHOM_SDF_VM_OP_ONION:
+        fathom_sdf_jit_load(jit, 0, FATHOM_SDF_JIT_DISTANCE(in->a, k));
+        if (in->opcode == FATHOM_SDF_VM_OP_MUL)
+        {
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MULPS, 0, c[0]);
+        }
+        else
+        {
+            if (in->opcode == FATHOM_SDF_VM_OP_ONION)
+            {
+                fathom_sdf_jit_sse_bits(jit, FATHOM_SDF_JIT_ANDPS, 0, FATHOM_SDF_JIT_ABS_MASK);
+            }
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 0, c[0]);
+        }
+        fathom_sdf_jit_load(jit, 1, FATHOM_SDF_JIT_MATERIAL(in->a, k));
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_MATERIAL(in->dst, k), 1);
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_DISTANCE(in->dst, k), 0);
+        break;
+
+    case FATHOM_SDF_VM_OP_BOUND:
+        /* Squared distance to the box in xmm7, see fathom_sdf_aabb_distance_x4. The lane mask goes to ecx (packet 0) or edx. */
+        fathom_sdf_jit_load_position(jit, in->a, k);
+        for (axis = 0; axis < 3; ++axis)
+        {
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_MOVAPS, 3, c[axis]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_SUBPS, 3, axis);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 4, axis);
+            fathom_sdf_jit_sse_f32(jit, FATHOM_SDF_JIT_SUBPS, 4, c[3 + axis]);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 3, 4);
+            fathom_sdf_jit_zero(jit, 5);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MAXPS, 3, 5);
+            fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 7 + axis, 3);
+        }
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, 7, 7);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, 8, 8);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 7, 8);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MULPS, 9, 9);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ADDPS, 7, 9);
+        fathom_sdf_jit_load(jit, 4, FATHOM_SDF_JIT_DISTANCE(in->b, k));
+        fathom_sdf_jit_cmp(jit, 7, 4, FATHOM_SDF_JIT_CMP_LE);
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_DISTANCE(in->dst, k), 7);
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVMSKPS, 1 + k, 7);
+        break;
+    case FATHOM_SDF_VM_OP_SELECT:
+        fathom_sdf_jit_load(jit, 0, FATHOM_SDF_JIT_DISTANCE(in->c, k));
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 1, 0);
+        fathom_sdf_jit_sse_frame(jit, FATHOM_SDF_JIT_ANDPS, 1, FATHOM_SDF_JIT_DISTANCE(in->a, k));
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 2, 0);
+        fathom_sdf_jit_sse_frame(jit, FATHOM_SDF_JIT_ANDNPS, 2, FATHOM_SDF_JIT_DISTANCE(in->b, k));
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ORPS, 1, 2);
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_DISTANCE(in->dst, k), 1);
+
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_MOVAPS, 1, 0);
+        fathom_sdf_jit_sse_frame(jit, FATHOM_SDF_JIT_ANDPS, 1, FATHOM_SDF_JIT_MATERIAL(in->a, k));
+        fathom_sdf_jit_sse_frame(jit, FATHOM_SDF_JIT_ANDNPS, 0, FATHOM_SDF_JIT_MATERIAL(in->b, k));
+        fathom_sdf_jit_op(jit, FATHOM_SDF_JIT_ORPS, 1, 0);
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_MATERIAL(in->dst, k), 1);
+        break;
+    default:
+        break;
+    }
+}
+
+/* One pass over the program: prologue, the instructions for both packets, epilogue */
+FATHOM_API void fathom_sdf_jit_assemble(fathom_sdf_jit_program *jit)
+{
+    fathom_sdf_vm_program *program = jit->program;
+    u32 i, k;
+
+    /* The frame pointer (first argument) goes to rax */
+    fathom_sdf_jit_byte(jit, 0x48);
+    fathom_sdf_jit_byte(jit, 0x89);
+#if defined(_WIN32)
+    fathom_sdf_jit_byte(jit, 0xC8); /* mov rax, rcx */
+
+    for (i = 0; i < 10; ++i)
+    {
+        fathom_sdf_jit_store(jit, FATHOM_SDF_JIT_SAVED(i), 6 + i);
+    }
+#else
+    fathom_sdf_jit_byte(jit, 0xF8); /* mov rax, rdi */
+#endif
+
+    for (i = 0; i < program->instruction_count; ++i)
+    {
+        fathom_sdf_vm_instruction *in = &program->instructions[i];
+
+        jit->instruction_offsets[i] = jit->position;
+
+        for (k = 0; k < FATHOM_SDF_VM_PACKETS; ++k)
+        {
+            fathom_sdf_jit_instruction(jit, in, program->constants + in->c, k);
+        }
+
+        if (in->opcode == FATHOM_SDF_VM_OP_BOUND)
+        {
+            /* or ecx, edx; jz past the skipped instructions (their offsets are known from pass 0) */
+            fathom_sdf_jit_byte(jit, 0x09);
+            fathom_sdf_jit_byte(jit, 0xD1);
+            fathom_sdf_jit_byte(jit, 0x0F);
+            fathom_sdf_jit_byte(jit, 0x84);
+            fathom_sdf_jit_u32(jit, jit->pass ? jit->instruction_offsets[i + 1 + in->e] - (jit->position + 4) : 0);
+        }
+    }
+
+    jit->instruction_offsets[program->instruction_count] = jit->position;
+
+#if defined(_WIN32)
+    for (i = 0; i < 10; ++i)
+    {
+        fathom_sdf_jit_load(jit, 6 + i, FATHOM_SDF_JIT_SAVED(i));
+    }
+#endif
+
+    fathom_sdf_jit_byte(jit, 0xC3); /* ret */
+}
+#endif
+
+/* Compiles program into code (code_capacity bytes, 16 byte aligned, writable). The code has to be made
+ * executable before the first evaluation. Returns 0 if the program runs on the interpreter instead:
+ * no code memory, not enough of it, too many constants or no SSE2 x86-64 build.
+ * The program has to outlive the jit.
+ */
+FATHOM_API u8 fathom_sdf_jit_compile(fathom_sdf_jit_program *jit, fathom_sdf_vm_program *program, u8 *code, u32 code_capacity)
+{
+    jit->program = program;
+    jit->function = FATHOM_NULL;
+    jit->code = code;
+    jit->code_capacity = code_capacity;
+    jit->code_size = 0;
+
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+    {
+        union
+        {
+            u8 *code;
+            fathom_sdf_jit_function function;
+        } entry;
+
+        u32 i;
+
+        if (!code || program->error)
+        {
+            return 0;
+        }
+
+        jit->error = 0;
+        jit->constant_count = 0;
+
+        for (i = 0; i < FATHOM_SDF_JIT_CONSTANT_HASH; ++i)
+        {
+            jit->constant_hash[i] = 0;
+        }
+
+        for (jit->pass = 0; jit->pass < 2; ++jit->pass)
+        {
+            jit->position = 0;
+            jit->code_start = jit->constant_count * 16;
+
+            fathom_sdf_jit_assemble(jit);
+
+            if (jit->error || jit->code_start + jit->position > code_capacity)
+            {
+                return 0;
+            }
+        }
+
+        for (i = 0; i < jit->constant_count * 16; ++i)
+        {
+            code[i] = (u8)(jit->constants[i / 16] >> ((i % 4) * 8));
+        }
+
+        jit->code_size = jit->code_start + jit->position;
+
+        entry.code = code + jit->code_start;
+        jit->function = entry.function;
+
+        return 1;
+    }
+#else
+    return 0;
+#endif
+}
+
+/* Evaluates count positions given as struct of arrays, 8 per call of the code (fathom_sdf_vm_evaluate_batch without code) */
+FATHOM_API void fathom_sdf_jit_evaluate_batch(fathom_sdf_jit_program *jit, f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials)
+{
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+    fathom_sdf_jit_frame frame;
+    u32 lanes = 4 * FATHOM_SDF_VM_PACKETS;
+    u32 i;
+
+    if (!jit->function)
+    {
+        fathom_sdf_vm_evaluate_batch(jit->program, x, y, z, count, distances, materials, FATHOM_SDF_VM_PACKETS);
+        return;
+    }
+
+    for (i = 0; i < count; i += lanes)
+    {
+        f32 lane_x[4 * FATHOM_SDF_VM_PACKETS];
+        f32 lane_y[4 * FATHOM_SDF_VM_PACKETS];
+        f32 lane_z[4 * FATHOM_SDF_VM_PACKETS];
+        f32 lane_distance[4 * FATHOM_SDF_VM_PACKETS];
+        i32 lane_material[4 * FATHOM_SDF_VM_PACKETS];
+        u32 lane_count = (count - i) < lanes ? (count - i) : lanes;
+        u32 j, k;
+
+        /* Pad the last pass by repeating its last position */
+        for (j = 0; j < lanes; ++j)
+        {
+            u32 source = i + (j < lane_count ? j : lane_count - 1);
+            lane_x[j] = x[source];
+            lane_y[j] = y[source];
+            lane_z[j] = z[source];
+        }
+
+        for (k = 0; k < FATHOM_SDF_VM_PACKETS; ++k)
+        {
+            frame.registers.position[0][k] = fathom_vec3x4_load(lane_x + (4 * k), lane_y + (4 * k), lane_z + (4 * k));
+        }
+
+        jit->function(&frame);
+
+        for (k = 0; k < FATHOM_SDF_VM_PACKETS; ++k)
+        {
+            _mm_storeu_ps(lane_distance + (4 * k), frame.registers.distance[jit->program->result][k]);
+            _mm_storeu_si128((__m128i *)(lane_material + (4 * k)), frame.registers.material[jit->program->result][k]);
+        }
+
+        for (j = 0; j < lane_count; ++j)
+        {
+            distances[i + j] = lane_distance[j];
+            materials[i + j] = (u8)lane_material[j];
+        }
+    }
+#else
+    fathom_sdf_vm_evaluate_batch(jit->program, x, y, z, count, distances, materials, 1);
+#endif
+}
+
+/* Grid callbacks, user_data is the jit (fathom_grid_distance_function and fathom_grid_distance_function_batch).
+ * One position runs on the interpreter, the code would evaluate 8.
+ */
+FATHOM_API fathom_grid_data fathom_sdf_jit(fathom_vec3 position, void *user_data)
+{
+    return fathom_sdf_vm_evaluate(((fathom_sdf_jit_program *)user_data)->program, position);
+}
+
+FATHOM_API void fathom_sdf_jit_batch(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, void *user_data)
+{
+    fathom_sdf_jit_evaluate_batch((fathom_sdf_jit_program *)user_data, x, y, z, count, distances, materials);
+}
+
+/* 1 if the code of jit evaluates the positions in box faster than batch with user_data (the same scene, usually
+ * fathom_sdf_scene_batch). Both run the rows of FATHOM_SDF_JIT_MEASURE_ROW positions the grid passes hand to a
+ * batch function on a lattice through the box, twice each, the faster run counts. 0 without code.
+ */
+
+FATHOM_API u8 fathom_sdf_jit_faster(fathom_sdf_jit_program *jit, fathom_grid_distance_function_batch batch, void *user_data, fathom_sdf_aabb *box)
+{
+    f32 x[FATHOM_SDF_JIT_MEASURE_ROW];
+    f32 y[FATHOM_SDF_JIT_MEASURE_ROW];
+    f32 z[FATHOM_SDF_JIT_MEASURE_ROW];
+    f32 distances[FATHOM_SDF_JIT_MEASURE_ROW];
+    u8 materials[FATHOM_SDF_JIT_MEASURE_ROW];
+    fathom_vec3 extent = fathom_vec3_sub(box->max, box->min);
+    f64 time_ms[2];
+    u32 run, method, row, i;
+
+    if (!jit->function)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < FATHOM_SDF_JIT_MEASURE_ROW; ++i)
+    {
+        x[i] = box->min.x + extent.x * ((f32)i + 0.5f) / (f32)FATHOM_SDF_JIT_MEASURE_ROW;
+    }
+
+    time_ms[0] = 1e30;
+    time_ms[1] = 1e30;
+
+    for (run = 0; run < 2; ++run)
+    {
+        for (method = 0; method < 2; ++method)
+        {
+            f64 time_start = fathom_profiler_time_ms();
+            f64 time_run;
+
+            for (row = 0; row < FATHOM_SDF_JIT_MEASURE_ROWS * FATHOM_SDF_JIT_MEASURE_ROWS; ++row)
+            {
+                for (i = 0; i < FATHOM_SDF_JIT_MEASURE_ROW; ++i)
+                {
+                    y[i] = box->min.y + extent.y * ((f32)(row % FATHOM_SDF_JIT_MEASURE_ROWS) + 0.5f) / (f32)FATHOM_SDF_JIT_MEASURE_ROWS;
+                    z[i] = box->min.z + extent.z * ((f32)(row / FATHOM_SDF_JIT_MEASURE_ROWS) + 0.5f) / (f32)FATHOM_SDF_JIT_MEASURE_ROWS;
+                }
+
+                if (method == 0)
+                {
+                    fathom_sdf_jit_evaluate_batch(jit, x, y, z, FATHOM_SDF_JIT_MEASURE_ROW, distances, materials);
+                }
+                else
+                {
+                    batch(x, y, z, FATHOM_SDF_JIT_MEASURE_ROW, distances, materials, user_data);
+                }
+            }
+
+            time_run = fathom_profiler_time_ms() - time_start;
+            time_ms[method] = time_run < time_ms[method] ? time_run : time_ms[method];
+        }
+    }
+
+    return (u8)(time_ms[0] < time_ms[1]);
+}
+
+#endif /* FATHOM_SDF_JIT_H */
@@ -5,6 +5,7 @@
 #include "fathom_color.h"
 #include "fathom_math_sdf.h"
 #include "fathom_sparse_grid.h"
+#include "fathom_sdf_vm.h"
 
 /* #############################################################################
  * # [SECTION] SDF Scene
@@ -34,6 +35,9 @@ typedef enum fathom_sdf_operation_id
 
 } fathom_sdf_operation_id;
 
+/* The primitive is scaled, then rotated about x, y and z in that order (radians), then moved to position.
+ * Scale is uniform, 0 (unset) counts as 1.
+ */
 typedef struct fathom_sdf_transform
 {
     fathom_vec3 position;
@@ -81,20 +85,507 @@ typedef struct fathom_sdf_primitive
 
 } fathom_sdf_primitive;
 
-#define FATHOM_SDF_PRIMITIVE_COUNT 5
-static fathom_sdf_primitive primitives[FATHOM_SDF_PRIMITIVE_COUNT];
-static fathom_sdf_aabb sdf_scene_aabb;
+#define FATHOM_SDF_SCENE_PRIMITIVE_BLEND 0.4f /* Smooth operation range between primitives */
+#define FATHOM_SDF_SCENE_GROUND_BLEND 0.6f    /* Smooth union range between the primitives and the ground */
+#define FATHOM_SDF_SCENE_PRUNE_MARGIN 0.001f  /* Distance a pruning decision keeps against float error of the evaluation */
 
 #define FATHOM_SDF_MATERIAL_COUNT 256
 static u8 fathom_sdf_scene_materials[FATHOM_SDF_MATERIAL_COUNT * 3];
 
-FATHOM_API void fathom_sdf_scene_build(void)
+FATHOM_API f32 fathom_sdf_scene_transform_scale(fathom_sdf_transform *transform)
+{
+    return transform->scale > 0.0f ? transform->scale : 1.0f;
+}
+
+/* Sine and cosine of angle scaled to unit length: the table sine is only accurate to about 1e-4,
+ * a rotation built from it would stretch the distances (and break the bounds) by as much.
+ * A zero angle gives exactly 0 and 1.
+ */
+FATHOM_API void fathom_sdf_scene_transform_sincos(f32 angle, f32 *s, f32 *c)
+{
+    f32 length;
+
+    *s = 0.0f;
+    *c = 1.0f;
+
+    if (angle != 0.0f)
+    {
+        *s = fathom_sinf(angle);
+        *c = fathom_cosf(angle);
+        length = fathom_sqrtf(*s * *s + *c * *c);
+        *s /= length;
+        *c /= length;
+    }
+}
+
+/* Rotation of transform as row major 3x3 matrix, rz * ry * rx */
+FATHOM_API void fathom_sdf_scene_transform_rotation(fathom_sdf_transform *transform, f32 *rotation)
+{
+    f32 sx, cx, sy, cy, sz, cz;
+
+    fathom_sdf_scene_transform_sincos(transform->rotation.x, &sx, &cx);
+    fathom_sdf_scene_transform_sincos(transform->rotation.y, &sy, &cy);
+    fathom_sdf_scene_transform_sincos(transform->rotation.z, &sz, &cz);
+
+    rotation[0] = cz * cy;
+    rotation[1] = -sz * cx + cz * sy * sx;
+    rotation[2] = sz * sx + cz * sy * cx;
+    rotation[3] = sz * cy;
+    rotation[4] = cz * cx + sz * sy * sx;
+    rotation[5] = -cz * sx + sz * sy * cx;
+    rotation[6] = -sy;
+    rotation[7] = cy * sx;
+    rotation[8] = cy * cx;
+}
+
+/* Conservative bounds of a primitive (used to find the grid region an edit touches):
+ * the box around its rotated and scaled local bounds.
+ */
+FATHOM_API fathom_sdf_aabb fathom_sdf_scene_primitive_aabb(fathom_sdf_primitive *primitive)
+{
+    fathom_vec3 extent = fathom_vec3_zero;
+    f32 scale = fathom_sdf_scene_transform_scale(&primitive->transform);
+    f32 r[9];
+    fathom_sdf_aabb b;
+
+    switch (primitive->primitive_id)
+    {
+    case FATHOM_SDF_PRIMITIVE_SPHERE:
+        extent = fathom_vec3_initf(primitive->attributes.sphere.radius);
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX:
+        extent = primitive->attributes.box.base;
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+        extent = primitive->attributes.box_frame.base;
+        break;
+    case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+        extent = primitive->attributes.ellipsoid.radius;
+        break;
+    case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+        extent = fathom_vec3_initf(primitive->attributes.octahedron.scale);
+        break;
+    default:
+        break;
+    }
+
+    fathom_sdf_scene_transform_rotation(&primitive->transform, r);
+
+    extent = fathom_vec3_init(scale * ((fathom_absf(r[0]) * extent.x + fathom_absf(r[1]) * extent.y) + fathom_absf(r[2]) * extent.z),
+                              scale * ((fathom_absf(r[3]) * extent.x + fathom_absf(r[4]) * extent.y) + fathom_absf(r[5]) * extent.z),
+                              scale * ((fathom_absf(r[6]) * extent.x + fathom_absf(r[7]) * extent.y) + fathom_absf(r[8]) * extent.z));
+
+    b.min = fathom_vec3_sub(primitive->transform.position, extent);
+    b.max = fathom_vec3_add(primitive->transform.position, extent);
+
+    return b;
+}
+
+/* Smallest ratio between the distance of a primitive and the distance to its fathom_sdf_scene_primitive_aabb
+ * outside of the box. 1 for the exact distances, below 1 for the bounds:
+ *   - octahedron: the sum of the coordinates beyond the scale is at least the box distance, divided by sqrt(3),
+ *   - ellipsoid: k0 (k0 - 1) / k1 >= (k0 - 1) min(r) and the box distance is at most (k0 - 1) max(r).
+ */
+FATHOM_API f32 fathom_sdf_scene_primitive_bound_scale(fathom_sdf_primitive *primitive)
+{
+    fathom_vec3 radius;
+
+    switch (primitive->primitive_id)
+    {
+    case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+        radius = primitive->attributes.ellipsoid.radius;
+        return fathom_minf(radius.x, fathom_minf(radius.y, radius.z)) / fathom_maxf(radius.x, fathom_maxf(radius.y, radius.z));
+    case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+        return 0.57735027f;
+    default:
+        return 1.0f;
+    }
+}
+
+/* Box around primitive whose outside is at least k away from it: outside of the box the distance of the
+ * primitive is at least the distance to the box scaled by fathom_sdf_scene_primitive_bound_scale plus k.
+ */
+FATHOM_API fathom_sdf_aabb fathom_sdf_scene_primitive_reach(fathom_sdf_primitive *primitive, f32 k)
+{
+    fathom_sdf_aabb b = fathom_sdf_scene_primitive_aabb(primitive);
+    f32 grow = k / fathom_sdf_scene_primitive_bound_scale(primitive);
+
+    b.min = fathom_vec3_subf(b.min, grow);
+    b.max = fathom_vec3_addf(b.max, grow);
+
+    return b;
+}
+
+/* #############################################################################
+ * # [SECTION] SDF Scene Store
+ * #############################################################################
+ *
+ * The primitives of a scene as struct of arrays in one arena provided by the caller:
+ * positions, attributes, operations and materials each in their own array, 16 byte
+ * aligned and padded to a multiple of 4 so SIMD code can load 4 primitives at once.
+ * Array order is evaluation order (every operation but the unions depends on it),
+ * removing a primitive moves the ones after it down. A handle names a primitive until
+ * it is removed. Nothing allocates after fathom_sdf_scene_store_clear.
+ *
+ * The transform is compiled into an inverse 3x4 matrix whenever a primitive is set,
+ * local = inverse (p - position): one matrix vector product per primitive and sample
+ * and a multiply by scale on the distance, no trigonometry. Without rotation and scale
+ * the inverse is the exact identity: the evaluations skip it (transformed is 0) and the
+ * distances are the same bits as without a transform.
+ */
+#define FATHOM_SDF_SCENE_HANDLE_NONE 0xFFFFFFFF
+
+typedef struct fathom_sdf_scene_store
+{
+    u32 primitive_count;
+    u32 primitive_capacity; /* Multiple of 4, the lanes after primitive_count hold no primitive (FATHOM_SDF_PRIMITIVE_COUNT) */
+
+    /* Attributes per primitive type:
+     *   sphere: radius in x, box: base in xyz, box frame: base in xyz and edge thickness in w,
+     *   ellipsoid: radius in xyz, octahedron: scale in x.
+     */
+    f32 *position_x;
+    f32 *position_y;
+    f32 *position_z;
+    f32 *rotation_x;
+    f32 *rotation_y;
+    f32 *rotation_z;
+    f32 *scale;      /* fathom_sdf_scene_transform_scale, 1 for the lanes without a primitive */
+    f32 *inverse;    /* 12 per primitive: the transposed rotation divided by scale (3x3 row major), then the position */
+    f32 *attribute_x;
+    f32 *attribute_y;
+    f32 *attribute_z;
+    f32 *attribute_w;
+    u8 *primitive_ids;
+    u8 *operation_ids;
+    u8 *material_ids;
+    u8 *transformed; /* 1 if the inverse is not the identity */
+
+    u32 *handle_index; /* Index of each handle, FATHOM_SDF_SCENE_HANDLE_NONE once removed */
+    u32 *index_handle; /* Handle of each index */
+    u32 *handle_free;  /* Removed handles, handed out again first */
+    u32 handle_free_count;
+    u32 handle_count; /* Handles handed out so far */
+
+    fathom_sdf_aabb bounds; /* Reach of every primitive with the ground blend range, the bounds test of fathom_sdf_scene */
+
+    u32 arena_bytes; /* Set by fathom_sdf_scene_store_initialize */
+    u8 *arena_data;  /* arena_bytes 16 byte aligned, provided by the caller */
+
+} fathom_sdf_scene_store;
+
+/* Sets the arena size for capacity primitives, the caller provides arena_data before fathom_sdf_scene_store_clear */
+FATHOM_API void fathom_sdf_scene_store_initialize(fathom_sdf_scene_store *store, u32 capacity)
+{
+    store->primitive_count = 0;
+    store->primitive_capacity = (capacity + 3) & ~3u;
+
+    /* 11 float arrays, the inverse transforms, 3 handle arrays, 4 byte arrays each padded to 16 bytes */
+    store->arena_bytes = store->primitive_capacity * ((11 + 12) * (u32)sizeof(f32) + 3 * (u32)sizeof(u32)) + 4 * ((store->primitive_capacity + 15) & ~15u);
+    store->arena_data = FATHOM_NULL;
+}
+
+FATHOM_API void *fathom_sdf_scene_store_carve(u8 **cursor, u32 bytes)
+{
+    void *result = *cursor;
+
+    *cursor += (bytes + 15) & ~15u;
+
+    return result;
+}
+
+/* Copies primitive into the arrays at index and compiles its inverse transform */
+FATHOM_API void fathom_sdf_scene_store_set(fathom_sdf_scene_store *store, u32 index, fathom_sdf_primitive *primitive)
+{
+    fathom_vec3 attribute = fathom_vec3_zero;
+    f32 attribute_w = 0.0f;
+    f32 scale = fathom_sdf_scene_transform_scale(&primitive->transform);
+    f32 scale_inverse = 1.0f / scale;
+    f32 *inverse = store->inverse + index * 12;
+    f32 rotation[9];
+    u32 i;
+    u32 j;
+
+    switch (primitive->primitive_id)
+    {
+    case FATHOM_SDF_PRIMITIVE_SPHERE:
+        attribute.x = primitive->attributes.sphere.radius;
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX:
+        attribute = primitive->attributes.box.base;
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+        attribute = primitive->attributes.box_frame.base;
+        attribute_w = primitive->attributes.box_frame.edge_thickness;
+        break;
+    case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+        attribute = primitive->attributes.ellipsoid.radius;
+        break;
+    case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+        attribute.x = primitive->attributes.octahedron.scale;
+        break;
+    default:
+        break;
+    }
+
+    store->position_x[index] = primitive->transform.position.x;
+    store->position_y[index] = primitive->transform.position.y;
+    store->position_z[index] = primitive->transform.position.z;
+    store->rotation_x[index] = primitive->transform.rotation.x;
+    store->rotation_y[index] = primitive->transform.rotation.y;
+    store->rotation_z[index] = primitive->transform.rotation.z;
+    store->scale[index] = scale;
+    store->attribute_x[index] = attribute.x;
+    store->attribute_y[index] = attribute.y;
+    store->attribute_z[index] = attribute.z;
+    store->attribute_w[index] = attribute_w;
+    store->primitive_ids[index] = primitive->primitive_id;
+    store->operation_ids[index] = primitive->operation_id;
+    store->material_ids[index] = primitive->material_id;
+
+    /* The inverse of a rotation is its transpose */
+    fathom_sdf_scene_transform_rotation(&primitive->transform, rotation);
+    store->transformed[index] = 0;
+
+    for (i = 0; i < 3; ++i)
+    {
+        for (j = 0; j < 3; ++j)
+        {
+            inverse[i * 3 + j] = rotation[j * 3 + i] * scale_inverse;
+
+            if (inverse[i * 3 + j] != (i == j ? 1.0f : 0.0f))
+            {
+                store->transformed[index] = 1;
+            }
+        }
+    }
+
+    inverse[9] = primitive->transform.position.x;
+    inverse[10] = primitive->transform.position.y;
+    inverse[11] = primitive->transform.position.z;
+}
+
+/* The primitive at index (evaluation order) */
+FATHOM_API fathom_sdf_primitive fathom_sdf_scene_store_primitive(fathom_sdf_scene_store *store, u32 index)
+{
+    fathom_sdf_primitive primitive = {0};
+    fathom_vec3 attribute = fathom_vec3_init(store->attribute_x[index], store->attribute_y[index], store->attribute_z[index]);
+
+    primitive.primitive_id = store->primitive_ids[index];
+    primitive.operation_id = store->operation_ids[index];
+    primitive.material_id = store->material_ids[index];
+    primitive.transform.position = fathom_vec3_init(store->position_x[index], store->position_y[index], store->position_z[index]);
+    primitive.transform.rotation = fathom_vec3_init(store->rotation_x[index], store->rotation_y[index], store->rotation_z[index]);
+    primitive.transform.scale = store->scale[index];
+
+    switch (primitive.primitive_id)
+    {
+    case FATHOM_SDF_PRIMITIVE_SPHERE:
+        primitive.attributes.sphere.radius = attribute.x;
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX:
+        primitive.attributes.box.base = attribute;
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+        primitive.attributes.box_frame.base = attribute;
+        primitive.attributes.box_frame.edge_thickness = store->attribute_w[index];
+        break;
+    case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+        primitive.attributes.ellipsoid.radius = attribute;
+        break;
+    case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+        primitive.attributes.octahedron.scale = attribute.x;
+        break;
+    default:
+        break;
+    }
+
+    return primitive;
+}
+
+/* Empties the store and lays out its arrays in arena_data */
+FATHOM_API void fathom_sdf_scene_store_clear(fathom_sdf_scene_store *store)
+{
+    fathom_sdf_primitive none = {0};
+    u8 *cursor = store->arena_data;
+    u32 capacity = store->primitive_capacity;
+    u32 i;
+
+    store->position_x = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->position_y = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->position_z = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->rotation_x = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->rotation_y = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->rotation_z = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->scale = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->inverse = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * 12 * (u32)sizeof(f32));
+    store->attribute_x = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->attribute_y = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->attribute_z = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->attribute_w = (f32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(f32));
+    store->handle_index = (u32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(u32));
+    store->index_handle = (u32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(u32));
+    store->handle_free = (u32 *)fathom_sdf_scene_store_carve(&cursor, capacity * (u32)sizeof(u32));
+    store->primitive_ids = (u8 *)fathom_sdf_scene_store_carve(&cursor, capacity);
+    store->operation_ids = (u8 *)fathom_sdf_scene_store_carve(&cursor, capacity);
+    store->material_ids = (u8 *)fathom_sdf_scene_store_carve(&cursor, capacity);
+    store->transformed = (u8 *)fathom_sdf_scene_store_carve(&cursor, capacity);
+
+    store->primitive_count = 0;
+    store->handle_free_count = 0;
+    store->handle_count = 0;
+
+    none.primitive_id = FATHOM_SDF_PRIMITIVE_COUNT;
+
+    for (i = 0; i < capacity; ++i)
+    {
+        fathom_sdf_scene_store_set(store, i, &none);
+    }
+
+    /* Empty: every position fails the bounds test */
+    store->bounds.min = fathom_vec3_initf(1e30f);
+    store->bounds.max = fathom_vec3_initf(-1e30f);
+}
+
+FATHOM_API void fathom_sdf_scene_store_bounds_add(fathom_sdf_scene_store *store, u32 index)
+{
+    fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(store, index);
+    fathom_sdf_aabb reach = fathom_sdf_scene_primitive_reach(&primitive, FATHOM_SDF_SCENE_GROUND_BLEND);
+
+    store->bounds.min = fathom_vec3_min(store->bounds.min, reach.min);
+    store->bounds.max = fathom_vec3_max(store->bounds.max, reach.max);
+}
+
+FATHOM_API void fathom_sdf_scene_store_bounds_update(fathom_sdf_scene_store *store)
+{
+    u32 i;
+
+    store->bounds.min = fathom_vec3_initf(1e30f);
+    store->bounds.max = fathom_vec3_initf(-1e30f);
+
+    for (i = 0; i < store->primitive_count; ++i)
+    {
+        fathom_sdf_scene_store_bounds_add(store, i);
+    }
+}
+
+/* Appends primitive (evaluated after all others), returns its handle or FATHOM_SDF_SCENE_HANDLE_NONE if the store is full */
+FATHOM_API u32 fathom_sdf_scene_store_add(fathom_sdf_scene_store *store, fathom_sdf_primitive *primitive)
+{
+    u32 index = store->primitive_count;
+    u32 handle;
+
+    if (index == store->primitive_capacity)
+    {
+        return FATHOM_SDF_SCENE_HANDLE_NONE;
+    }
+
+    handle = store->handle_free_count ? store->handle_free[--store->handle_free_count] : store->handle_count++;
+
+    store->handle_index[handle] = index;
+    store->index_handle[index] = handle;
+    ++store->primitive_count;
+
+    fathom_sdf_scene_store_set(store, index, primitive);
+    fathom_sdf_scene_store_bounds_add(store, index);
+
+    return handle;
+}
+
+/* Removes the primitive of handle, the primitives after it keep their order. Returns 0 for a removed handle. */
+FATHOM_API u8 fathom_sdf_scene_store_remove(fathom_sdf_scene_store *store, u32 handle)
+{
+    fathom_sdf_primitive none = {0};
+    u32 index;
+    u32 i;
+    u32 j;
+
+    if (handle >= store->handle_count || store->handle_index[handle] == FATHOM_SDF_SCENE_HANDLE_NONE)
+    {
+        return 0;
+    }
+
+    index = store->handle_index[handle];
+
+    for (i = index + 1; i < store->primitive_count; ++i)
+    {
+        store->position_x[i - 1] = store->position_x[i];
+        store->position_y[i - 1] = store->position_y[i];
+        store->position_z[i - 1] = store->position_z[i];
+        store->rotation_x[i - 1] = store->rotation_x[i];
+        store->rotation_y[i - 1] = store->rotation_y[i];
+        store->rotation_z[i - 1] = store->rotation_z[i];
+        store->scale[i - 1] = store->scale[i];
+        store->attribute_x[i - 1] = store->attribute_x[i];
+        store->attribute_y[i - 1] = store->attribute_y[i];
+        store->attribute_z[i - 1] = store->attribute_z[i];
+        store->attribute_w[i - 1] = store->attribute_w[i];
+        store->primitive_ids[i - 1] = store->primitive_ids[i];
+        store->operation_ids[i - 1] = store->operation_ids[i];
+        store->material_ids[i - 1] = store->material_ids[i];
+        store->transformed[i - 1] = store->transformed[i];
+        store->index_handle[i - 1] = store->index_handle[i];
+
+        for (j = 0; j < 12; ++j)
+        {
+            store->inverse[(i - 1) * 12 + j] = store->inverse[i * 12 + j];
+        }
+
+        store->handle_index[store->index_handle[i - 1]] = i - 1;
+    }
+
+    --store->primitive_count;
+    none.primitive_id = FATHOM_SDF_PRIMITIVE_COUNT;
+    fathom_sdf_scene_store_set(store, store->primitive_count, &none);
+
+    store->handle_index[handle] = FATHOM_SDF_SCENE_HANDLE_NONE;
+    store->handle_free[store->handle_free_count++] = handle;
+
+    fathom_sdf_scene_store_bounds_update(store);
+
+    return 1;
+}
+
+/* Replaces the primitive of handle in place. Returns 0 for a removed handle. */
+FATHOM_API u8 fathom_sdf_scene_store_update(fathom_sdf_scene_store *store, u32 handle, fathom_sdf_primitive *primitive)
+{
+    if (handle >= store->handle_count || store->handle_index[handle] == FATHOM_SDF_SCENE_HANDLE_NONE)
+    {
+        return 0;
+    }
+
+    fathom_sdf_scene_store_set(store, store->handle_index[handle], primitive);
+    fathom_sdf_scene_store_bounds_update(store);
+
+    return 1;
+}
+
+/* Copies the primitive of handle to primitive. Returns 0 for a removed handle. */
+FATHOM_API u8 fathom_sdf_scene_store_get(fathom_sdf_scene_store *store, u32 handle, fathom_sdf_primitive *primitive)
+{
+    if (handle >= store->handle_count || store->handle_index[handle] == FATHOM_SDF_SCENE_HANDLE_NONE)
+    {
+        return 0;
+    }
+
+    *primitive = fathom_sdf_scene_store_primitive(store, store->handle_index[handle]);
+
+    return 1;
+}
+
+/* #############################################################################
+ * # [SECTION] SDF Scene Evaluation
+ * #############################################################################
+ */
+/* Adds the demo scene to store, returns the handle of its sphere (the animated primitive) */
+FATHOM_API u32 fathom_sdf_scene_build(fathom_sdf_scene_store *store)
 {
     fathom_sdf_primitive sphere = {0};
     fathom_sdf_primitive box = {0};
     fathom_sdf_primitive ellipsoid = {0};
     fathom_sdf_primitive octahedron = {0};
     fathom_sdf_primitive box_frame = {0};
+    u32 handle;
 
     sphere.primitive_id = FATHOM_SDF_PRIMITIVE_SPHERE;
     sphere.material_id = 1;
@@ -122,15 +613,11 @@ FATHOM_API void fathom_sdf_scene_build(void)
     box_frame.attributes.box_frame.base = fathom_vec3_init(0.25f, 0.25f, 0.25f);
     box_frame.attributes.box_frame.edge_thickness = 0.025f;
 
-    primitives[0] = sphere;
-    primitives[1] = box;
-    primitives[2] = ellipsoid;
-    primitives[3] = octahedron;
-    primitives[4] = box_frame;
-
-    /* Set simple bounding box */
-    sdf_scene_aabb.min = fathom_vec3_init(-2.0f, -1.0f, -2.0f);
-    sdf_scene_aabb.max = fathom_vec3_init(2.0f, 2.0f, 2.0f);
+    handle = fathom_sdf_scene_store_add(store, &sphere);
+    fathom_sdf_scene_store_add(store, &box);
+    fathom_sdf_scene_store_add(store, &ellipsoid);
+    fathom_sdf_scene_store_add(store, &octahedron);
+    fathom_sdf_scene_store_add(store, &box_frame);
 
     /* Set Materials */
     /* ID 0: Default/Background */
@@ -157,107 +644,577 @@ FATHOM_API void fathom_sdf_scene_build(void)
     fathom_sdf_scene_materials[12] = 46;
     fathom_sdf_scene_materials[13] = 191;
     fathom_sdf_scene_materials[14] = 199;
+
+    return handle;
 }
 
-FATHOM_API fathom_grid_data fathom_sdf_scene(fathom_vec3 position, void *user_data)
+/* Distance of the primitive at index at its transform.
+ * Slots without a primitive give the ground distance like the SIMD and bytecode evaluations.
+ */
+FATHOM_API FATHOM_INLINE f32 fathom_sdf_scene_primitive_distance(fathom_sdf_scene_store *store, u32 index, fathom_vec3 position)
+{
+    f32 *inverse = store->inverse + index * 12;
+    fathom_vec3 primitive_pos = fathom_vec3_sub(position, fathom_vec3_init(inverse[9], inverse[10], inverse[11]));
+    u8 transformed = store->transformed[index];
+    f32 distance;
+
+    if (transformed)
+    {
+        primitive_pos = fathom_sdf_op_rotate(primitive_pos, inverse);
+    }
+
+    /* Each case loads only the attributes it uses */
+    switch (store->primitive_ids[index])
+    {
+    case FATHOM_SDF_PRIMITIVE_SPHERE:
+        distance = fathom_sdf_sphere(primitive_pos, store->attribute_x[index]);
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX:
+        distance = fathom_sdf_box(primitive_pos, fathom_vec3_init(store->attribute_x[index], store->attribute_y[index], store->attribute_z[index]));
+        break;
+    case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+        distance = fathom_sdf_box_frame(primitive_pos, fathom_vec3_init(store->attribute_x[index], store->attribute_y[index], store->attribute_z[index]), store->attribute_w[index]);
+        break;
+    case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+        distance = fathom_sdf_ellipsoid(primitive_pos, fathom_vec3_init(store->attribute_x[index], store->attribute_y[index], store->attribute_z[index]));
+        break;
+    case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+        distance = fathom_sdf_octahedron(primitive_pos, store->attribute_x[index]);
+        break;
+    default:
+        distance = position.y - (-0.25f);
+        break;
+    }
+
+    /* Back to world units */
+    return transformed ? distance * store->scale[index] : distance;
+}
+
+/* Combines the distance of the primitive at index with the running distance and material of the primitives before it */
+FATHOM_API FATHOM_INLINE void fathom_sdf_scene_combine(f32 *distance_total, u8 *material_total, fathom_sdf_scene_store *store, u32 index, f32 primitive_distance)
+{
+    /* material: choose the primitive that is closer (before smooth offset) */
+    if (primitive_distance < *distance_total)
+    {
+        *material_total = store->material_ids[index];
+    }
+
+    /* smooth union distance */
+    switch (store->operation_ids[index])
+    {
+    case FATHOM_SDF_OPERATION_UNION_SMOOTH:
+        *distance_total = fathom_sdf_op_union_smooth(*distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+        break;
+    case FATHOM_SDF_OPERATION_SUBTRACT_SMOOTH:
+        *distance_total = fathom_sdf_op_subtract_smooth(*distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+        break;
+    case FATHOM_SDF_OPERATION_INTERSECT_SMOOTH:
+        *distance_total = fathom_sdf_op_intersect_smooth(*distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+        break;
+    case FATHOM_SDF_OPERATION_UNION:
+        *distance_total = fathom_sdf_op_union(*distance_total, primitive_distance);
+        break;
+    case FATHOM_SDF_OPERATION_SUBTRACT:
+        *distance_total = fathom_sdf_op_subtract(*distance_total, primitive_distance);
+        break;
+    case FATHOM_SDF_OPERATION_INTERSECT:
+        *distance_total = fathom_sdf_op_intersect(*distance_total, primitive_distance);
+        break;
+    case FATHOM_SDF_OPERATION_XOR:
+        *distance_total = fathom_sdf_op_xor(*distance_total, primitive_distance);
+        break;
+    default:
+        break;
+    }
+}
+
+/* The scene is a tape of primitives: each one is combined with the distance of all primitives before it by its
+ * operation. tape lists the primitives to evaluate (see fathom_sdf_scene_prune), FATHOM_NULL runs all of them.
+ * user_data is the fathom_sdf_scene_store.
+ */
+FATHOM_API fathom_grid_data fathom_sdf_scene_tape(fathom_vec3 position, fathom_grid_tape *tape, void *user_data)
 {
+    fathom_sdf_scene_store *store = (fathom_sdf_scene_store *)user_data;
     f32 ground = position.y - (-0.25f);
+    u32 length = tape ? tape->length : store->primitive_count;
 
     fathom_grid_data d;
     d.distance = ground;
     d.material = 0;
 
-    (void)user_data;
-
-    if (fathom_sdf_aabb_distance(position, &sdf_scene_aabb) <= d.distance)
+    if (length && fathom_sdf_aabb_distance(position, &store->bounds) <= d.distance)
     {
         f32 primitive_distance_total = 1e30f; /* very large start distance */
         u8 primitive_material_total = 0;
 
         u32 i;
 
-        for (i = 0; i < FATHOM_SDF_PRIMITIVE_COUNT; ++i)
+        for (i = 0; i < length; ++i)
         {
-            fathom_sdf_primitive primitive = primitives[i];
-            fathom_vec3 primitive_pos = fathom_vec3_sub(position, primitive.transform.position);
-            f32 primitive_distance = ground;
+            u32 index = tape ? tape->instructions[i] : i;
 
-            switch (primitive.primitive_id)
-            {
-            case FATHOM_SDF_PRIMITIVE_SPHERE:
+            fathom_sdf_scene_combine(&primitive_distance_total, &primitive_material_total, store, index, fathom_sdf_scene_primitive_distance(store, index, position));
+        }
+
+        if (ground < primitive_distance_total)
+        {
+            primitive_material_total = 0; /* ground material id */
+        }
+
+        d.distance = fathom_sdf_op_union_smooth(ground, primitive_distance_total, FATHOM_SDF_SCENE_GROUND_BLEND);
+        d.material = primitive_material_total;
+    }
+
+    return d;
+}
+
+FATHOM_API fathom_grid_data fathom_sdf_scene(fathom_vec3 position, void *user_data)
+{
+    return fathom_sdf_scene_tape(position, FATHOM_NULL, user_data);
+}
+
+/* Struct of arrays variant of fathom_sdf_scene_tape (fathom_grid_distance_function_tape).
+ * Evaluates 4 positions per iteration with SSE2 and produces the same distances and materials as the scalar version.
+ */
+FATHOM_API void fathom_sdf_scene_batch_tape(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, fathom_grid_tape *tape, void *user_data)
+{
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+    fathom_sdf_scene_store *store = (fathom_sdf_scene_store *)user_data;
+    u32 length = tape ? tape->length : store->primitive_count;
+
+    /* The arrays in locals, the material stores (u8) may alias the store otherwise */
+    fathom_sdf_aabb bounds = store->bounds;
+    f32 *scale = store->scale;
+    f32 *inverse = store->inverse;
+    f32 *attribute_x = store->attribute_x;
+    f32 *attribute_y = store->attribute_y;
+    f32 *attribute_z = store->attribute_z;
+    f32 *attribute_w = store->attribute_w;
+    u8 *primitive_ids = store->primitive_ids;
+    u8 *operation_ids = store->operation_ids;
+    u8 *material_ids = store->material_ids;
+    u8 *transformed = store->transformed;
+    u32 i;
+
+    for (i = 0; i < count; i += 4)
+    {
+        f32 lane_x[4];
+        f32 lane_y[4];
+        f32 lane_z[4];
+        f32 lane_distance[4];
+        i32 lane_material[4];
+        u32 lane_count = (count - i) < 4 ? (count - i) : 4;
+        u32 j;
+
+        fathom_vec3x4 position;
+        __m128 ground;
+        __m128 inside;
+
+        /* Pad the last packet by repeating its last position */
+        for (j = 0; j < 4; ++j)
+        {
+            u32 k = i + (j < lane_count ? j : lane_count - 1);
+            lane_x[j] = x[k];
+            lane_y[j] = y[k];
+            lane_z[j] = z[k];
+        }
+
+        position = fathom_vec3x4_load(lane_x, lane_y, lane_z);
+        ground = _mm_sub_ps(position.y, _mm_set1_ps(-0.25f));
+        inside = _mm_cmple_ps(fathom_sdf_aabb_distance_x4(position, bounds.min, bounds.max), ground);
+
+        if (length && _mm_movemask_ps(inside))
+        {
+            __m128 primitive_distance_total = _mm_set1_ps(1e30f); /* very large start distance */
+            __m128i primitive_material_total = _mm_setzero_si128();
+            __m128 d;
+            __m128i material_mask;
+            u32 p;
+
+            for (p = 0; p < length; ++p)
             {
-                primitive_distance = fathom_sdf_sphere(primitive_pos, primitive.attributes.sphere.radius);
+                u32 k = tape ? tape->instructions[p] : p;
+                f32 *m = inverse + k * 12;
+                fathom_vec3x4 primitive_pos = fathom_vec3x4_sub_vec3(position, fathom_vec3_init(m[9], m[10], m[11]));
+                __m128 primitive_distance = ground;
+                __m128i closer;
+
+                if (transformed[k])
+                {
+                    __m128 matrix[9];
+
+                    for (j = 0; j < 9; ++j)
+                    {
+                        matrix[j] = _mm_set1_ps(m[j]);
+                    }
+
+                    primitive_pos = fathom_sdf_op_rotate_x4(primitive_pos, matrix);
+                }
+
+                /* Parameters splatted from the arrays, SIMD across positions */
+                switch (primitive_ids[k])
+                {
+                case FATHOM_SDF_PRIMITIVE_SPHERE:
+                    primitive_distance = fathom_sdf_sphere_x4(primitive_pos, _mm_set1_ps(attribute_x[k]));
+                    break;
+                case FATHOM_SDF_PRIMITIVE_BOX:
+                    primitive_distance = fathom_sdf_box_x4(primitive_pos, fathom_vec3x4_set1(attribute_x[k], attribute_y[k], attribute_z[k]));
+                    break;
+                case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+                    primitive_distance = fathom_sdf_box_frame_x4(primitive_pos, fathom_vec3x4_set1(attribute_x[k], attribute_y[k], attribute_z[k]), _mm_set1_ps(attribute_w[k]));
+                    break;
+                case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+                    primitive_distance = fathom_sdf_ellipsoid_x4(primitive_pos, fathom_vec3x4_set1(attribute_x[k], attribute_y[k], attribute_z[k]));
+                    break;
+                case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+                    primitive_distance = fathom_sdf_octahedron_x4(primitive_pos, _mm_set1_ps(attribute_x[k]));
+                    break;
+                default:
+                    break;
+                }
+
+                if (transformed[k])
+                {
+                    primitive_distance = _mm_mul_ps(primitive_distance, _mm_set1_ps(scale[k]));
+                }
+
+                /* material: choose the primitive that is closer (before smooth offset) */
+                closer = _mm_castps_si128(_mm_cmplt_ps(primitive_distance, primitive_distance_total));
+                primitive_material_total = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(material_ids[k])), _mm_andnot_si128(closer, primitive_material_total));
+
+                /* smooth union distance */
+                switch (operation_ids[k])
+                {
+                case FATHOM_SDF_OPERATION_UNION_SMOOTH:
+                    primitive_distance_total = fathom_sdf_op_union_smooth_x4(primitive_distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+                    break;
+                case FATHOM_SDF_OPERATION_SUBTRACT_SMOOTH:
+                    primitive_distance_total = fathom_sdf_op_subtract_smooth_x4(primitive_distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+                    break;
+                case FATHOM_SDF_OPERATION_INTERSECT_SMOOTH:
+                    primitive_distance_total = fathom_sdf_op_intersect_smooth_x4(primitive_distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+                    break;
+                case FATHOM_SDF_OPERATION_UNION:
+                    primitive_distance_total = fathom_sdf_op_union_x4(primitive_distance_total, primitive_distance);
+                    break;
+                case FATHOM_SDF_OPERATION_SUBTRACT:
+                    primitive_distance_total = fathom_sdf_op_subtract_x4(primitive_distance_total, primitive_distance);
+                    break;
+                case FATHOM_SDF_OPERATION_INTERSECT:
+                    primitive_distance_total = fathom_sdf_op_intersect_x4(primitive_distance_total, primitive_distance);
+                    break;
+                case FATHOM_SDF_OPERATION_XOR:
+                    primitive_distance_total = fathom_sdf_op_xor_x4(primitive_distance_total, primitive_distance);
+                    break;
+                default:
+                    break;
+                }
             }
-            break;
-            case FATHOM_SDF_PRIMITIVE_BOX:
+
+            /* ground material id */
+            primitive_material_total = _mm_andnot_si128(_mm_castps_si128(_mm_cmplt_ps(ground, primitive_distance_total)), primitive_material_total);
+
+            /* Lanes outside of the scene bounds keep the plain ground distance and material */
+            d = fathom_sdf_op_union_smooth_x4(ground, primitive_distance_total, FATHOM_SDF_SCENE_GROUND_BLEND);
+            d = _mm_or_ps(_mm_and_ps(inside, d), _mm_andnot_ps(inside, ground));
+            material_mask = _mm_and_si128(_mm_castps_si128(inside), primitive_material_total);
+
+            _mm_storeu_ps(lane_distance, d);
+            _mm_storeu_si128((__m128i *)lane_material, material_mask);
+        }
+        else
+        {
+            _mm_storeu_ps(lane_distance, ground);
+            _mm_storeu_si128((__m128i *)lane_material, _mm_setzero_si128());
+        }
+
+        for (j = 0; j < lane_count; ++j)
+        {
+            distances[i + j] = lane_distance[j];
+            materials[i + j] = (u8)lane_material[j];
+        }
+    }
+#else
+    u32 i;
+
+    for (i = 0; i < count; ++i)
+    {
+        fathom_grid_data data = fathom_sdf_scene_tape(fathom_vec3_init(x[i], y[i], z[i]), tape, user_data);
+        distances[i] = data.distance;
+        materials[i] = data.material;
+    }
+#endif
+}
+
+/* Struct of arrays variant of fathom_sdf_scene (fathom_grid_distance_function_batch) */
+FATHOM_API void fathom_sdf_scene_batch(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, void *user_data)
+{
+    fathom_sdf_scene_batch_tape(x, y, z, count, distances, materials, FATHOM_NULL, user_data);
+}
+
+/* Distance range of fathom_sdf_scene over the box [box_min, box_max].
+ * Follows the scalar version step by step with the interval versions of the primitives and operations.
+ * Where the box straddles the bounds test both branches are taken and joined.
+ *
+ * If tape is set it receives the primitives that can change the distance or the material inside of the box.
+ * Only unions are pruned, the material rule (closest primitive before the operation) makes every other
+ * operation visible even where its distance cannot win:
+ *   - a union whose primitive is further than its blend range above the running distance leaves both unchanged,
+ *   - a union whose primitive is further than its blend range below it replaces both, everything before is dropped,
+ *   - if the primitives end up further than the ground blend range above the ground, the tape is empty (ground only).
+ * In all three cases the smooth union evaluates to the exact minimum, so the pruned tape gives the same bits.
+ * tape_fits is cleared if the pruned primitives do not fit the tape (more than FATHOM_GRID_TAPE_MAX_LENGTH or
+ * an index beyond the u16 instructions), the tape must not be evaluated then.
+ */
+FATHOM_API fathom_sdf_interval fathom_sdf_scene_interval_prune(fathom_sdf_scene_store *store, fathom_vec3 box_min, fathom_vec3 box_max, fathom_grid_tape *tape, u8 *tape_fits)
+{
+    fathom_sdf_aabb box;
+    fathom_sdf_interval ground;
+    fathom_sdf_interval bounds;
+    fathom_sdf_interval result;
+
+    if (tape)
+    {
+        tape->length = 0;
+        *tape_fits = 1;
+    }
+
+    box.min = box_min;
+    box.max = box_max;
+
+    ground = fathom_sdf_interval_init(box_min.y - (-0.25f), box_max.y - (-0.25f));
+    bounds = fathom_sdf_aabb_distance_interval(&box, &store->bounds);
+    result = ground;
+
+    /* Some position of the box may pass the bounds test */
+    if (bounds.min <= ground.max)
+    {
+        fathom_sdf_interval primitive_distance_total = fathom_sdf_interval_init(1e30f, 1e30f); /* very large start distance */
+        fathom_sdf_interval primitives_blended;
+        u32 i;
+
+        for (i = 0; i < store->primitive_count; ++i)
+        {
+            fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(store, i);
+            fathom_sdf_aabb primitive_box;
+            fathom_sdf_interval primitive_distance = ground;
+
+            /* The box around the local positions of the box */
+            primitive_box.min = fathom_vec3_sub(box_min, primitive.transform.position);
+            primitive_box.max = fathom_vec3_sub(box_max, primitive.transform.position);
+
+            if (store->transformed[i])
             {
-                primitive_distance = fathom_sdf_box(primitive_pos, primitive.attributes.box.base);
+                primitive_box = fathom_sdf_interval_rotate(primitive_box, store->inverse + i * 12);
             }
-            break;
-            case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+
+            switch (primitive.primitive_id)
             {
-                primitive_distance = fathom_sdf_box_frame(primitive_pos, primitive.attributes.box_frame.base, primitive.attributes.box_frame.edge_thickness);
-            }
-            break;
+            case FATHOM_SDF_PRIMITIVE_SPHERE:
+                primitive_distance = fathom_sdf_sphere_interval(primitive_box, primitive.attributes.sphere.radius);
+                break;
+            case FATHOM_SDF_PRIMITIVE_BOX:
+                primitive_distance = fathom_sdf_box_interval(primitive_box, primitive.attributes.box.base);
+                break;
+            case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+                primitive_distance = fathom_sdf_box_frame_interval(primitive_box, primitive.attributes.box_frame.base, primitive.attributes.box_frame.edge_thickness);
+                break;
             case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
-            {
-                primitive_distance = fathom_sdf_ellipsoid(primitive_pos, primitive.attributes.ellipsoid.radius);
-            }
-            break;
+                primitive_distance = fathom_sdf_ellipsoid_interval(primitive_box, primitive.attributes.ellipsoid.radius);
+                break;
             case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
-            {
-                primitive_distance = fathom_sdf_octahedron(primitive_pos, primitive.attributes.octahedron.scale);
-            }
-            break;
+                primitive_distance = fathom_sdf_octahedron_interval(primitive_box, primitive.attributes.octahedron.scale);
+                break;
             default:
                 break;
             }
 
-            /* material: choose the primitive that is closer (before smooth offset) */
-            if (primitive_distance < primitive_distance_total)
+            if (store->transformed[i])
             {
-                primitive_material_total = primitive.material_id;
+                primitive_distance = fathom_sdf_interval_mulf(primitive_distance, store->scale[i]);
+            }
+
+            if (tape)
+            {
+                u8 is_union = primitive.operation_id == FATHOM_SDF_OPERATION_UNION_SMOOTH || primitive.operation_id == FATHOM_SDF_OPERATION_UNION;
+                f32 blend = (primitive.operation_id == FATHOM_SDF_OPERATION_UNION_SMOOTH ? FATHOM_SDF_SCENE_PRIMITIVE_BLEND : 0.0f) + FATHOM_SDF_SCENE_PRUNE_MARGIN;
+
+                if (is_union && primitive_distance.min >= primitive_distance_total.max + blend)
+                {
+                    continue;
+                }
+
+                /* Dropping everything before also drops an earlier overflow */
+                if (is_union && primitive_distance.max + blend <= primitive_distance_total.min)
+                {
+                    tape->length = 0;
+                    *tape_fits = 1;
+                }
+
+                if (tape->length < FATHOM_GRID_TAPE_MAX_LENGTH && i <= 0xFFFF)
+                {
+                    tape->instructions[tape->length++] = (u16)i;
+                }
+                else
+                {
+                    *tape_fits = 0;
+                }
             }
 
-            /* smooth union distance */
             switch (primitive.operation_id)
             {
             case FATHOM_SDF_OPERATION_UNION_SMOOTH:
-                primitive_distance_total = fathom_sdf_op_union_smooth(primitive_distance_total, primitive_distance, 0.4f);
+                primitive_distance_total = fathom_sdf_op_union_smooth_interval(primitive_distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
                 break;
             case FATHOM_SDF_OPERATION_SUBTRACT_SMOOTH:
-                primitive_distance_total = fathom_sdf_op_subtract_smooth(primitive_distance_total, primitive_distance, 0.4f);
+                primitive_distance_total = fathom_sdf_op_subtract_smooth_interval(primitive_distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
                 break;
             case FATHOM_SDF_OPERATION_INTERSECT_SMOOTH:
-                primitive_distance_total = fathom_sdf_op_intersect_smooth(primitive_distance_total, primitive_distance, 0.4f);
+                primitive_distance_total = fathom_sdf_op_intersect_smooth_interval(primitive_distance_total, primitive_distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
                 break;
             case FATHOM_SDF_OPERATION_UNION:
-                primitive_distance_total = fathom_sdf_op_union(primitive_distance_total, primitive_distance);
+                primitive_distance_total = fathom_sdf_op_union_interval(primitive_distance_total, primitive_distance);
                 break;
             case FATHOM_SDF_OPERATION_SUBTRACT:
-                primitive_distance_total = fathom_sdf_op_subtract(primitive_distance_total, primitive_distance);
+                primitive_distance_total = fathom_sdf_op_subtract_interval(primitive_distance_total, primitive_distance);
                 break;
             case FATHOM_SDF_OPERATION_INTERSECT:
-                primitive_distance_total = fathom_sdf_op_intersect(primitive_distance_total, primitive_distance);
+                primitive_distance_total = fathom_sdf_op_intersect_interval(primitive_distance_total, primitive_distance);
                 break;
             case FATHOM_SDF_OPERATION_XOR:
-                primitive_distance_total = fathom_sdf_op_xor(primitive_distance_total, primitive_distance);
+                primitive_distance_total = fathom_sdf_op_xor_interval(primitive_distance_total, primitive_distance);
                 break;
             default:
                 break;
             }
         }
 
-        if (ground < primitive_distance_total)
+        primitives_blended = fathom_sdf_op_union_smooth_interval(ground, primitive_distance_total, FATHOM_SDF_SCENE_GROUND_BLEND);
+
+        /* Every position passes the bounds test: the plain ground distance never occurs */
+        result = bounds.max <= ground.min ? primitives_blended : fathom_sdf_interval_hull(ground, primitives_blended);
+
+        if (tape && primitive_distance_total.min >= ground.max + FATHOM_SDF_SCENE_GROUND_BLEND + FATHOM_SDF_SCENE_PRUNE_MARGIN)
         {
-            primitive_material_total = 0; /* ground material id */
+            tape->length = 0;
+            *tape_fits = 1;
         }
+    }
 
-        d.distance = fathom_sdf_op_union_smooth(ground, primitive_distance_total, 0.6f);
-        d.material = primitive_material_total;
+    return result;
+}
+
+/* fathom_grid_distance_function_interval */
+FATHOM_API void fathom_sdf_scene_interval(fathom_vec3 box_min, fathom_vec3 box_max, f32 *distance_min, f32 *distance_max, void *user_data)
+{
+    fathom_sdf_interval result = fathom_sdf_scene_interval_prune((fathom_sdf_scene_store *)user_data, box_min, box_max, FATHOM_NULL, FATHOM_NULL);
+
+    *distance_min = result.min;
+    *distance_max = result.max;
+}
+
+/* fathom_grid_distance_function_prune */
+FATHOM_API u8 fathom_sdf_scene_prune(fathom_vec3 box_min, fathom_vec3 box_max, fathom_grid_tape *tape, void *user_data)
+{
+    u8 tape_fits;
+
+    fathom_sdf_scene_interval_prune((fathom_sdf_scene_store *)user_data, box_min, box_max, tape, &tape_fits);
+
+    return tape_fits;
+}
+
+/* #############################################################################
+ * # [SECTION] SDF Scene Bytecode
+ * #############################################################################
+ */
+/* Compiles fathom_sdf_scene over store into program, the VM reproduces its distances and materials bit for bit.
+ * Returns 0 if the scene does not fit into a program (more than 1024 primitives, see FATHOM_SDF_VM_MAX_INSTRUCTIONS).
+ */
+FATHOM_API u8 fathom_sdf_scene_compile(fathom_sdf_vm_program *program, fathom_sdf_scene_store *store)
+{
+    static u8 opcodes[FATHOM_SDF_OPERATION_COUNT] = {
+        FATHOM_SDF_VM_OP_UNION_SMOOTH,
+        FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH,
+        FATHOM_SDF_VM_OP_INTERSECT_SMOOTH,
+        FATHOM_SDF_VM_OP_UNION,
+        FATHOM_SDF_VM_OP_SUBTRACT,
+        FATHOM_SDF_VM_OP_INTERSECT,
+        FATHOM_SDF_VM_OP_XOR};
+
+    f32 start = 1e30f; /* very large start distance */
+    u8 ground;
+    u8 mask;
+    u8 total;
+    u8 inside;
+    u32 i;
+
+    fathom_sdf_vm_begin(program);
+
+    ground = fathom_sdf_vm_plane(program, 0, fathom_vec3_init(0.0f, 1.0f, 0.0f), -0.25f, 0);
+    mask = fathom_sdf_vm_bound_begin(program, 0, &store->bounds, ground);
+    total = fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_CONSTANT, 0, &start, 1, 0);
+
+    for (i = 0; i < store->primitive_count; ++i)
+    {
+        fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(store, i);
+        u8 translated = fathom_sdf_vm_translate(program, 0, primitive.transform.position);
+        u8 position = translated;
+        u8 distance;
+        u8 combined;
+        if (store->transformed[i])
+        {
+            position = fathom_sdf_vm_rotate(program, translated, store->inverse + i * 12);
+        }
+
+        switch (primitive.primitive_id)
+        {
+        case FATHOM_SDF_PRIMITIVE_SPHERE:
+            distance = fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_SPHERE, position, &primitive.attributes.sphere.radius, 1, primitive.material_id);
+            break;
+        case FATHOM_SDF_PRIMITIVE_BOX:
+            distance = fathom_sdf_vm_vec3_primitive(program, FATHOM_SDF_VM_OP_BOX, position, primitive.attributes.box.base, primitive.material_id);
+            break;
+        case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+            distance = fathom_sdf_vm_box_frame(program, position, primitive.attributes.box_frame.base, primitive.attributes.box_frame.edge_thickness, primitive.material_id);
+            break;
+        case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+            distance = fathom_sdf_vm_vec3_primitive(program, FATHOM_SDF_VM_OP_ELLIPSOID, position, primitive.attributes.ellipsoid.radius, primitive.material_id);
+            break;
+        case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+            distance = fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_OCTAHEDRON, position, &primitive.attributes.octahedron.scale, 1, primitive.material_id);
+            break;
+        default:
+            /* Unknown primitives measure the ground like the scalar version */
+            distance = fathom_sdf_vm_plane(program, 0, fathom_vec3_init(0.0f, 1.0f, 0.0f), -0.25f, primitive.material_id);
+            break;
+        }
+
+        if (store->transformed[i])
+        {
+            u8 scaled = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_MUL, distance, 0, store->scale[i]);
+
+            fathom_sdf_vm_free(program, distance);
+            distance = scaled;
+        }
+
+        combined = fathom_sdf_vm_operation(program, opcodes[primitive.operation_id % FATHOM_SDF_OPERATION_COUNT], total, distance, FATHOM_SDF_SCENE_PRIMITIVE_BLEND);
+
+        if (position != translated)
+        {
+            fathom_sdf_vm_free_position(program, position);
+        }
+
+        fathom_sdf_vm_free_position(program, translated);
+        fathom_sdf_vm_free(program, distance);
+        fathom_sdf_vm_free(program, total);
+        total = combined;
     }
 
-    return d;
+    /* The ground is the second operand: where it is closer it takes over with material 0 */
+    inside = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_UNION_SMOOTH, total, ground, FATHOM_SDF_SCENE_GROUND_BLEND);
+    fathom_sdf_vm_free(program, total);
+
+    return fathom_sdf_vm_end(program, fathom_sdf_vm_bound_end(program, mask, inside, ground));
 }
 
 /* old keep for reference */
@@ -269,6 +1226,7 @@ FATHOM_API FATHOM_INLINE fathom_grid_data fathom_sdf_scene_original(fathom_vec3
     f32 ground = position.y - (-0.25f);
 
     fathom_grid_data d;
+    d.distance = ground;
     d.material = 0;
 
     if (!sdf_scene_initialized)
@@ -323,4 +1281,86 @@ FATHOM_API FATHOM_INLINE fathom_grid_data fathom_sdf_scene_original(fathom_vec3
     return d;
 }
 
+/* fathom_sdf_scene_original as a program. The distances match, the materials follow the rule of the VM. */
+FATHOM_API u8 fathom_sdf_scene_original_compile(fathom_sdf_vm_program *program)
+{
+    fathom_mat2x2 box_rot = fathom_mat2x2_rot2d(FATHOM_DEG_TO_RAD(45.0f));
+    fathom_sdf_aabb bounds;
+    f32 rotation_z[9];
+    f32 rotation_x[9];
+    f32 box_scale = 1.0f;
+    f32 sphere_radius = 0.5f;
+    f32 octahedron_scale = 0.25f;
+    u8 ground, mask, sphere, box, ellipsoid, box_frame, octahedron, inside;
+    u8 p0, p1, p2, p3;
+    u8 d0, d1, d2;
+
+    bounds.min = fathom_vec3_init(-2.0f, -1.0f, -2.0f);
+    bounds.max = fathom_vec3_init(2.0f, 2.0f, 2.0f);
+
+    /* fathom_vec2_mul_mat2x2 on (x, y) and then on (y, z) as row major 3x3 matrices */
+    rotation_z[0] = box_rot.e[FATHOM_MAT2X2_AT(0, 0)];
+    rotation_z[1] = box_rot.e[FATHOM_MAT2X2_AT(1, 0)];
+    rotation_z[2] = 0.0f;
+    rotation_z[3] = box_rot.e[FATHOM_MAT2X2_AT(0, 1)];
+    rotation_z[4] = box_rot.e[FATHOM_MAT2X2_AT(1, 1)];
+    rotation_z[5] = 0.0f;
+    rotation_z[6] = 0.0f;
+    rotation_z[7] = 0.0f;
+    rotation_z[8] = 1.0f;
+
+    rotation_x[0] = 1.0f;
+    rotation_x[1] = 0.0f;
+    rotation_x[2] = 0.0f;
+    rotation_x[3] = 0.0f;
+    rotation_x[4] = box_rot.e[FATHOM_MAT2X2_AT(0, 0)];
+    rotation_x[5] = box_rot.e[FATHOM_MAT2X2_AT(1, 0)];
+    rotation_x[6] = 0.0f;
+    rotation_x[7] = box_rot.e[FATHOM_MAT2X2_AT(0, 1)];
+    rotation_x[8] = box_rot.e[FATHOM_MAT2X2_AT(1, 1)];
+
+    fathom_sdf_vm_begin(program);
+
+    ground = fathom_sdf_vm_plane(program, 0, fathom_vec3_init(0.0f, 1.0f, 0.0f), -0.25f, 0);
+    mask = fathom_sdf_vm_bound_begin(program, 0, &bounds, ground);
+
+    sphere = fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_SPHERE, 0, &sphere_radius, 1, 1);
+
+    p0 = fathom_sdf_vm_translate(program, 0, fathom_vec3_init(-0.5f, 0.5f, -0.5f));
+    p1 = fathom_sdf_vm_rotate(program, p0, rotation_z);
+    p2 = fathom_sdf_vm_rotate(program, p1, rotation_x);
+    p3 = fathom_sdf_vm_scale(program, p2, box_scale);
+    d0 = fathom_sdf_vm_vec3_primitive(program, FATHOM_SDF_VM_OP_BOX, p3, fathom_vec3_init(0.25f, 0.25f, 0.25f), 2);
+    box = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_MUL, d0, 0, box_scale);
+    fathom_sdf_vm_free_position(program, p0);
+    fathom_sdf_vm_free_position(program, p1);
+    fathom_sdf_vm_free_position(program, p2);
+    fathom_sdf_vm_free_position(program, p3);
+    fathom_sdf_vm_free(program, d0);
+
+    p0 = fathom_sdf_vm_translate(program, 0, fathom_vec3_init(1.0f, 0.5f, -0.5f));
+    ellipsoid = fathom_sdf_vm_vec3_primitive(program, FATHOM_SDF_VM_OP_ELLIPSOID, p0, fathom_vec3_init(0.5f, 0.25f, 0.125f), 0);
+    fathom_sdf_vm_free_position(program, p0);
+
+    p0 = fathom_sdf_vm_translate(program, 0, fathom_vec3_init(0.25f, 0.5f, -1.0f));
+    p1 = fathom_sdf_vm_repeat_limited(program, p0, 1.0f, fathom_vec3_init(1.0f, 1.0f, 0.0f));
+    box_frame = fathom_sdf_vm_box_frame(program, p1, fathom_vec3_init(0.25f, 0.25f, 0.25f), 0.025f, 0);
+    fathom_sdf_vm_free_position(program, p0);
+    fathom_sdf_vm_free_position(program, p1);
+
+    p0 = fathom_sdf_vm_translate(program, 0, fathom_vec3_init(0.0f, 0.25f, 0.35f));
+    octahedron = fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_OCTAHEDRON, p0, &octahedron_scale, 1, 0);
+    fathom_sdf_vm_free_position(program, p0);
+
+    d0 = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_SUBTRACT, octahedron, sphere, 0.0f);
+    d1 = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_UNION_SMOOTH, d0, box, 0.4f);
+    d2 = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_UNION_SMOOTH, d1, ellipsoid, 0.2f);
+    fathom_sdf_vm_free(program, d0);
+    fathom_sdf_vm_free(program, d1);
+    d0 = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_UNION_SMOOTH, d2, box_frame, 0.1f);
+    inside = fathom_sdf_vm_operation(program, FATHOM_SDF_VM_OP_UNION_SMOOTH, ground, d0, 0.6f);
+
+    return fathom_sdf_vm_end(program, fathom_sdf_vm_bound_end(program, mask, inside, ground));
+}
+
 #endif /* FATHOM_SDF_SCENE_H */
\ No newline at end of file
@@ -0,0 +1,797 @@
+#ifndef FATHOM_SDF_VM_H
+#define FATHOM_SDF_VM_H
+
+#include "fathom_types.h"
+#include "fathom_math_sdf.h"
+#include "fathom_sparse_grid.h"
+
+/* #############################################################################
+ * # [SECTION] SDF Bytecode
+ * #############################################################################
+ *
+ * A CSG tree compiled into a linear program for a register machine. Position
+ * registers hold sample positions (register 0 is the input), distance registers
+ * hold a distance and the material of the primitive that produced it.
+ * Every instruction is 8 bytes, its parameters live in the constant pool.
+ *
+ * Materials follow the rule of fathom_sdf_scene: a binary operation takes the
+ * material of its second operand where that distance is smaller than the first
+ * one and keeps the material of the first operand otherwise.
+ */
+#define FATHOM_SDF_VM_MAX_INSTRUCTIONS 8192 /* A scene store of 1024 primitives, 5 instructions and 18 constants each at most */
+#define FATHOM_SDF_VM_MAX_CONSTANTS 32768   /* The u16 constant offsets reach 65536 */
+#define FATHOM_SDF_VM_REGISTERS 32          /* Distance registers, one bit each in registers_free */
+#define FATHOM_SDF_VM_POSITION_REGISTERS 16 /* Position registers, register 0 is the input position */
+
+typedef enum fathom_sdf_vm_opcode
+{
+    /* Positions: pd = f(pa) */
+    FATHOM_SDF_VM_OP_TRANSLATE = 0,  /* c: offset xyz, p - offset */
+    FATHOM_SDF_VM_OP_ROTATE,         /* c: 3x3 row major, p' = M p */
+    FATHOM_SDF_VM_OP_SCALE,          /* c: s, p / s (the distance is scaled back with FATHOM_SDF_VM_OP_MUL) */
+    FATHOM_SDF_VM_OP_SYMMETRIC_X,    /* |x| */
+    FATHOM_SDF_VM_OP_SYMMETRIC_XZ,   /* |x|, |z| */
+    FATHOM_SDF_VM_OP_REPEAT,         /* c: spacing xyz */
+    FATHOM_SDF_VM_OP_REPEAT_LIMITED, /* c: spacing, limits xyz */
+
+    /* Primitives: rd = sdf(pa) with material e */
+    FATHOM_SDF_VM_OP_PLANE,      /* c: normal xyz, height */
+    FATHOM_SDF_VM_OP_SPHERE,     /* c: radius */
+    FATHOM_SDF_VM_OP_BOX,        /* c: base xyz */
+    FATHOM_SDF_VM_OP_BOX_FRAME,  /* c: base xyz, edge thickness */
+    FATHOM_SDF_VM_OP_ELLIPSOID,  /* c: radius xyz */
+    FATHOM_SDF_VM_OP_OCTAHEDRON, /* c: scale */
+    FATHOM_SDF_VM_OP_CONSTANT,   /* c: distance, no position */
+
+    /* Distances: rd = op(ra, rb) */
+    FATHOM_SDF_VM_OP_UNION,
+    FATHOM_SDF_VM_OP_SUBTRACT,
+    FATHOM_SDF_VM_OP_INTERSECT,
+    FATHOM_SDF_VM_OP_XOR,
+    FATHOM_SDF_VM_OP_UNION_SMOOTH,     /* c: k */
+    FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH,  /* c: k */
+    FATHOM_SDF_VM_OP_INTERSECT_SMOOTH, /* c: k */
+    FATHOM_SDF_VM_OP_MUL,              /* c: factor, rd = ra * factor */
+    FATHOM_SDF_VM_OP_ROUND,            /* c: radius, rd = ra - radius */
+    FATHOM_SDF_VM_OP_ONION,            /* c: thickness, rd = |ra| - thickness */
+
+    /* Bounds: rd = fathom_sdf_aabb_distance(pa) <= rb as a mask, c: box min xyz, max xyz.
+     * If no position is inside the next e instructions are skipped and FATHOM_SDF_VM_OP_SELECT
+     * picks the outside value (the registers written by the skipped instructions are never read).
+     */
+    FATHOM_SDF_VM_OP_BOUND,
+    FATHOM_SDF_VM_OP_SELECT, /* rd = r[c] ? ra : rb */
+
+    FATHOM_SDF_VM_OP_COUNT
+
+} fathom_sdf_vm_opcode;
+
+typedef struct fathom_sdf_vm_instruction
+{
+    u8 opcode;
+    u8 dst;
+    u8 a;
+    u8 b;
+    u16 c; /* Constant pool offset, the mask register for FATHOM_SDF_VM_OP_SELECT */
+    u16 e; /* Material of a primitive, instructions skipped by FATHOM_SDF_VM_OP_BOUND */
+
+} fathom_sdf_vm_instruction;
+
+typedef struct fathom_sdf_vm_program
+{
+    fathom_sdf_vm_instruction instructions[FATHOM_SDF_VM_MAX_INSTRUCTIONS];
+    f32 constants[FATHOM_SDF_VM_MAX_CONSTANTS];
+    u32 instruction_count;
+    u32 constant_count;
+    u8 result; /* Distance register holding the result after the last instruction */
+
+    /* Builder: free registers as bit masks and a sticky error if the program ran out of space */
+    u32 registers_free;
+    u32 position_registers_free;
+    u8 error;
+
+} fathom_sdf_vm_program;
+
+FATHOM_API void fathom_sdf_vm_begin(fathom_sdf_vm_program *program)
+{
+    program->instruction_count = 0;
+    program->constant_count = 0;
+    program->result = 0;
+    program->registers_free = 0xFFFFFFFF;
+    program->position_registers_free = 0xFFFE; /* Register 0 holds the input */
+    program->error = 0;
+}
+
+/* Lowest free register of the mask, sets error if there is none */
+FATHOM_API u8 fathom_sdf_vm_register_alloc(u32 *registers_free, u8 *error)
+{
+    u8 r;
+
+    for (r = 0; r < 32; ++r)
+    {
+        if (*registers_free & (1u << r))
+        {
+            *registers_free &= ~(1u << r);
+            return r;
+        }
+    }
+
+    *error = 1;
+
+    return 0;
+}
+
+FATHOM_API void fathom_sdf_vm_free(fathom_sdf_vm_program *program, u8 r)
+{
+    program->registers_free |= 1u << r;
+}
+
+FATHOM_API void fathom_sdf_vm_free_position(fathom_sdf_vm_program *program, u8 p)
+{
+    if (p != 0)
+    {
+        program->position_registers_free |= 1u << p;
+    }
+}
+
+/* Appends an instruction and its constants, returns its index */
+FATHOM_API u32 fathom_sdf_vm_emit(fathom_sdf_vm_program *program, u8 opcode, u8 dst, u8 a, u8 b, f32 *constants, u32 constant_count, u16 e)
+{
+    fathom_sdf_vm_instruction *instruction;
+    u32 i;
+
+    if (program->instruction_count >= FATHOM_SDF_VM_MAX_INSTRUCTIONS || program->constant_count + constant_count > FATHOM_SDF_VM_MAX_CONSTANTS)
+    {
+        program->error = 1;
+        return 0;
+    }
+
+    instruction = &program->instructions[program->instruction_count];
+    instruction->opcode = opcode;
+    instruction->dst = dst;
+    instruction->a = a;
+    instruction->b = b;
+    instruction->c = (u16)program->constant_count;
+    instruction->e = e;
+
+    for (i = 0; i < constant_count; ++i)
+    {
+        program->constants[program->constant_count++] = constants[i];
+    }
+
+    return program->instruction_count++;
+}
+
+/* Position instruction on p into a new position register (symmetry and repetition are emitted directly) */
+FATHOM_API u8 fathom_sdf_vm_position(fathom_sdf_vm_program *program, u8 opcode, u8 p, f32 *constants, u32 constant_count)
+{
+    u8 dst = fathom_sdf_vm_register_alloc(&program->position_registers_free, &program->error);
+
+    fathom_sdf_vm_emit(program, opcode, dst, p, 0, constants, constant_count, 0);
+
+    return dst;
+}
+
+FATHOM_API u8 fathom_sdf_vm_translate(fathom_sdf_vm_program *program, u8 p, fathom_vec3 offset)
+{
+    f32 c[3];
+
+    c[0] = offset.x;
+    c[1] = offset.y;
+    c[2] = offset.z;
+
+    return fathom_sdf_vm_position(program, FATHOM_SDF_VM_OP_TRANSLATE, p, c, 3);
+}
+
+/* matrix: 9 floats, row major */
+FATHOM_API u8 fathom_sdf_vm_rotate(fathom_sdf_vm_program *program, u8 p, f32 *matrix)
+{
+    return fathom_sdf_vm_position(program, FATHOM_SDF_VM_OP_ROTATE, p, matrix, 9);
+}
+
+FATHOM_API u8 fathom_sdf_vm_scale(fathom_sdf_vm_program *program, u8 p, f32 scale)
+{
+    return fathom_sdf_vm_position(program, FATHOM_SDF_VM_OP_SCALE, p, &scale, 1);
+}
+
+FATHOM_API u8 fathom_sdf_vm_repeat_limited(fathom_sdf_vm_program *program, u8 p, f32 spacing, fathom_vec3 limits)
+{
+    f32 c[4];
+
+    c[0] = spacing;
+    c[1] = limits.x;
+    c[2] = limits.y;
+    c[3] = limits.z;
+
+    return fathom_sdf_vm_position(program, FATHOM_SDF_VM_OP_REPEAT_LIMITED, p, c, 4);
+}
+
+/* Primitive (or FATHOM_SDF_VM_OP_CONSTANT) on p into a new distance register */
+FATHOM_API u8 fathom_sdf_vm_primitive(fathom_sdf_vm_program *program, u8 opcode, u8 p, f32 *constants, u32 constant_count, u8 material)
+{
+    u8 dst = fathom_sdf_vm_register_alloc(&program->registers_free, &program->error);
+
+    fathom_sdf_vm_emit(program, opcode, dst, p, 0, constants, constant_count, material);
+
+    return dst;
+}
+
+FATHOM_API u8 fathom_sdf_vm_plane(fathom_sdf_vm_program *program, u8 p, fathom_vec3 normal, f32 height, u8 material)
+{
+    f32 c[4];
+
+    c[0] = normal.x;
+    c[1] = normal.y;
+    c[2] = normal.z;
+    c[3] = height;
+
+    return fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_PLANE, p, c, 4, material);
+}
+
+FATHOM_API u8 fathom_sdf_vm_vec3_primitive(fathom_sdf_vm_program *program, u8 opcode, u8 p, fathom_vec3 value, u8 material)
+{
+    f32 c[3];
+
+    c[0] = value.x;
+    c[1] = value.y;
+    c[2] = value.z;
+
+    return fathom_sdf_vm_primitive(program, opcode, p, c, 3, material);
+}
+
+FATHOM_API u8 fathom_sdf_vm_box_frame(fathom_sdf_vm_program *program, u8 p, fathom_vec3 base, f32 edge_thickness, u8 material)
+{
+    f32 c[4];
+
+    c[0] = base.x;
+    c[1] = base.y;
+    c[2] = base.z;
+    c[3] = edge_thickness;
+
+    return fathom_sdf_vm_primitive(program, FATHOM_SDF_VM_OP_BOX_FRAME, p, c, 4, material);
+}
+
+/* Binary operation (k is only stored for the smooth ones) or unary one (b unused, k its parameter) into a new distance register */
+FATHOM_API u8 fathom_sdf_vm_operation(fathom_sdf_vm_program *program, u8 opcode, u8 a, u8 b, f32 k)
+{
+    u8 dst = fathom_sdf_vm_register_alloc(&program->registers_free, &program->error);
+    u8 parameter = opcode >= FATHOM_SDF_VM_OP_UNION_SMOOTH;
+
+    fathom_sdf_vm_emit(program, opcode, dst, a, b, &k, parameter, 0);
+
+    return dst;
+}
+
+/* Starts a bounded block: the instructions up to fathom_sdf_vm_bound_end only run if a position of p lies
+ * in box closer than the distance in reference (squared box distance like the scene bounds test).
+ * Returns the mask register.
+ */
+FATHOM_API u8 fathom_sdf_vm_bound_begin(fathom_sdf_vm_program *program, u8 p, fathom_sdf_aabb *box, u8 reference)
+{
+    u8 dst = fathom_sdf_vm_register_alloc(&program->registers_free, &program->error);
+    f32 c[6];
+
+    c[0] = box->min.x;
+    c[1] = box->min.y;
+    c[2] = box->min.z;
+    c[3] = box->max.x;
+    c[4] = box->max.y;
+    c[5] = box->max.z;
+
+    fathom_sdf_vm_emit(program, FATHOM_SDF_VM_OP_BOUND, dst, p, reference, c, 6, 0);
+
+    return dst;
+}
+
+/* Ends the bounded block of mask: patches its skip distance and selects inside or outside per position */
+FATHOM_API u8 fathom_sdf_vm_bound_end(fathom_sdf_vm_program *program, u8 mask, u8 inside, u8 outside)
+{
+    u8 dst = fathom_sdf_vm_register_alloc(&program->registers_free, &program->error);
+    u32 i;
+    u32 select;
+
+    /* The latest bound writing mask */
+    for (i = program->instruction_count; i > 0; --i)
+    {
+        fathom_sdf_vm_instruction *bound = &program->instructions[i - 1];
+
+        if (bound->opcode == FATHOM_SDF_VM_OP_BOUND && bound->dst == mask)
+        {
+            bound->e = (u16)(program->instruction_count - i);
+            break;
+        }
+    }
+
+    select = fathom_sdf_vm_emit(program, FATHOM_SDF_VM_OP_SELECT, dst, inside, outside, FATHOM_NULL, 0, 0);
+
+    if (!program->error)
+    {
+        program->instructions[select].c = mask;
+    }
+
+    fathom_sdf_vm_free(program, mask);
+
+    return dst;
+}
+
+/* Marks the result register, returns 0 if the program did not fit */
+FATHOM_API u8 fathom_sdf_vm_end(fathom_sdf_vm_program *program, u8 result)
+{
+    program->result = result;
+
+    return (u8)!program->error;
+}
+
+/* #############################################################################
+ * # [SECTION] SDF VM
+ * #############################################################################
+ */
+FATHOM_API FATHOM_INLINE u8 fathom_sdf_vm_closer(u8 material_a, u8 material_b, f32 a, f32 b)
+{
+    return b < a ? material_b : material_a;
+}
+
+/* Runs the program for one position */
+FATHOM_API fathom_grid_data fathom_sdf_vm_evaluate(fathom_sdf_vm_program *program, fathom_vec3 input)
+{
+    fathom_vec3 position[FATHOM_SDF_VM_POSITION_REGISTERS];
+    f32 distance[FATHOM_SDF_VM_REGISTERS];
+    u8 material[FATHOM_SDF_VM_REGISTERS];
+    fathom_grid_data result;
+    u32 i;
+
+    position[0] = input;
+
+    for (i = 0; i < program->instruction_count; ++i)
+    {
+        fathom_sdf_vm_instruction *in = &program->instructions[i];
+        f32 *c = program->constants + in->c;
+        fathom_vec3 p = position[in->a];
+        f32 a = distance[in->a];
+        f32 b = distance[in->b];
+
+        switch (in->opcode)
+        {
+        case FATHOM_SDF_VM_OP_TRANSLATE:
+            position[in->dst] = fathom_vec3_sub(p, fathom_vec3_init(c[0], c[1], c[2]));
+            break;
+        case FATHOM_SDF_VM_OP_ROTATE:
+            position[in->dst] = fathom_sdf_op_rotate(p, c);
+            break;
+        case FATHOM_SDF_VM_OP_SCALE:
+            position[in->dst] = fathom_vec3_divf(p, c[0]);
+            break;
+        case FATHOM_SDF_VM_OP_SYMMETRIC_X:
+            position[in->dst] = fathom_sdf_op_symmetric_x(p);
+            break;
+        case FATHOM_SDF_VM_OP_SYMMETRIC_XZ:
+            position[in->dst] = fathom_sdf_op_symmetric_xz(p);
+            break;
+        case FATHOM_SDF_VM_OP_REPEAT:
+            position[in->dst] = fathom_sdf_op_repeat(p, fathom_vec3_init(c[0], c[1], c[2]));
+            break;
+        case FATHOM_SDF_VM_OP_REPEAT_LIMITED:
+            position[in->dst] = fathom_sdf_op_repeat_limited(p, c[0], fathom_vec3_init(c[1], c[2], c[3]));
+            break;
+
+        case FATHOM_SDF_VM_OP_PLANE:
+            distance[in->dst] = ((p.x * c[0] + p.y * c[1]) + p.z * c[2]) - c[3];
+            material[in->dst] = (u8)in->e;
+            break;
+        case FATHOM_SDF_VM_OP_SPHERE:
+            distance[in->dst] = fathom_sdf_sphere(p, c[0]);
+            material[in->dst] = (u8)in->e;
+            break;
+        case FATHOM_SDF_VM_OP_BOX:
+            distance[in->dst] = fathom_sdf_box(p, fathom_vec3_init(c[0], c[1], c[2]));
+            material[in->dst] = (u8)in->e;
+            break;
+        case FATHOM_SDF_VM_OP_BOX_FRAME:
+            distance[in->dst] = fathom_sdf_box_frame(p, fathom_vec3_init(c[0], c[1], c[2]), c[3]);
+            material[in->dst] = (u8)in->e;
+            break;
+        case FATHOM_SDF_VM_OP_ELLIPSOID:
+            distance[in->dst] = fathom_sdf_ellipsoid(p, fathom_vec3_init(c[0], c[1], c[2]));
+            material[in->dst] = (u8)in->e;
+            break;
+        case FATHOM_SDF_VM_OP_OCTAHEDRON:
+            distance[in->dst] = fathom_sdf_octahedron(p, c[0]);
+            material[in->dst] = (u8)in->e;
+            break;
+        case FATHOM_SDF_VM_OP_CONSTANT:
+            distance[in->dst] = c[0];
+            material[in->dst] = (u8)in->e;
+            break;
+
+        case FATHOM_SDF_VM_OP_UNION:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_union(a, b);
+            break;
+        case FATHOM_SDF_VM_OP_SUBTRACT:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_subtract(a, b);
+            break;
+        case FATHOM_SDF_VM_OP_INTERSECT:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_intersect(a, b);
+            break;
+        case FATHOM_SDF_VM_OP_XOR:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_xor(a, b);
+            break;
+        case FATHOM_SDF_VM_OP_UNION_SMOOTH:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_union_smooth(a, b, c[0]);
+            break;
+        case FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_subtract_smooth(a, b, c[0]);
+            break;
+        case FATHOM_SDF_VM_OP_INTERSECT_SMOOTH:
+            material[in->dst] = fathom_sdf_vm_closer(material[in->a], material[in->b], a, b);
+            distance[in->dst] = fathom_sdf_op_intersect_smooth(a, b, c[0]);
+            break;
+        case FATHOM_SDF_VM_OP_MUL:
+            material[in->dst] = material[in->a];
+            distance[in->dst] = a * c[0];
+            break;
+        case FATHOM_SDF_VM_OP_ROUND:
+            material[in->dst] = material[in->a];
+            distance[in->dst] = fathom_sdf_op_round(a, c[0]);
+            break;
+        case FATHOM_SDF_VM_OP_ONION:
+            material[in->dst] = material[in->a];
+            distance[in->dst] = fathom_sdf_op_onion(a, c[0]);
+            break;
+
+        case FATHOM_SDF_VM_OP_BOUND:
+        {
+            fathom_sdf_aabb box;
+            box.min = fathom_vec3_init(c[0], c[1], c[2]);
+            box.max = fathom_vec3_init(c[3], c[4], c[5]);
+
+            distance[in->dst] = fathom_sdf_aabb_distance(p, &box) <= b ? 1.0f : 0.0f;
+
+            if (distance[in->dst] == 0.0f)
+            {
+                i += in->e;
+            }
+        }
+        break;
+        case FATHOM_SDF_VM_OP_SELECT:
+            material[in->dst] = distance[in->c] != 0.0f ? material[in->a] : material[in->b];
+            distance[in->dst] = distance[in->c] != 0.0f ? a : b;
+            break;
+        default:
+            break;
+        }
+    }
+
+    result.distance = distance[program->result];
+    result.material = material[program->result];
+
+    return result;
+}
+
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+#define FATHOM_SDF_VM_PACKETS 2 /* Most packets of 4 positions run through the program at once */
+
+typedef struct fathom_sdf_vm_registers
+{
+    fathom_vec3x4 position[FATHOM_SDF_VM_POSITION_REGISTERS][FATHOM_SDF_VM_PACKETS];
+    __m128 distance[FATHOM_SDF_VM_REGISTERS][FATHOM_SDF_VM_PACKETS];
+    __m128i material[FATHOM_SDF_VM_REGISTERS][FATHOM_SDF_VM_PACKETS];
+
+} fathom_sdf_vm_registers;
+
+FATHOM_API FATHOM_INLINE __m128i fathom_sdf_vm_closer_x4(__m128i material_a, __m128i material_b, __m128 a, __m128 b)
+{
+    __m128i closer = _mm_castps_si128(_mm_cmplt_ps(b, a));
+
+    return _mm_or_si128(_mm_and_si128(closer, material_b), _mm_andnot_si128(closer, material_a));
+}
+
+/* Runs the program on packets (1 or FATHOM_SDF_VM_PACKETS) packets of 4 positions in position register 0.
+ * Each instruction is decoded once for all packets, the packets are independent so their latencies overlap.
+ */
+FATHOM_API void fathom_sdf_vm_execute_x4(fathom_sdf_vm_program *program, fathom_sdf_vm_registers *r, u32 packets)
+{
+    u32 i, k;
+
+    for (i = 0; i < program->instruction_count; ++i)
+    {
+        fathom_sdf_vm_instruction *in = &program->instructions[i];
+        f32 *c = program->constants + in->c;
+
+        switch (in->opcode)
+        {
+        case FATHOM_SDF_VM_OP_TRANSLATE:
+            for (k = 0; k < packets; ++k)
+            {
+                r->position[in->dst][k] = fathom_vec3x4_sub_vec3(r->position[in->a][k], fathom_vec3_init(c[0], c[1], c[2]));
+            }
+            break;
+        case FATHOM_SDF_VM_OP_ROTATE:
+            {
+                __m128 m[9];
+                u32 j;
+
+                for (j = 0; j < 9; ++j)
+                {
+                    m[j] = _mm_set1_ps(c[j]);
+                }
+
+                for (k = 0; k < packets; ++k)
+                {
+                    r->position[in->dst][k] = fathom_sdf_op_rotate_x4(r->position[in->a][k], m);
+                }
+            }
+            break;
+        case FATHOM_SDF_VM_OP_SCALE:
+            for (k = 0; k < packets; ++k)
+            {
+                fathom_vec3x4 p = r->position[in->a][k];
+                __m128 s = _mm_set1_ps(c[0]);
+
+                p.x = _mm_div_ps(p.x, s);
+                p.y = _mm_div_ps(p.y, s);
+                p.z = _mm_div_ps(p.z, s);
+
+                r->position[in->dst][k] = p;
+            }
+            break;
+        case FATHOM_SDF_VM_OP_SYMMETRIC_X:
+            for (k = 0; k < packets; ++k)
+            {
+                r->position[in->dst][k] = fathom_sdf_op_symmetric_x_x4(r->position[in->a][k]);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_SYMMETRIC_XZ:
+            for (k = 0; k < packets; ++k)
+            {
+                r->position[in->dst][k] = fathom_sdf_op_symmetric_xz_x4(r->position[in->a][k]);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_REPEAT:
+            for (k = 0; k < packets; ++k)
+            {
+                r->position[in->dst][k] = fathom_sdf_op_repeat_x4(r->position[in->a][k], fathom_vec3_init(c[0], c[1], c[2]));
+            }
+            break;
+        case FATHOM_SDF_VM_OP_REPEAT_LIMITED:
+            for (k = 0; k < packets; ++k)
+            {
+                r->position[in->dst][k] = fathom_sdf_op_repeat_limited_x4(r->position[in->a][k], c[0], fathom_vec3_init(c[1], c[2], c[3]));
+            }
+            break;
+
+        case FATHOM_SDF_VM_OP_PLANE:
+            for (k = 0; k < packets; ++k)
+            {
+                fathom_vec3x4 p = r->position[in->a][k];
+                __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.x, _mm_set1_ps(c[0])), _mm_mul_ps(p.y, _mm_set1_ps(c[1]))), _mm_mul_ps(p.z, _mm_set1_ps(c[2])));
+
+                r->distance[in->dst][k] = _mm_sub_ps(dot, _mm_set1_ps(c[3]));
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_SPHERE:
+            for (k = 0; k < packets; ++k)
+            {
+                r->distance[in->dst][k] = fathom_sdf_sphere_x4(r->position[in->a][k], _mm_set1_ps(c[0]));
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_BOX:
+            for (k = 0; k < packets; ++k)
+            {
+                r->distance[in->dst][k] = fathom_sdf_box_x4(r->position[in->a][k], fathom_vec3x4_set1(c[0], c[1], c[2]));
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_BOX_FRAME:
+            for (k = 0; k < packets; ++k)
+            {
+                r->distance[in->dst][k] = fathom_sdf_box_frame_x4(r->position[in->a][k], fathom_vec3x4_set1(c[0], c[1], c[2]), _mm_set1_ps(c[3]));
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_ELLIPSOID:
+            for (k = 0; k < packets; ++k)
+            {
+                r->distance[in->dst][k] = fathom_sdf_ellipsoid_x4(r->position[in->a][k], fathom_vec3x4_set1(c[0], c[1], c[2]));
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_OCTAHEDRON:
+            for (k = 0; k < packets; ++k)
+            {
+                r->distance[in->dst][k] = fathom_sdf_octahedron_x4(r->position[in->a][k], _mm_set1_ps(c[0]));
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+        case FATHOM_SDF_VM_OP_CONSTANT:
+            for (k = 0; k < packets; ++k)
+            {
+                r->distance[in->dst][k] = _mm_set1_ps(c[0]);
+                r->material[in->dst][k] = _mm_set1_epi32((i32)in->e);
+            }
+            break;
+
+        case FATHOM_SDF_VM_OP_UNION:
+        case FATHOM_SDF_VM_OP_SUBTRACT:
+        case FATHOM_SDF_VM_OP_INTERSECT:
+        case FATHOM_SDF_VM_OP_XOR:
+        case FATHOM_SDF_VM_OP_UNION_SMOOTH:
+        case FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH:
+        case FATHOM_SDF_VM_OP_INTERSECT_SMOOTH:
+            for (k = 0; k < packets; ++k)
+            {
+                __m128 a = r->distance[in->a][k];
+                __m128 b = r->distance[in->b][k];
+                __m128 d = a;
+
+                switch (in->opcode)
+                {
+                case FATHOM_SDF_VM_OP_UNION:
+                    d = fathom_sdf_op_union_x4(a, b);
+                    break;
+                case FATHOM_SDF_VM_OP_SUBTRACT:
+                    d = fathom_sdf_op_subtract_x4(a, b);
+                    break;
+                case FATHOM_SDF_VM_OP_INTERSECT:
+                    d = fathom_sdf_op_intersect_x4(a, b);
+                    break;
+                case FATHOM_SDF_VM_OP_XOR:
+                    d = fathom_sdf_op_xor_x4(a, b);
+                    break;
+                case FATHOM_SDF_VM_OP_UNION_SMOOTH:
+                    d = fathom_sdf_op_union_smooth_x4(a, b, c[0]);
+                    break;
+                case FATHOM_SDF_VM_OP_SUBTRACT_SMOOTH:
+                    d = fathom_sdf_op_subtract_smooth_x4(a, b, c[0]);
+                    break;
+                default:
+                    d = fathom_sdf_op_intersect_smooth_x4(a, b, c[0]);
+                    break;
+                }
+
+                r->material[in->dst][k] = fathom_sdf_vm_closer_x4(r->material[in->a][k], r->material[in->b][k], a, b);
+                r->distance[in->dst][k] = d;
+            }
+            break;
+        case FATHOM_SDF_VM_OP_MUL:
+            for (k = 0; k < packets; ++k)
+            {
+                r->material[in->dst][k] = r->material[in->a][k];
+                r->distance[in->dst][k] = _mm_mul_ps(r->distance[in->a][k], _mm_set1_ps(c[0]));
+            }
+            break;
+        case FATHOM_SDF_VM_OP_ROUND:
+            for (k = 0; k < packets; ++k)
+            {
+                r->material[in->dst][k] = r->material[in->a][k];
+                r->distance[in->dst][k] = _mm_sub_ps(r->distance[in->a][k], _mm_set1_ps(c[0]));
+            }
+            break;
+        case FATHOM_SDF_VM_OP_ONION:
+            for (k = 0; k < packets; ++k)
+            {
+                r->material[in->dst][k] = r->material[in->a][k];
+                r->distance[in->dst][k] = _mm_sub_ps(fathom_absf_x4(r->distance[in->a][k]), _mm_set1_ps(c[0]));
+            }
+            break;
+
+        case FATHOM_SDF_VM_OP_BOUND:
+        {
+            i32 any = 0;
+
+            for (k = 0; k < packets; ++k)
+            {
+                __m128 box_distance = fathom_sdf_aabb_distance_x4(r->position[in->a][k], fathom_vec3_init(c[0], c[1], c[2]), fathom_vec3_init(c[3], c[4], c[5]));
+                __m128 inside = _mm_cmple_ps(box_distance, r->distance[in->b][k]);
+
+                r->distance[in->dst][k] = inside;
+                any |= _mm_movemask_ps(inside);
+            }
+
+            if (!any)
+            {
+                i += in->e;
+            }
+        }
+        break;
+        case FATHOM_SDF_VM_OP_SELECT:
+            for (k = 0; k < packets; ++k)
+            {
+                __m128 mask = r->distance[in->c][k];
+                __m128i mask_material = _mm_castps_si128(mask);
+
+                r->material[in->dst][k] = _mm_or_si128(_mm_and_si128(mask_material, r->material[in->a][k]), _mm_andnot_si128(mask_material, r->material[in->b][k]));
+                r->distance[in->dst][k] = _mm_or_ps(_mm_and_ps(mask, r->distance[in->a][k]), _mm_andnot_ps(mask, r->distance[in->b][k]));
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+#endif
+
+/* Evaluates count positions given as struct of arrays, packets packets of 4 positions per pass
+ * (1 or 2, see FATHOM_SDF_VM_PACKETS). Without SIMD every position runs through fathom_sdf_vm_evaluate.
+ */
+FATHOM_API void fathom_sdf_vm_evaluate_batch(fathom_sdf_vm_program *program, f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, u32 packets)
+{
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+    fathom_sdf_vm_registers registers;
+    u32 lanes;
+    u32 i;
+
+    packets = packets < 1 ? 1 : (packets > FATHOM_SDF_VM_PACKETS ? FATHOM_SDF_VM_PACKETS : packets);
+    lanes = packets * 4;
+
+    for (i = 0; i < count; i += lanes)
+    {
+        f32 lane_x[4 * FATHOM_SDF_VM_PACKETS];
+        f32 lane_y[4 * FATHOM_SDF_VM_PACKETS];
+        f32 lane_z[4 * FATHOM_SDF_VM_PACKETS];
+        f32 lane_distance[4 * FATHOM_SDF_VM_PACKETS];
+        i32 lane_material[4 * FATHOM_SDF_VM_PACKETS];
+        u32 lane_count = (count - i) < lanes ? (count - i) : lanes;
+        u32 j, k;
+
+        /* Pad the last pass by repeating its last position */
+        for (j = 0; j < lanes; ++j)
+        {
+            u32 source = i + (j < lane_count ? j : lane_count - 1);
+            lane_x[j] = x[source];
+            lane_y[j] = y[source];
+            lane_z[j] = z[source];
+        }
+
+        for (k = 0; k < packets; ++k)
+        {
+            registers.position[0][k] = fathom_vec3x4_load(lane_x + (4 * k), lane_y + (4 * k), lane_z + (4 * k));
+        }
+
+        fathom_sdf_vm_execute_x4(program, &registers, packets);
+
+        for (k = 0; k < packets; ++k)
+        {
+            _mm_storeu_ps(lane_distance + (4 * k), registers.distance[program->result][k]);
+            _mm_storeu_si128((__m128i *)(lane_material + (4 * k)), registers.material[program->result][k]);
+        }
+
+        for (j = 0; j < lane_count; ++j)
+        {
+            distances[i + j] = lane_distance[j];
+            materials[i + j] = (u8)lane_material[j];
+        }
+    }
+#else
+    u32 i;
+
+    (void)packets;
+
+    for (i = 0; i < count; ++i)
+    {
+        fathom_grid_data data = fathom_sdf_vm_evaluate(program, fathom_vec3_init(x[i], y[i], z[i]));
+        distances[i] = data.distance;
+        materials[i] = data.material;
+    }
+#endif
+}
+
+/* Grid callbacks, user_data is the program (fathom_grid_distance_function and fathom_grid_distance_function_batch) */
+FATHOM_API fathom_grid_data fathom_sdf_vm(fathom_vec3 position, void *user_data)
+{
+    return fathom_sdf_vm_evaluate((fathom_sdf_vm_program *)user_data, position);
+}
+
+FATHOM_API void fathom_sdf_vm_batch(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, void *user_data)
+{
+    fathom_sdf_vm_evaluate_batch((fathom_sdf_vm_program *)user_data, x, y, z, count, distances, materials, 2);
+}
+
+#endif /* FATHOM_SDF_VM_H */
@@ -2,6 +2,7 @@
 #define FATHOM_SPARSE_GRID_H
 
 #include "fathom_math_linear_algebra.h"
+#include "fathom_job.h"
 
 /* #############################################################################
  * # [SECTION] Sparse Grid Helper Functions
@@ -35,6 +36,34 @@ FATHOM_API FATHOM_INLINE s8 fathom_types_f32_to_s8(f32 value)
     return (s8)value;
 }
 
+/* Quantize: map [-trunc, +trunc] to [-127, 127], same result as fathom_types_f32_to_s8(distance * quant_scale) */
+FATHOM_API void fathom_sparse_grid_quantize(f32 *distances, s8 *out, u32 count, f32 quant_scale)
+{
+    u32 i = 0;
+
+#if !defined(FATHOM_DISABLE_SIMD) && defined(FATHOM_ARCH_X64)
+    __m128 scale = _mm_set1_ps(quant_scale);
+    __m128 lo = _mm_set1_ps(-127.0f);
+    __m128 hi = _mm_set1_ps(127.0f);
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i a = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(distances + i + 0), scale), lo), hi));
+        __m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(distances + i + 4), scale), lo), hi));
+        __m128i c = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(distances + i + 8), scale), lo), hi));
+        __m128i d = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(distances + i + 12), scale), lo), hi));
+
+        /* Values are already clamped to [-127, 127] so the saturating packs never change them */
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        out[i] = fathom_types_f32_to_s8(distances[i] * quant_scale);
+    }
+}
+
 /* #############################################################################
  * # [SECTION] Sparse Grid Setup
  * #############################################################################
@@ -44,9 +73,54 @@ FATHOM_API FATHOM_INLINE s8 fathom_types_f32_to_s8(f32 value)
 #define FATHOM_PHYSICAL_BRICK_SIZE (FATHOM_BRICK_SIZE + (2 * FATHOM_BRICK_APRON))                                        /* 10 */
 #define FATHOM_BRICK_TOTAL_VOXELS (FATHOM_PHYSICAL_BRICK_SIZE * FATHOM_PHYSICAL_BRICK_SIZE * FATHOM_PHYSICAL_BRICK_SIZE) /* 1000 */
 
-#define FATHOM_BRICK_MAP_INDEX_AIR 0         /* EMPTY (far outside): Skip Atlas Data */
-#define FATHOM_BRICK_MAP_INDEX_SOLID 0xFFFF  /* SOLID (far inside): Skip Atlas Data */
-#define FATHOM_BRICK_MAP_INDEX_USEFUL 0xFFFE /* USABLE: Sentinal for useable brick. Use this for Atlas Data */
+#define FATHOM_BRICK_MAP_INDEX_AIR 0             /* EMPTY (far outside): Skip Atlas Data */
+#define FATHOM_BRICK_MAP_INDEX_SOLID 0xFFFFFFFF  /* SOLID (far inside): Skip Atlas Data (stored as 0xFFFF in 16 bit mode) */
+#define FATHOM_BRICK_MAP_INDEX_USEFUL 0xFFFFFFFE /* USABLE: Sentinal for useable brick. Use this for Atlas Data (stored as 0xFFFE in 16 bit mode) */
+
+/* Brick map entry width, chosen by fathom_sparse_grid_initialize */
+#define FATHOM_SPARSE_GRID_INDEX_AUTO 0 /* 16 bit if every brick of the grid can be active at once, 32 bit otherwise */
+#define FATHOM_SPARSE_GRID_INDEX_16 2   /* Up to FATHOM_SPARSE_GRID_INDEX_16_MAX_SLOTS atlas slots */
+#define FATHOM_SPARSE_GRID_INDEX_32 4   /* Up to FATHOM_SPARSE_GRID_INDEX_32_MAX_SLOTS atlas slots */
+
+#define FATHOM_SPARSE_GRID_INDEX_16_MAX_SLOTS 0xFFFD   /* 1-based slot indices have to stay below the sentinels 0xFFFE and 0xFFFF */
+#define FATHOM_SPARSE_GRID_INDEX_32_MAX_SLOTS 0x400000 /* Atlas voxel offsets are u32: 4M slots of FATHOM_BRICK_TOTAL_VOXELS stay below 4GB */
+
+#define FATHOM_SPARSE_GRID_MAX_DIMENSION 1024 /* Max bricks per axis (grid_cell_count / FATHOM_BRICK_SIZE) */
+
+#define FATHOM_SPARSE_GRID_ATLAS_HEADROOM 0.25f        /* Default spare atlas slots on top of the active bricks (25%) */
+#define FATHOM_SPARSE_GRID_ATLAS_MAX_TEXTURE_SIZE 2048 /* Default atlas texture limit per axis in voxels, see fathom_sparse_grid_atlas_texture_limit */
+#define FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE 0xFFFFFFFF /* Owner of a slot that holds no brick */
+
+/* Material entry per atlas slot: the material id (0..255) of a brick that has one material in every
+ * voxel, or this flag plus the material slot that holds the per voxel materials of a mixed brick
+ */
+#define FATHOM_SPARSE_GRID_MATERIAL_MIXED 0x80000000
+
+/* Two level brick map: a dense top map over blocks of FATHOM_SPARSE_GRID_LEAF_SIZE^3 bricks and a
+ * pool of leaf blocks. A block that is completely air or solid stores that state in the top map and
+ * owns no leaf, only mixed blocks hold their FATHOM_SPARSE_GRID_LEAF_ENTRIES brick map entries.
+ */
+#define FATHOM_SPARSE_GRID_LEAF_SIZE 4                                                                                  /* Bricks per axis of a leaf block */
+#define FATHOM_SPARSE_GRID_LEAF_ENTRIES (FATHOM_SPARSE_GRID_LEAF_SIZE * FATHOM_SPARSE_GRID_LEAF_SIZE * FATHOM_SPARSE_GRID_LEAF_SIZE) /* 64 */
+#define FATHOM_SPARSE_GRID_LEAF_HEADROOM 0.25f                                                                          /* Default spare leaves on top of the mixed blocks (25%) */
+
+/* Air distance map: Chebyshev distance in bricks from every brick to the nearest brick that is not air,
+ * 0 for those and capped at FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX. Every brick closer than the distance of
+ * an air brick is air, so a traversal can jump over the cube of 2 * distance - 1 bricks around it.
+ */
+#define FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX 16
+
+/* Sub-block skip of the brick fill: the physical brick is split in halves per axis (10 -> 5 -> 3 / 2 voxels).
+ * The center of every sub-block is evaluated and a sub-block whose center distance is further than the
+ * Lipschitz bound from the truncation band is filled with the saturated value without evaluating its voxels.
+ */
+#define FATHOM_SPARSE_GRID_SKIP_LEVELS 2      /* 2^3 sub-blocks of 5^3 voxels, then 2^3 sub-blocks of 3^3 .. 2^3 voxels in each */
+#define FATHOM_SPARSE_GRID_SKIP_MAX_BLOCKS 64 /* Sub-blocks of the last level: 8^FATHOM_SPARSE_GRID_SKIP_LEVELS */
+#define FATHOM_SPARSE_GRID_SKIP_MARGIN 0.05f  /* Cells added to the truncation distance against float error in the distance function */
+
+/* Order of the entries inside a leaf block and of the atlas slots handed out by a full build */
+#define FATHOM_SPARSE_GRID_LAYOUT_LINEAR 0 /* x-fastest inside a leaf, atlas slots in scan order per z-slab */
+#define FATHOM_SPARSE_GRID_LAYOUT_MORTON 1 /* Z-order inside a leaf, atlas slots in Z-order over the storage blocks and the bricks inside of them */
 
 typedef struct fathom_grid_data
 {
@@ -56,22 +130,138 @@ typedef struct fathom_grid_data
 
 typedef fathom_grid_data (*fathom_grid_distance_function)(fathom_vec3 position, void *user_data);
 
+/* Evaluates count positions given as struct of arrays (x, y, z) and writes count distances and materials */
+typedef void (*fathom_grid_distance_function_batch)(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, void *user_data);
+
+/* Writes a range [distance_min, distance_max] that holds the distance of every position in the box [box_min, box_max] */
+typedef void (*fathom_grid_distance_function_interval)(fathom_vec3 box_min, fathom_vec3 box_max, f32 *distance_min, f32 *distance_max, void *user_data);
+
+/* Instructions of a distance program (in program order) that can still change a result inside of a box */
+#define FATHOM_GRID_TAPE_MAX_LENGTH 256
+
+typedef struct fathom_grid_tape
+{
+    u32 length;
+    u16 instructions[FATHOM_GRID_TAPE_MAX_LENGTH];
+
+} fathom_grid_tape;
+
+/* Writes the instructions that can change a distance or material in the box [box_min, box_max] to tape.
+ * Evaluating only those has to give the results of the whole program bit for bit inside of the box.
+ * Returns 0 if the program does not fit a tape.
+ */
+typedef u8 (*fathom_grid_distance_function_prune)(fathom_vec3 box_min, fathom_vec3 box_max, fathom_grid_tape *tape, void *user_data);
+
+/* fathom_grid_distance_function_batch restricted to the instructions of a pruned tape */
+typedef void (*fathom_grid_distance_function_tape)(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, fathom_grid_tape *tape, void *user_data);
+
+typedef struct fathom_grid_distance
+{
+    fathom_grid_distance_function function;                   /* Required: one position per call */
+    fathom_grid_distance_function_batch function_batch;       /* Optional: used by the grid passes if set */
+    fathom_grid_distance_function_interval function_interval; /* Optional: culls bricks and blocks the center test keeps */
+    fathom_grid_distance_function_prune function_prune;       /* Optional, together with function_tape: every brick fill evaluates a tape pruned to the brick */
+    fathom_grid_distance_function_tape function_tape;
+    void *user_data;
+
+} fathom_grid_distance;
+
 typedef struct fathom_sparse_grid
 {
+    /* Zeroth Pass: Top map, one entry per block of FATHOM_SPARSE_GRID_LEAF_SIZE^3 bricks */
+    u32 brick_map_top_dimensions;
+    u32 brick_map_top_bytes;
+    u32 *brick_map_top_data; /* FATHOM_BRICK_MAP_INDEX_AIR / _SOLID for uniform blocks, 1-based leaf otherwise */
+
+    /* Zeroth Pass: Leaf pool sized for the mixed blocks plus headroom, released leaves go on a stack */
+    f32 brick_map_leaf_headroom;
+    u32 brick_map_leaf_capacity;
+    u32 brick_map_leaf_count; /* High water mark: leaves [0, brick_map_leaf_count) are live or on the free stack */
+    u32 brick_map_leaf_bytes;
+    u32 *brick_map_leaf_free_data; /* brick_map_leaf_bytes */
+    u32 brick_map_leaf_free_count;
+
     /* First Pass: Evaluate Brick Map */
     u32 brick_map_dimensions;
-    u32 brick_map_bytes;
+    u32 brick_map_bytes; /* Leaf pool */
     u32 brick_map_active_bricks_count;
-    u16 *brick_map_data;
+    u32 brick_map_index_bytes; /* FATHOM_SPARSE_GRID_INDEX_16 or FATHOM_SPARSE_GRID_INDEX_32 */
+    u32 brick_map_layout;      /* FATHOM_SPARSE_GRID_LAYOUT_LINEAR or FATHOM_SPARSE_GRID_LAYOUT_MORTON, set before pass 0 */
+    void *brick_map_data;      /* Leaf pool of u16 or u32 entries, access with fathom_sparse_grid_brick_map_get/set */
+
+    /* Toroidal addressing: storage position of local brick (0, 0, 0) per axis, moved by fathom_sparse_grid_scroll */
+    u32 brick_map_offset[3];
+
+    /* First Pass: Air distance map, one byte per brick in storage order (x fastest), see FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX.
+     * Bricks outside of the grid count as air. The scratch holds the partial transforms while it is computed.
+     */
+    u32 air_distance_bytes;
+    u8 *air_distance_data;         /* air_distance_bytes */
+    u8 *air_distance_scratch_data; /* air_distance_bytes */
+
+    /* First Pass: Active bricks per z-slab, turned into the first atlas slot of each slab (exclusive prefix sum) */
+    u32 slab_atlas_offset[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    /* First and Second Pass: Distance function evaluations per z-slab */
+    u32 slab_sdf_calls[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    /* Second Pass: Voxels per z-slab filled by the sub-block skip instead of being evaluated */
+    u32 slab_sdf_skipped[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    /* Second Pass: Pruned tapes per z-slab, their summed length and the bricks that got one */
+    u32 slab_tape_length[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u32 slab_tape_bricks[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    /* Zeroth and First Pass: Bricks per z-slab (blocks per block slab) that only the distance range culled */
+    u32 slab_interval_culled[FATHOM_SPARSE_GRID_MAX_DIMENSION];
 
     /* Second Pass: Fill Atlas */
     u32 atlas_bricks_per_row;
+    u32 atlas_bricks_per_column;
+    u32 atlas_brick_layers;  /* Bricks along z: slots fill a row, then a layer of rows, then the next layer */
+    u32 atlas_max_bricks[3]; /* Most bricks per axis the atlas texture may hold */
+    u32 atlas_slot_capacity; /* Bricks of the atlas box, at most the slot limit of the index width */
+    u32 atlas_slot_count;    /* High water mark: slots [0, atlas_slot_count) are live or on the free list */
+
+    /* Atlas Allocator: owning brick map index per slot and a stack of released slots below the high water mark */
+    f32 atlas_headroom; /* Spare capacity of the full build relative to the active bricks, set before pass 1 */
+    u32 atlas_dedup;    /* Fold identical bricks into one slot at the end of pass 2, set before pass 2 */
+    u32 sub_block_skip; /* Fill saturated sub-blocks of a brick without evaluating their voxels, see FATHOM_SPARSE_GRID_SKIP_LEVELS */
+    f32 lipschitz;      /* Upper bound of the distance function gradient, the sub-block skip relies on it */
+    u32 atlas_slot_bytes;
+    u32 *atlas_slot_owner_data; /* atlas_slot_bytes, a shared slot keeps the brick it was filled for */
+    u32 *atlas_slot_ref_data;   /* atlas_slot_bytes, brick map entries pointing at each slot */
+    u32 *atlas_free_slot_data;  /* atlas_slot_bytes */
+    u32 *atlas_slot_hash_data;   /* atlas_slot_bytes, payload hash per slot, only used with atlas_dedup */
+    u32 *atlas_dedup_table_data; /* 2 * atlas_slot_bytes, open addressing over the slot hashes, only used with atlas_dedup */
+    u32 atlas_dedup_table_inserts;
+    u32 atlas_free_slot_count;
     fathom_vec3 atlas_dimensions;
     fathom_vec3 atlas_dimensions_inverse;
     u32 atlas_bytes;
     s8 *atlas_data;
 
+    /* Materials: material_data holds the per voxel materials of every atlas slot (atlas_bytes) for the
+     * passes. Only mixed bricks get a slot in the material atlas on the GPU, it shares the bricks per
+     * row and column of the atlas and is material_brick_layers deep.
+     */
     u8 *material_data;
+    u32 *atlas_slot_material_data; /* atlas_slot_bytes, see FATHOM_SPARSE_GRID_MATERIAL_MIXED */
+    u32 *material_free_slot_data;  /* atlas_slot_bytes */
+    u32 material_free_slot_count;
+    u32 material_slot_capacity;
+    u32 material_slot_count; /* High water mark like atlas_slot_count */
+    u32 material_brick_layers;
+    fathom_vec3 material_dimensions;
+
+    /* Statistics: Distance function evaluations (without apron sharing pass 2 needs FATHOM_BRICK_TOTAL_VOXELS per active brick) */
+    u32 sdf_calls_pass_01; /* Including the block centers of pass 0 */
+    u32 interval_culled_pass_00; /* Blocks made uniform by the distance range (function_interval) */
+    u32 interval_culled_pass_01; /* Bricks of mixed blocks culled by the distance range */
+    u32 sdf_calls_pass_02;    /* Including the sub-block centers */
+    u32 sdf_skipped_pass_02;  /* Voxels filled with the saturated value without an evaluation */
+    u32 tape_length_pass_02;  /* Instructions of the pruned tapes summed over tape_bricks_pass_02 bricks */
+    u32 tape_bricks_pass_02;
 
     /* Data for shader upload */
     fathom_vec3 start;
@@ -83,14 +273,54 @@ typedef struct fathom_sparse_grid
     u32 cell_count;
     f32 brick_radius;
     f32 cull_threshold;
+    f32 block_cull_threshold; /* cull_threshold grown by the distance from a block center to its outermost brick center */
 
 } fathom_sparse_grid;
 
-FATHOM_API u8 fathom_sparse_grid_initialize(fathom_sparse_grid *grid, fathom_vec3 grid_center, u32 grid_cell_count, f32 grid_cell_size)
+/* index_mode: FATHOM_SPARSE_GRID_INDEX_AUTO, FATHOM_SPARSE_GRID_INDEX_16 or FATHOM_SPARSE_GRID_INDEX_32
+ * grid_cell_count has to be a multiple of FATHOM_BRICK_SIZE * FATHOM_SPARSE_GRID_LEAF_SIZE (32).
+ */
+FATHOM_API u8 fathom_sparse_grid_initialize(fathom_sparse_grid *grid, fathom_vec3 grid_center, u32 grid_cell_count, f32 grid_cell_size, u32 index_mode)
 {
+    u32 brick_count;
+
     /* First Pass: Calculate Brick Map Memory Requirements */
     grid->brick_map_dimensions = grid_cell_count / FATHOM_BRICK_SIZE;
-    grid->brick_map_bytes = grid->brick_map_dimensions * grid->brick_map_dimensions * grid->brick_map_dimensions * sizeof(u16);
+    grid->brick_map_offset[0] = grid->brick_map_offset[1] = grid->brick_map_offset[2] = 0;
+
+    if (grid->brick_map_dimensions > FATHOM_SPARSE_GRID_MAX_DIMENSION || grid->brick_map_dimensions == 0 ||
+        grid_cell_count % (FATHOM_BRICK_SIZE * FATHOM_SPARSE_GRID_LEAF_SIZE) != 0)
+    {
+        return 0;
+    }
+
+    brick_count = grid->brick_map_dimensions * grid->brick_map_dimensions * grid->brick_map_dimensions;
+
+    if (index_mode == FATHOM_SPARSE_GRID_INDEX_AUTO)
+    {
+        index_mode = brick_count <= FATHOM_SPARSE_GRID_INDEX_16_MAX_SLOTS ? FATHOM_SPARSE_GRID_INDEX_16 : FATHOM_SPARSE_GRID_INDEX_32;
+    }
+
+    if (index_mode != FATHOM_SPARSE_GRID_INDEX_16 && index_mode != FATHOM_SPARSE_GRID_INDEX_32)
+    {
+        return 0;
+    }
+
+    grid->brick_map_index_bytes = index_mode;
+    grid->brick_map_layout = FATHOM_SPARSE_GRID_LAYOUT_LINEAR;
+
+    /* Zeroth Pass: The top map is dense, the leaf pool is sized by pass 0 */
+    grid->brick_map_top_dimensions = grid->brick_map_dimensions / FATHOM_SPARSE_GRID_LEAF_SIZE;
+    grid->brick_map_top_bytes = grid->brick_map_top_dimensions * grid->brick_map_top_dimensions * grid->brick_map_top_dimensions * sizeof(u32);
+    grid->brick_map_leaf_headroom = FATHOM_SPARSE_GRID_LEAF_HEADROOM;
+    grid->brick_map_leaf_capacity = 0;
+    grid->brick_map_leaf_count = 0;
+    grid->brick_map_leaf_free_count = 0;
+    grid->brick_map_leaf_bytes = 0;
+    grid->brick_map_bytes = 0;
+
+    /* First Pass: The air distance map is dense like the brick map texture */
+    grid->air_distance_bytes = brick_count;
 
     /* Data for shader upload */
     grid->start = fathom_vec3_subf(grid_center, (f32)grid_cell_count * grid_cell_size * 0.5f);
@@ -102,164 +332,2892 @@ FATHOM_API u8 fathom_sparse_grid_initialize(fathom_sparse_grid *grid, fathom_vec
     grid->cell_count = grid_cell_count;
     grid->brick_radius = (FATHOM_PHYSICAL_BRICK_SIZE * 0.5f) * 1.7320508f * grid_cell_size;
     grid->cull_threshold = grid->brick_radius + grid->truncation_distance;
+    grid->block_cull_threshold = grid->cull_threshold + ((f32)(FATHOM_SPARSE_GRID_LEAF_SIZE - 1) * 0.5f) * 1.7320508f * (f32)FATHOM_BRICK_SIZE * grid_cell_size;
+
+    grid->atlas_headroom = FATHOM_SPARSE_GRID_ATLAS_HEADROOM;
+    grid->atlas_dedup = 1;
+    grid->sub_block_skip = 1;
+    grid->lipschitz = 1.0f;
+    grid->atlas_max_bricks[0] = FATHOM_SPARSE_GRID_ATLAS_MAX_TEXTURE_SIZE / FATHOM_PHYSICAL_BRICK_SIZE;
+    grid->atlas_max_bricks[1] = FATHOM_SPARSE_GRID_ATLAS_MAX_TEXTURE_SIZE / FATHOM_PHYSICAL_BRICK_SIZE;
+    grid->atlas_max_bricks[2] = FATHOM_SPARSE_GRID_ATLAS_MAX_TEXTURE_SIZE / FATHOM_PHYSICAL_BRICK_SIZE;
 
     return 1;
 }
 
-FATHOM_API u8 fathom_sparse_grid_pass_01_fill_brick_map(fathom_sparse_grid *grid, fathom_grid_distance_function distance_function, void *user_data)
+/* Limits the atlas texture of the next full build to width x height x depth voxels (e.g. GL_MAX_3D_TEXTURE_SIZE), call before pass 1 */
+FATHOM_API void fathom_sparse_grid_atlas_texture_limit(fathom_sparse_grid *grid, u32 width, u32 height, u32 depth)
 {
-    u32 brick_map_index = 0;
-    u32 active_brick_count = 0;
+    grid->atlas_max_bricks[0] = width / FATHOM_PHYSICAL_BRICK_SIZE;
+    grid->atlas_max_bricks[1] = height / FATHOM_PHYSICAL_BRICK_SIZE;
+    grid->atlas_max_bricks[2] = depth / FATHOM_PHYSICAL_BRICK_SIZE;
+}
 
-    u32 bx, by, bz;
-    f32 px, py, pz;
+/* #############################################################################
+ * # [SECTION] Sparse Grid Bricks
+ * #############################################################################
+ */
 
-    fathom_vec3 start = grid->start;
+/* Box of bricks [brick_min, brick_max) */
+typedef struct fathom_sparse_grid_region
+{
+    u32 brick_min[3];
+    u32 brick_max[3];
 
-    f32 brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
-    f32 center_off = brick_step * 0.5f;
+} fathom_sparse_grid_region;
+
+/* Voxels of one physical brick that have to be evaluated, as struct of arrays */
+typedef struct fathom_sparse_grid_brick_scratch
+{
+    f32 x[FATHOM_BRICK_TOTAL_VOXELS];
+    f32 y[FATHOM_BRICK_TOTAL_VOXELS];
+    f32 z[FATHOM_BRICK_TOTAL_VOXELS];
+    f32 distance[FATHOM_BRICK_TOTAL_VOXELS];
+    s8 quantized[FATHOM_BRICK_TOTAL_VOXELS];
+    u8 material[FATHOM_BRICK_TOTAL_VOXELS];
+    u32 atlas_index[FATHOM_BRICK_TOTAL_VOXELS];
+
+    /* Sub-block skip: voxels that are neither copied from a neighbour nor filled yet, and the sub-blocks (min xyz, size xyz) of a level */
+    u8 pending[FATHOM_BRICK_TOTAL_VOXELS];
+    u8 block[FATHOM_SPARSE_GRID_SKIP_MAX_BLOCKS][6];
+    u8 child[FATHOM_SPARSE_GRID_SKIP_MAX_BLOCKS][6];
+    u32 skipped; /* Voxels filled by the sub-block skip, summed over the bricks of a slab */
+
+    /* Distance program pruned to the brick being filled (function_prune), only evaluated if tape_valid */
+    fathom_grid_tape tape;
+    u8 tape_valid;
+    u32 tape_length; /* Summed over the bricks of a slab like skipped */
+    u32 tape_bricks;
+
+} fathom_sparse_grid_brick_scratch;
+
+FATHOM_API FATHOM_INLINE u8 fathom_sparse_grid_brick_map_is_index(u32 entry)
+{
+    return entry != FATHOM_BRICK_MAP_INDEX_AIR && entry != FATHOM_BRICK_MAP_INDEX_SOLID && entry != FATHOM_BRICK_MAP_INDEX_USEFUL;
+}
+
+FATHOM_API FATHOM_INLINE u8 fathom_sparse_grid_brick_map_is_leaf(u32 top_entry)
+{
+    return top_entry != FATHOM_BRICK_MAP_INDEX_AIR && top_entry != FATHOM_BRICK_MAP_INDEX_SOLID;
+}
+
+/* Entry at brick map index, 16 bit sentinels are widened to FATHOM_BRICK_MAP_INDEX_SOLID / _USEFUL.
+ * The index addresses the block (index / FATHOM_SPARSE_GRID_LEAF_ENTRIES) and the brick inside of it,
+ * a uniform block answers for all of its bricks from the top map.
+ */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_brick_map_get(fathom_sparse_grid *grid, u32 index)
+{
+    u32 top_entry = grid->brick_map_top_data[index / FATHOM_SPARSE_GRID_LEAF_ENTRIES];
+    u32 entry;
+
+    if (!fathom_sparse_grid_brick_map_is_leaf(top_entry))
+    {
+        return top_entry;
+    }
+
+    index = ((top_entry - 1) * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + (index % FATHOM_SPARSE_GRID_LEAF_ENTRIES);
+
+    if (grid->brick_map_index_bytes == FATHOM_SPARSE_GRID_INDEX_32)
+    {
+        return ((u32 *)grid->brick_map_data)[index];
+    }
+
+    entry = ((u16 *)grid->brick_map_data)[index];
+
+    return entry >= 0xFFFE ? entry | 0xFFFF0000 : entry;
+}
 
-    pz = start.z;
+FATHOM_API FATHOM_INLINE void fathom_sparse_grid_brick_map_leaf_store(fathom_sparse_grid *grid, u32 leaf_index, u32 entry)
+{
+    if (grid->brick_map_index_bytes == FATHOM_SPARSE_GRID_INDEX_32)
+    {
+        ((u32 *)grid->brick_map_data)[leaf_index] = entry;
+    }
+    else
+    {
+        /* Truncating keeps the sentinels apart: 0xFFFFFFFF -> 0xFFFF, 0xFFFFFFFE -> 0xFFFE */
+        ((u16 *)grid->brick_map_data)[leaf_index] = (u16)entry;
+    }
+}
+
+/* Hands out a leaf with every entry set to fill and points the top map entry block at it.
+ * The free stack is only touched outside of the parallel passes. Pass 1 starts with an empty pool
+ * and takes leaves from the high water mark, which several slab jobs may do at once.
+ * Returns 0 if the pool is exhausted.
+ */
+FATHOM_API u8 fathom_sparse_grid_brick_map_leaf_alloc(fathom_sparse_grid *grid, u32 block, u32 fill)
+{
+    u32 leaf;
+    u32 i;
 
-    for (bz = 0; bz < grid->brick_map_dimensions; ++bz, pz += brick_step)
+    if (grid->brick_map_leaf_free_count > 0)
+    {
+        leaf = grid->brick_map_leaf_free_data[--grid->brick_map_leaf_free_count];
+    }
+    else
     {
-        py = start.y;
+        leaf = FATHOM_JOB_ATOMIC_ADD(&grid->brick_map_leaf_count, 1u) - 1;
 
-        for (by = 0; by < grid->brick_map_dimensions; ++by, py += brick_step)
+        if (leaf >= grid->brick_map_leaf_capacity)
         {
-            px = start.x;
+            FATHOM_JOB_ATOMIC_ADD(&grid->brick_map_leaf_count, 0xFFFFFFFFu);
+            return 0;
+        }
+    }
 
-            for (bx = 0; bx < grid->brick_map_dimensions; ++bx, px += brick_step, ++brick_map_index)
-            {
-                fathom_vec3 center = fathom_vec3_init(px + center_off, py + center_off, pz + center_off);
-                fathom_grid_data data = distance_function(center, user_data);
+    for (i = 0; i < FATHOM_SPARSE_GRID_LEAF_ENTRIES; ++i)
+    {
+        fathom_sparse_grid_brick_map_leaf_store(grid, (leaf * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + i, fill);
+    }
 
-                if (fathom_absf(data.distance) > grid->cull_threshold)
-                {
-                    /* Culled: Either air (0) or solid (0xFFFF) */
-                    u16 state = (data.distance > 0.0f) ? FATHOM_BRICK_MAP_INDEX_AIR : FATHOM_BRICK_MAP_INDEX_SOLID;
-                    grid->brick_map_data[brick_map_index] = state;
-                }
-                else
-                {
-                    /* Active: sentinel so the next pass knows to calculate it */
-                    u16 state = FATHOM_BRICK_MAP_INDEX_USEFUL;
-                    grid->brick_map_data[brick_map_index] = state;
-                    active_brick_count++;
-                }
-            }
+    grid->brick_map_top_data[block] = leaf + 1;
+
+    return 1;
+}
+
+/* Writes the entry at brick map index. Writing into a uniform block with a different state splits
+ * it into a leaf first. Returns 0 if that needs a leaf and the pool is exhausted.
+ */
+FATHOM_API FATHOM_INLINE u8 fathom_sparse_grid_brick_map_set(fathom_sparse_grid *grid, u32 index, u32 entry)
+{
+    u32 block = index / FATHOM_SPARSE_GRID_LEAF_ENTRIES;
+    u32 top_entry = grid->brick_map_top_data[block];
+
+    if (!fathom_sparse_grid_brick_map_is_leaf(top_entry))
+    {
+        if (top_entry == entry)
+        {
+            return 1;
         }
+
+        if (!fathom_sparse_grid_brick_map_leaf_alloc(grid, block, top_entry))
+        {
+            return 0;
+        }
+
+        top_entry = grid->brick_map_top_data[block];
     }
 
-    grid->brick_map_active_bricks_count = active_brick_count;
+    fathom_sparse_grid_brick_map_leaf_store(grid, ((top_entry - 1) * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + (index % FATHOM_SPARSE_GRID_LEAF_ENTRIES), entry);
+
+    return 1;
+}
+
+/* Most atlas slots a brick map entry can address */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_atlas_slot_limit(fathom_sparse_grid *grid)
+{
+    return grid->brick_map_index_bytes == FATHOM_SPARSE_GRID_INDEX_32 ? FATHOM_SPARSE_GRID_INDEX_32_MAX_SLOTS : FATHOM_SPARSE_GRID_INDEX_16_MAX_SLOTS;
+}
+
+/* Spreads the two bits of a coordinate inside a leaf block to the bits 0 and 3 of a Morton code */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_morton_spread(u32 value)
+{
+    return (value & 1u) | ((value & 2u) << 2);
+}
+
+/* Brick map index of the brick at storage position (sx, sy, sz): block first, then the brick inside of it */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_brick_map_storage_index(fathom_sparse_grid *grid, u32 sx, u32 sy, u32 sz)
+{
+    u32 top_dim = grid->brick_map_top_dimensions;
+    u32 block = (sx / FATHOM_SPARSE_GRID_LEAF_SIZE) + ((sy / FATHOM_SPARSE_GRID_LEAF_SIZE) * top_dim) + ((sz / FATHOM_SPARSE_GRID_LEAF_SIZE) * top_dim * top_dim);
+    u32 local;
+
+    if (grid->brick_map_layout == FATHOM_SPARSE_GRID_LAYOUT_MORTON)
+    {
+        /* Every 2x2x2 group of bricks shares 8 consecutive entries (16 or 32 bytes) */
+        local = fathom_sparse_grid_morton_spread(sx % FATHOM_SPARSE_GRID_LEAF_SIZE) |
+                (fathom_sparse_grid_morton_spread(sy % FATHOM_SPARSE_GRID_LEAF_SIZE) << 1) |
+                (fathom_sparse_grid_morton_spread(sz % FATHOM_SPARSE_GRID_LEAF_SIZE) << 2);
+    }
+    else
+    {
+        local = (sx % FATHOM_SPARSE_GRID_LEAF_SIZE) + ((sy % FATHOM_SPARSE_GRID_LEAF_SIZE) * FATHOM_SPARSE_GRID_LEAF_SIZE) + ((sz % FATHOM_SPARSE_GRID_LEAF_SIZE) * FATHOM_SPARSE_GRID_LEAF_SIZE * FATHOM_SPARSE_GRID_LEAF_SIZE);
+    }
+
+    return (block * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + local;
+}
+
+/* Brick map index of the local brick (bx, by, bz).
+ * The map is addressed toroidally so a scrolled grid keeps the entries of the bricks that stay inside
+ * of it in place and reuses the storage of the bricks that left for the ones that entered.
+ */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_brick_map_index(fathom_sparse_grid *grid, u32 bx, u32 by, u32 bz)
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 sx = bx + grid->brick_map_offset[0];
+    u32 sy = by + grid->brick_map_offset[1];
+    u32 sz = bz + grid->brick_map_offset[2];
+
+    sx = sx >= dim ? sx - dim : sx;
+    sy = sy >= dim ? sy - dim : sy;
+    sz = sz >= dim ? sz - dim : sz;
+
+    return fathom_sparse_grid_brick_map_storage_index(grid, sx, sy, sz);
+}
+
+/* Releases the leaves whose bricks are all air or all solid, the block state moves back into the top map.
+ * Returns the number of released leaves.
+ */
+FATHOM_API u32 fathom_sparse_grid_brick_map_prune(fathom_sparse_grid *grid)
+{
+    u32 top_dim = grid->brick_map_top_dimensions;
+    u32 block_count = top_dim * top_dim * top_dim;
+    u32 released = 0;
+    u32 block;
 
-    /* Calculate atlas dimensions and bytes required (e.g. how big does the atlas 3d texture needs to be to fit all relevant bricks) */
+    for (block = 0; block < block_count; ++block)
     {
-        u32 bricks_per_row = (u32)fathom_ceilf(fathom_sqrtf((f32)active_brick_count));
-        u32 bricks_per_col = (active_brick_count + bricks_per_row - 1) / bricks_per_row;
+        u32 top_entry = grid->brick_map_top_data[block];
+        u32 first;
+        u32 i;
 
-        grid->atlas_bricks_per_row = bricks_per_row;
+        if (!fathom_sparse_grid_brick_map_is_leaf(top_entry))
+        {
+            continue;
+        }
 
-        grid->atlas_dimensions = fathom_vec3_init(
-            (f32)(bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE),
-            (f32)(bricks_per_col * FATHOM_PHYSICAL_BRICK_SIZE),
-            (f32)FATHOM_PHYSICAL_BRICK_SIZE);
+        first = fathom_sparse_grid_brick_map_get(grid, block * FATHOM_SPARSE_GRID_LEAF_ENTRIES);
+
+        if (first != FATHOM_BRICK_MAP_INDEX_AIR && first != FATHOM_BRICK_MAP_INDEX_SOLID)
+        {
+            continue;
+        }
 
-        grid->atlas_dimensions_inverse = fathom_vec3_init(
-            1.0f / (f32)grid->atlas_dimensions.x,
-            1.0f / (f32)grid->atlas_dimensions.y,
-            1.0f / (f32)grid->atlas_dimensions.z);
+        for (i = 1; i < FATHOM_SPARSE_GRID_LEAF_ENTRIES && fathom_sparse_grid_brick_map_get(grid, (block * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + i) == first; ++i)
+        {
+        }
 
-        grid->atlas_bytes = (u32)(grid->atlas_dimensions.x * grid->atlas_dimensions.y * grid->atlas_dimensions.z) * sizeof(u8);
+        if (i == FATHOM_SPARSE_GRID_LEAF_ENTRIES)
+        {
+            grid->brick_map_top_data[block] = first;
+            grid->brick_map_leaf_free_data[grid->brick_map_leaf_free_count++] = top_entry - 1;
+            released++;
+        }
     }
 
-    return 1;
+    return released;
 }
 
-FATHOM_API u8 fathom_sparse_grid_pass_02_fill_atlas(fathom_sparse_grid *grid, fathom_grid_distance_function distance_function, void *user_data)
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_brick_classify(fathom_sparse_grid *grid, f32 center_distance)
 {
-    u32 bricks_per_row = grid->atlas_bricks_per_row;
-    u32 atlas_used_count = 0;
-    f32 quant_scale = 127.0f / grid->truncation_distance;
+    if (fathom_absf(center_distance) > grid->cull_threshold)
+    {
+        /* Culled: Either air or solid */
+        return (center_distance > 0.0f) ? FATHOM_BRICK_MAP_INDEX_AIR : FATHOM_BRICK_MAP_INDEX_SOLID;
+    }
 
-    f32 apron_offset = -((f32)FATHOM_BRICK_APRON * grid->cell_size);
-    u32 atlas_width = bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
-    u32 atlas_height = ((grid->brick_map_active_bricks_count + bricks_per_row - 1) / bricks_per_row) * FATHOM_PHYSICAL_BRICK_SIZE;
+    /* Active: sentinel so the next pass knows to calculate it */
+    return FATHOM_BRICK_MAP_INDEX_USEFUL;
+}
 
-    u32 bx, by, bz;
-    u32 lx, ly, lz;
+/* Box of the physical bricks [b, b + bricks) per axis, aprons included */
+FATHOM_API void fathom_sparse_grid_brick_box(fathom_sparse_grid *grid, u32 bx, u32 by, u32 bz, u32 bricks, fathom_vec3 *box_min, fathom_vec3 *box_max)
+{
+    f32 voxel_min = -(f32)FATHOM_BRICK_APRON;
+    f32 voxel_max = (f32)(bricks * FATHOM_BRICK_SIZE) - 1.0f + (f32)FATHOM_BRICK_APRON;
 
-    for (bz = 0; bz < grid->brick_map_dimensions; ++bz)
+    box_min->x = grid->start.x + ((f32)(bx * FATHOM_BRICK_SIZE) + voxel_min) * grid->cell_size;
+    box_min->y = grid->start.y + ((f32)(by * FATHOM_BRICK_SIZE) + voxel_min) * grid->cell_size;
+    box_min->z = grid->start.z + ((f32)(bz * FATHOM_BRICK_SIZE) + voxel_min) * grid->cell_size;
+    box_max->x = grid->start.x + ((f32)(bx * FATHOM_BRICK_SIZE) + voxel_max) * grid->cell_size;
+    box_max->y = grid->start.y + ((f32)(by * FATHOM_BRICK_SIZE) + voxel_max) * grid->cell_size;
+    box_max->z = grid->start.z + ((f32)(bz * FATHOM_BRICK_SIZE) + voxel_max) * grid->cell_size;
+}
+
+/* Tightens an active state with the distance range over the physical bricks [b, b + bricks) per axis,
+ * aprons included: if the range lies outside of the truncation band every voxel saturates, the bricks
+ * are air or solid. Keeps FATHOM_SPARSE_GRID_SKIP_MARGIN against float error like the sub-block skip.
+ */
+FATHOM_API u32 fathom_sparse_grid_classify_interval(fathom_sparse_grid *grid, fathom_grid_distance *distance, u32 bx, u32 by, u32 bz, u32 bricks, u32 state)
+{
+    f32 saturated = grid->truncation_distance + (FATHOM_SPARSE_GRID_SKIP_MARGIN * grid->cell_size);
+    fathom_vec3 box_min;
+    fathom_vec3 box_max;
+    f32 distance_min;
+    f32 distance_max;
+
+    if (state != FATHOM_BRICK_MAP_INDEX_USEFUL || !distance->function_interval)
+    {
+        return state;
+    }
+
+    fathom_sparse_grid_brick_box(grid, bx, by, bz, bricks, &box_min, &box_max);
+
+    distance->function_interval(box_min, box_max, &distance_min, &distance_max, distance->user_data);
+
+    if (distance_min > saturated)
+    {
+        return FATHOM_BRICK_MAP_INDEX_AIR;
+    }
+
+    if (distance_max < -saturated)
     {
-        for (by = 0; by < grid->brick_map_dimensions; ++by)
+        return FATHOM_BRICK_MAP_INDEX_SOLID;
+    }
+
+    return state;
+}
+
+/* First voxel of an atlas slot */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_atlas_slot_base(fathom_sparse_grid *grid, u32 slot)
+{
+    u32 atlas_width = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_height = grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 row = slot / grid->atlas_bricks_per_row;
+    u32 layer = row / grid->atlas_bricks_per_column;
+
+    return ((slot - (row * grid->atlas_bricks_per_row)) * FATHOM_PHYSICAL_BRICK_SIZE) +
+           ((row - (layer * grid->atlas_bricks_per_column)) * FATHOM_PHYSICAL_BRICK_SIZE * atlas_width) +
+           (layer * FATHOM_PHYSICAL_BRICK_SIZE * atlas_width * atlas_height);
+}
+
+/* Evaluates count positions given as struct of arrays into distances, count is at most FATHOM_SPARSE_GRID_MAX_DIMENSION */
+FATHOM_API void fathom_sparse_grid_evaluate_row(fathom_grid_distance *distance, f32 *x, f32 *y, f32 *z, u32 count, f32 *distances)
+{
+    u32 i;
+
+    if (distance->function_batch)
+    {
+        u8 row_material[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+        distance->function_batch(x, y, z, count, distances, row_material, distance->user_data);
+    }
+    else
+    {
+        for (i = 0; i < count; ++i)
         {
-            for (bx = 0; bx < grid->brick_map_dimensions; ++bx)
-            {
-                u32 map_idx = bx + (by * grid->brick_map_dimensions) + (bz * grid->brick_map_dimensions * grid->brick_map_dimensions);
+            distances[i] = distance->function(fathom_vec3_init(x[i], y[i], z[i]), distance->user_data).distance;
+        }
+    }
+}
 
-                fathom_vec3 brick_min;
-                u32 cur_idx;
-                u32 atlas_bx, atlas_by;
-                u32 atlas_vox_stride;
-                u32 atlas_slice_stride;
+/* Evaluates the brick centers bx in [bx_min, bx_max) of the row (by, bz) into distances[0, bx_max - bx_min) */
+FATHOM_API void fathom_sparse_grid_evaluate_brick_centers(fathom_sparse_grid *grid, fathom_grid_distance *distance, u32 bx_min, u32 bx_max, u32 by, u32 bz, f32 *distances)
+{
+    f32 brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
+    f32 center_off = brick_step * 0.5f;
 
-                if (grid->brick_map_data[map_idx] != FATHOM_BRICK_MAP_INDEX_USEFUL)
-                {
-                    continue;
-                }
+    f32 py = grid->start.y + ((f32)by * brick_step) + center_off;
+    f32 pz = grid->start.z + ((f32)bz * brick_step) + center_off;
 
-                /* 1. Determine World Space origin for this brick (including apron) */
-                brick_min = fathom_vec3_init(
-                    grid->start.x + (f32)(bx * FATHOM_BRICK_SIZE) * grid->cell_size,
-                    grid->start.y + (f32)(by * FATHOM_BRICK_SIZE) * grid->cell_size,
-                    grid->start.z + (f32)(bz * FATHOM_BRICK_SIZE) * grid->cell_size);
+    /* Brick centers of one x-row */
+    f32 row_x[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_y[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_z[FATHOM_SPARSE_GRID_MAX_DIMENSION];
 
-                /* 2. Determine Atlas Destination (Brick Coordinates) */
-                cur_idx = atlas_used_count++;
-                atlas_bx = cur_idx % bricks_per_row;
-                atlas_by = cur_idx / bricks_per_row;
+    u32 bx;
 
-                /* 3. Voxel Fill Loop */
-                atlas_vox_stride = atlas_width;
-                atlas_slice_stride = atlas_width * atlas_height;
+    for (bx = bx_min; bx < bx_max; ++bx)
+    {
+        row_x[bx - bx_min] = grid->start.x + ((f32)bx * brick_step) + center_off;
+        row_y[bx - bx_min] = py;
+        row_z[bx - bx_min] = pz;
+    }
 
-                for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
-                {
-                    f32 pz = brick_min.z + apron_offset + ((f32)lz * grid->cell_size);
+    fathom_sparse_grid_evaluate_row(distance, row_x, row_y, row_z, bx_max - bx_min, distances);
+}
 
-                    for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
-                    {
-                        f32 py = brick_min.y + apron_offset + ((f32)ly * grid->cell_size);
+/* Evaluates the distances and materials of the first count positions of the scratch, with the pruned tape if there is one */
+FATHOM_API void fathom_sparse_grid_evaluate_scratch(fathom_grid_distance *distance, fathom_sparse_grid_brick_scratch *scratch, u32 count)
+{
+    u32 k;
+
+    if (scratch->tape_valid)
+    {
+        distance->function_tape(scratch->x, scratch->y, scratch->z, count, scratch->distance, scratch->material, &scratch->tape, distance->user_data);
+    }
+    else if (distance->function_batch)
+    {
+        distance->function_batch(scratch->x, scratch->y, scratch->z, count, scratch->distance, scratch->material, distance->user_data);
+    }
+    else
+    {
+        for (k = 0; k < count; ++k)
+        {
+            fathom_grid_data data = distance->function(fathom_vec3_init(scratch->x[k], scratch->y[k], scratch->z[k]), distance->user_data);
+            scratch->distance[k] = data.distance;
+            scratch->material[k] = data.material;
+        }
+    }
+}
 
-                        /* Calculate destination pointer for this row (x-line) in the atlas */
-                        u32 dst_x = atlas_bx * FATHOM_PHYSICAL_BRICK_SIZE;
-                        u32 dst_y = (atlas_by * FATHOM_PHYSICAL_BRICK_SIZE) + ly;
-                        u32 dst_z = lz;
+/* Sub-block skip of brick (bx, by, bz): every pending voxel of a sub-block whose center distance d satisfies
+ * |d| - lipschitz * radius >= truncation_distance quantizes to -127 / 127 anyway, so it is written directly
+ * and its pending flag is cleared. Saturated voxels get material 0 no matter if they were skipped or
+ * evaluated, so a brick does not depend on which neighbour filled its apron. The shader never samples
+ * their material: a saturated voxel is more than the truncation distance away from the surface.
+ * A sub-block is only split further if one of its children could still pass the test, which the parent
+ * center bounds: |d_child| <= |d| + lipschitz * |child center - center|.
+ * Returns the number of distance function evaluations (sub-block centers).
+ */
+FATHOM_API u32 fathom_sparse_grid_skip_saturated(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_sparse_grid_brick_scratch *scratch, u32 bx, u32 by, u32 bz, u32 atlas_base)
+{
+    f32 apron_offset = -((f32)FATHOM_BRICK_APRON * grid->cell_size);
+    fathom_vec3 lattice_start = fathom_vec3_addf(grid->start, apron_offset);
+    u32 atlas_vox_stride = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice_stride = atlas_vox_stride * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    f32 saturated = grid->truncation_distance + (FATHOM_SPARSE_GRID_SKIP_MARGIN * grid->cell_size);
+    f32 half_cell = 0.5f * grid->cell_size;
 
-                        s8 *dst_row = &grid->atlas_data[dst_x + (dst_y * atlas_vox_stride) + (dst_z * atlas_slice_stride)];
-                        u8 *dst_material_row = &grid->material_data[dst_x + (dst_y * atlas_vox_stride) + (dst_z * atlas_slice_stride)];
+    u32 block_count = 1;
+    u32 evaluations = 0;
+    u32 level;
 
-                        for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
-                        {
-                            f32 px = brick_min.x + apron_offset + ((f32)lx * grid->cell_size);
-                            fathom_grid_data data = distance_function(fathom_vec3_init(px, py, pz), user_data);
+    /* Level -1: the whole physical brick, never evaluated. Its distance bound disables the parent test. */
+    scratch->block[0][0] = scratch->block[0][1] = scratch->block[0][2] = 0;
+    scratch->block[0][3] = scratch->block[0][4] = scratch->block[0][5] = FATHOM_PHYSICAL_BRICK_SIZE;
+    scratch->distance[0] = 1e30f;
+
+    for (level = 0; level < FATHOM_SPARSE_GRID_SKIP_LEVELS && block_count > 0; ++level)
+    {
+        u32 child_count = 0;
+        u32 b, c;
+
+        /* 1. Children that hold pending voxels and could pass the test, gather their centers */
+        for (b = 0; b < block_count; ++b)
+        {
+            u8 *block = scratch->block[b];
+            f32 parent_distance = fathom_absf(scratch->distance[b]);
 
-                            /* Quantize: map [-trunc, +trunc] to [-127, 127] */
-                            f32 val = data.distance * quant_scale;
-                            dst_row[lx] = fathom_types_f32_to_s8(val);
+            for (c = 0; c < 8; ++c)
+            {
+                u8 *child = scratch->child[child_count];
+                u32 axis;
+                u32 lx, ly, lz;
+                u8 pending = 0;
+                f32 offset_sq = 0.0f;
+                f32 radius_sq = 0.0f;
+
+                for (axis = 0; axis < 3; ++axis)
+                {
+                    u32 low = (u32)(block[3 + axis] + 1) / 2;
+                    u32 high = (c >> axis) & 1;
+                    f32 offset;
+
+                    child[axis] = (u8)(block[axis] + (high ? low : 0u));
+                    child[3 + axis] = (u8)(high ? block[3 + axis] - low : low);
+
+                    /* Doubled voxel coordinates of the centers avoid the halves */
+                    offset = (f32)((2 * child[axis] + child[3 + axis]) - (2 * block[axis] + block[3 + axis])) * half_cell;
+                    offset_sq += offset * offset;
+                    radius_sq += (f32)((child[3 + axis] - 1) * (child[3 + axis] - 1)) * half_cell * half_cell;
+                }
+
+                if (child[3] == 0 || child[4] == 0 || child[5] == 0 ||
+                    parent_distance + grid->lipschitz * fathom_sqrtf(offset_sq) < saturated + grid->lipschitz * fathom_sqrtf(radius_sq))
+                {
+                    continue;
+                }
 
-                            dst_material_row[lx] = data.material;
+                for (lz = child[2]; lz < (u32)(child[2] + child[5]) && !pending; ++lz)
+                {
+                    for (ly = child[1]; ly < (u32)(child[1] + child[4]) && !pending; ++ly)
+                    {
+                        for (lx = child[0]; lx < (u32)(child[0] + child[3]); ++lx)
+                        {
+                            if (scratch->pending[lx + (ly * FATHOM_PHYSICAL_BRICK_SIZE) + (lz * FATHOM_PHYSICAL_BRICK_SIZE * FATHOM_PHYSICAL_BRICK_SIZE)])
+                            {
+                                pending = 1;
+                                break;
+                            }
                         }
                     }
                 }
 
-                /* 4. Update Map with 1-based index to Atlas Brick */
-                grid->brick_map_data[map_idx] = (u16)(cur_idx + 1);
-            }
-        }
-    }
+                if (!pending)
+                {
+                    continue;
+                }
+
+                scratch->x[child_count] = lattice_start.x + ((f32)((bx * FATHOM_BRICK_SIZE * 2) + (2 * child[0]) + child[3] - 1) * half_cell);
+                scratch->y[child_count] = lattice_start.y + ((f32)((by * FATHOM_BRICK_SIZE * 2) + (2 * child[1]) + child[4] - 1) * half_cell);
+                scratch->z[child_count] = lattice_start.z + ((f32)((bz * FATHOM_BRICK_SIZE * 2) + (2 * child[2]) + child[5] - 1) * half_cell);
+                child_count++;
+            }
+        }
+
+        /* 2. Evaluate the centers, fill the saturated children and keep the others for the next level */
+        fathom_sparse_grid_evaluate_scratch(distance, scratch, child_count);
+        evaluations += child_count;
+        block_count = 0;
+
+        for (c = 0; c < child_count; ++c)
+        {
+            u8 *child = scratch->child[c];
+            f32 d = scratch->distance[c];
+            u32 lx, ly, lz;
+            f32 radius_sq = 0.0f;
+            u32 axis;
+
+            for (axis = 0; axis < 3; ++axis)
+            {
+                radius_sq += (f32)((child[3 + axis] - 1) * (child[3 + axis] - 1)) * half_cell * half_cell;
+            }
+
+            if (fathom_absf(d) - grid->lipschitz * fathom_sqrtf(radius_sq) < saturated)
+            {
+                /* The distances of the kept blocks move down to their slot, block_count <= c */
+                scratch->distance[block_count] = d;
+                scratch->block[block_count][0] = child[0];
+                scratch->block[block_count][1] = child[1];
+                scratch->block[block_count][2] = child[2];
+                scratch->block[block_count][3] = child[3];
+                scratch->block[block_count][4] = child[4];
+                scratch->block[block_count][5] = child[5];
+                block_count++;
+                continue;
+            }
+
+            for (lz = child[2]; lz < (u32)(child[2] + child[5]); ++lz)
+            {
+                for (ly = child[1]; ly < (u32)(child[1] + child[4]); ++ly)
+                {
+                    for (lx = child[0]; lx < (u32)(child[0] + child[3]); ++lx)
+                    {
+                        u32 local = lx + (ly * FATHOM_PHYSICAL_BRICK_SIZE) + (lz * FATHOM_PHYSICAL_BRICK_SIZE * FATHOM_PHYSICAL_BRICK_SIZE);
+                        u32 dst = atlas_base + lx + (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+
+                        if (!scratch->pending[local])
+                        {
+                            continue;
+                        }
+
+                        grid->atlas_data[dst] = (s8)(d > 0.0f ? 127 : -127);
+                        grid->material_data[dst] = 0;
+                        scratch->pending[local] = 0;
+                        scratch->skipped++;
+                    }
+                }
+            }
+        }
+    }
+
+    return evaluations;
+}
+
+/* Fills the atlas slot of brick (bx, by, bz) and points its brick map entry at it.
+ *
+ * Apron sharing: adjacent physical bricks overlap by 2 * FATHOM_BRICK_APRON voxels per axis.
+ * Voxels that a finished neighbour brick already holds are copied from its atlas slot instead of
+ * being evaluated again. Sample positions are derived from the global voxel lattice so a copied
+ * value is bit identical to an evaluated one.
+ *
+ * A neighbour is finished if it has an atlas slot and lies outside of the region being filled, or
+ * inside of it and was filled before: earlier in scan order of the same slab, or in a neighbouring
+ * slab while odd slabs are filled (even slabs of a region are always filled first).
+ *
+ * With sub_block_skip the voxels left over are first offered to fathom_sparse_grid_skip_saturated.
+ * With function_prune every evaluation of the brick runs the tape pruned to its box.
+ * Returns the number of distance function evaluations.
+ */
+FATHOM_API u32 fathom_sparse_grid_fill_brick(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_sparse_grid_region *region, fathom_sparse_grid_brick_scratch *scratch, u32 bx, u32 by, u32 bz, u32 slot)
+{
+    f32 quant_scale = 127.0f / grid->truncation_distance;
+
+    f32 apron_offset = -((f32)FATHOM_BRICK_APRON * grid->cell_size);
+    fathom_vec3 lattice_start = fathom_vec3_addf(grid->start, apron_offset);
+    u32 atlas_vox_stride = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice_stride = atlas_vox_stride * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 dim = grid->brick_map_dimensions;
+
+    u32 atlas_base = fathom_sparse_grid_atlas_slot_base(grid, slot);
+    u32 count = 0;
+    u32 evaluations = 0;
+    u32 lx, ly, lz;
+    u32 c, k;
+
+    /* Per overlap class (low/mid/high per axis): atlas base of the neighbour providing the voxel and its offset */
+    u32 class_source_base[27];
+    u32 class_source_e[27]; /* Packed neighbour offset ex + 3 * ey + 9 * ez, each e = d + 1 */
+
+    /* 1. Find a finished neighbour for every overlap class */
+    for (c = 0; c < 27; ++c)
+    {
+        u32 cx = c % 3;
+        u32 cy = (c / 3) % 3;
+        u32 cz = c / 9;
+        u32 ex, ey, ez;
+
+        class_source_base[c] = 0xFFFFFFFF;
+        class_source_e[c] = 13;
+
+        /* Class 0 (low) can be shared with the -1 neighbour, class 2 (high) with the +1 neighbour */
+        for (ez = (cz == 0 ? 0u : 1u); ez <= (cz == 2 ? 2u : 1u) && class_source_base[c] == 0xFFFFFFFF; ++ez)
+        {
+            for (ey = (cy == 0 ? 0u : 1u); ey <= (cy == 2 ? 2u : 1u) && class_source_base[c] == 0xFFFFFFFF; ++ey)
+            {
+                for (ex = (cx == 0 ? 0u : 1u); ex <= (cx == 2 ? 2u : 1u); ++ex)
+                {
+                    u32 nx = bx + ex - 1;
+                    u32 ny = by + ey - 1;
+                    u32 nz = bz + ez - 1;
+                    u32 entry;
+                    u8 inside;
+
+                    /* Unsigned wrap turns -1 into a large value */
+                    if ((ex == 1 && ey == 1 && ez == 1) || nx >= dim || ny >= dim || nz >= dim)
+                    {
+                        continue;
+                    }
+
+                    entry = fathom_sparse_grid_brick_map_get(grid, fathom_sparse_grid_brick_map_index(grid, nx, ny, nz));
+
+                    if (!fathom_sparse_grid_brick_map_is_index(entry))
+                    {
+                        continue;
+                    }
+
+                    inside = nx >= region->brick_min[0] && nx < region->brick_max[0] &&
+                             ny >= region->brick_min[1] && ny < region->brick_max[1] &&
+                             nz >= region->brick_min[2] && nz < region->brick_max[2];
+
+                    if (!inside || (nz == bz && (ny < by || (ny == by && nx < bx))) || (nz != bz && (bz & 1)))
+                    {
+                        u32 neighbour_slot = entry - 1;
+                        class_source_base[c] = fathom_sparse_grid_atlas_slot_base(grid, neighbour_slot);
+                        class_source_e[c] = ex + (3 * ey) + (9 * ez);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    /* 2. Copy shared voxels from the neighbours, mark the rest as pending */
+    for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
+    {
+        u32 cz = lz < 2 * FATHOM_BRICK_APRON ? 0u : (lz >= FATHOM_BRICK_SIZE ? 2u : 1u);
+
+        for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
+        {
+            u32 cy = ly < 2 * FATHOM_BRICK_APRON ? 0u : (ly >= FATHOM_BRICK_SIZE ? 2u : 1u);
+
+            for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
+            {
+                u32 cx = lx < 2 * FATHOM_BRICK_APRON ? 0u : (lx >= FATHOM_BRICK_SIZE ? 2u : 1u);
+                u32 cls = cx + (3 * cy) + (9 * cz);
+                u32 dst = atlas_base + lx + (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+                u32 local = lx + (ly * FATHOM_PHYSICAL_BRICK_SIZE) + (lz * FATHOM_PHYSICAL_BRICK_SIZE * FATHOM_PHYSICAL_BRICK_SIZE);
+
+                scratch->pending[local] = (u8)(class_source_base[cls] == 0xFFFFFFFF);
+
+                if (class_source_base[cls] != 0xFFFFFFFF)
+                {
+                    /* Neighbour local coordinate: l + BRICK_SIZE for e = 0, l for e = 1, l - BRICK_SIZE for e = 2 */
+                    u32 e = class_source_e[cls];
+                    u32 sx = lx + FATHOM_BRICK_SIZE - (FATHOM_BRICK_SIZE * (e % 3));
+                    u32 sy = ly + FATHOM_BRICK_SIZE - (FATHOM_BRICK_SIZE * ((e / 3) % 3));
+                    u32 sz = lz + FATHOM_BRICK_SIZE - (FATHOM_BRICK_SIZE * (e / 9));
+                    u32 src = class_source_base[cls] + sx + (sy * atlas_vox_stride) + (sz * atlas_slice_stride);
+
+                    grid->atlas_data[dst] = grid->atlas_data[src];
+                    grid->material_data[dst] = grid->material_data[src];
+                }
+                else
+                {
+                    count++;
+                }
+            }
+        }
+    }
+
+    /* 3. Prune the distance program to the brick, fill saturated sub-blocks, gather the voxels still pending for evaluation */
+    scratch->tape_valid = 0;
+
+    if (distance->function_prune && distance->function_tape && count > 0)
+    {
+        fathom_vec3 box_min;
+        fathom_vec3 box_max;
+
+        fathom_sparse_grid_brick_box(grid, bx, by, bz, 1, &box_min, &box_max);
+
+        scratch->tape_valid = distance->function_prune(box_min, box_max, &scratch->tape, distance->user_data);
+        scratch->tape_length += scratch->tape_valid ? scratch->tape.length : 0;
+        scratch->tape_bricks += scratch->tape_valid;
+    }
+
+    if (grid->sub_block_skip && count > 0)
+    {
+        evaluations += fathom_sparse_grid_skip_saturated(grid, distance, scratch, bx, by, bz, atlas_base);
+    }
+
+    count = 0;
+
+    for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
+    {
+        f32 pz = lattice_start.z + (f32)((bz * FATHOM_BRICK_SIZE) + lz) * grid->cell_size;
+
+        for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
+        {
+            f32 py = lattice_start.y + (f32)((by * FATHOM_BRICK_SIZE) + ly) * grid->cell_size;
+
+            for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
+            {
+                if (!scratch->pending[lx + (ly * FATHOM_PHYSICAL_BRICK_SIZE) + (lz * FATHOM_PHYSICAL_BRICK_SIZE * FATHOM_PHYSICAL_BRICK_SIZE)])
+                {
+                    continue;
+                }
+
+                scratch->x[count] = lattice_start.x + (f32)((bx * FATHOM_BRICK_SIZE) + lx) * grid->cell_size;
+                scratch->y[count] = py;
+                scratch->z[count] = pz;
+                scratch->atlas_index[count] = atlas_base + lx + (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+                count++;
+            }
+        }
+    }
+
+    /* 4. Evaluate the remaining voxels and quantize them: map [-trunc, +trunc] to [-127, 127] */
+    fathom_sparse_grid_evaluate_scratch(distance, scratch, count);
+
+    fathom_sparse_grid_quantize(scratch->distance, scratch->quantized, count, quant_scale);
+
+    for (k = 0; k < count; ++k)
+    {
+        s8 quantized = scratch->quantized[k];
+
+        grid->atlas_data[scratch->atlas_index[k]] = quantized;
+        grid->material_data[scratch->atlas_index[k]] = (grid->sub_block_skip && (quantized == 127 || quantized == -127)) ? 0 : scratch->material[k];
+    }
+
+    /* 5. Update Map with 1-based index to Atlas Brick */
+    fathom_sparse_grid_brick_map_set(grid, fathom_sparse_grid_brick_map_index(grid, bx, by, bz), slot + 1);
+    grid->atlas_slot_owner_data[slot] = fathom_sparse_grid_brick_map_index(grid, bx, by, bz);
+
+    return evaluations + count;
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Passes (per z-slab of bricks)
+ * #############################################################################
+ */
+typedef struct fathom_sparse_grid_pass_context
+{
+    fathom_sparse_grid *grid;
+    fathom_grid_distance *distance;
+    fathom_sparse_grid_region *region;
+    u32 slab_first; /* Job i processes slab slab_first + i * slab_step */
+    u32 slab_step;
+
+} fathom_sparse_grid_pass_context;
+
+/* Local brick coordinate of the storage coordinate s on axis */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_storage_to_local(fathom_sparse_grid *grid, u32 s, u32 axis)
+{
+    return (s + grid->brick_map_dimensions - grid->brick_map_offset[axis]) % grid->brick_map_dimensions;
+}
+
+/* Classifies the blocks of the storage block slab tz by their center and returns the number of mixed blocks.
+ * A block is uniform if its center is further away from the surface than block_cull_threshold: every
+ * brick center of it is then culled by the brick test with the same sign (distance bound).
+ * Mixed blocks are marked FATHOM_BRICK_MAP_INDEX_USEFUL for pass 1, so are blocks that the toroidal
+ * offset splits across two ends of the grid since they have no single center.
+ */
+FATHOM_API u32 fathom_sparse_grid_pass_00_fill_top_map_slab(fathom_sparse_grid *grid, fathom_grid_distance *distance, u32 tz)
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 top_dim = grid->brick_map_top_dimensions;
+    f32 brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
+    u32 mixed_block_count = 0;
+    u32 interval_culled = 0;
+    u32 tx, ty;
+
+    f32 row_x[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_y[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_z[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_distance[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u32 row_local[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u8 row_split[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    /* First local brick of the block per axis, the block center sits on the brick boundary half a block further */
+    u32 lz = fathom_sparse_grid_storage_to_local(grid, tz * FATHOM_SPARSE_GRID_LEAF_SIZE, 2);
+    f32 pz = grid->start.z + ((f32)lz + (f32)FATHOM_SPARSE_GRID_LEAF_SIZE * 0.5f) * brick_step;
+
+    for (ty = 0; ty < top_dim; ++ty)
+    {
+        u32 ly = fathom_sparse_grid_storage_to_local(grid, ty * FATHOM_SPARSE_GRID_LEAF_SIZE, 1);
+        f32 py = grid->start.y + ((f32)ly + (f32)FATHOM_SPARSE_GRID_LEAF_SIZE * 0.5f) * brick_step;
+
+        for (tx = 0; tx < top_dim; ++tx)
+        {
+            u32 lx = fathom_sparse_grid_storage_to_local(grid, tx * FATHOM_SPARSE_GRID_LEAF_SIZE, 0);
+
+            row_x[tx] = grid->start.x + ((f32)lx + (f32)FATHOM_SPARSE_GRID_LEAF_SIZE * 0.5f) * brick_step;
+            row_y[tx] = py;
+            row_z[tx] = pz;
+            row_local[tx] = lx;
+            row_split[tx] = (u8)(lx + FATHOM_SPARSE_GRID_LEAF_SIZE > dim || ly + FATHOM_SPARSE_GRID_LEAF_SIZE > dim || lz + FATHOM_SPARSE_GRID_LEAF_SIZE > dim);
+        }
+
+        fathom_sparse_grid_evaluate_row(distance, row_x, row_y, row_z, top_dim, row_distance);
+
+        for (tx = 0; tx < top_dim; ++tx)
+        {
+            u32 block = tx + (ty * top_dim) + (tz * top_dim * top_dim);
+            u32 state = FATHOM_BRICK_MAP_INDEX_USEFUL;
+
+            if (!row_split[tx] && fathom_absf(row_distance[tx]) > grid->block_cull_threshold)
+            {
+                state = (row_distance[tx] > 0.0f) ? FATHOM_BRICK_MAP_INDEX_AIR : FATHOM_BRICK_MAP_INDEX_SOLID;
+            }
+            else if (!row_split[tx])
+            {
+                /* The center only bounds the block by its radius, the distance range may still prove it uniform */
+                state = fathom_sparse_grid_classify_interval(grid, distance, row_local[tx], ly, lz, FATHOM_SPARSE_GRID_LEAF_SIZE, state);
+                interval_culled += (state != FATHOM_BRICK_MAP_INDEX_USEFUL);
+            }
+
+            mixed_block_count += (state == FATHOM_BRICK_MAP_INDEX_USEFUL);
+
+            grid->brick_map_top_data[block] = state;
+        }
+    }
+
+    grid->slab_interval_culled[tz] = interval_culled;
+
+    return mixed_block_count;
+}
+
+/* Classifies all bricks of the blocks marked by pass 0 in the storage block slab tz.
+ * Stores the active bricks of every (local) brick slab in slab_atlas_offset and returns the number
+ * of distance function evaluations. The bricks of uniform blocks keep the state of their block.
+ */
+FATHOM_API u32 fathom_sparse_grid_pass_01_fill_brick_map_slab(fathom_sparse_grid *grid, fathom_grid_distance *distance, u32 tz)
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 top_dim = grid->brick_map_top_dimensions;
+    f32 brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
+    f32 center_off = brick_step * 0.5f;
+    u32 sdf_calls = 0;
+    u32 tx, ty;
+    u32 sx, sy, sz;
+
+    f32 row_x[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_y[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_z[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    f32 row_distance[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u32 row_index[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u32 row_local[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    /* Leaves for the mixed blocks, pass 0 left the pool empty and sized it for all of them */
+    for (ty = 0; ty < top_dim; ++ty)
+    {
+        for (tx = 0; tx < top_dim; ++tx)
+        {
+            u32 block = tx + (ty * top_dim) + (tz * top_dim * top_dim);
+
+            if (grid->brick_map_top_data[block] == FATHOM_BRICK_MAP_INDEX_USEFUL)
+            {
+                fathom_sparse_grid_brick_map_leaf_alloc(grid, block, FATHOM_BRICK_MAP_INDEX_AIR);
+            }
+        }
+    }
+
+    for (sz = tz * FATHOM_SPARSE_GRID_LEAF_SIZE; sz < (tz + 1) * FATHOM_SPARSE_GRID_LEAF_SIZE; ++sz)
+    {
+        u32 bz = fathom_sparse_grid_storage_to_local(grid, sz, 2);
+        f32 pz = grid->start.z + ((f32)bz * brick_step) + center_off;
+        u32 active_brick_count = 0;
+        u32 interval_culled = 0;
+
+        for (sy = 0; sy < dim; ++sy)
+        {
+            u32 by = fathom_sparse_grid_storage_to_local(grid, sy, 1);
+            f32 py = grid->start.y + ((f32)by * brick_step) + center_off;
+            u32 count = 0;
+            u32 k;
+
+            /* Gather the brick centers of all mixed blocks of the row */
+            for (tx = 0; tx < top_dim; ++tx)
+            {
+                u32 block = tx + ((sy / FATHOM_SPARSE_GRID_LEAF_SIZE) * top_dim) + (tz * top_dim * top_dim);
+
+                if (!fathom_sparse_grid_brick_map_is_leaf(grid->brick_map_top_data[block]))
+                {
+                    continue;
+                }
+
+                for (sx = tx * FATHOM_SPARSE_GRID_LEAF_SIZE; sx < (tx + 1) * FATHOM_SPARSE_GRID_LEAF_SIZE; ++sx)
+                {
+                    u32 bx = fathom_sparse_grid_storage_to_local(grid, sx, 0);
+
+                    row_x[count] = grid->start.x + ((f32)bx * brick_step) + center_off;
+                    row_y[count] = py;
+                    row_z[count] = pz;
+                    row_index[count] = fathom_sparse_grid_brick_map_storage_index(grid, sx, sy, sz);
+                    row_local[count] = bx;
+                    count++;
+                }
+            }
+
+            if (count == 0)
+            {
+                continue;
+            }
+
+            fathom_sparse_grid_evaluate_row(distance, row_x, row_y, row_z, count, row_distance);
+            sdf_calls += count;
+
+            for (k = 0; k < count; ++k)
+            {
+                u32 state = fathom_sparse_grid_brick_classify(grid, row_distance[k]);
+                u32 refined = fathom_sparse_grid_classify_interval(grid, distance, row_local[k], by, bz, 1, state);
+                fathom_sparse_grid_brick_map_set(grid, row_index[k], refined);
+
+                if (refined == FATHOM_BRICK_MAP_INDEX_USEFUL)
+                {
+                    active_brick_count++;
+                }
+                else if (state == FATHOM_BRICK_MAP_INDEX_USEFUL)
+                {
+                    interval_culled++;
+                }
+            }
+        }
+
+        grid->slab_atlas_offset[bz] = active_brick_count;
+        grid->slab_interval_culled[bz] = interval_culled;
+    }
+
+    return sdf_calls;
+}
+
+/* Fills the atlas for all active bricks of the slab bz.
+ * Atlas slots are handed out in scan order starting at the slabs prefix sum offset,
+ * which makes the result independent of the order in which slabs are processed.
+ * Bricks that pass 1 already gave a slot (FATHOM_SPARSE_GRID_LAYOUT_MORTON) keep it.
+ * Returns the number of distance function evaluations.
+ */
+FATHOM_API u32 fathom_sparse_grid_pass_02_fill_atlas_slab(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_sparse_grid_region *region, u32 bz)
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 atlas_used_count = grid->slab_atlas_offset[bz];
+    u32 sdf_calls = 0;
+    u32 bx, by;
+
+    fathom_sparse_grid_brick_scratch scratch;
+    scratch.skipped = 0;
+    scratch.tape_length = 0;
+    scratch.tape_bricks = 0;
+
+    for (by = 0; by < dim; ++by)
+    {
+        for (bx = 0; bx < dim; ++bx)
+        {
+            u32 entry = fathom_sparse_grid_brick_map_get(grid, fathom_sparse_grid_brick_map_index(grid, bx, by, bz));
+
+            if (entry == FATHOM_BRICK_MAP_INDEX_USEFUL)
+            {
+                sdf_calls += fathom_sparse_grid_fill_brick(grid, distance, region, &scratch, bx, by, bz, atlas_used_count++);
+            }
+            else if (fathom_sparse_grid_brick_map_is_index(entry))
+            {
+                sdf_calls += fathom_sparse_grid_fill_brick(grid, distance, region, &scratch, bx, by, bz, entry - 1);
+            }
+        }
+    }
+
+    grid->slab_sdf_skipped[bz] = scratch.skipped;
+    grid->slab_tape_length[bz] = scratch.tape_length;
+    grid->slab_tape_bricks[bz] = scratch.tape_bricks;
+
+    return sdf_calls;
+}
+
+/* Refills all bricks with an atlas slot inside of the region in slab bz */
+FATHOM_API u32 fathom_sparse_grid_update_region_slab(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_sparse_grid_region *region, u32 bz)
+{
+    u32 sdf_calls = 0;
+    u32 bx, by;
+
+    fathom_sparse_grid_brick_scratch scratch;
+    scratch.skipped = 0;
+    scratch.tape_length = 0;
+    scratch.tape_bricks = 0;
+
+    for (by = region->brick_min[1]; by < region->brick_max[1]; ++by)
+    {
+        for (bx = region->brick_min[0]; bx < region->brick_max[0]; ++bx)
+        {
+            u32 entry = fathom_sparse_grid_brick_map_get(grid, fathom_sparse_grid_brick_map_index(grid, bx, by, bz));
+
+            if (fathom_sparse_grid_brick_map_is_index(entry))
+            {
+                sdf_calls += fathom_sparse_grid_fill_brick(grid, distance, region, &scratch, bx, by, bz, entry - 1);
+            }
+        }
+    }
+
+    grid->slab_sdf_skipped[bz] = scratch.skipped;
+
+    return sdf_calls;
+}
+
+FATHOM_API void fathom_sparse_grid_pass_00_job(void *data, u32 job_index, u32 worker_index)
+{
+    fathom_sparse_grid_pass_context *context = (fathom_sparse_grid_pass_context *)data;
+
+    (void)worker_index;
+
+    /* Store the mixed block count of the block slab, pass 0 sums them once all slabs are done */
+    context->grid->slab_atlas_offset[job_index] = fathom_sparse_grid_pass_00_fill_top_map_slab(context->grid, context->distance, job_index);
+}
+
+FATHOM_API void fathom_sparse_grid_pass_01_job(void *data, u32 job_index, u32 worker_index)
+{
+    fathom_sparse_grid_pass_context *context = (fathom_sparse_grid_pass_context *)data;
+
+    (void)worker_index;
+
+    /* The slab counts go to slab_atlas_offset, pass 1 turns them into offsets once all slabs are done */
+    context->grid->slab_sdf_calls[job_index] = fathom_sparse_grid_pass_01_fill_brick_map_slab(context->grid, context->distance, job_index);
+}
+
+FATHOM_API void fathom_sparse_grid_pass_02_job(void *data, u32 job_index, u32 worker_index)
+{
+    fathom_sparse_grid_pass_context *context = (fathom_sparse_grid_pass_context *)data;
+    u32 bz = context->slab_first + (job_index * context->slab_step);
+
+    (void)worker_index;
+
+    context->grid->slab_sdf_calls[bz] = fathom_sparse_grid_pass_02_fill_atlas_slab(context->grid, context->distance, context->region, bz);
+}
+
+FATHOM_API void fathom_sparse_grid_update_region_job(void *data, u32 job_index, u32 worker_index)
+{
+    fathom_sparse_grid_pass_context *context = (fathom_sparse_grid_pass_context *)data;
+    u32 bz = context->slab_first + (job_index * context->slab_step);
+
+    (void)worker_index;
+
+    context->grid->slab_sdf_calls[bz] = fathom_sparse_grid_update_region_slab(context->grid, context->distance, context->region, bz);
+}
+
+/* Runs job over the slabs [z_min, z_max) of the region: even slabs first, then odd slabs.
+ * An odd slab can then copy its z-apron from both finished neighbour slabs while no two
+ * concurrently running slabs ever touch each others bricks.
+ */
+FATHOM_API void fathom_sparse_grid_run_slabs_even_odd(fathom_job_system *jobs, fathom_job_function job, fathom_sparse_grid_pass_context *context, u32 z_min, u32 z_max)
+{
+    u32 parity;
+
+    context->slab_step = 2;
+
+    for (parity = 0; parity < 2; ++parity)
+    {
+        context->slab_first = z_min + ((z_min ^ parity) & 1);
+
+        if (context->slab_first < z_max)
+        {
+            fathom_job_system_parallel_for(jobs, job, context, (z_max - context->slab_first + 1) / 2);
+        }
+    }
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Atlas Deduplication
+ * #############################################################################
+ *
+ * Many bricks quantize to the same payload: every brick of a flat ground plane at the same height,
+ * bricks that only see the saturated ends of the truncation band, repeated primitives on the same
+ * lattice offset. At the end of pass 2 bricks with byte identical distances and materials (aprons
+ * included, so sampling stays exact) are folded into one atlas slot that all of their brick map
+ * entries point at. Every slot counts the entries that reference it, the incremental update moves a
+ * brick into a private slot before it is refilled and folds it again afterwards through a hash table
+ * over the live slots (see fathom_sparse_grid_rebuild_region).
+ */
+
+/* FNV-1a over the voxels of a slot, distance and material folded into one step per voxel */
+FATHOM_API u32 fathom_sparse_grid_atlas_slot_hash(fathom_sparse_grid *grid, u32 slot)
+{
+    u32 atlas_vox_stride = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice_stride = atlas_vox_stride * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 base = fathom_sparse_grid_atlas_slot_base(grid, slot);
+    u32 hash = 2166136261u;
+    u32 lx, ly, lz;
+
+    for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
+    {
+        for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
+        {
+            u32 offset = base + (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+
+            for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
+            {
+                hash = (hash ^ ((u32)(u8)grid->atlas_data[offset + lx] | ((u32)grid->material_data[offset + lx] << 8))) * 16777619u;
+            }
+        }
+    }
+
+    return hash;
+}
+
+FATHOM_API u8 fathom_sparse_grid_atlas_slot_equal(fathom_sparse_grid *grid, u32 slot_a, u32 slot_b)
+{
+    u32 atlas_vox_stride = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice_stride = atlas_vox_stride * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 base_a = fathom_sparse_grid_atlas_slot_base(grid, slot_a);
+    u32 base_b = fathom_sparse_grid_atlas_slot_base(grid, slot_b);
+    u32 lx, ly, lz;
+
+    for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
+    {
+        for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
+        {
+            u32 offset = (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+
+            for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
+            {
+                if (grid->atlas_data[base_a + offset + lx] != grid->atlas_data[base_b + offset + lx] ||
+                    grid->material_data[base_a + offset + lx] != grid->material_data[base_b + offset + lx])
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+FATHOM_API void fathom_sparse_grid_atlas_slot_copy(fathom_sparse_grid *grid, u32 slot_dst, u32 slot_src)
+{
+    u32 atlas_vox_stride = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice_stride = atlas_vox_stride * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 src = fathom_sparse_grid_atlas_slot_base(grid, slot_src);
+    u32 dst = fathom_sparse_grid_atlas_slot_base(grid, slot_dst);
+    u32 lx, ly, lz;
+
+    for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
+    {
+        for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
+        {
+            u32 offset = (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+
+            for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
+            {
+                grid->atlas_data[dst + offset + lx] = grid->atlas_data[src + offset + lx];
+                grid->material_data[dst + offset + lx] = grid->material_data[src + offset + lx];
+            }
+        }
+    }
+}
+
+/* Points every atlas index of the brick map at slot_map[old slot] and, if refs is not FATHOM_NULL,
+ * counts the entries per new slot into it (refs has to be zeroed by the caller)
+ */
+FATHOM_API void fathom_sparse_grid_brick_map_remap(fathom_sparse_grid *grid, u32 *slot_map, u32 *refs)
+{
+    u32 top_dim = grid->brick_map_top_dimensions;
+    u32 block_count = top_dim * top_dim * top_dim;
+    u32 block;
+    u32 i;
+
+    for (block = 0; block < block_count; ++block)
+    {
+        if (!fathom_sparse_grid_brick_map_is_leaf(grid->brick_map_top_data[block]))
+        {
+            continue;
+        }
+
+        for (i = 0; i < FATHOM_SPARSE_GRID_LEAF_ENTRIES; ++i)
+        {
+            u32 index = (block * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + i;
+            u32 entry = fathom_sparse_grid_brick_map_get(grid, index);
+
+            if (fathom_sparse_grid_brick_map_is_index(entry))
+            {
+                u32 slot = slot_map ? slot_map[entry - 1] : entry - 1;
+
+                if (slot_map)
+                {
+                    fathom_sparse_grid_brick_map_set(grid, index, slot + 1);
+                }
+
+                if (refs)
+                {
+                    refs[slot]++;
+                }
+            }
+        }
+    }
+}
+
+/* Inserts every live slot with its stored hash into an empty table and resets the insert count */
+FATHOM_API void fathom_sparse_grid_atlas_dedup_table_rebuild(fathom_sparse_grid *grid)
+{
+    u32 table_size = grid->atlas_slot_capacity * 2;
+    u32 slot;
+
+    for (slot = 0; slot < table_size; ++slot)
+    {
+        grid->atlas_dedup_table_data[slot] = FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+    }
+
+    grid->atlas_dedup_table_inserts = 0;
+
+    for (slot = 0; slot < grid->atlas_slot_count; ++slot)
+    {
+        if (grid->atlas_slot_owner_data[slot] != FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+        {
+            u32 probe = grid->atlas_slot_hash_data[slot] % table_size;
+
+            while (grid->atlas_dedup_table_data[probe] != FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+            {
+                probe = probe + 1 < table_size ? probe + 1 : 0;
+            }
+
+            grid->atlas_dedup_table_data[probe] = slot;
+            grid->atlas_dedup_table_inserts++;
+        }
+    }
+}
+
+/* Looks up a live slot other than slot with the same payload. Table entries are never removed: an
+ * entry whose slot was released or refilled since is skipped by the owner, hash and payload checks.
+ * Returns FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE and inserts slot if there is none.
+ */
+FATHOM_API u32 fathom_sparse_grid_atlas_dedup_find_or_insert(fathom_sparse_grid *grid, u32 slot)
+{
+    u32 table_size = grid->atlas_slot_capacity * 2;
+    u32 hash = fathom_sparse_grid_atlas_slot_hash(grid, slot);
+    u32 probe = hash % table_size;
+    u32 candidate;
+
+    grid->atlas_slot_hash_data[slot] = hash;
+
+    while ((candidate = grid->atlas_dedup_table_data[probe]) != FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+    {
+        if (candidate != slot && grid->atlas_slot_owner_data[candidate] != FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE &&
+            grid->atlas_slot_hash_data[candidate] == hash && fathom_sparse_grid_atlas_slot_equal(grid, candidate, slot))
+        {
+            return candidate;
+        }
+
+        probe = probe + 1 < table_size ? probe + 1 : 0;
+    }
+
+    /* Stale entries only lengthen the probes: start over from the live slots at three quarters load */
+    if (++grid->atlas_dedup_table_inserts > (table_size / 4) * 3)
+    {
+        fathom_sparse_grid_atlas_dedup_table_rebuild(grid);
+    }
+    else
+    {
+        grid->atlas_dedup_table_data[probe] = slot;
+    }
+
+    return FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+}
+
+/* Folds identical bricks of a full build into one slot each and closes the gaps in slot order, so
+ * the unique bricks occupy [0, unique) afterwards. Atlas layers that neither the unique bricks nor
+ * the headroom need are dropped: atlas_bytes and atlas_dimensions shrink, the memory past the new
+ * atlas_bytes is not touched anymore and can be released by the caller.
+ * Returns the number of slots that were folded.
+ */
+FATHOM_API u32 fathom_sparse_grid_atlas_dedup(fathom_sparse_grid *grid)
+{
+    u32 *slot_map = grid->atlas_slot_ref_data; /* Old slot -> new slot until the brick map is remapped */
+    u32 slot_count = grid->atlas_slot_count;
+    u32 slots_per_layer = grid->atlas_bricks_per_row * grid->atlas_bricks_per_column;
+    u32 unique = 0;
+    u32 slots;
+    u32 layers;
+    u32 slot;
+
+    for (slot = 0; slot < grid->atlas_slot_capacity * 2; ++slot)
+    {
+        grid->atlas_dedup_table_data[slot] = FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+    }
+
+    grid->atlas_dedup_table_inserts = 0;
+
+    /* 1. Hash every slot, the first slot of a payload keeps it */
+    for (slot = 0; slot < slot_count; ++slot)
+    {
+        u32 match = fathom_sparse_grid_atlas_dedup_find_or_insert(grid, slot);
+
+        slot_map[slot] = match == FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE ? unique++ : slot_map[match];
+    }
+
+    if (unique == slot_count)
+    {
+        for (slot = 0; slot < slot_count; ++slot)
+        {
+            grid->atlas_slot_ref_data[slot] = 1;
+        }
+
+        return 0;
+    }
+
+    /* 2. Move the first brick of every payload down to its new slot, the target was consumed already */
+    unique = 0;
+
+    for (slot = 0; slot < slot_count; ++slot)
+    {
+        if (slot_map[slot] != unique)
+        {
+            continue;
+        }
+
+        if (unique != slot)
+        {
+            fathom_sparse_grid_atlas_slot_copy(grid, unique, slot);
+            grid->atlas_slot_owner_data[unique] = grid->atlas_slot_owner_data[slot];
+            grid->atlas_slot_hash_data[unique] = grid->atlas_slot_hash_data[slot];
+        }
+
+        unique++;
+    }
+
+    for (slot = unique; slot < grid->atlas_slot_capacity; ++slot)
+    {
+        grid->atlas_slot_owner_data[slot] = FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+    }
+
+    /* 3. Point the brick map at the new slots, then count the references */
+    fathom_sparse_grid_brick_map_remap(grid, slot_map, FATHOM_NULL);
+
+    for (slot = 0; slot < unique; ++slot)
+    {
+        grid->atlas_slot_ref_data[slot] = 0;
+    }
+
+    fathom_sparse_grid_brick_map_remap(grid, FATHOM_NULL, grid->atlas_slot_ref_data);
+
+    grid->atlas_slot_count = unique;
+    grid->atlas_free_slot_count = 0;
+
+    /* 4. Drop the layers past the unique bricks and the headroom, the slots below keep their place.
+     *    The headroom stays relative to the active bricks: an update gives every shared brick it
+     *    refills a private slot until it is folded again, so a scrolled-in slab of ground plane
+     *    needs a slot for each of its bricks for a moment.
+     */
+    slots = unique + (u32)fathom_ceilf((f32)grid->brick_map_active_bricks_count * grid->atlas_headroom);
+    slots = slots < unique ? unique : slots;
+    slots = slots < 1 ? 1 : slots;
+    layers = (slots + slots_per_layer - 1) / slots_per_layer;
+
+    if (layers < grid->atlas_brick_layers)
+    {
+        grid->atlas_brick_layers = layers;
+        grid->atlas_slot_capacity = slots_per_layer * layers < grid->atlas_slot_capacity ? slots_per_layer * layers : grid->atlas_slot_capacity;
+        grid->atlas_dimensions.z = (f32)(layers * FATHOM_PHYSICAL_BRICK_SIZE);
+        grid->atlas_dimensions_inverse.z = 1.0f / grid->atlas_dimensions.z;
+        grid->atlas_bytes = slots_per_layer * layers * FATHOM_BRICK_TOTAL_VOXELS * (u32)sizeof(u8);
+    }
+
+    fathom_sparse_grid_atlas_dedup_table_rebuild(grid);
+
+    return slot_count - unique;
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Brick Materials
+ * #############################################################################
+ *
+ * Most bricks see one material in every voxel, aprons included (the shader filters across them).
+ * Saturated voxels do not count, the shader never samples their material at a surface hit.
+ * Such a brick only keeps the material id in its slot entry. The GPU material atlas is reserved for
+ * the mixed bricks and is sized for them at the end of pass 2, the incremental update classifies
+ * every refilled brick again.
+ */
+
+/* Returns the material id if every unsaturated voxel of slot has the same material (0 if there is none),
+ * FATHOM_SPARSE_GRID_MATERIAL_MIXED otherwise
+ */
+FATHOM_API u32 fathom_sparse_grid_brick_material(fathom_sparse_grid *grid, u32 slot)
+{
+    u32 atlas_vox_stride = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice_stride = atlas_vox_stride * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 base = fathom_sparse_grid_atlas_slot_base(grid, slot);
+    u32 material = FATHOM_SPARSE_GRID_MATERIAL_MIXED; /* Not seen yet */
+    u32 lx, ly, lz;
+
+    for (lz = 0; lz < FATHOM_PHYSICAL_BRICK_SIZE; ++lz)
+    {
+        for (ly = 0; ly < FATHOM_PHYSICAL_BRICK_SIZE; ++ly)
+        {
+            u32 offset = base + (ly * atlas_vox_stride) + (lz * atlas_slice_stride);
+
+            for (lx = 0; lx < FATHOM_PHYSICAL_BRICK_SIZE; ++lx)
+            {
+                s8 value = grid->atlas_data[offset + lx];
+
+                if (value == 127 || value == -127)
+                {
+                    continue;
+                }
+
+                if (material == FATHOM_SPARSE_GRID_MATERIAL_MIXED)
+                {
+                    material = grid->material_data[offset + lx];
+                }
+                else if (grid->material_data[offset + lx] != material)
+                {
+                    return FATHOM_SPARSE_GRID_MATERIAL_MIXED;
+                }
+            }
+        }
+    }
+
+    return material == FATHOM_SPARSE_GRID_MATERIAL_MIXED ? 0u : material;
+}
+
+/* Returns a material slot (a released one first), FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE if the material atlas is full */
+FATHOM_API u32 fathom_sparse_grid_material_alloc(fathom_sparse_grid *grid)
+{
+    if (grid->material_free_slot_count > 0)
+    {
+        return grid->material_free_slot_data[--grid->material_free_slot_count];
+    }
+
+    if (grid->material_slot_count < grid->material_slot_capacity)
+    {
+        return grid->material_slot_count++;
+    }
+
+    return FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+}
+
+FATHOM_API void fathom_sparse_grid_material_free(fathom_sparse_grid *grid, u32 material_slot)
+{
+    grid->material_free_slot_data[grid->material_free_slot_count++] = material_slot;
+}
+
+/* Classifies the materials of a refilled atlas slot: a uniform brick releases its material slot,
+ * a mixed brick keeps its material slot or takes a new one.
+ * Returns 0 if the material atlas has no slot left.
+ */
+FATHOM_API u8 fathom_sparse_grid_material_update(fathom_sparse_grid *grid, u32 slot)
+{
+    u32 material = fathom_sparse_grid_brick_material(grid, slot);
+    u32 entry = grid->atlas_slot_material_data[slot];
+
+    if (material != FATHOM_SPARSE_GRID_MATERIAL_MIXED)
+    {
+        if (entry & FATHOM_SPARSE_GRID_MATERIAL_MIXED)
+        {
+            fathom_sparse_grid_material_free(grid, entry & ~FATHOM_SPARSE_GRID_MATERIAL_MIXED);
+        }
+
+        grid->atlas_slot_material_data[slot] = material;
+    }
+    else if (!(entry & FATHOM_SPARSE_GRID_MATERIAL_MIXED))
+    {
+        u32 material_slot = fathom_sparse_grid_material_alloc(grid);
+
+        if (material_slot == FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+        {
+            return 0;
+        }
+
+        grid->atlas_slot_material_data[slot] = FATHOM_SPARSE_GRID_MATERIAL_MIXED | material_slot;
+    }
+
+    return 1;
+}
+
+/* Classifies every live slot of a full build, sizes the material atlas for the mixed bricks plus
+ * headroom in whole layers and hands out the material slots in atlas slot order
+ */
+FATHOM_API void fathom_sparse_grid_material_layout(fathom_sparse_grid *grid)
+{
+    u32 slots_per_layer = grid->atlas_bricks_per_row * grid->atlas_bricks_per_column;
+    u32 mixed_brick_count = 0;
+    u32 slots;
+    u32 layers;
+    u32 slot;
+
+    for (slot = 0; slot < grid->atlas_slot_count; ++slot)
+    {
+        u32 material = fathom_sparse_grid_brick_material(grid, slot);
+
+        grid->atlas_slot_material_data[slot] = material;
+        mixed_brick_count += material == FATHOM_SPARSE_GRID_MATERIAL_MIXED;
+    }
+
+    for (slot = grid->atlas_slot_count; slot < slots_per_layer * grid->atlas_brick_layers; ++slot)
+    {
+        grid->atlas_slot_material_data[slot] = 0;
+    }
+
+    slots = (u32)fathom_ceilf((f32)mixed_brick_count * (1.0f + grid->atlas_headroom));
+    slots = slots < mixed_brick_count ? mixed_brick_count : slots;
+    layers = (slots + slots_per_layer - 1) / slots_per_layer;
+    layers = layers < 1 ? 1 : layers;
+    layers = layers > grid->atlas_brick_layers ? grid->atlas_brick_layers : layers;
+
+    grid->material_brick_layers = layers;
+    grid->material_slot_capacity = slots_per_layer * layers;
+    grid->material_slot_count = 0;
+    grid->material_free_slot_count = 0;
+    grid->material_dimensions = fathom_vec3_init(grid->atlas_dimensions.x, grid->atlas_dimensions.y, (f32)(layers * FATHOM_PHYSICAL_BRICK_SIZE));
+
+    for (slot = 0; slot < grid->atlas_slot_count; ++slot)
+    {
+        if (grid->atlas_slot_material_data[slot] == FATHOM_SPARSE_GRID_MATERIAL_MIXED)
+        {
+            grid->atlas_slot_material_data[slot] |= grid->material_slot_count++;
+        }
+    }
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Air Distance
+ * #############################################################################
+ *
+ * The Chebyshev distance transform is separable: the distance along x to the nearest brick that is
+ * not air, then per y the minimum over the column of max(|dy|, distance along x), then the same
+ * along z. Distances are capped at FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX, so a brick map change in a
+ * region only reaches the bricks of the region grown by FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX - 1 and
+ * those only depend on the bricks of that grown once more.
+ */
+typedef struct fathom_sparse_grid_air_distance_context
+{
+    fathom_sparse_grid *grid;
+    fathom_sparse_grid_region update; /* Bricks whose distance is computed */
+    fathom_sparse_grid_region source; /* Bricks that can be closer than the cap to one of them */
+    u32 axis;
+
+} fathom_sparse_grid_air_distance_context;
+
+/* Air distance map entry of the local brick (bx, by, bz) */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_air_distance_index(fathom_sparse_grid *grid, u32 bx, u32 by, u32 bz)
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 sx = bx + grid->brick_map_offset[0];
+    u32 sy = by + grid->brick_map_offset[1];
+    u32 sz = bz + grid->brick_map_offset[2];
+
+    sx = sx >= dim ? sx - dim : sx;
+    sy = sy >= dim ? sy - dim : sy;
+    sz = sz >= dim ? sz - dim : sz;
+
+    return sx + (sy * dim) + (sz * dim * dim);
+}
+
+/* Grows region by FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX - 1 bricks, clamped to the grid */
+FATHOM_API void fathom_sparse_grid_air_distance_grow(fathom_sparse_grid *grid, fathom_sparse_grid_region *region, fathom_sparse_grid_region *grown)
+{
+    u32 reach = FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX - 1;
+    u32 axis;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        grown->brick_min[axis] = region->brick_min[axis] > reach ? region->brick_min[axis] - reach : 0;
+        grown->brick_max[axis] = region->brick_max[axis] + reach < grid->brick_map_dimensions ? region->brick_max[axis] + reach : grid->brick_map_dimensions;
+    }
+}
+
+/* In place: line[i] = min over j of max(|i - j|, line[j]) for i in [first, last), reading the count entries of the line */
+FATHOM_API void fathom_sparse_grid_air_distance_line(u8 *line, u8 *out, u32 count, u32 first, u32 last)
+{
+    u32 i;
+
+    for (i = first; i < last; ++i)
+    {
+        u32 best = line[i];
+        u32 r;
+
+        /* Entry j at |i - j| = r can only win while r is below the best so far */
+        for (r = 1; r < best; ++r)
+        {
+            if (i >= r && line[i - r] < best)
+            {
+                best = line[i - r] > r ? line[i - r] : r;
+            }
+
+            if (i + r < count && line[i + r] < best)
+            {
+                best = line[i + r] > r ? line[i + r] : r;
+            }
+        }
+
+        out[i] = (u8)best;
+    }
+}
+
+/* One plane of the transform: job_index walks z of the source (x and y passes) or y of the update (z pass) */
+FATHOM_API void fathom_sparse_grid_air_distance_job(void *data, u32 job_index, u32 worker_index)
+{
+    fathom_sparse_grid_air_distance_context *context = (fathom_sparse_grid_air_distance_context *)data;
+    fathom_sparse_grid *grid = context->grid;
+    fathom_sparse_grid_region *update = &context->update;
+    fathom_sparse_grid_region *source = &context->source;
+    u8 line[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u8 out[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+    u32 a, b, i;
+
+    (void)worker_index;
+
+    if (context->axis == 0)
+    {
+        u32 bz = source->brick_min[2] + job_index;
+
+        for (b = source->brick_min[1]; b < source->brick_max[1]; ++b)
+        {
+            u32 count = source->brick_max[0] - source->brick_min[0];
+            u32 distance = FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX;
+
+            /* Distance along x: a forward and a backward sweep over the bricks of the row */
+            for (i = 0; i < count; ++i)
+            {
+                u32 entry = fathom_sparse_grid_brick_map_get(grid, fathom_sparse_grid_brick_map_index(grid, source->brick_min[0] + i, b, bz));
+
+                distance = entry != FATHOM_BRICK_MAP_INDEX_AIR ? 0 : (distance < FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX ? distance + 1 : distance);
+                line[i] = (u8)distance;
+            }
+
+            distance = FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX;
+
+            for (i = count; i-- > 0;)
+            {
+                distance = line[i] == 0 ? 0 : (distance < FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX ? distance + 1 : distance);
+                line[i] = (u8)(distance < line[i] ? distance : line[i]);
+            }
+
+            for (a = update->brick_min[0]; a < update->brick_max[0]; ++a)
+            {
+                grid->air_distance_scratch_data[fathom_sparse_grid_air_distance_index(grid, a, b, bz)] = line[a - source->brick_min[0]];
+            }
+        }
+    }
+    else if (context->axis == 1)
+    {
+        u32 bz = source->brick_min[2] + job_index;
+        u32 count = source->brick_max[1] - source->brick_min[1];
+
+        for (a = update->brick_min[0]; a < update->brick_max[0]; ++a)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                line[i] = grid->air_distance_scratch_data[fathom_sparse_grid_air_distance_index(grid, a, source->brick_min[1] + i, bz)];
+            }
+
+            fathom_sparse_grid_air_distance_line(line, out, count, update->brick_min[1] - source->brick_min[1], update->brick_max[1] - source->brick_min[1]);
+
+            for (b = update->brick_min[1]; b < update->brick_max[1]; ++b)
+            {
+                grid->air_distance_scratch_data[fathom_sparse_grid_air_distance_index(grid, a, b, bz)] = out[b - source->brick_min[1]];
+            }
+        }
+    }
+    else
+    {
+        u32 by = update->brick_min[1] + job_index;
+        u32 count = source->brick_max[2] - source->brick_min[2];
+
+        for (a = update->brick_min[0]; a < update->brick_max[0]; ++a)
+        {
+            for (i = 0; i < count; ++i)
+            {
+                line[i] = grid->air_distance_scratch_data[fathom_sparse_grid_air_distance_index(grid, a, by, source->brick_min[2] + i)];
+            }
+
+            fathom_sparse_grid_air_distance_line(line, out, count, update->brick_min[2] - source->brick_min[2], update->brick_max[2] - source->brick_min[2]);
+
+            for (b = update->brick_min[2]; b < update->brick_max[2]; ++b)
+            {
+                grid->air_distance_data[fathom_sparse_grid_air_distance_index(grid, a, by, b)] = out[b - source->brick_min[2]];
+            }
+        }
+    }
+}
+
+/* Recomputes the air distances that a change of the brick map entries in region (local brick
+ * coordinates) can affect, that is region grown by FATHOM_SPARSE_GRID_AIR_DISTANCE_MAX - 1, and
+ * returns those bricks in updated if set. jobs may be FATHOM_NULL to run on the calling thread only.
+ */
+FATHOM_API void fathom_sparse_grid_air_distance_update(fathom_sparse_grid *grid, fathom_sparse_grid_region *region, fathom_job_system *jobs, fathom_sparse_grid_region *updated)
+{
+    fathom_sparse_grid_air_distance_context context;
+
+    if (region->brick_min[0] >= region->brick_max[0] || region->brick_min[1] >= region->brick_max[1] || region->brick_min[2] >= region->brick_max[2])
+    {
+        return;
+    }
+
+    context.grid = grid;
+    fathom_sparse_grid_air_distance_grow(grid, region, &context.update);
+    fathom_sparse_grid_air_distance_grow(grid, &context.update, &context.source);
+
+    /* x over the source, y over the update columns of the source slabs, z into the map */
+    context.axis = 0;
+    fathom_job_system_parallel_for(jobs, fathom_sparse_grid_air_distance_job, &context, context.source.brick_max[2] - context.source.brick_min[2]);
+    context.axis = 1;
+    fathom_job_system_parallel_for(jobs, fathom_sparse_grid_air_distance_job, &context, context.source.brick_max[2] - context.source.brick_min[2]);
+    context.axis = 2;
+    fathom_job_system_parallel_for(jobs, fathom_sparse_grid_air_distance_job, &context, context.update.brick_max[1] - context.update.brick_min[1]);
+
+    if (updated)
+    {
+        *updated = context.update;
+    }
+}
+
+/* Every brick of the grid */
+FATHOM_API void fathom_sparse_grid_air_distance_fill(fathom_sparse_grid *grid, fathom_job_system *jobs)
+{
+    fathom_sparse_grid_region region;
+
+    region.brick_min[0] = region.brick_min[1] = region.brick_min[2] = 0;
+    region.brick_max[0] = region.brick_max[1] = region.brick_max[2] = grid->brick_map_dimensions;
+
+    fathom_sparse_grid_air_distance_update(grid, &region, jobs, FATHOM_NULL);
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Passes
+ * #############################################################################
+ */
+
+/* jobs may be FATHOM_NULL to build on the calling thread only.
+ * Fills brick_map_top_data (brick_map_top_bytes, known after fathom_sparse_grid_initialize) and sizes
+ * the leaf pool for the mixed blocks: brick_map_data (brick_map_bytes) and brick_map_leaf_free_data
+ * (brick_map_leaf_bytes) have to be allocated before pass 1, as well as air_distance_data and
+ * air_distance_scratch_data (air_distance_bytes each).
+ */
+FATHOM_API u8 fathom_sparse_grid_pass_00_fill_top_map(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_job_system *jobs)
+{
+    fathom_sparse_grid_pass_context context;
+    u32 top_dim = grid->brick_map_top_dimensions;
+    u32 mixed_block_count = 0;
+    u32 capacity;
+    u32 tz;
+
+    context.grid = grid;
+    context.distance = distance;
+    context.region = FATHOM_NULL;
+    context.slab_first = 0;
+    context.slab_step = 1;
+
+    fathom_job_system_parallel_for(jobs, fathom_sparse_grid_pass_00_job, &context, top_dim);
+
+    grid->interval_culled_pass_00 = 0;
+
+    for (tz = 0; tz < top_dim; ++tz)
+    {
+        mixed_block_count += grid->slab_atlas_offset[tz];
+        grid->interval_culled_pass_00 += grid->slab_interval_culled[tz];
+    }
+
+    /* Headroom for blocks that turn mixed in updates, plus one layer of blocks for a scrolled slab */
+    capacity = (u32)fathom_ceilf((f32)mixed_block_count * (1.0f + grid->brick_map_leaf_headroom)) + (top_dim * top_dim);
+    capacity = capacity < mixed_block_count ? mixed_block_count : capacity;
+    capacity = capacity > top_dim * top_dim * top_dim ? top_dim * top_dim * top_dim : capacity;
+
+    grid->brick_map_leaf_capacity = capacity;
+    grid->brick_map_leaf_count = 0;
+    grid->brick_map_leaf_free_count = 0;
+    grid->brick_map_leaf_bytes = capacity * sizeof(u32);
+    grid->brick_map_bytes = capacity * FATHOM_SPARSE_GRID_LEAF_ENTRIES * grid->brick_map_index_bytes;
+
+    grid->sdf_calls_pass_01 = top_dim * top_dim * top_dim;
+
+    return 1;
+}
+
+/* Sizes the atlas of a full build for active_brick_count bricks plus headroom. The slots are packed
+ * into a box of roughly equal bricks per axis (a 2D sheet with a depth of one brick runs into the
+ * texture limit long before the third axis is used) that fits grid->atlas_max_bricks.
+ * Returns 0 if not even the active bricks fit.
+ */
+FATHOM_API u8 fathom_sparse_grid_atlas_layout(fathom_sparse_grid *grid, u32 active_brick_count)
+{
+    u32 max_x = grid->atlas_max_bricks[0] ? grid->atlas_max_bricks[0] : 1;
+    u32 max_y = grid->atlas_max_bricks[1] ? grid->atlas_max_bricks[1] : 1;
+    u32 max_z = grid->atlas_max_bricks[2] ? grid->atlas_max_bricks[2] : 1;
+    u32 layer_limit = max_x * max_y;
+    u32 slot_limit = fathom_sparse_grid_atlas_slot_limit(grid);
+    u32 slots;
+    u32 side = 1;
+    u32 slots_per_layer;
+    u32 bricks_per_row;
+    u32 bricks_per_col;
+    u32 layers;
+
+    /* Most slots the texture limit allows, without overflowing u32 */
+    if (max_z < (slot_limit + layer_limit - 1) / layer_limit)
+    {
+        slot_limit = max_z * layer_limit;
+    }
+
+    if (active_brick_count > slot_limit)
+    {
+        return 0;
+    }
+
+    /* f32 rounding of large counts, and the headroom must not hand out slots the brick map or the texture cannot address */
+    slots = (u32)fathom_ceilf((f32)active_brick_count * (1.0f + grid->atlas_headroom));
+    slots = slots < active_brick_count ? active_brick_count : slots;
+    slots = slots > slot_limit ? slot_limit : slots;
+    slots = slots < 1 ? 1 : slots;
+
+    while (side * side * side < slots)
+    {
+        ++side;
+    }
+
+    layers = side < max_z ? side : max_z;
+    slots_per_layer = (slots + layers - 1) / layers;
+
+    bricks_per_row = (u32)fathom_ceilf(fathom_sqrtf((f32)slots_per_layer));
+    bricks_per_row = bricks_per_row < 1 ? 1 : bricks_per_row;
+    bricks_per_row = bricks_per_row > max_x ? max_x : bricks_per_row;
+    bricks_per_col = (slots_per_layer + bricks_per_row - 1) / bricks_per_row;
+
+    if (bricks_per_col > max_y)
+    {
+        /* Too narrow on y: widen the rows, then spill into more layers */
+        bricks_per_col = max_y;
+        bricks_per_row = (slots_per_layer + max_y - 1) / max_y;
+        bricks_per_row = bricks_per_row > max_x ? max_x : bricks_per_row;
+    }
+
+    layers = (slots + (bricks_per_row * bricks_per_col) - 1) / (bricks_per_row * bricks_per_col);
+
+    /* Atlas voxel offsets are u32, the box may round past the slot limit */
+    if (bricks_per_row * bricks_per_col > FATHOM_SPARSE_GRID_INDEX_32_MAX_SLOTS / layers)
+    {
+        return 0;
+    }
+
+    grid->atlas_bricks_per_row = bricks_per_row;
+    grid->atlas_bricks_per_column = bricks_per_col;
+    grid->atlas_brick_layers = layers;
+    grid->atlas_slot_capacity = bricks_per_row * bricks_per_col * layers;
+    grid->atlas_slot_capacity = grid->atlas_slot_capacity > slot_limit ? slot_limit : grid->atlas_slot_capacity;
+
+    grid->atlas_slot_count = active_brick_count;
+    grid->atlas_slot_bytes = bricks_per_row * bricks_per_col * layers * sizeof(u32); /* Whole box: the material entries are uploaded as one brick per texel */
+    grid->atlas_free_slot_count = 0;
+
+    grid->atlas_dimensions = fathom_vec3_init(
+        (f32)(bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE),
+        (f32)(bricks_per_col * FATHOM_PHYSICAL_BRICK_SIZE),
+        (f32)(layers * FATHOM_PHYSICAL_BRICK_SIZE));
+
+    grid->atlas_dimensions_inverse = fathom_vec3_init(
+        1.0f / (f32)grid->atlas_dimensions.x,
+        1.0f / (f32)grid->atlas_dimensions.y,
+        1.0f / (f32)grid->atlas_dimensions.z);
+
+    grid->atlas_bytes = bricks_per_row * bricks_per_col * layers * FATHOM_BRICK_TOTAL_VOXELS * (u32)sizeof(u8);
+
+    return 1;
+}
+
+/* Hands out the atlas slots [slot, ...) to the active bricks of the blocks inside the cube of size^3
+ * blocks at (tx, ty, tz) in Z-order, size is a power of two. The entries of a Morton leaf already are
+ * in Z-order, so neighbouring bricks on every axis end up in nearby slots instead of only along x.
+ * Returns the next free slot.
+ */
+FATHOM_API u32 fathom_sparse_grid_atlas_assign_morton(fathom_sparse_grid *grid, u32 tx, u32 ty, u32 tz, u32 size, u32 slot)
+{
+    u32 top_dim = grid->brick_map_top_dimensions;
+    u32 block;
+    u32 i;
+
+    if (tx >= top_dim || ty >= top_dim || tz >= top_dim)
+    {
+        return slot;
+    }
+
+    if (size > 1)
+    {
+        u32 half = size / 2;
+
+        for (i = 0; i < 8; ++i)
+        {
+            slot = fathom_sparse_grid_atlas_assign_morton(grid, tx + ((i & 1u) * half), ty + (((i >> 1) & 1u) * half), tz + ((i >> 2) * half), half, slot);
+        }
+
+        return slot;
+    }
+
+    block = tx + (ty * top_dim) + (tz * top_dim * top_dim);
+
+    if (!fathom_sparse_grid_brick_map_is_leaf(grid->brick_map_top_data[block]))
+    {
+        return slot;
+    }
+
+    for (i = 0; i < FATHOM_SPARSE_GRID_LEAF_ENTRIES; ++i)
+    {
+        u32 index = (block * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + i;
+
+        if (fathom_sparse_grid_brick_map_get(grid, index) == FATHOM_BRICK_MAP_INDEX_USEFUL)
+        {
+            fathom_sparse_grid_brick_map_set(grid, index, ++slot);
+        }
+    }
+
+    return slot;
+}
+
+/* jobs may be FATHOM_NULL to build on the calling thread only.
+ * Returns 0 if there are more active bricks than the brick map index width can address
+ * (see fathom_sparse_grid_atlas_slot_limit) or the atlas texture limit can hold (see
+ * fathom_sparse_grid_atlas_layout). The grid must not be used for pass 2 then, initialize it
+ * again with FATHOM_SPARSE_GRID_INDEX_32 or a coarser cell size.
+ */
+FATHOM_API u8 fathom_sparse_grid_pass_01_fill_brick_map(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_job_system *jobs)
+{
+    fathom_sparse_grid_pass_context context;
+    u32 active_brick_count = 0;
+    u32 bz;
+
+    context.grid = grid;
+    context.distance = distance;
+    context.region = FATHOM_NULL;
+    context.slab_first = 0;
+    context.slab_step = 1;
+
+    fathom_job_system_parallel_for(jobs, fathom_sparse_grid_pass_01_job, &context, grid->brick_map_top_dimensions);
+
+    grid->interval_culled_pass_01 = 0;
+
+    for (bz = 0; bz < grid->brick_map_top_dimensions; ++bz)
+    {
+        grid->sdf_calls_pass_01 += grid->slab_sdf_calls[bz];
+    }
+
+    for (bz = 0; bz < grid->brick_map_dimensions; ++bz)
+    {
+        grid->interval_culled_pass_01 += grid->slab_interval_culled[bz];
+    }
+
+    /* Mixed blocks whose bricks all came out air or solid (the block test is conservative) */
+    fathom_sparse_grid_brick_map_prune(grid);
+
+    /* Air distances of the final brick map */
+    fathom_sparse_grid_air_distance_fill(grid, jobs);
+
+    /* Exclusive prefix sum over the slab counts: first atlas slot of every slab */
+    for (bz = 0; bz < grid->brick_map_dimensions; ++bz)
+    {
+        u32 slab_count = grid->slab_atlas_offset[bz];
+        grid->slab_atlas_offset[bz] = active_brick_count;
+        active_brick_count += slab_count;
+    }
+
+    grid->brick_map_active_bricks_count = active_brick_count;
+
+    if (active_brick_count > fathom_sparse_grid_atlas_slot_limit(grid) || !fathom_sparse_grid_atlas_layout(grid, active_brick_count))
+    {
+        return 0;
+    }
+
+    if (grid->brick_map_layout == FATHOM_SPARSE_GRID_LAYOUT_MORTON)
+    {
+        u32 size = 1;
+
+        while (size < grid->brick_map_top_dimensions)
+        {
+            size *= 2;
+        }
+
+        fathom_sparse_grid_atlas_assign_morton(grid, 0, 0, 0, size, 0);
+    }
+
+    return 1;
+}
+
+/* jobs may be FATHOM_NULL to build on the calling thread only. The atlas is identical in both cases.
+ * atlas_data, material_data (atlas_bytes each) and the slot arrays have to be allocated before. With
+ * grid->atlas_dedup identical bricks share a slot afterwards and the atlas can end up with fewer
+ * layers, see fathom_sparse_grid_atlas_dedup. The material atlas is sized last, see
+ * fathom_sparse_grid_material_layout.
+ */
+FATHOM_API u8 fathom_sparse_grid_pass_02_fill_atlas(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_job_system *jobs)
+{
+    fathom_sparse_grid_pass_context context;
+    fathom_sparse_grid_region region;
+    u32 bz;
+
+    region.brick_min[0] = region.brick_min[1] = region.brick_min[2] = 0;
+    region.brick_max[0] = region.brick_max[1] = region.brick_max[2] = grid->brick_map_dimensions;
+
+    /* Live slots get their owner while being filled */
+    for (bz = 0; bz < grid->atlas_slot_count; ++bz)
+    {
+        grid->atlas_slot_ref_data[bz] = 1;
+    }
+
+    for (bz = grid->atlas_slot_count; bz < grid->atlas_slot_capacity; ++bz)
+    {
+        grid->atlas_slot_owner_data[bz] = FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+    }
+
+    context.grid = grid;
+    context.distance = distance;
+    context.region = &region;
+
+    fathom_sparse_grid_run_slabs_even_odd(jobs, fathom_sparse_grid_pass_02_job, &context, 0, grid->brick_map_dimensions);
+
+    grid->sdf_calls_pass_02 = 0;
+    grid->sdf_skipped_pass_02 = 0;
+    grid->tape_length_pass_02 = 0;
+    grid->tape_bricks_pass_02 = 0;
+
+    for (bz = 0; bz < grid->brick_map_dimensions; ++bz)
+    {
+        grid->sdf_calls_pass_02 += grid->slab_sdf_calls[bz];
+        grid->sdf_skipped_pass_02 += grid->slab_sdf_skipped[bz];
+        grid->tape_length_pass_02 += grid->slab_tape_length[bz];
+        grid->tape_bricks_pass_02 += grid->slab_tape_bricks[bz];
+    }
+
+    if (grid->atlas_dedup)
+    {
+        fathom_sparse_grid_atlas_dedup(grid);
+    }
+
+    fathom_sparse_grid_material_layout(grid);
+
+    return 1;
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Atlas Allocator
+ * #############################################################################
+ */
+typedef struct fathom_sparse_grid_atlas_stats
+{
+    u32 capacity;      /* Slots in the atlas texture */
+    u32 live;          /* Slots holding a brick */
+    u32 free;          /* Released slots below the high water mark (holes) */
+    u32 high_water;    /* Slots ever handed out, everything above is untouched headroom */
+    f32 occupancy;     /* live / capacity */
+    f32 fragmentation; /* free / high_water: share of the used atlas range that are holes */
+    f32 waste;         /* Share of the atlas texture volume that holds no brick (headroom, holes and the unused end of the last layer) */
+    u32 shared;        /* Active bricks that use the slot of an identical brick instead of their own */
+    f32 dedup_ratio;   /* Active bricks per live slot */
+
+} fathom_sparse_grid_atlas_stats;
+
+/* Returns a slot for the brick at brick map index owner (a released slot first), FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE if the atlas is full */
+FATHOM_API u32 fathom_sparse_grid_atlas_alloc(fathom_sparse_grid *grid, u32 owner)
+{
+    u32 slot;
+
+    if (grid->atlas_free_slot_count > 0)
+    {
+        slot = grid->atlas_free_slot_data[--grid->atlas_free_slot_count];
+    }
+    else if (grid->atlas_slot_count < grid->atlas_slot_capacity)
+    {
+        slot = grid->atlas_slot_count++;
+    }
+    else
+    {
+        return FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+    }
+
+    grid->atlas_slot_owner_data[slot] = owner;
+    grid->atlas_slot_ref_data[slot] = 1;
+    grid->atlas_slot_material_data[slot] = 0;
+
+    return slot;
+}
+
+/* Drops one reference to slot, the slot and its material slot go on the free lists with the last one */
+FATHOM_API void fathom_sparse_grid_atlas_free(fathom_sparse_grid *grid, u32 slot)
+{
+    if (--grid->atlas_slot_ref_data[slot] > 0)
+    {
+        return;
+    }
+
+    if (grid->atlas_slot_material_data[slot] & FATHOM_SPARSE_GRID_MATERIAL_MIXED)
+    {
+        fathom_sparse_grid_material_free(grid, grid->atlas_slot_material_data[slot] & ~FATHOM_SPARSE_GRID_MATERIAL_MIXED);
+        grid->atlas_slot_material_data[slot] = 0;
+    }
+
+    grid->atlas_slot_owner_data[slot] = FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+    grid->atlas_free_slot_data[grid->atlas_free_slot_count++] = slot;
+}
+
+FATHOM_API void fathom_sparse_grid_atlas_stats_get(fathom_sparse_grid *grid, fathom_sparse_grid_atlas_stats *stats)
+{
+    stats->capacity = grid->atlas_slot_capacity;
+    stats->free = grid->atlas_free_slot_count;
+    stats->high_water = grid->atlas_slot_count;
+    stats->live = grid->atlas_slot_count - grid->atlas_free_slot_count;
+    stats->occupancy = stats->capacity ? (f32)stats->live / (f32)stats->capacity : 0.0f;
+    stats->fragmentation = stats->high_water ? (f32)stats->free / (f32)stats->high_water : 0.0f;
+    stats->waste = grid->atlas_bytes ? 1.0f - ((f32)stats->live * (f32)FATHOM_BRICK_TOTAL_VOXELS) / (f32)grid->atlas_bytes : 0.0f;
+    stats->shared = grid->brick_map_active_bricks_count > stats->live ? grid->brick_map_active_bricks_count - stats->live : 0;
+    stats->dedup_ratio = stats->live ? (f32)grid->brick_map_active_bricks_count / (f32)stats->live : 1.0f;
+}
+
+/* Moves the live bricks from the top of the used range into the holes below and patches the brick map,
+ * afterwards the live bricks occupy [0, live) and the free list is empty. A shared slot can be
+ * referenced by bricks other than its owner, so the brick map is patched in one sweep through the
+ * slot map that takes the place of the free list.
+ * Returns the number of moved bricks. Brick map and atlas have to be uploaded again if it is not 0.
+ */
+FATHOM_API u32 fathom_sparse_grid_atlas_compact(fathom_sparse_grid *grid)
+{
+    u32 *slot_map = grid->atlas_free_slot_data;
+    u32 low = 0;
+    u32 high = grid->atlas_slot_count;
+    u32 moved = 0;
+
+    for (low = 0; low < high; ++low)
+    {
+        slot_map[low] = low;
+    }
+
+    low = 0;
+
+    while (1)
+    {
+        /* Lowest hole and highest live slot */
+        while (low < high && grid->atlas_slot_owner_data[low] != FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+        {
+            low++;
+        }
+
+        while (high > low && grid->atlas_slot_owner_data[high - 1] == FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+        {
+            high--;
+        }
+
+        if (low + 1 >= high)
+        {
+            break;
+        }
+
+        high--;
+
+        fathom_sparse_grid_atlas_slot_copy(grid, low, high);
+
+        slot_map[high] = low;
+        grid->atlas_slot_owner_data[low] = grid->atlas_slot_owner_data[high];
+        grid->atlas_slot_ref_data[low] = grid->atlas_slot_ref_data[high];
+        grid->atlas_slot_material_data[low] = grid->atlas_slot_material_data[high];
+        grid->atlas_slot_owner_data[high] = FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE;
+
+        if (grid->atlas_dedup)
+        {
+            grid->atlas_slot_hash_data[low] = grid->atlas_slot_hash_data[high];
+        }
+
+        moved++;
+    }
+
+    if (moved)
+    {
+        fathom_sparse_grid_brick_map_remap(grid, slot_map, FATHOM_NULL);
+    }
+
+    grid->atlas_slot_count = grid->atlas_slot_count - grid->atlas_free_slot_count;
+    grid->atlas_free_slot_count = 0;
+
+    if (moved && grid->atlas_dedup)
+    {
+        fathom_sparse_grid_atlas_dedup_table_rebuild(grid);
+    }
+
+    return moved;
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Incremental Update
+ * #############################################################################
+ */
+typedef struct fathom_sparse_grid_dirty
+{
+    fathom_sparse_grid_region region;              /* Brick map entries that may have changed */
+    fathom_sparse_grid_region air_distance_region; /* Air distance map entries that may have changed, empty if brick_min equals brick_max on an axis */
+
+    u32 atlas_brick_row_min; /* Atlas brick rows that were rewritten [row_min, row_max), empty if equal. Rows count on through the layers (slot / atlas_bricks_per_row) */
+    u32 atlas_brick_row_max;
+
+    u32 sdf_calls;
+    u32 sdf_skipped; /* Voxels filled by the sub-block skip */
+
+} fathom_sparse_grid_dirty;
+
+/* Converts the box [box_min, box_max] into the bricks whose center lies inside of it (clamped to the grid) */
+FATHOM_API void fathom_sparse_grid_region_from_box(fathom_sparse_grid *grid, fathom_vec3 box_min, fathom_vec3 box_max, fathom_sparse_grid_region *region)
+{
+    f32 brick_step_inverse = 1.0f / ((f32)FATHOM_BRICK_SIZE * grid->cell_size);
+    f32 box_min_a[3];
+    f32 box_max_a[3];
+    f32 start_a[3];
+    u32 axis;
+
+    box_min_a[0] = box_min.x;
+    box_min_a[1] = box_min.y;
+    box_min_a[2] = box_min.z;
+    box_max_a[0] = box_max.x;
+    box_max_a[1] = box_max.y;
+    box_max_a[2] = box_max.z;
+    start_a[0] = grid->start.x;
+    start_a[1] = grid->start.y;
+    start_a[2] = grid->start.z;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        /* Brick b has its center at start + (b + 0.5) * brick_step */
+        f32 lo = fathom_ceilf((box_min_a[axis] - start_a[axis]) * brick_step_inverse - 0.5f);
+        f32 hi = -fathom_ceilf(0.5f - (box_max_a[axis] - start_a[axis]) * brick_step_inverse) + 1.0f; /* floor(x - 0.5) + 1 */
+        f32 dim = (f32)grid->brick_map_dimensions;
+
+        lo = fathom_clampf(lo, 0.0f, dim);
+        hi = fathom_clampf(hi, lo, dim);
+
+        region->brick_min[axis] = (u32)lo;
+        region->brick_max[axis] = (u32)hi;
+    }
+}
+
+/* Re-classifies and refills every brick of the region in place.
+ * Bricks that stay active keep their atlas slot unless it is shared with identical bricks (see
+ * fathom_sparse_grid_atlas_dedup), bricks that turn into air or solid release their slot and newly
+ * active bricks take one from the atlas allocator. The rewritten atlas rows and the
+ * distance function evaluations are added to dirty, its region is left untouched.
+ * Leaves of blocks that became uniform are kept, see fathom_sparse_grid_brick_map_prune.
+ *
+ * Returns 0 if the atlas has no slot left for a newly active or formerly shared brick, the material
+ * atlas none for a newly mixed brick or the brick map no leaf for a block that is not uniform anymore.
+ * The grid is inconsistent in that case and has to be rebuilt with the full passes.
+ */
+FATHOM_API u8 fathom_sparse_grid_rebuild_region(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_sparse_grid_region *region, fathom_job_system *jobs, fathom_sparse_grid_dirty *dirty)
+{
+    fathom_sparse_grid_pass_context context;
+    u32 bx, by, bz;
+
+    f32 row_distance[FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+    if (region->brick_min[0] >= region->brick_max[0] || region->brick_min[1] >= region->brick_max[1] || region->brick_min[2] >= region->brick_max[2])
+    {
+        return 1;
+    }
+
+    /* 1. Re-classify: release slots of bricks that are culled now, mark newly active ones */
+    for (bz = region->brick_min[2]; bz < region->brick_max[2]; ++bz)
+    {
+        for (by = region->brick_min[1]; by < region->brick_max[1]; ++by)
+        {
+            fathom_sparse_grid_evaluate_brick_centers(grid, distance, region->brick_min[0], region->brick_max[0], by, bz, row_distance);
+            dirty->sdf_calls += region->brick_max[0] - region->brick_min[0];
+
+            for (bx = region->brick_min[0]; bx < region->brick_max[0]; ++bx)
+            {
+                u32 brick_map_index = fathom_sparse_grid_brick_map_index(grid, bx, by, bz);
+                u32 entry = fathom_sparse_grid_brick_map_get(grid, brick_map_index);
+                u32 state = fathom_sparse_grid_brick_classify(grid, row_distance[bx - region->brick_min[0]]);
+                u8 was_active = fathom_sparse_grid_brick_map_is_index(entry);
+
+                /* Same refinement as pass 1 so an update ends where a full build would */
+                state = fathom_sparse_grid_classify_interval(grid, distance, bx, by, bz, 1, state);
+
+                if (state != FATHOM_BRICK_MAP_INDEX_USEFUL)
+                {
+                    if (was_active)
+                    {
+                        fathom_sparse_grid_atlas_free(grid, entry - 1);
+                        grid->brick_map_active_bricks_count--;
+                    }
+
+                    if (!fathom_sparse_grid_brick_map_set(grid, brick_map_index, state))
+                    {
+                        return 0;
+                    }
+                }
+                else if (!was_active)
+                {
+                    if (!fathom_sparse_grid_brick_map_set(grid, brick_map_index, state))
+                    {
+                        return 0;
+                    }
+                }
+            }
+        }
+    }
+
+    /* 2. Hand out atlas slots to the newly active bricks and collect the touched atlas rows */
+    for (bz = region->brick_min[2]; bz < region->brick_max[2]; ++bz)
+    {
+        for (by = region->brick_min[1]; by < region->brick_max[1]; ++by)
+        {
+            for (bx = region->brick_min[0]; bx < region->brick_max[0]; ++bx)
+            {
+                u32 brick_map_index = fathom_sparse_grid_brick_map_index(grid, bx, by, bz);
+                u32 entry = fathom_sparse_grid_brick_map_get(grid, brick_map_index);
+                u32 row;
+
+                if (entry == FATHOM_BRICK_MAP_INDEX_USEFUL ||
+                    (fathom_sparse_grid_brick_map_is_index(entry) && grid->atlas_slot_ref_data[entry - 1] > 1))
+                {
+                    u32 slot = fathom_sparse_grid_atlas_alloc(grid, brick_map_index);
+
+                    if (slot == FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+                    {
+                        return 0;
+                    }
+
+                    if (entry == FATHOM_BRICK_MAP_INDEX_USEFUL)
+                    {
+                        grid->brick_map_active_bricks_count++;
+                    }
+                    else
+                    {
+                        /* Shared with identical bricks: refill into a private slot, the others keep theirs */
+                        fathom_sparse_grid_atlas_free(grid, entry - 1);
+                    }
+
+                    entry = slot + 1;
+                    fathom_sparse_grid_brick_map_set(grid, brick_map_index, entry);
+                }
+                else if (!fathom_sparse_grid_brick_map_is_index(entry))
+                {
+                    continue;
+                }
+
+                row = (entry - 1) / grid->atlas_bricks_per_row;
+
+                if (dirty->atlas_brick_row_min == dirty->atlas_brick_row_max)
+                {
+                    dirty->atlas_brick_row_min = row;
+                    dirty->atlas_brick_row_max = row + 1;
+                }
+                else
+                {
+                    dirty->atlas_brick_row_min = row < dirty->atlas_brick_row_min ? row : dirty->atlas_brick_row_min;
+                    dirty->atlas_brick_row_max = row + 1 > dirty->atlas_brick_row_max ? row + 1 : dirty->atlas_brick_row_max;
+                }
+            }
+        }
+    }
+
+    /* 3. Refill the active bricks of the region */
+    context.grid = grid;
+    context.distance = distance;
+    context.region = region;
+
+    fathom_sparse_grid_run_slabs_even_odd(jobs, fathom_sparse_grid_update_region_job, &context, region->brick_min[2], region->brick_max[2]);
+
+    for (bz = region->brick_min[2]; bz < region->brick_max[2]; ++bz)
+    {
+        dirty->sdf_calls += grid->slab_sdf_calls[bz];
+        dirty->sdf_skipped += grid->slab_sdf_skipped[bz];
+    }
+
+    /* 4. Fold the refilled bricks into identical live slots, their own slot goes back to the free list */
+    if (grid->atlas_dedup)
+    {
+        for (bz = region->brick_min[2]; bz < region->brick_max[2]; ++bz)
+        {
+            for (by = region->brick_min[1]; by < region->brick_max[1]; ++by)
+            {
+                for (bx = region->brick_min[0]; bx < region->brick_max[0]; ++bx)
+                {
+                    u32 brick_map_index = fathom_sparse_grid_brick_map_index(grid, bx, by, bz);
+                    u32 entry = fathom_sparse_grid_brick_map_get(grid, brick_map_index);
+                    u32 match;
+
+                    if (!fathom_sparse_grid_brick_map_is_index(entry))
+                    {
+                        continue;
+                    }
+
+                    match = fathom_sparse_grid_atlas_dedup_find_or_insert(grid, entry - 1);
+
+                    if (match != FATHOM_SPARSE_GRID_ATLAS_SLOT_FREE)
+                    {
+                        grid->atlas_slot_ref_data[match]++;
+                        fathom_sparse_grid_atlas_free(grid, entry - 1);
+                        fathom_sparse_grid_brick_map_set(grid, brick_map_index, match + 1);
+                    }
+                }
+            }
+        }
+    }
+
+    /* 5. Classify the materials of the refilled bricks, their material slots are in the dirty atlas rows */
+    for (bz = region->brick_min[2]; bz < region->brick_max[2]; ++bz)
+    {
+        for (by = region->brick_min[1]; by < region->brick_max[1]; ++by)
+        {
+            for (bx = region->brick_min[0]; bx < region->brick_max[0]; ++bx)
+            {
+                u32 entry = fathom_sparse_grid_brick_map_get(grid, fathom_sparse_grid_brick_map_index(grid, bx, by, bz));
+
+                if (fathom_sparse_grid_brick_map_is_index(entry) && !fathom_sparse_grid_material_update(grid, entry - 1))
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Rebuilds the bricks affected by an edited primitive in place.
+ * old_min/old_max and new_min/new_max are the bounds of the primitive before and after the edit.
+ * Their union is grown by blend_radius (the smooth union range of the scene), the truncation
+ * distance and the brick radius, so every brick whose classification or voxels can change is
+ * re-classified and refilled (see fathom_sparse_grid_rebuild_region).
+ *
+ * Returns 0 if the atlas has no slot or the brick map no leaf left. The grid is inconsistent in that
+ * case and has to be rebuilt with the full passes.
+ */
+FATHOM_API u8 fathom_sparse_grid_update(fathom_sparse_grid *grid, fathom_grid_distance *distance, fathom_vec3 old_min, fathom_vec3 old_max, fathom_vec3 new_min, fathom_vec3 new_max, f32 blend_radius, fathom_job_system *jobs, fathom_sparse_grid_dirty *dirty)
+{
+    f32 grow = blend_radius + grid->truncation_distance + grid->brick_radius;
+
+    fathom_vec3 box_min = fathom_vec3_init(fathom_minf(old_min.x, new_min.x), fathom_minf(old_min.y, new_min.y), fathom_minf(old_min.z, new_min.z));
+    fathom_vec3 box_max = fathom_vec3_init(fathom_maxf(old_max.x, new_max.x), fathom_maxf(old_max.y, new_max.y), fathom_maxf(old_max.z, new_max.z));
+
+    fathom_sparse_grid_region_from_box(grid, fathom_vec3_subf(box_min, grow), fathom_vec3_addf(box_max, grow), &dirty->region);
+
+    dirty->atlas_brick_row_min = 0;
+    dirty->atlas_brick_row_max = 0;
+    dirty->sdf_calls = 0;
+    dirty->sdf_skipped = 0;
+
+    dirty->air_distance_region = dirty->region;
+
+    if (!fathom_sparse_grid_rebuild_region(grid, distance, &dirty->region, jobs, dirty))
+    {
+        return 0;
+    }
+
+    fathom_sparse_grid_brick_map_prune(grid);
+    fathom_sparse_grid_air_distance_update(grid, &dirty->region, jobs, &dirty->air_distance_region);
+
+    return 1;
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Scrolling
+ * #############################################################################
+ */
+
+/* Splits the bricks that enter (or leave) a grid scrolled by shift into up to three disjoint slabs.
+ * Slab a spans the moved range on axis a, the unmoved range on the axes before a and the whole
+ * grid on the axes after a. Regions are in local brick coordinates after (entering) or before
+ * (leaving) the scroll. count[axis] is the number of moved brick layers (at most the dimension).
+ */
+FATHOM_API void fathom_sparse_grid_scroll_slabs(fathom_sparse_grid *grid, i32 shift[3], u32 count[3], u8 entering, fathom_sparse_grid_region slabs[3])
+{
+    u32 dim = grid->brick_map_dimensions;
+    u32 moved_min[3];
+    u32 moved_max[3];
+    u32 kept_min[3];
+    u32 kept_max[3];
+    u32 axis, other;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        /* Scrolling towards +axis: bricks leave at the low end and enter at the high end */
+        u8 at_high_end = (u8)((shift[axis] > 0) == (entering != 0));
+
+        moved_min[axis] = at_high_end ? dim - count[axis] : 0;
+        moved_max[axis] = at_high_end ? dim : count[axis];
+        kept_min[axis] = at_high_end ? 0 : count[axis];
+        kept_max[axis] = at_high_end ? dim - count[axis] : dim;
+    }
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        for (other = 0; other < 3; ++other)
+        {
+            if (other < axis)
+            {
+                slabs[axis].brick_min[other] = kept_min[other];
+                slabs[axis].brick_max[other] = kept_max[other];
+            }
+            else if (other == axis)
+            {
+                slabs[axis].brick_min[other] = moved_min[other];
+                slabs[axis].brick_max[other] = moved_max[other];
+            }
+            else
+            {
+                slabs[axis].brick_min[other] = 0;
+                slabs[axis].brick_max[other] = dim;
+            }
+        }
+    }
+}
+
+/* Moves the grid by shift whole bricks per axis (start moves by shift * FATHOM_BRICK_SIZE * cell_size).
+ * Bricks that stay inside of the grid keep their brick map entry and atlas slot, only the slabs of
+ * bricks that enter the grid are classified and filled. They take over the brick map storage of the
+ * bricks that left, whose atlas slots are released first. Scrolling by the grid dimension or more
+ * on an axis re-evaluates the whole grid.
+ *
+ * dirty->region covers the whole brick map since every entry got a new local position. Upload the
+ * brick map and brick_map_offset together. The air distance map is recomputed for the whole grid as
+ * well, bricks next to the edge that was left may have lost their nearest non-air brick.
+ * Returns 0 if the atlas has no slot or the brick map no leaf left for an entering brick, the grid
+ * has to be rebuilt then.
+ */
+FATHOM_API u8 fathom_sparse_grid_scroll(fathom_sparse_grid *grid, fathom_grid_distance *distance, i32 shift[3], fathom_job_system *jobs, fathom_sparse_grid_dirty *dirty)
+{
+    u32 dim = grid->brick_map_dimensions;
+    f32 brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
+    fathom_sparse_grid_region slabs[3];
+    u32 count[3];
+    u32 axis;
+    u32 bx, by, bz;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        u32 magnitude = shift[axis] < 0 ? (u32)(-shift[axis]) : (u32)shift[axis];
+        count[axis] = magnitude < dim ? magnitude : dim;
+    }
+
+    dirty->region.brick_min[0] = dirty->region.brick_min[1] = dirty->region.brick_min[2] = 0;
+    dirty->region.brick_max[0] = dirty->region.brick_max[1] = dirty->region.brick_max[2] = dim;
+    dirty->air_distance_region = dirty->region;
+    dirty->atlas_brick_row_min = 0;
+    dirty->atlas_brick_row_max = 0;
+    dirty->sdf_calls = 0;
+    dirty->sdf_skipped = 0;
+
+    /* 1. Release the bricks that leave the grid */
+    fathom_sparse_grid_scroll_slabs(grid, shift, count, 0, slabs);
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        fathom_sparse_grid_region *slab = &slabs[axis];
+
+        for (bz = slab->brick_min[2]; bz < slab->brick_max[2]; ++bz)
+        {
+            for (by = slab->brick_min[1]; by < slab->brick_max[1]; ++by)
+            {
+                for (bx = slab->brick_min[0]; bx < slab->brick_max[0]; ++bx)
+                {
+                    u32 brick_map_index = fathom_sparse_grid_brick_map_index(grid, bx, by, bz);
+                    u32 entry = fathom_sparse_grid_brick_map_get(grid, brick_map_index);
+
+                    /* Air and solid may stay, the entering bricks are classified again. An active brick has a leaf to write to. */
+                    if (fathom_sparse_grid_brick_map_is_index(entry))
+                    {
+                        fathom_sparse_grid_atlas_free(grid, entry - 1);
+                        grid->brick_map_active_bricks_count--;
+                        fathom_sparse_grid_brick_map_set(grid, brick_map_index, FATHOM_BRICK_MAP_INDEX_AIR);
+                    }
+                }
+            }
+        }
+    }
+
+    /* 2. Move the grid: a brick that stays keeps its storage, so the offset moves with the shift */
+    for (axis = 0; axis < 3; ++axis)
+    {
+        u32 magnitude = (shift[axis] < 0 ? (u32)(-shift[axis]) : (u32)shift[axis]) % dim;
+        u32 step = shift[axis] < 0 ? dim - magnitude : magnitude;
+
+        grid->brick_map_offset[axis] = (grid->brick_map_offset[axis] + step) % dim;
+    }
+
+    grid->start = fathom_vec3_add(grid->start, fathom_vec3_init((f32)shift[0] * brick_step, (f32)shift[1] * brick_step, (f32)shift[2] * brick_step));
+    grid->center = fathom_vec3_add(grid->center, fathom_vec3_init((f32)shift[0] * brick_step, (f32)shift[1] * brick_step, (f32)shift[2] * brick_step));
+
+    /* 3. Classify and fill the bricks that entered, one slab after the other so later slabs can copy aprons from earlier ones */
+    fathom_sparse_grid_scroll_slabs(grid, shift, count, 1, slabs);
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        if (!fathom_sparse_grid_rebuild_region(grid, distance, &slabs[axis], jobs, dirty))
+        {
+            return 0;
+        }
+    }
+
+    fathom_sparse_grid_brick_map_prune(grid);
+    fathom_sparse_grid_air_distance_fill(grid, jobs);
 
     return 1;
 }
 
-#endif /* FATHOM_SPARSE_GRID_H */
\ No newline at end of file
+/* #############################################################################
+ * # [SECTION] Sparse Grid Brick Map Flattening
+ * #############################################################################
+ *
+ * The GPU samples the brick map as one dense 3D texture in storage order plus a small
+ * block texture for skipping empty blocks. Both are expanded from the two level map
+ * slice by slice, so the CPU never holds a dense copy.
+ */
+
+/* Writes the entries of the storage box [box->brick_min, box->brick_max) on x and y in the storage
+ * slice sz x-fastest as u16 or u32 (brick_map_index_bytes) into out
+ */
+FATHOM_API void fathom_sparse_grid_brick_map_flatten(fathom_sparse_grid *grid, fathom_sparse_grid_region *box, u32 sz, void *out)
+{
+    u32 count = 0;
+    u32 sx, sy;
+
+    for (sy = box->brick_min[1]; sy < box->brick_max[1]; ++sy)
+    {
+        for (sx = box->brick_min[0]; sx < box->brick_max[0]; ++sx)
+        {
+            u32 entry = fathom_sparse_grid_brick_map_get(grid, fathom_sparse_grid_brick_map_storage_index(grid, sx, sy, sz));
+
+            if (grid->brick_map_index_bytes == FATHOM_SPARSE_GRID_INDEX_32)
+            {
+                ((u32 *)out)[count++] = entry;
+            }
+            else
+            {
+                ((u16 *)out)[count++] = (u16)entry;
+            }
+        }
+    }
+}
+
+/* Writes one byte per block of the block slice tz x-fastest into out: 0 if every brick of the block is air, 1 otherwise */
+FATHOM_API void fathom_sparse_grid_brick_map_flatten_blocks(fathom_sparse_grid *grid, u32 tz, u8 *out)
+{
+    u32 top_dim = grid->brick_map_top_dimensions;
+    u32 *top_slice = grid->brick_map_top_data + (tz * top_dim * top_dim);
+    u32 i;
+
+    for (i = 0; i < top_dim * top_dim; ++i)
+    {
+        out[i] = (u8)(top_slice[i] != FATHOM_BRICK_MAP_INDEX_AIR);
+    }
+}
+
+/* #############################################################################
+ * # [SECTION] Sparse Grid Traversal
+ * #############################################################################
+ *
+ * CPU version of the brick DDA of the shader for one grid, used to compare memory layouts.
+ * The statistics run every brick map and atlas read through a small direct mapped cache model
+ * (the platforms have no portable access to the hardware miss counters).
+ */
+#define FATHOM_SPARSE_GRID_TRACE_CACHE_LINES 512     /* 512 lines of 64 bytes: 32KB, the size of a typical L1 data cache */
+#define FATHOM_SPARSE_GRID_TRACE_CACHE_LINE_BYTES 64
+#define FATHOM_SPARSE_GRID_TRACE_MAX_STEPS 32        /* Sphere tracing steps per brick, as in the shader */
+
+/* Memories seen by the cache model */
+#define FATHOM_SPARSE_GRID_TRACE_MEMORY_TOP_MAP 0
+#define FATHOM_SPARSE_GRID_TRACE_MEMORY_LEAVES 1
+#define FATHOM_SPARSE_GRID_TRACE_MEMORY_ATLAS 2
+
+typedef struct fathom_sparse_grid_trace_stats
+{
+    u32 rays;
+    u32 hits;
+    u32 bricks;   /* Brick map entries read by the DDA */
+    u32 samples;  /* Trilinear atlas samples while sphere tracing */
+    u32 accesses; /* Reads of the brick map and atlas */
+    u32 misses;   /* Reads that missed the cache model */
+
+    u32 cache_tags[FATHOM_SPARSE_GRID_TRACE_CACHE_LINES];
+
+} fathom_sparse_grid_trace_stats;
+
+FATHOM_API void fathom_sparse_grid_trace_stats_reset(fathom_sparse_grid_trace_stats *stats)
+{
+    u32 i;
+
+    stats->rays = 0;
+    stats->hits = 0;
+    stats->bricks = 0;
+    stats->samples = 0;
+    stats->accesses = 0;
+    stats->misses = 0;
+
+    for (i = 0; i < FATHOM_SPARSE_GRID_TRACE_CACHE_LINES; ++i)
+    {
+        stats->cache_tags[i] = 0xFFFFFFFF;
+    }
+}
+
+/* Records a read of the byte at offset in memory */
+FATHOM_API FATHOM_INLINE void fathom_sparse_grid_trace_touch(fathom_sparse_grid_trace_stats *stats, u32 memory, u32 offset)
+{
+    u32 line = offset / FATHOM_SPARSE_GRID_TRACE_CACHE_LINE_BYTES; /* Below 2^26 for every memory */
+    u32 tag = line | (memory << 30);
+    u32 set = (line + (memory * (FATHOM_SPARSE_GRID_TRACE_CACHE_LINES / 3))) % FATHOM_SPARSE_GRID_TRACE_CACHE_LINES;
+
+    stats->accesses++;
+
+    if (stats->cache_tags[set] != tag)
+    {
+        stats->cache_tags[set] = tag;
+        stats->misses++;
+    }
+}
+
+/* fathom_sparse_grid_brick_map_get that records its reads */
+FATHOM_API FATHOM_INLINE u32 fathom_sparse_grid_trace_brick_map_get(fathom_sparse_grid *grid, u32 index, fathom_sparse_grid_trace_stats *stats)
+{
+    u32 block = index / FATHOM_SPARSE_GRID_LEAF_ENTRIES;
+    u32 top_entry = grid->brick_map_top_data[block];
+
+    fathom_sparse_grid_trace_touch(stats, FATHOM_SPARSE_GRID_TRACE_MEMORY_TOP_MAP, block * (u32)sizeof(u32));
+
+    if (fathom_sparse_grid_brick_map_is_leaf(top_entry))
+    {
+        u32 leaf_index = ((top_entry - 1) * FATHOM_SPARSE_GRID_LEAF_ENTRIES) + (index % FATHOM_SPARSE_GRID_LEAF_ENTRIES);
+        fathom_sparse_grid_trace_touch(stats, FATHOM_SPARSE_GRID_TRACE_MEMORY_LEAVES, leaf_index * grid->brick_map_index_bytes);
+    }
+
+    return fathom_sparse_grid_brick_map_get(grid, index);
+}
+
+/* Trilinear distance at the voxel coordinate (fx, fy, fz) of the physical brick in slot, like the texture unit */
+FATHOM_API f32 fathom_sparse_grid_trace_sample(fathom_sparse_grid *grid, u32 slot, f32 fx, f32 fy, f32 fz, fathom_sparse_grid_trace_stats *stats)
+{
+    u32 atlas_width = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+    u32 atlas_slice = atlas_width * grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
+    f32 max_voxel = (f32)(FATHOM_PHYSICAL_BRICK_SIZE - 2);
+    f32 value = 0.0f;
+    u32 x0, y0, z0;
+    f32 wx, wy, wz;
+    u32 i;
+
+    fx = fathom_clampf(fx, 0.0f, max_voxel + 0.999f);
+    fy = fathom_clampf(fy, 0.0f, max_voxel + 0.999f);
+    fz = fathom_clampf(fz, 0.0f, max_voxel + 0.999f);
+
+    x0 = (u32)fx;
+    y0 = (u32)fy;
+    z0 = (u32)fz;
+    wx = fx - (f32)x0;
+    wy = fy - (f32)y0;
+    wz = fz - (f32)z0;
+
+    for (i = 0; i < 8; ++i)
+    {
+        u32 dx = i & 1u;
+        u32 dy = (i >> 1) & 1u;
+        u32 dz = i >> 2;
+        u32 offset = fathom_sparse_grid_atlas_slot_base(grid, slot) + (x0 + dx) + ((y0 + dy) * atlas_width) + ((z0 + dz) * atlas_slice);
+        f32 weight = (dx ? wx : 1.0f - wx) * (dy ? wy : 1.0f - wy) * (dz ? wz : 1.0f - wz);
+
+        fathom_sparse_grid_trace_touch(stats, FATHOM_SPARSE_GRID_TRACE_MEMORY_ATLAS, offset);
+        value += weight * (f32)grid->atlas_data[offset];
+    }
+
+    stats->samples++;
+
+    return value * (grid->truncation_distance / 127.0f);
+}
+
+/* Casts the ray ro + t * rd (rd normalized) through the grid: a brick DDA that stops at solid bricks and
+ * sphere traces the atlas of every active brick. Returns the hit distance t or a negative value on a miss.
+ */
+FATHOM_API f32 fathom_sparse_grid_trace(fathom_sparse_grid *grid, fathom_vec3 ro, fathom_vec3 rd, fathom_sparse_grid_trace_stats *stats)
+{
+    f32 brick_step = (f32)FATHOM_BRICK_SIZE * grid->cell_size;
+    f32 extent = (f32)grid->cell_count * grid->cell_size;
+    f32 hit_distance = grid->cell_size * 0.1f;
+    i32 dim = (i32)grid->brick_map_dimensions;
+    f32 origin[3];
+    f32 direction[3];
+    f32 direction_inverse[3];
+    f32 t_max[3];
+    f32 t_delta[3];
+    i32 brick[3];
+    i32 step[3];
+    f32 t_near = 0.0f;
+    f32 t_far = 1e30f;
+    f32 t;
+    u32 axis;
+
+    origin[0] = ro.x - grid->start.x;
+    origin[1] = ro.y - grid->start.y;
+    origin[2] = ro.z - grid->start.z;
+    direction[0] = rd.x;
+    direction[1] = rd.y;
+    direction[2] = rd.z;
+
+    stats->rays++;
+
+    /* Clip the ray against the grid box */
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 t0, t1;
+
+        direction_inverse[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : 1e30f;
+        t0 = -origin[axis] * direction_inverse[axis];
+        t1 = (extent - origin[axis]) * direction_inverse[axis];
+        t_near = fathom_maxf(t_near, fathom_minf(t0, t1));
+        t_far = fathom_minf(t_far, fathom_maxf(t0, t1));
+    }
+
+    if (t_near >= t_far)
+    {
+        return -1.0f;
+    }
+
+    t = t_near;
+
+    for (axis = 0; axis < 3; ++axis)
+    {
+        f32 p = origin[axis] + (direction[axis] * t);
+        i32 b = (i32)-fathom_ceilf(-p / brick_step);
+
+        brick[axis] = b < 0 ? 0 : (b >= dim ? dim - 1 : b);
+        step[axis] = direction[axis] > 0.0f ? 1 : -1;
+        t_max[axis] = direction[axis] != 0.0f ? (((f32)(brick[axis] + (step[axis] > 0 ? 1 : 0)) * brick_step) - origin[axis]) * direction_inverse[axis] : 1e30f;
+        t_delta[axis] = brick_step * fathom_absf(direction_inverse[axis]);
+    }
+
+    for (;;)
+    {
+        u32 index = fathom_sparse_grid_brick_map_index(grid, (u32)brick[0], (u32)brick[1], (u32)brick[2]);
+        u32 entry = fathom_sparse_grid_trace_brick_map_get(grid, index, stats);
+        f32 t_exit = fathom_minf(fathom_minf(t_max[0], t_max[1]), t_max[2]);
+
+        stats->bricks++;
+
+        if (entry == FATHOM_BRICK_MAP_INDEX_SOLID)
+        {
+            stats->hits++;
+            return t;
+        }
+
+        if (fathom_sparse_grid_brick_map_is_index(entry))
+        {
+            f32 cell_size_inverse = 1.0f / grid->cell_size;
+            f32 t_brick = t;
+            u32 j;
+
+            for (j = 0; j < FATHOM_SPARSE_GRID_TRACE_MAX_STEPS && t_brick <= t_exit; ++j)
+            {
+                /* Voxel coordinate inside the physical brick: the apron voxel sits at 0 */
+                f32 fx = ((origin[0] + (direction[0] * t_brick)) * cell_size_inverse) - (f32)(brick[0] * FATHOM_BRICK_SIZE) + (f32)FATHOM_BRICK_APRON;
+                f32 fy = ((origin[1] + (direction[1] * t_brick)) * cell_size_inverse) - (f32)(brick[1] * FATHOM_BRICK_SIZE) + (f32)FATHOM_BRICK_APRON;
+                f32 fz = ((origin[2] + (direction[2] * t_brick)) * cell_size_inverse) - (f32)(brick[2] * FATHOM_BRICK_SIZE) + (f32)FATHOM_BRICK_APRON;
+                f32 d = fathom_sparse_grid_trace_sample(grid, entry - 1, fx, fy, fz, stats);
+
+                if (d < hit_distance)
+                {
+                    stats->hits++;
+                    return t_brick;
+                }
+
+                t_brick += d;
+            }
+        }
+
+        /* Step into the next brick */
+        axis = t_max[0] < t_max[1] ? (t_max[0] < t_max[2] ? 0u : 2u) : (t_max[1] < t_max[2] ? 1u : 2u);
+        t = t_max[axis];
+        t_max[axis] += t_delta[axis];
+        brick[axis] += step[axis];
+
+        if (brick[axis] < 0 || brick[axis] >= dim || t > t_far)
+        {
+            return -1.0f;
+        }
+    }
+}
+
+#endif /* FATHOM_SPARSE_GRID_H */
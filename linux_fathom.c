@@ -0,0 +1,1864 @@
+/* linux_fathom.c - v0.1 - public domain data structures - nickscha 2026
+
+LICENSE
+
+  Placed in the public domain and also MIT licensed.
+  See end of file for detailed license information.
+
+*/
+#include "fathom_types.h"
+#include "fathom.h"
+#include "fathom_string_builder.h"
+#include "fathom_profiler.h"
+#include "fathom_job.h"
+#include "fathom_sdf_scene.h"
+#include "fathom_sdf_jit.h"
+#include "fathom_sdf_bvh.h"
+#include "fathom_sparse_grid.h"
+#include "fathom_clipmap.h"
+#include "fathom_raymarch.h"
+
+#if !defined(FATHOM_ARCH_X64) || !defined(__GNUC__)
+#error "linux_fathom.c issues raw x86-64 system calls with GCC/Clang inline assembly"
+#endif
+
+/* Headless platform layer: no window, no OpenGL. It runs a scripted session over the
+ * portable core (scene, clipmap, CPU raymarcher, job system, profiler) and prints the
+ * profiler results, so performance can be measured on machines without a GPU.
+ */
+
+/* Like on win32 the compiler may emit memset / memcpy calls for struct initialization and copies */
+void *memset(void *dest, i32 c, unsigned long count)
+{
+  s8 *bytes = (s8 *)dest;
+  while (count--)
+  {
+    *bytes++ = (s8)c;
+  }
+  return dest;
+}
+
+void *memcpy(void *dest, const void *src, unsigned long count)
+{
+  s8 *d = (s8 *)dest;
+  const s8 *s = (const s8 *)src;
+  while (count--)
+  {
+    *d++ = *s++;
+  }
+  return dest;
+}
+
+/* #############################################################################
+ * # [SECTION] Linux System Calls (x86-64)
+ * #############################################################################
+ */
+#define LINUX_SYS_READ 0
+#define LINUX_SYS_WRITE 1
+#define LINUX_SYS_OPEN 2
+#define LINUX_SYS_CLOSE 3
+#define LINUX_SYS_LSEEK 8
+#define LINUX_SYS_MMAP 9
+#define LINUX_SYS_MPROTECT 10
+#define LINUX_SYS_MUNMAP 11
+#define LINUX_SYS_SCHED_YIELD 24
+#define LINUX_SYS_MADVISE 28
+#define LINUX_SYS_NANOSLEEP 35
+#define LINUX_SYS_SCHED_GETAFFINITY 204
+#define LINUX_SYS_CLOCK_GETTIME 228
+#define LINUX_SYS_EXIT_GROUP 231
+
+#define LINUX_O_RDONLY 0
+#define LINUX_O_WRONLY_CREAT_TRUNC 01101
+#define LINUX_O_CLOEXEC 02000000
+#define LINUX_SEEK_END 2
+#define LINUX_PROT_READ_WRITE 3
+#define LINUX_PROT_READ_EXEC 5
+#define LINUX_MAP_PRIVATE_ANONYMOUS 0x22
+#define LINUX_MADV_DONTNEED 4
+#define LINUX_CLOCK_MONOTONIC 1
+#define LINUX_PAGE_SIZE 4096
+
+/* CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD | CLONE_SYSVSEM */
+#define LINUX_CLONE_THREAD_FLAGS 0x50F00
+
+typedef struct linux_timespec
+{
+  long tv_sec;
+  long tv_nsec;
+
+} linux_timespec;
+
+FATHOM_API FATHOM_INLINE long linux_syscall1(long number, long a)
+{
+  long result;
+  __asm__ __volatile__("syscall" : "=a"(result) : "a"(number), "D"(a) : "rcx", "r11", "memory");
+  return result;
+}
+
+FATHOM_API FATHOM_INLINE long linux_syscall2(long number, long a, long b)
+{
+  long result;
+  __asm__ __volatile__("syscall" : "=a"(result) : "a"(number), "D"(a), "S"(b) : "rcx", "r11", "memory");
+  return result;
+}
+
+FATHOM_API FATHOM_INLINE long linux_syscall3(long number, long a, long b, long c)
+{
+  long result;
+  __asm__ __volatile__("syscall" : "=a"(result) : "a"(number), "D"(a), "S"(b), "d"(c) : "rcx", "r11", "memory");
+  return result;
+}
+
+FATHOM_API FATHOM_INLINE long linux_syscall6(long number, long a, long b, long c, long d, long e, long f)
+{
+  long result;
+  register long r10 __asm__("r10") = d;
+  register long r8 __asm__("r8") = e;
+  register long r9 __asm__("r9") = f;
+  __asm__ __volatile__("syscall" : "=a"(result) : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10), "r"(r8), "r"(r9) : "rcx", "r11", "memory");
+  return result;
+}
+
+/* Starts function(argument) on a new thread with its stack ending at stack_top (16 byte aligned).
+ * The child takes function and argument from its own stack since it returns from clone without
+ * the frame of the caller, and leaves with exit (only the thread) once function returns.
+ */
+long linux_thread_clone(long flags, void *stack_top, fathom_job_thread_function function, void *argument);
+
+__asm__(
+    ".text\n"
+    "linux_thread_clone:\n"
+    "  sub $16, %rsi\n"
+    "  mov %rdx, (%rsi)\n"
+    "  mov %rcx, 8(%rsi)\n"
+    "  mov $56, %eax\n" /* clone(flags, stack, 0, 0, 0) */
+    "  xor %edx, %edx\n"
+    "  xor %r10d, %r10d\n"
+    "  xor %r8d, %r8d\n"
+    "  syscall\n"
+    "  test %rax, %rax\n"
+    "  jnz 1f\n"
+    "  xor %ebp, %ebp\n"
+    "  pop %rax\n"
+    "  pop %rdi\n"
+    "  call *%rax\n"
+    "  mov %eax, %edi\n"
+    "  mov $60, %eax\n" /* exit */
+    "  syscall\n"
+    "  hlt\n"
+    "1:\n"
+    "  ret\n");
+
+/* #############################################################################
+ * # [SECTION] Linux specific functions
+ * #############################################################################
+ */
+FATHOM_API f64 fathom_profiler_time_ms(void)
+{
+  linux_timespec time;
+
+  linux_syscall2(LINUX_SYS_CLOCK_GETTIME, LINUX_CLOCK_MONOTONIC, (long)&time);
+
+  return ((f64)time.tv_sec * 1000.0) + ((f64)time.tv_nsec / 1000000.0);
+}
+
+FATHOM_API u8 linux_print(s8 *str)
+{
+  u32 len = 0;
+
+  while (str[len])
+  {
+    len++;
+  }
+
+  while (len)
+  {
+    long written = linux_syscall3(LINUX_SYS_WRITE, 1, (long)str, (long)len);
+
+    if (written <= 0)
+    {
+      return 0;
+    }
+
+    str += written;
+    len -= (u32)written;
+  }
+
+  return 1;
+}
+
+FATHOM_API u8 linux_file_size(s8 *filename, u32 *file_size)
+{
+  long fd = linux_syscall3(LINUX_SYS_OPEN, (long)filename, LINUX_O_RDONLY | LINUX_O_CLOEXEC, 0);
+  long size;
+
+  if (fd < 0)
+  {
+    return 0;
+  }
+
+  size = linux_syscall3(LINUX_SYS_LSEEK, fd, 0, LINUX_SEEK_END);
+  linux_syscall1(LINUX_SYS_CLOSE, fd);
+
+  if (size < 0 || size > 0x7FFFFFFF)
+  {
+    return 0;
+  }
+
+  *file_size = (u32)size;
+
+  return 1;
+}
+
+/* Reads the file into buffer, at most buffer_size bytes */
+FATHOM_API u8 linux_file_read(s8 *filename, u8 *buffer, u32 buffer_size)
+{
+  long fd = linux_syscall3(LINUX_SYS_OPEN, (long)filename, LINUX_O_RDONLY | LINUX_O_CLOEXEC, 0);
+  u32 total = 0;
+
+  if (fd < 0)
+  {
+    return 0;
+  }
+
+  while (total < buffer_size)
+  {
+    long bytes = linux_syscall3(LINUX_SYS_READ, fd, (long)(buffer + total), (long)(buffer_size - total));
+
+    if (bytes < 0)
+    {
+      linux_syscall1(LINUX_SYS_CLOSE, fd);
+      return 0;
+    }
+
+    if (bytes == 0)
+    {
+      break;
+    }
+
+    total += (u32)bytes;
+  }
+
+  linux_syscall1(LINUX_SYS_CLOSE, fd);
+
+  return 1;
+}
+
+/* Creates or replaces the file with size bytes of data */
+FATHOM_API u8 linux_file_write(s8 *filename, u8 *data, u32 size)
+{
+  long fd = linux_syscall3(LINUX_SYS_OPEN, (long)filename, LINUX_O_WRONLY_CREAT_TRUNC | LINUX_O_CLOEXEC, 0644);
+  u32 total = 0;
+
+  if (fd < 0)
+  {
+    return 0;
+  }
+
+  while (total < size)
+  {
+    long bytes = linux_syscall3(LINUX_SYS_WRITE, fd, (long)(data + total), (long)(size - total));
+
+    if (bytes <= 0)
+    {
+      linux_syscall1(LINUX_SYS_CLOSE, fd);
+      return 0;
+    }
+
+    total += (u32)bytes;
+  }
+
+  linux_syscall1(LINUX_SYS_CLOSE, fd);
+
+  return 1;
+}
+
+/* Zeroed pages like VirtualAlloc. The mapping size is kept in front of the memory (one cache line) for linux_memory_free. */
+FATHOM_API void *linux_memory_alloc(u32 bytes)
+{
+  long size = (long)bytes + 64;
+  long base = linux_syscall6(LINUX_SYS_MMAP, 0, size, LINUX_PROT_READ_WRITE, LINUX_MAP_PRIVATE_ANONYMOUS, -1, 0);
+
+  /* Errors are returned as -4095 to -1 */
+  if (base < 0 && base > -4096)
+  {
+    return FATHOM_NULL;
+  }
+
+  *(long *)base = size;
+
+  return (u8 *)base + 64;
+}
+
+FATHOM_API void linux_memory_free(void *memory)
+{
+  u8 *base;
+
+  if (!memory)
+  {
+    return;
+  }
+
+  base = (u8 *)memory - 64;
+  linux_syscall2(LINUX_SYS_MUNMAP, (long)base, *(long *)base);
+}
+
+/* Gives the pages of [memory + bytes_used, memory + bytes) back to the system, like MEM_DECOMMIT */
+FATHOM_API void linux_memory_decommit(void *memory, u32 bytes_used, u32 bytes)
+{
+  long first = ((long)memory + (long)bytes_used + (LINUX_PAGE_SIZE - 1)) & ~(long)(LINUX_PAGE_SIZE - 1);
+  long last = (long)memory + (long)bytes;
+
+  if (first < last)
+  {
+    linux_syscall3(LINUX_SYS_MADVISE, first, last - first, LINUX_MADV_DONTNEED);
+  }
+}
+
+/* fathom_jit_compile of the win32 platform: the code pages are mapped on first use (page aligned, so
+ * they can change protection), writable while compiling and read / execute afterwards.
+ * Returns 0 if the program runs on the interpreter.
+ */
+FATHOM_API u8 linux_jit_compile(fathom_sdf_jit_program *jit, fathom_sdf_vm_program *program, u8 **code)
+{
+  if (!*code)
+  {
+    long base = linux_syscall6(LINUX_SYS_MMAP, 0, FATHOM_SDF_JIT_CODE_BYTES, LINUX_PROT_READ_WRITE, LINUX_MAP_PRIVATE_ANONYMOUS, -1, 0);
+
+    if (base < 0 && base > -4096)
+    {
+      return fathom_sdf_jit_compile(jit, program, FATHOM_NULL, 0);
+    }
+
+    *code = (u8 *)base;
+  }
+  else if (linux_syscall3(LINUX_SYS_MPROTECT, (long)*code, FATHOM_SDF_JIT_CODE_BYTES, LINUX_PROT_READ_WRITE) != 0)
+  {
+    return fathom_sdf_jit_compile(jit, program, FATHOM_NULL, 0);
+  }
+
+  if (!fathom_sdf_jit_compile(jit, program, *code, FATHOM_SDF_JIT_CODE_BYTES) || linux_syscall3(LINUX_SYS_MPROTECT, (long)*code, FATHOM_SDF_JIT_CODE_BYTES, LINUX_PROT_READ_EXEC) != 0)
+  {
+    return fathom_sdf_jit_compile(jit, program, FATHOM_NULL, 0);
+  }
+
+  return 1;
+}
+
+/* #############################################################################
+ * # [SECTION] Linux Threading (job system platform callbacks)
+ * #############################################################################
+ */
+#define LINUX_THREAD_STACK_BYTES 0x100000 /* Like the stacks of the win32 threads */
+
+FATHOM_API u8 linux_thread_create(fathom_job_thread_function function, void *argument)
+{
+  u8 *stack = (u8 *)linux_memory_alloc(LINUX_THREAD_STACK_BYTES);
+
+  if (!stack)
+  {
+    return 0;
+  }
+
+  if (linux_thread_clone(LINUX_CLONE_THREAD_FLAGS, stack + LINUX_THREAD_STACK_BYTES, function, argument) <= 0)
+  {
+    linux_memory_free(stack);
+    return 0;
+  }
+
+  return 1;
+}
+
+FATHOM_API void linux_thread_sleep(u32 milliseconds)
+{
+  if (milliseconds == 0)
+  {
+    linux_syscall1(LINUX_SYS_SCHED_YIELD, 0);
+  }
+  else
+  {
+    linux_timespec time;
+    time.tv_sec = (long)(milliseconds / 1000);
+    time.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+    linux_syscall2(LINUX_SYS_NANOSLEEP, (long)&time, 0);
+  }
+}
+
+/* CPUs the process may run on */
+FATHOM_API u32 linux_processor_count(void)
+{
+  u8 mask[128] = {0};
+  long bytes = linux_syscall3(LINUX_SYS_SCHED_GETAFFINITY, 0, (long)sizeof(mask), (long)mask);
+  u32 count = 0;
+  long i;
+
+  for (i = 0; i < bytes; ++i)
+  {
+    u8 bits = mask[i];
+
+    while (bits)
+    {
+      count += bits & 1u;
+      bits = (u8)(bits >> 1);
+    }
+  }
+
+  return count > 0 ? count : 1;
+}
+
+/* #############################################################################
+ * # [SECTION] Headless Session
+ * #############################################################################
+ *
+ * Builds the clipmap of the win32 renderer around the orbiting camera, then runs
+ * frame_count frames at a fixed 30 Hz: the levels scroll after the camera, the
+ * animated primitive is rebuilt and the CPU raymarcher renders the window size.
+ * Prints the grid and the profiler results at the end.
+ */
+#define LINUX_SESSION_FRAMES 90
+#define LINUX_SESSION_FRAME_SECONDS (1.0f / 30.0f)
+#define LINUX_SESSION_SCENE_CAPACITY 1024
+
+static fathom_sdf_scene_store linux_session_scene;
+static u32 linux_session_sphere;
+static fathom_clipmap linux_session_clipmap;
+static fathom_raymarch linux_session_raymarch;
+static u32 linux_session_frame;
+static u32 linux_session_frame_count = LINUX_SESSION_FRAMES;
+
+FATHOM_API fathom_grid_distance linux_scene_distance(fathom_sdf_scene_store *store)
+{
+  fathom_grid_distance distance;
+
+  distance.function = fathom_sdf_scene;
+  distance.function_batch = fathom_sdf_scene_batch;
+  distance.function_interval = fathom_sdf_scene_interval;
+  distance.function_prune = fathom_sdf_scene_prune;
+  distance.function_tape = fathom_sdf_scene_batch_tape;
+  distance.user_data = store;
+
+  return distance;
+}
+
+/* fathom_create_grid of the win32 platform. pass_ms receives the time of each pass if set. */
+FATHOM_API u8 linux_create_grid(fathom_platform_api *api, fathom_sparse_grid *grid, fathom_grid_distance *distance, f64 *pass_ms)
+{
+  f64 time_start;
+  f64 time_ms[3];
+  u32 atlas_bytes;
+  u8 fits;
+
+  grid->brick_map_top_data = linux_memory_alloc(grid->brick_map_top_bytes);
+
+  FATHOM_PROFILER_BEGIN(sparse_grid_pass_00);
+  time_start = fathom_profiler_time_ms();
+  fathom_sparse_grid_pass_00_fill_top_map(grid, distance, api->job_system);
+  time_ms[0] = fathom_profiler_time_ms() - time_start;
+  FATHOM_PROFILER_END(sparse_grid_pass_00);
+
+  grid->brick_map_data = linux_memory_alloc(grid->brick_map_bytes);
+  grid->brick_map_leaf_free_data = linux_memory_alloc(grid->brick_map_leaf_bytes);
+  grid->air_distance_data = linux_memory_alloc(grid->air_distance_bytes);
+  grid->air_distance_scratch_data = linux_memory_alloc(grid->air_distance_bytes);
+
+  FATHOM_PROFILER_BEGIN(sparse_grid_pass_01);
+  time_start = fathom_profiler_time_ms();
+  fits = fathom_sparse_grid_pass_01_fill_brick_map(grid, distance, api->job_system);
+  time_ms[1] = fathom_profiler_time_ms() - time_start;
+  FATHOM_PROFILER_END(sparse_grid_pass_01);
+
+  if (pass_ms)
+  {
+    pass_ms[0] = time_ms[0];
+    pass_ms[1] = time_ms[1];
+    pass_ms[2] = 0.0;
+  }
+
+  if (!fits)
+  {
+    api->io_print("[ERROR] Sparse grid has more active bricks than its brick map index or atlas can hold\n");
+    return 0;
+  }
+
+  atlas_bytes = grid->atlas_bytes;
+  grid->atlas_data = linux_memory_alloc(grid->atlas_bytes);
+  grid->material_data = linux_memory_alloc(grid->atlas_bytes);
+  grid->atlas_slot_owner_data = linux_memory_alloc(grid->atlas_slot_bytes);
+  grid->atlas_slot_ref_data = linux_memory_alloc(grid->atlas_slot_bytes);
+  grid->atlas_free_slot_data = linux_memory_alloc(grid->atlas_slot_bytes);
+  grid->atlas_slot_hash_data = linux_memory_alloc(grid->atlas_slot_bytes);
+  grid->atlas_dedup_table_data = linux_memory_alloc(grid->atlas_slot_bytes * 2);
+  grid->atlas_slot_material_data = linux_memory_alloc(grid->atlas_slot_bytes);
+  grid->material_free_slot_data = linux_memory_alloc(grid->atlas_slot_bytes);
+
+  FATHOM_PROFILER_BEGIN(sparse_grid_pass_02);
+  time_start = fathom_profiler_time_ms();
+  fathom_sparse_grid_pass_02_fill_atlas(grid, distance, api->job_system);
+  time_ms[2] = fathom_profiler_time_ms() - time_start;
+  FATHOM_PROFILER_END(sparse_grid_pass_02);
+
+  if (pass_ms)
+  {
+    pass_ms[2] = time_ms[2];
+  }
+
+  /* Deduplication may have dropped atlas layers: give the pages past the smaller atlas back */
+  linux_memory_decommit(grid->atlas_data, grid->atlas_bytes, atlas_bytes);
+  linux_memory_decommit(grid->material_data, grid->atlas_bytes, atlas_bytes);
+
+  return 1;
+}
+
+FATHOM_API void linux_destroy_grid(fathom_sparse_grid *grid)
+{
+  linux_memory_free(grid->brick_map_top_data);
+  linux_memory_free(grid->brick_map_data);
+  linux_memory_free(grid->brick_map_leaf_free_data);
+  linux_memory_free(grid->air_distance_data);
+  linux_memory_free(grid->air_distance_scratch_data);
+  linux_memory_free(grid->atlas_data);
+  linux_memory_free(grid->material_data);
+  linux_memory_free(grid->atlas_slot_owner_data);
+  linux_memory_free(grid->atlas_slot_ref_data);
+  linux_memory_free(grid->atlas_free_slot_data);
+  linux_memory_free(grid->atlas_slot_hash_data);
+  linux_memory_free(grid->atlas_dedup_table_data);
+  linux_memory_free(grid->atlas_slot_material_data);
+  linux_memory_free(grid->material_free_slot_data);
+
+  grid->brick_map_top_data = 0;
+  grid->brick_map_data = 0;
+  grid->brick_map_leaf_free_data = 0;
+  grid->air_distance_data = 0;
+  grid->air_distance_scratch_data = 0;
+  grid->atlas_data = 0;
+  grid->material_data = 0;
+  grid->atlas_slot_owner_data = 0;
+  grid->atlas_slot_ref_data = 0;
+  grid->atlas_free_slot_data = 0;
+  grid->atlas_slot_hash_data = 0;
+  grid->atlas_dedup_table_data = 0;
+  grid->atlas_slot_material_data = 0;
+  grid->material_free_slot_data = 0;
+}
+
+FATHOM_API void linux_session_print_results(fathom_platform_api *api)
+{
+  fathom_clipmap *clipmap = &linux_session_clipmap;
+  s8 buffer[256];
+  fathom_sb t = {0};
+  u32 active_bricks = 0;
+  u32 brick_map_bytes = 0;
+  u32 atlas_bytes = 0;
+  u32 level;
+  u32 i;
+
+  t.size = sizeof(buffer);
+  t.buffer = buffer;
+
+  for (level = 0; level < clipmap->level_count; ++level)
+  {
+    fathom_sparse_grid *grid = &clipmap->levels[level];
+
+    active_bricks += grid->brick_map_active_bricks_count;
+    brick_map_bytes += grid->brick_map_top_bytes + grid->brick_map_bytes + grid->brick_map_leaf_bytes;
+    atlas_bytes += grid->atlas_bytes;
+  }
+
+  fathom_sb_s8(&t, "[linux] frames ");
+  fathom_sb_i32(&t, (i32)linux_session_frame_count);
+  fathom_sb_s8(&t, " workers ");
+  fathom_sb_i32(&t, (i32)api->job_system->worker_count);
+  fathom_sb_s8(&t, " levels ");
+  fathom_sb_i32(&t, (i32)clipmap->level_count);
+  fathom_sb_s8(&t, " active bricks ");
+  fathom_sb_i32(&t, (i32)active_bricks);
+  fathom_sb_s8(&t, " brick map MB ");
+  fathom_sb_f64(&t, (f64)brick_map_bytes / 1024.0 / 1024.0, 3);
+  fathom_sb_s8(&t, " atlas MB ");
+  fathom_sb_f64(&t, (f64)atlas_bytes / 1024.0 / 1024.0, 3);
+  fathom_sb_s8(&t, "\n");
+  api->io_print(t.buffer);
+
+  t.length = 0;
+  fathom_sb_s8(&t, "[linux] raymarch ");
+  fathom_sb_i32(&t, (i32)linux_session_raymarch.width);
+  fathom_sb_s8(&t, "x");
+  fathom_sb_i32(&t, (i32)linux_session_raymarch.height);
+  fathom_sb_s8(&t, " hits ");
+  fathom_sb_i32(&t, (i32)linux_session_raymarch.stats.hits);
+  fathom_sb_s8(&t, " samples/ray ");
+  fathom_sb_f64(&t, linux_session_raymarch.stats.rays ? (f64)linux_session_raymarch.stats.samples / (f64)linux_session_raymarch.stats.rays : 0.0, 2);
+  fathom_sb_s8(&t, "\n");
+  api->io_print(t.buffer);
+
+  /* Same columns as the debug UI: last / average / total ms and count */
+  for (i = 0; i < fathom_profiler_entries_count; ++i)
+  {
+    fathom_profiler_entry entry = fathom_profiler_entries[i];
+
+    t.length = 0;
+    fathom_sb_s8(&t, "[profiler] ");
+    fathom_sb_s8_pad(&t, entry.name, 27, ' ', FATHOM_SB_PAD_RIGHT);
+    fathom_sb_s8(&t, ": ");
+    fathom_sb_f64(&t, entry.time_ms_last, 4);
+    fathom_sb_s8(&t, "/");
+    fathom_sb_f64(&t, entry.time_ms_total / (f64)entry.counter, 4);
+    fathom_sb_s8(&t, "/");
+    fathom_sb_f64(&t, entry.time_ms_total, 4);
+    fathom_sb_s8(&t, "/");
+    fathom_sb_i32(&t, (i32)entry.counter);
+    fathom_sb_s8(&t, "\n");
+    api->io_print(t.buffer);
+
+    /* Rays per second of the CPU raymarcher over all frames */
+    if (fathom_profiler_string_equals(entry.name, "raymarch_render") && entry.time_ms_total > 0.0)
+    {
+      t.length = 0;
+      fathom_sb_s8(&t, "[profiler] ");
+      fathom_sb_s8_pad(&t, "raymarch_render Mrays/s", 27, ' ', FATHOM_SB_PAD_RIGHT);
+      fathom_sb_s8(&t, ": ");
+      fathom_sb_f64(&t, ((f64)linux_session_raymarch.width * (f64)linux_session_raymarch.height * (f64)entry.counter) / (entry.time_ms_total * 1000.0), 3);
+      fathom_sb_s8(&t, "\n");
+      api->io_print(t.buffer);
+    }
+  }
+}
+
+FATHOM_API u8 linux_session_update(fathom_platform_api *api, fathom_platform_window *window, fathom_platform_input *input)
+{
+  static u8 *pixels;
+  fathom_clipmap *clipmap = &linux_session_clipmap;
+  fathom_vec3 world_up = fathom_vec3_init(0.0f, 1.0f, 0.0f);
+  f32 time = (f32)linux_session_frame * LINUX_SESSION_FRAME_SECONDS;
+  f32 camera_angle = time * 0.2f;
+  fathom_vec3 camera_position = fathom_vec3_init(fathom_sinf(camera_angle) * 4.0f, 1.5f, fathom_cosf(camera_angle) * 4.0f);
+  fathom_vec3 camera_forward = fathom_vec3_normalize(fathom_vec3_sub(fathom_vec3_zero, camera_position));
+  fathom_vec3 camera_right = fathom_vec3_normalize(fathom_vec3_cross(camera_forward, world_up));
+  fathom_vec3 camera_up = fathom_vec3_normalize(fathom_vec3_cross(camera_right, camera_forward));
+  fathom_grid_distance distance = linux_scene_distance(&linux_session_scene);
+  u32 level;
+
+  (void)input;
+
+  if (linux_session_frame == 0)
+  {
+    FATHOM_PROFILER_BEGIN(sdf_scene_build);
+    fathom_sdf_scene_store_initialize(&linux_session_scene, LINUX_SESSION_SCENE_CAPACITY);
+    linux_session_scene.arena_data = linux_memory_alloc(linux_session_scene.arena_bytes);
+    fathom_sdf_scene_store_clear(&linux_session_scene);
+    linux_session_sphere = fathom_sdf_scene_build(&linux_session_scene);
+    FATHOM_PROFILER_END(sdf_scene_build);
+
+    /* The clipmap of the win32 renderer, the atlas limit of a typical GL_MAX_3D_TEXTURE_SIZE */
+    fathom_clipmap_initialize(clipmap, 4, 128, 1.0f / 16.0f, FATHOM_SPARSE_GRID_INDEX_AUTO, 2048);
+
+    FATHOM_PROFILER_BEGIN(sparse_grid_create_clipmap);
+    for (level = 0; level < clipmap->level_count; ++level)
+    {
+      fathom_clipmap_level_initialize(clipmap, level, camera_position);
+
+      if (!linux_create_grid(api, &clipmap->levels[level], &distance, FATHOM_NULL))
+      {
+        return 0;
+      }
+    }
+    FATHOM_PROFILER_END(sparse_grid_create_clipmap);
+
+    pixels = (u8 *)linux_memory_alloc(window->window_width * window->window_height * 3);
+    fathom_raymarch_initialize(&linux_session_raymarch, clipmap, pixels, window->window_width, window->window_height);
+  }
+
+  /* Follow the camera: every level only evaluates the bricks that scrolled into it */
+  FATHOM_PROFILER_BEGIN(sparse_grid_clipmap_scroll);
+  for (level = 0; level < clipmap->level_count; ++level)
+  {
+    fathom_sparse_grid_dirty dirty;
+
+    if (fathom_clipmap_level_update(clipmap, level, &distance, camera_position, api->job_system, &dirty) == FATHOM_CLIPMAP_LEVEL_REBUILD)
+    {
+      linux_destroy_grid(&clipmap->levels[level]);
+      fathom_clipmap_level_initialize(clipmap, level, camera_position);
+
+      if (!linux_create_grid(api, &clipmap->levels[level], &distance, FATHOM_NULL))
+      {
+        return 0;
+      }
+    }
+  }
+  FATHOM_PROFILER_END(sparse_grid_clipmap_scroll);
+
+  /* Animated primitive: rebuild only the bricks around it in every level */
+  {
+    fathom_sdf_primitive sphere;
+    fathom_sdf_aabb bounds_old;
+    fathom_sdf_aabb bounds_new;
+
+    fathom_sdf_scene_store_get(&linux_session_scene, linux_session_sphere, &sphere);
+    bounds_old = fathom_sdf_scene_primitive_aabb(&sphere);
+
+    sphere.transform.position.y = 0.375f + 0.375f * fathom_sinf(time * 2.0f);
+    bounds_new = fathom_sdf_scene_primitive_aabb(&sphere);
+    fathom_sdf_scene_store_update(&linux_session_scene, linux_session_sphere, &sphere);
+
+    FATHOM_PROFILER_BEGIN(sparse_grid_update);
+    for (level = 0; level < clipmap->level_count; ++level)
+    {
+      fathom_sparse_grid *grid = &clipmap->levels[level];
+      fathom_sparse_grid_dirty dirty;
+      fathom_sparse_grid_atlas_stats stats;
+
+      if (!fathom_sparse_grid_update(grid, &distance, bounds_old.min, bounds_old.max, bounds_new.min, bounds_new.max, FATHOM_SDF_SCENE_GROUND_BLEND, api->job_system, &dirty))
+      {
+        linux_destroy_grid(grid);
+        fathom_clipmap_level_initialize(clipmap, level, camera_position);
+
+        if (!linux_create_grid(api, grid, &distance, FATHOM_NULL))
+        {
+          return 0;
+        }
+
+        continue;
+      }
+
+      fathom_sparse_grid_atlas_stats_get(grid, &stats);
+
+      if (stats.fragmentation > 0.25f)
+      {
+        fathom_sparse_grid_atlas_compact(grid);
+      }
+    }
+    FATHOM_PROFILER_END(sparse_grid_update);
+  }
+
+  /* Render the frame on the CPU */
+  linux_session_raymarch.camera.position = camera_position;
+  linux_session_raymarch.camera.right = camera_right;
+  linux_session_raymarch.camera.up = camera_up;
+  linux_session_raymarch.camera.forward_scaled = fathom_vec3_mulf(camera_forward, 1.5f);
+
+  FATHOM_PROFILER_BEGIN(raymarch_render);
+  fathom_raymarch_render(&linux_session_raymarch, api->job_system);
+  FATHOM_PROFILER_END(raymarch_render);
+
+  if (++linux_session_frame < linux_session_frame_count)
+  {
+    return 1;
+  }
+
+  linux_session_print_results(api);
+
+  return 0;
+}
+
+/* #############################################################################
+ * # [SECTION] Grid Build Benchmark
+ * #############################################################################
+ *
+ * Builds the sparse grid of procedural stress scenes at 64^3 to max_cells^3 cells over the same
+ * world box, so only the cell size changes with the resolution. Every pass reports its time, the
+ * distance function evaluations, the active bricks, the atlas bytes and the voxels per second.
+ * Pass 0 and 1 cover every cell of the grid, pass 2 the voxels of the atlas bricks it fills.
+ * With bvh set the hierarchy of fathom_sdf_bvh.h is built for every scene and its point queries are
+ * checked against the scene functions at random points, the passes run fathom_sdf_bvh_distance
+ * (batches and tapes of the scene, the hierarchy answers the point queries only).
+ * The rows are written as CSV together with the revision the executable was built from, so runs
+ * of different commits can be compared.
+ */
+#ifndef LINUX_BENCHMARK_REVISION
+#define LINUX_BENCHMARK_REVISION "unknown" /* Set by linux_fathom_build.sh */
+#endif
+
+#define LINUX_BENCHMARK_GRID_FILE "fathom_benchmark_grid.csv"
+#define LINUX_BENCHMARK_GRID_SCENES 4
+#define LINUX_BENCHMARK_GRID_CELLS_MIN 64
+#define LINUX_BENCHMARK_GRID_CELLS_MAX 1024
+#define LINUX_BENCHMARK_GRID_EXTENT 8.0f
+#define LINUX_BENCHMARK_GRID_CAPACITY 1024
+#define LINUX_BENCHMARK_GRID_BVH_POINTS 65536
+#define LINUX_BENCHMARK_GRID_BVH_EDITS 16
+
+FATHOM_API f32 linux_benchmark_random(u32 *seed)
+{
+  *seed = *seed * 1664525u + 1013904223u;
+  return (f32)(*seed >> 8) / 16777216.0f;
+}
+
+/* Sets the attributes of the primitive type for an extent of about size in every direction */
+FATHOM_API void linux_benchmark_primitive_size(fathom_sdf_primitive *primitive, f32 size)
+{
+  switch (primitive->primitive_id)
+  {
+  case FATHOM_SDF_PRIMITIVE_SPHERE:
+    primitive->attributes.sphere.radius = size;
+    break;
+  case FATHOM_SDF_PRIMITIVE_BOX:
+    primitive->attributes.box.base = fathom_vec3_init(size, size * 0.75f, size * 0.5f);
+    break;
+  case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+    primitive->attributes.box_frame.base = fathom_vec3_initf(size);
+    primitive->attributes.box_frame.edge_thickness = size * 0.1f;
+    break;
+  case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+    primitive->attributes.ellipsoid.radius = fathom_vec3_init(size, size * 0.5f, size * 0.75f);
+    break;
+  default:
+    primitive->attributes.octahedron.scale = size;
+    break;
+  }
+}
+
+/* Fills the store with one scene family and returns its name:
+ *   scattered:   512 primitives of every type and random rotation spread over the grid
+ *   csg_chain:   a box carved (xor) and grown (union) by 256 smooth and hard operations around
+ *                its surface, so the pruned tapes stay long. Subtraction and intersection would
+ *                cut away every primitive before them (the new primitive is their left operand).
+ *   repeated:    a 16 x 4 x 16 lattice of the same box frame (the store has no domain repetition)
+ *   thin_shells: 8 nests of 16 concentric spheres combined by xor, so the walls are 0.025 thick,
+ *                thinner than the cells of the coarse grids
+ */
+FATHOM_API s8 *linux_benchmark_grid_scene(fathom_sdf_scene_store *store, u32 scene)
+{
+  u32 seed = 1;
+  u32 i;
+
+  fathom_sdf_scene_store_clear(store);
+
+  if (scene == 0)
+  {
+    for (i = 0; i < 512; ++i)
+    {
+      fathom_sdf_primitive primitive = {0};
+
+      primitive.primitive_id = (u8)(i % FATHOM_SDF_PRIMITIVE_COUNT);
+      primitive.material_id = (u8)(1 + i % 4);
+      primitive.operation_id = (u8)(i % 7 == 0 ? FATHOM_SDF_OPERATION_UNION : FATHOM_SDF_OPERATION_UNION_SMOOTH);
+      primitive.transform.position.x = (linux_benchmark_random(&seed) - 0.5f) * 7.0f;
+      primitive.transform.position.y = -0.25f + linux_benchmark_random(&seed) * 2.5f;
+      primitive.transform.position.z = (linux_benchmark_random(&seed) - 0.5f) * 7.0f;
+      primitive.transform.rotation = fathom_vec3_init(linux_benchmark_random(&seed) * 3.0f, linux_benchmark_random(&seed) * 3.0f, 0.0f);
+      linux_benchmark_primitive_size(&primitive, 0.08f + 0.2f * linux_benchmark_random(&seed));
+      fathom_sdf_scene_store_add(store, &primitive);
+    }
+
+    return "scattered";
+  }
+
+  if (scene == 1)
+  {
+    fathom_sdf_primitive base = {0};
+    u8 operations[8] = {
+        FATHOM_SDF_OPERATION_XOR, FATHOM_SDF_OPERATION_UNION_SMOOTH, FATHOM_SDF_OPERATION_XOR, FATHOM_SDF_OPERATION_UNION,
+        FATHOM_SDF_OPERATION_UNION_SMOOTH, FATHOM_SDF_OPERATION_XOR, FATHOM_SDF_OPERATION_UNION_SMOOTH, FATHOM_SDF_OPERATION_XOR};
+
+    base.primitive_id = FATHOM_SDF_PRIMITIVE_BOX;
+    base.material_id = 1;
+    base.operation_id = FATHOM_SDF_OPERATION_UNION;
+    base.transform.position = fathom_vec3_init(0.0f, 1.0f, 0.0f);
+    base.attributes.box.base = fathom_vec3_initf(1.5f);
+    fathom_sdf_scene_store_add(store, &base);
+
+    /* Operations on a helix around the surface of the box */
+    for (i = 1; i < 256; ++i)
+    {
+      fathom_sdf_primitive primitive = {0};
+      f32 angle = (f32)i * 0.7f;
+
+      primitive.primitive_id = (u8)(i % FATHOM_SDF_PRIMITIVE_COUNT);
+      primitive.material_id = (u8)(1 + i % 4);
+      primitive.operation_id = operations[i % 8];
+      primitive.transform.position = fathom_vec3_init(fathom_sinf(angle) * 1.5f, -0.5f + (f32)i * (3.0f / 256.0f), fathom_cosf(angle) * 1.5f);
+      primitive.transform.rotation = fathom_vec3_init(angle, angle * 0.5f, 0.0f);
+      linux_benchmark_primitive_size(&primitive, 0.3f + 0.3f * linux_benchmark_random(&seed));
+      fathom_sdf_scene_store_add(store, &primitive);
+    }
+
+    /* The whole chain is rounded off by a large intersection */
+    {
+      fathom_sdf_primitive bound = {0};
+
+      bound.primitive_id = FATHOM_SDF_PRIMITIVE_SPHERE;
+      bound.material_id = 2;
+      bound.operation_id = FATHOM_SDF_OPERATION_INTERSECT_SMOOTH;
+      bound.transform.position = fathom_vec3_init(0.0f, 1.0f, 0.0f);
+      bound.attributes.sphere.radius = 2.2f;
+      fathom_sdf_scene_store_add(store, &bound);
+    }
+
+    return "csg_chain";
+  }
+
+  if (scene == 2)
+  {
+    for (i = 0; i < 16 * 4 * 16; ++i)
+    {
+      fathom_sdf_primitive primitive = {0};
+
+      primitive.primitive_id = FATHOM_SDF_PRIMITIVE_BOX_FRAME;
+      primitive.material_id = (u8)(1 + i % 4);
+      primitive.operation_id = FATHOM_SDF_OPERATION_UNION;
+      primitive.transform.position = fathom_vec3_init(-3.75f + (f32)(i % 16) * 0.5f, (f32)((i / 16) % 4) * 0.5f, -3.75f + (f32)(i / 64) * 0.5f);
+      primitive.attributes.box_frame.base = fathom_vec3_initf(0.15f);
+      primitive.attributes.box_frame.edge_thickness = 0.02f;
+      fathom_sdf_scene_store_add(store, &primitive);
+    }
+
+    return "repeated";
+  }
+
+  for (i = 0; i < 8 * 16; ++i)
+  {
+    fathom_sdf_primitive primitive = {0};
+    u32 nest = i / 16;
+    u32 shell = i % 16;
+
+    primitive.primitive_id = FATHOM_SDF_PRIMITIVE_SPHERE;
+    primitive.material_id = (u8)(1 + nest % 4);
+    primitive.operation_id = (u8)(shell == 0 ? FATHOM_SDF_OPERATION_UNION : FATHOM_SDF_OPERATION_XOR);
+    primitive.transform.position = fathom_vec3_init(-2.7f + (f32)(nest % 4) * 1.8f, 1.0f, nest < 4 ? -1.5f : 1.5f);
+    primitive.attributes.sphere.radius = 0.8f - (f32)shell * 0.025f;
+    fathom_sdf_scene_store_add(store, &primitive);
+  }
+
+  return "thin_shells";
+}
+
+/* Queries the hierarchy at random points of the grid box and prints the primitives a query evaluates, the queries
+ * that fell back to the store order and the distances or materials that differ from fathom_sdf_scene.
+ * scene_name is printed with the results.
+ */
+FATHOM_API void linux_benchmark_grid_bvh(fathom_platform_api *api, fathom_sdf_bvh_tree *bvh, s8 *scene_name)
+{
+  fathom_sdf_bvh_query_stats stats = {0};
+  s8 buffer[256];
+  fathom_sb t = {0};
+  u32 mismatches = 0;
+  u32 seed = 3;
+  u32 i;
+
+  t.size = sizeof(buffer);
+  t.buffer = buffer;
+
+  for (i = 0; i < LINUX_BENCHMARK_GRID_BVH_POINTS; ++i)
+  {
+    fathom_vec3 position;
+    fathom_grid_data bvh_data;
+    fathom_grid_data scene_data;
+
+    position.x = (linux_benchmark_random(&seed) - 0.5f) * LINUX_BENCHMARK_GRID_EXTENT;
+    position.y = 1.5f + (linux_benchmark_random(&seed) - 0.5f) * LINUX_BENCHMARK_GRID_EXTENT;
+    position.z = (linux_benchmark_random(&seed) - 0.5f) * LINUX_BENCHMARK_GRID_EXTENT;
+
+    bvh_data = fathom_sdf_bvh_evaluate(bvh, position, &stats);
+    scene_data = fathom_sdf_scene(position, bvh->scene);
+
+    mismatches += bvh_data.distance != scene_data.distance || bvh_data.material != scene_data.material;
+  }
+
+  fathom_sb_s8(&t, "[benchmark] grid ");
+  fathom_sb_s8_pad(&t, scene_name, 12, ' ', FATHOM_SB_PAD_RIGHT);
+  fathom_sb_s8(&t, " bvh: ");
+  fathom_sb_f64(&t, (f64)stats.primitives / (f64)LINUX_BENCHMARK_GRID_BVH_POINTS, 1);
+  fathom_sb_s8(&t, " of ");
+  fathom_sb_i32(&t, (i32)bvh->primitive_count);
+  fathom_sb_s8(&t, " primitives/query (");
+  fathom_sb_i32(&t, (i32)bvh->primitive_first);
+  fathom_sb_s8(&t, " before the tree) fallbacks ");
+  fathom_sb_i32(&t, (i32)stats.fallbacks);
+  fathom_sb_s8(&t, " mismatches ");
+  fathom_sb_i32(&t, (i32)mismatches);
+  fathom_sb_s8(&t, "\n");
+  api->io_print(t.buffer);
+}
+
+FATHOM_API u8 linux_benchmark_grid(fathom_platform_api *api, u32 max_cells, s8 *filename, u8 bvh_enabled)
+{
+  static s8 csv_buffer[32768];
+  static fathom_sparse_grid grid;
+  fathom_sdf_scene_store store;
+  fathom_sdf_bvh_tree bvh;
+  fathom_sb csv = {0};
+  u32 scene;
+  u8 written;
+
+  csv.size = sizeof(csv_buffer);
+  csv.buffer = csv_buffer;
+
+  fathom_sdf_scene_store_initialize(&store, LINUX_BENCHMARK_GRID_CAPACITY);
+  store.arena_data = linux_memory_alloc(store.arena_bytes);
+
+  fathom_sdf_bvh_initialize(&bvh, &store);
+  bvh.node_data = bvh_enabled ? (fathom_sdf_bvh_node *)linux_memory_alloc(bvh.node_bytes) : FATHOM_NULL;
+  bvh.index_data = bvh_enabled ? (u32 *)linux_memory_alloc(bvh.index_bytes) : FATHOM_NULL;
+  bvh.bound_data = bvh_enabled ? (fathom_sdf_bvh_bound *)linux_memory_alloc(bvh.bound_bytes) : FATHOM_NULL;
+
+  fathom_sb_s8(&csv, "revision,scene,distance,primitives,cells,workers,pass,fits,ms,sdf_evaluations,active_bricks,atlas_kib,voxels,mvoxels_per_second\n");
+
+  for (scene = 0; scene < LINUX_BENCHMARK_GRID_SCENES; ++scene)
+  {
+    s8 *scene_name = linux_benchmark_grid_scene(&store, scene);
+    fathom_grid_distance distance = linux_scene_distance(&store);
+    u32 cells;
+
+    if (bvh_enabled)
+    {
+      u32 i;
+
+      fathom_sdf_bvh_build(&bvh);
+      linux_benchmark_grid_bvh(api, &bvh, scene_name);
+
+      /* Edits: the first primitives move to the end of the store, the rebuilt hierarchy has to match the new order */
+      for (i = 0; i < LINUX_BENCHMARK_GRID_BVH_EDITS && i < store.primitive_count; ++i)
+      {
+        fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(&store, 0);
+
+        fathom_sdf_scene_store_remove(&store, store.index_handle[0]);
+        fathom_sdf_scene_store_add(&store, &primitive);
+      }
+
+      fathom_sdf_bvh_build(&bvh);
+      linux_benchmark_grid_bvh(api, &bvh, "  edited");
+
+      /* The passes build the scene as generated */
+      linux_benchmark_grid_scene(&store, scene);
+      fathom_sdf_bvh_build(&bvh);
+      distance = fathom_sdf_bvh_distance(&bvh);
+    }
+
+    for (cells = LINUX_BENCHMARK_GRID_CELLS_MIN; cells <= max_cells; cells *= 2)
+    {
+      f64 pass_ms[3] = {0};
+      f64 evaluations[3];
+      f64 voxels[3];
+      u32 top_blocks;
+      u32 pass;
+      u8 fits;
+
+      if (!fathom_sparse_grid_initialize(&grid, fathom_vec3_init(0.0f, 1.5f, 0.0f), cells, LINUX_BENCHMARK_GRID_EXTENT / (f32)cells, FATHOM_SPARSE_GRID_INDEX_AUTO))
+      {
+        api->io_print("[ERROR] Benchmark grid resolution is not supported\n");
+        break;
+      }
+
+      fits = linux_create_grid(api, &grid, &distance, pass_ms);
+
+      /* sdf_calls_pass_01 starts with the block centers of pass 0 */
+      top_blocks = grid.brick_map_top_dimensions * grid.brick_map_top_dimensions * grid.brick_map_top_dimensions;
+      evaluations[0] = (f64)top_blocks;
+      evaluations[1] = (f64)(grid.sdf_calls_pass_01 - top_blocks);
+      evaluations[2] = fits ? (f64)grid.sdf_calls_pass_02 : 0.0;
+      voxels[0] = (f64)cells * (f64)cells * (f64)cells;
+      voxels[1] = voxels[0];
+      voxels[2] = fits ? (f64)grid.brick_map_active_bricks_count * (f64)FATHOM_BRICK_TOTAL_VOXELS : 0.0;
+
+      for (pass = 0; pass < (fits ? 3u : 2u); ++pass)
+      {
+        s8 buffer[256];
+        fathom_sb t = {0};
+        f64 voxels_per_second = pass_ms[pass] > 0.0 ? voxels[pass] * 1000.0 / pass_ms[pass] : 0.0;
+
+        t.size = sizeof(buffer);
+        t.buffer = buffer;
+
+        fathom_sb_s8(&t, "[benchmark] grid ");
+        fathom_sb_s8_pad(&t, scene_name, 12, ' ', FATHOM_SB_PAD_RIGHT);
+        fathom_sb_i32_pad(&t, (i32)cells, 5, ' ', FATHOM_SB_PAD_LEFT);
+        fathom_sb_s8(&t, "^3 pass ");
+        fathom_sb_i32(&t, (i32)pass);
+        fathom_sb_s8(&t, ": ");
+        fathom_sb_f64_pad(&t, pass_ms[pass], 3, 10, ' ', FATHOM_SB_PAD_LEFT);
+        fathom_sb_s8(&t, " ms ");
+        fathom_sb_f64_pad(&t, evaluations[pass], 0, 11, ' ', FATHOM_SB_PAD_LEFT);
+        fathom_sb_s8(&t, " evaluations ");
+        fathom_sb_i32_pad(&t, (i32)grid.brick_map_active_bricks_count, 8, ' ', FATHOM_SB_PAD_LEFT);
+        fathom_sb_s8(&t, " bricks ");
+        fathom_sb_f64_pad(&t, (f64)grid.atlas_bytes / 1024.0 / 1024.0, 2, 8, ' ', FATHOM_SB_PAD_LEFT);
+        fathom_sb_s8(&t, " atlas MB ");
+        fathom_sb_f64_pad(&t, voxels_per_second / 1000000.0, 2, 9, ' ', FATHOM_SB_PAD_LEFT);
+        fathom_sb_s8(&t, " Mvoxels/s\n");
+        api->io_print(t.buffer);
+
+        fathom_sb_s8(&csv, LINUX_BENCHMARK_REVISION);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_s8(&csv, scene_name);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_s8(&csv, bvh_enabled ? "bvh" : "scene");
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)store.primitive_count);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)cells);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)api->job_system->worker_count);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)pass);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)fits);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_f64(&csv, pass_ms[pass], 4);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_f64(&csv, evaluations[pass], 0);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)grid.brick_map_active_bricks_count);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_i32(&csv, (i32)(grid.atlas_bytes / 1024));
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_f64(&csv, voxels[pass], 0);
+        fathom_sb_s8(&csv, ",");
+        fathom_sb_f64(&csv, voxels_per_second / 1000000.0, 3);
+        fathom_sb_s8(&csv, "\n");
+      }
+
+      linux_destroy_grid(&grid);
+    }
+  }
+
+  linux_memory_free(bvh.node_data);
+  linux_memory_free(bvh.index_data);
+  linux_memory_free(bvh.bound_data);
+  linux_memory_free(store.arena_data);
+
+  written = linux_file_write(filename, (u8 *)csv.buffer, csv.length);
+  api->io_print(written ? "[benchmark] grid results written to " : "[ERROR] Could not write the grid benchmark results to ");
+  api->io_print(filename);
+  api->io_print("\n");
+
+  return written;
+}
+
+/* #############################################################################
+ * # [SECTION] Traversal Benchmark
+ * #############################################################################
+ *
+ * Runs the traversal of fathom.fs, the C ports of the prototype shaders (see fathom_raymarch.h)
+ * and the brick DDA of fathom_sparse_grid_trace over the same grid of the default scene and the
+ * same primary rays of four views around it. Every variant reports the rays per second on one
+ * thread, the brick map reads and atlas samples per ray, how often it ran out of iterations and
+ * how many rays disagree with fathom.fs (hit against miss, or hits more than a cell apart).
+ * fathom_sparse_grid_trace samples the atlas at its lattice points, half a voxel from where the
+ * texture coordinates of the shader land, so many of its hits differ by more than a cell.
+ * The time to flatten the brick map into the textures the shader samples (what every full upload
+ * of the win32 platform does) is reported before.
+ */
+#define LINUX_BENCHMARK_TRAVERSAL_FILE "fathom_benchmark_traversal.csv"
+#define LINUX_BENCHMARK_TRAVERSAL_CELLS 256
+#define LINUX_BENCHMARK_TRAVERSAL_VIEWS 4
+#define LINUX_BENCHMARK_TRAVERSAL_WIDTH 320
+#define LINUX_BENCHMARK_TRAVERSAL_HEIGHT 180
+
+/* fathom_raymarch_traversal_run with fathom_sparse_grid_trace through grid, which has no iteration limits to count */
+FATHOM_API void linux_benchmark_traversal_trace(fathom_raymarch *raymarch, fathom_sparse_grid *grid, f32 *t_hit, fathom_raymarch_stats *stats)
+{
+  static fathom_sparse_grid_trace_stats trace_stats;
+  u32 x, y;
+
+  fathom_sparse_grid_trace_stats_reset(&trace_stats);
+
+  for (y = 0; y < raymarch->height; ++y)
+  {
+    for (x = 0; x < raymarch->width; ++x)
+    {
+      fathom_raymarch_ray ray;
+
+      fathom_raymarch_ray_initialize(raymarch, &ray, (f32)x + 0.5f, (f32)y + 0.5f);
+
+      *t_hit++ = fathom_sparse_grid_trace(grid, fathom_vec3_init(ray.origin[0], ray.origin[1], ray.origin[2]),
+                                          fathom_vec3_init(ray.direction[0], ray.direction[1], ray.direction[2]), &trace_stats);
+    }
+  }
+
+  stats->rays += trace_stats.rays;
+  stats->hits += trace_stats.hits;
+  stats->bricks += trace_stats.bricks;
+  stats->samples += trace_stats.samples;
+}
+
+/* Flattens the whole brick map of grid slice by slice as the uploads of the win32 platform do, returns the milliseconds */
+FATHOM_API f64 linux_benchmark_traversal_flatten(fathom_sparse_grid *grid, void *slice)
+{
+  fathom_sparse_grid_region box;
+  f64 time_start = fathom_profiler_time_ms();
+  u32 z;
+
+  box.brick_min[0] = box.brick_min[1] = box.brick_min[2] = 0;
+  box.brick_max[0] = box.brick_max[1] = box.brick_max[2] = grid->brick_map_dimensions;
+
+  for (z = 0; z < grid->brick_map_dimensions; ++z)
+  {
+    fathom_sparse_grid_brick_map_flatten(grid, &box, z, slice);
+  }
+
+  for (z = 0; z < grid->brick_map_top_dimensions; ++z)
+  {
+    fathom_sparse_grid_brick_map_flatten_blocks(grid, z, (u8 *)slice);
+  }
+
+  return fathom_profiler_time_ms() - time_start;
+}
+
+FATHOM_API u8 linux_benchmark_traversal(fathom_platform_api *api, u32 cells, s8 *filename)
+{
+  static s8 csv_buffer[4096];
+  static fathom_clipmap clipmap;
+  static fathom_raymarch raymarch;
+  u32 view_rays = LINUX_BENCHMARK_TRAVERSAL_WIDTH * LINUX_BENCHMARK_TRAVERSAL_HEIGHT;
+  fathom_vec3 world_up = fathom_vec3_init(0.0f, 1.0f, 0.0f);
+  fathom_sdf_scene_store store;
+  fathom_grid_distance distance = linux_scene_distance(&store);
+  fathom_sb csv = {0};
+  fathom_sparse_grid *grid = &clipmap.levels[0];
+  f32 *t_hit;
+  f32 *t_hit_reference;
+  void *slice;
+  u32 variant;
+  u8 written;
+
+  csv.size = sizeof(csv_buffer);
+  csv.buffer = csv_buffer;
+
+  fathom_sdf_scene_store_initialize(&store, LINUX_SESSION_SCENE_CAPACITY);
+  store.arena_data = linux_memory_alloc(store.arena_bytes);
+  fathom_sdf_scene_store_clear(&store);
+  fathom_sdf_scene_build(&store);
+
+  /* One level: the prototypes trace a single grid */
+  if (!fathom_clipmap_initialize(&clipmap, 1, cells, LINUX_BENCHMARK_GRID_EXTENT / (f32)cells, FATHOM_SPARSE_GRID_INDEX_AUTO, 2048) ||
+      !fathom_clipmap_level_initialize(&clipmap, 0, fathom_vec3_init(0.0f, 1.5f, 0.0f)))
+  {
+    api->io_print("[ERROR] Benchmark grid resolution is not supported\n");
+    return 0;
+  }
+
+  if (!linux_create_grid(api, grid, &distance, FATHOM_NULL))
+  {
+    return 0;
+  }
+
+  /* One storage slice of u16 or u32 entries, the block slices are smaller */
+  slice = linux_memory_alloc(grid->brick_map_dimensions * grid->brick_map_dimensions * grid->brick_map_index_bytes);
+
+  if (slice)
+  {
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 ms = linux_benchmark_traversal_flatten(grid, slice);
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    fathom_sb_s8(&t, "[benchmark] traversal brick map upload: ");
+    fathom_sb_i32(&t, (i32)grid->brick_map_dimensions);
+    fathom_sb_s8(&t, "^3 entries and ");
+    fathom_sb_i32(&t, (i32)grid->brick_map_top_dimensions);
+    fathom_sb_s8(&t, "^3 blocks flattened in ");
+    fathom_sb_f64(&t, ms, 3);
+    fathom_sb_s8(&t, " ms\n");
+    api->io_print(t.buffer);
+
+    linux_memory_free(slice);
+  }
+
+  fathom_raymarch_initialize(&raymarch, &clipmap, FATHOM_NULL, LINUX_BENCHMARK_TRAVERSAL_WIDTH, LINUX_BENCHMARK_TRAVERSAL_HEIGHT);
+  fathom_raymarch_levels_update(&raymarch);
+
+  t_hit = (f32 *)linux_memory_alloc(LINUX_BENCHMARK_TRAVERSAL_VIEWS * view_rays * sizeof(f32));
+  t_hit_reference = (f32 *)linux_memory_alloc(LINUX_BENCHMARK_TRAVERSAL_VIEWS * view_rays * sizeof(f32));
+
+  fathom_sb_s8(&csv, "revision,variant,cells,rays,ms,mrays_per_second,hits,bricks_per_ray,samples_per_ray,brick_limits_per_ray,sphere_limits_per_ray,disagreements\n");
+
+  /* The last variant is fathom_sparse_grid_trace */
+  for (variant = 0; variant <= FATHOM_RAYMARCH_TRAVERSAL_COUNT; ++variant)
+  {
+    fathom_raymarch_stats stats;
+    s8 *name = variant < FATHOM_RAYMARCH_TRAVERSAL_COUNT ? fathom_raymarch_traversal_names[variant] : "sparse_grid_trace";
+    s8 buffer[256];
+    fathom_sb t = {0};
+    u32 disagreements;
+    u32 view;
+    f64 time_start;
+    f64 ms;
+    f64 rays;
+
+    fathom_raymarch_stats_reset(&stats);
+    time_start = fathom_profiler_time_ms();
+
+    for (view = 0; view < LINUX_BENCHMARK_TRAVERSAL_VIEWS; ++view)
+    {
+      f32 camera_angle = (f32)view * 1.5707963f + 0.4f;
+      fathom_vec3 camera_position = fathom_vec3_init(fathom_sinf(camera_angle) * 3.5f, 1.5f, fathom_cosf(camera_angle) * 3.5f);
+      fathom_vec3 camera_forward = fathom_vec3_normalize(fathom_vec3_sub(fathom_vec3_zero, camera_position));
+      fathom_vec3 camera_right = fathom_vec3_normalize(fathom_vec3_cross(camera_forward, world_up));
+
+      raymarch.camera.position = camera_position;
+      raymarch.camera.right = camera_right;
+      raymarch.camera.up = fathom_vec3_normalize(fathom_vec3_cross(camera_right, camera_forward));
+      raymarch.camera.forward_scaled = fathom_vec3_mulf(camera_forward, 1.5f);
+
+      if (variant < FATHOM_RAYMARCH_TRAVERSAL_COUNT)
+      {
+        fathom_raymarch_traversal_run(&raymarch, fathom_raymarch_traversals[variant], (variant ? t_hit : t_hit_reference) + (view * view_rays), &stats);
+      }
+      else
+      {
+        linux_benchmark_traversal_trace(&raymarch, grid, t_hit + (view * view_rays), &stats);
+      }
+    }
+
+    ms = fathom_profiler_time_ms() - time_start;
+    rays = (f64)stats.rays;
+    disagreements = variant ? fathom_raymarch_traversal_disagreements(t_hit, t_hit_reference, LINUX_BENCHMARK_TRAVERSAL_VIEWS * view_rays, grid->cell_size) : 0;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    fathom_sb_s8(&t, "[benchmark] traversal ");
+    fathom_sb_s8_pad(&t, name, 16, ' ', FATHOM_SB_PAD_RIGHT);
+    fathom_sb_f64_pad(&t, ms > 0.0 ? rays / (ms * 1000.0) : 0.0, 3, 7, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " Mrays/s ");
+    fathom_sb_i32_pad(&t, (i32)stats.hits, 7, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " hits ");
+    fathom_sb_f64_pad(&t, (f64)stats.bricks / rays, 2, 7, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " bricks/ray ");
+    fathom_sb_f64_pad(&t, (f64)stats.samples / rays, 2, 7, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " samples/ray ");
+    fathom_sb_f64_pad(&t, (f64)stats.brick_limits / rays, 4, 7, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " brick limits/ray ");
+    fathom_sb_f64_pad(&t, (f64)stats.sphere_limits / rays, 4, 7, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " sphere limits/ray ");
+    fathom_sb_i32_pad(&t, (i32)disagreements, 6, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " disagreements\n");
+    api->io_print(t.buffer);
+
+    fathom_sb_s8(&csv, LINUX_BENCHMARK_REVISION);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_s8(&csv, name);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_i32(&csv, (i32)cells);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_i32(&csv, (i32)stats.rays);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_f64(&csv, ms, 4);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_f64(&csv, ms > 0.0 ? rays / (ms * 1000.0) : 0.0, 4);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_i32(&csv, (i32)stats.hits);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_f64(&csv, (f64)stats.bricks / rays, 4);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_f64(&csv, (f64)stats.samples / rays, 4);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_f64(&csv, (f64)stats.brick_limits / rays, 6);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_f64(&csv, (f64)stats.sphere_limits / rays, 6);
+    fathom_sb_s8(&csv, ",");
+    fathom_sb_i32(&csv, (i32)disagreements);
+    fathom_sb_s8(&csv, "\n");
+  }
+
+  linux_memory_free(t_hit);
+  linux_memory_free(t_hit_reference);
+  linux_destroy_grid(grid);
+  linux_memory_free(store.arena_data);
+
+  written = linux_file_write(filename, (u8 *)csv.buffer, csv.length);
+  api->io_print(written ? "[benchmark] traversal results written to " : "[ERROR] Could not write the traversal benchmark results to ");
+  api->io_print(filename);
+  api->io_print("\n");
+
+  return written;
+}
+
+/* #############################################################################
+ * # [SECTION] SDF JIT Benchmark
+ * #############################################################################
+ *
+ * Evaluates the default scene and the grid stress scenes at random points of the grid box: with the
+ * scene functions (point and batch), with the program on the VM and with its code from fathom_sdf_jit.h.
+ * Every variant reports the time per point and how many distances and materials differ from the
+ * scene batch, then which of the code and the scene batch fathom_sdf_jit_faster picks for the scene
+ * (single points always run on the interpreter). The hand written scene of fathom_sdf_scene_original
+ * and its program follow. The JIT has to match the VM bit for bit, so the System V entry of its code
+ * is checked here (win32 only runs the Microsoft x64 one).
+ */
+#define LINUX_BENCHMARK_JIT_FILE "fathom_benchmark_jit.csv"
+#define LINUX_BENCHMARK_JIT_POINTS (1 << 20)
+#define LINUX_BENCHMARK_JIT_METHODS 6
+#define LINUX_BENCHMARK_JIT_ROW 64
+
+/* The hand written scene (fathom_sdf_scene_original) against its program from fathom_sdf_scene_original_compile
+ * on the VM and in code, rows of the CSV as for the stores. Only the distances follow fathom_sdf_scene_original,
+ * the materials of the program follow the rule of the VM: they are compared with the interpreter.
+ */
+FATHOM_API void linux_benchmark_jit_original(fathom_platform_api *api, fathom_sb *csv, f32 *x, f32 *y, f32 *z, u32 points, f32 *reference, u8 *reference_materials, f32 *distances, u8 *materials)
+{
+  static fathom_sdf_vm_program program;
+  static fathom_sdf_jit_program jit;
+  static u8 *code;
+  s8 *names[3] = {"original", "vm", "jit x8"};
+  u32 method;
+  u8 native;
+
+  if (!fathom_sdf_scene_original_compile(&program))
+  {
+    api->io_print("[benchmark] jit original: program does not fit, skipped\n");
+    return;
+  }
+
+  native = linux_jit_compile(&jit, &program, &code);
+
+  for (method = 0; method < 3; ++method)
+  {
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 time_start;
+    f64 ns_per_point;
+    f32 max_error = 0.0f;
+    u32 distance_mismatches = 0;
+    u32 material_mismatches = 0;
+    u32 i;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    time_start = fathom_profiler_time_ms();
+
+    for (i = 0; i < points; i += LINUX_BENCHMARK_JIT_ROW)
+    {
+      u32 count = points - i < LINUX_BENCHMARK_JIT_ROW ? points - i : LINUX_BENCHMARK_JIT_ROW;
+      u32 j;
+
+      if (method == 2)
+      {
+        fathom_sdf_jit_batch(x + i, y + i, z + i, count, distances + i, materials + i, &jit);
+        continue;
+      }
+
+      for (j = i; j < i + count; ++j)
+      {
+        fathom_vec3 position = fathom_vec3_init(x[j], y[j], z[j]);
+        fathom_grid_data data = method == 0 ? fathom_sdf_scene_original(position, FATHOM_NULL) : fathom_sdf_vm(position, &program);
+
+        distances[j] = data.distance;
+        materials[j] = data.material;
+      }
+    }
+
+    ns_per_point = (fathom_profiler_time_ms() - time_start) * 1000000.0 / (f64)points;
+
+    for (i = 0; i < points; ++i)
+    {
+      if (method == 0)
+      {
+        reference[i] = distances[i];
+        continue;
+      }
+
+      if (distances[i] != reference[i])
+      {
+        f32 error = fathom_absf(distances[i] - reference[i]);
+        max_error = error > max_error ? error : max_error;
+        ++distance_mismatches;
+      }
+
+      if (method == 1)
+      {
+        reference_materials[i] = materials[i];
+      }
+
+      material_mismatches += materials[i] != reference_materials[i];
+    }
+
+    fathom_sb_s8(&t, "[benchmark] jit ");
+    fathom_sb_s8_pad(&t, "original", 12, ' ', FATHOM_SB_PAD_RIGHT);
+    fathom_sb_s8_pad(&t, names[method], 12, ' ', FATHOM_SB_PAD_RIGHT);
+    fathom_sb_f64_pad(&t, ns_per_point, 2, 9, ' ', FATHOM_SB_PAD_LEFT);
+    fathom_sb_s8(&t, " ns/point mismatches ");
+    fathom_sb_i32(&t, (i32)distance_mismatches);
+    fathom_sb_s8(&t, " / ");
+    fathom_sb_i32(&t, (i32)material_mismatches);
+    fathom_sb_s8(&t, " max error ");
+    fathom_sb_f64(&t, (f64)max_error, 6);
+    fathom_sb_s8(&t, method == 2 && !native ? " (interpreter)\n" : "\n");
+    api->io_print(t.buffer);
+
+    fathom_sb_s8(csv, LINUX_BENCHMARK_REVISION);
+    fathom_sb_s8(csv, ",original,0,");
+    fathom_sb_i32(csv, (i32)program.instruction_count);
+    fathom_sb_s8(csv, ",");
+    fathom_sb_i32(csv, (i32)native);
+    fathom_sb_s8(csv, ",0,");
+    fathom_sb_s8(csv, names[method]);
+    fathom_sb_s8(csv, ",");
+    fathom_sb_i32(csv, (i32)points);
+    fathom_sb_s8(csv, ",");
+    fathom_sb_f64(csv, ns_per_point, 3);
+    fathom_sb_s8(csv, ",");
+    fathom_sb_i32(csv, (i32)distance_mismatches);
+    fathom_sb_s8(csv, ",");
+    fathom_sb_i32(csv, (i32)material_mismatches);
+    fathom_sb_s8(csv, ",");
+    fathom_sb_f64(csv, (f64)max_error, 6);
+    fathom_sb_s8(csv, "\n");
+  }
+}
+
+FATHOM_API u8 linux_benchmark_jit(fathom_platform_api *api, u32 points, s8 *filename)
+{
+  static s8 csv_buffer[8192];
+  static fathom_sdf_vm_program program;
+  static fathom_sdf_jit_program jit;
+  static u8 *code;
+  s8 *names[LINUX_BENCHMARK_JIT_METHODS] = {"scene batch", "scene", "vm", "jit", "vm x8", "jit x8"};
+  fathom_sdf_scene_store store;
+  fathom_sb csv = {0};
+  f32 *x = (f32 *)linux_memory_alloc(points * 4);
+  f32 *y = (f32 *)linux_memory_alloc(points * 4);
+  f32 *z = (f32 *)linux_memory_alloc(points * 4);
+  f32 *reference = (f32 *)linux_memory_alloc(points * 4);
+  f32 *distances = (f32 *)linux_memory_alloc(points * 4);
+  u8 *reference_materials = (u8 *)linux_memory_alloc(points);
+  u8 *materials = (u8 *)linux_memory_alloc(points);
+  u32 scene;
+  u8 written;
+
+  csv.size = sizeof(csv_buffer);
+  csv.buffer = csv_buffer;
+
+  fathom_sdf_scene_store_initialize(&store, LINUX_BENCHMARK_GRID_CAPACITY);
+  store.arena_data = linux_memory_alloc(store.arena_bytes);
+
+  if (!x || !y || !z || !reference || !distances || !reference_materials || !materials || !store.arena_data)
+  {
+    api->io_print("[ERROR] Could not allocate the jit benchmark points\n");
+    return 0;
+  }
+
+  fathom_sb_s8(&csv, "revision,scene,primitives,instructions,native,faster,method,points,ns_per_point,distance_mismatches,material_mismatches,max_error\n");
+
+  /* Scene 0 is the default scene, the others the grid stress scenes */
+  for (scene = 0; scene <= LINUX_BENCHMARK_GRID_SCENES; ++scene)
+  {
+    s8 *scene_name = "default";
+    u32 seed = 7;
+    u32 method;
+    u8 native;
+    u8 faster;
+    u32 i;
+
+    if (scene == 0)
+    {
+      fathom_sdf_scene_store_clear(&store);
+      fathom_sdf_scene_build(&store);
+    }
+    else
+    {
+      scene_name = linux_benchmark_grid_scene(&store, scene - 1);
+    }
+
+    if (!fathom_sdf_scene_compile(&program, &store))
+    {
+      api->io_print("[benchmark] jit ");
+      api->io_print(scene_name);
+      api->io_print(": program does not fit, skipped\n");
+      continue;
+    }
+
+    native = linux_jit_compile(&jit, &program, &code);
+    faster = fathom_sdf_jit_faster(&jit, fathom_sdf_scene_batch, &store, &store.bounds);
+
+    /* The box of the grid benchmark, y from -2.5 to 5.5 around its center */
+    for (i = 0; i < points; ++i)
+    {
+      x[i] = (linux_benchmark_random(&seed) - 0.5f) * LINUX_BENCHMARK_GRID_EXTENT;
+      y[i] = 1.5f + (linux_benchmark_random(&seed) - 0.5f) * LINUX_BENCHMARK_GRID_EXTENT;
+      z[i] = (linux_benchmark_random(&seed) - 0.5f) * LINUX_BENCHMARK_GRID_EXTENT;
+    }
+
+    for (method = 0; method < LINUX_BENCHMARK_JIT_METHODS; ++method)
+    {
+      s8 buffer[256];
+      fathom_sb t = {0};
+      f64 time_start;
+      f64 ns_per_point;
+      f32 max_error = 0.0f;
+      u32 distance_mismatches = 0;
+      u32 material_mismatches = 0;
+
+      t.size = sizeof(buffer);
+      t.buffer = buffer;
+
+      time_start = fathom_profiler_time_ms();
+
+      /* Rows of the length the grid passes hand to the batch functions */
+      for (i = 0; i < points; i += LINUX_BENCHMARK_JIT_ROW)
+      {
+        u32 count = points - i < LINUX_BENCHMARK_JIT_ROW ? points - i : LINUX_BENCHMARK_JIT_ROW;
+        u32 j;
+
+        switch (method)
+        {
+        case 0:
+          fathom_sdf_scene_batch(x + i, y + i, z + i, count, distances + i, materials + i, &store);
+          break;
+        case 1:
+        case 2:
+        case 3:
+          for (j = i; j < i + count; ++j)
+          {
+            fathom_vec3 position = fathom_vec3_init(x[j], y[j], z[j]);
+            fathom_grid_data data = method == 1 ? fathom_sdf_scene(position, &store) : (method == 2 ? fathom_sdf_vm(position, &program) : fathom_sdf_jit(position, &jit));
+
+            distances[j] = data.distance;
+            materials[j] = data.material;
+          }
+          break;
+        case 4:
+          fathom_sdf_vm_batch(x + i, y + i, z + i, count, distances + i, materials + i, &program);
+          break;
+        default:
+          fathom_sdf_jit_batch(x + i, y + i, z + i, count, distances + i, materials + i, &jit);
+          break;
+        }
+      }
+
+      ns_per_point = (fathom_profiler_time_ms() - time_start) * 1000000.0 / (f64)points;
+
+      for (i = 0; i < points; ++i)
+      {
+        if (method == 0)
+        {
+          reference[i] = distances[i];
+          reference_materials[i] = materials[i];
+          continue;
+        }
+
+        if (distances[i] != reference[i])
+        {
+          f32 error = fathom_absf(distances[i] - reference[i]);
+          max_error = error > max_error ? error : max_error;
+          ++distance_mismatches;
+        }
+
+        material_mismatches += materials[i] != reference_materials[i];
+      }
+
+      fathom_sb_s8(&t, "[benchmark] jit ");
+      fathom_sb_s8_pad(&t, scene_name, 12, ' ', FATHOM_SB_PAD_RIGHT);
+      fathom_sb_s8_pad(&t, names[method], 12, ' ', FATHOM_SB_PAD_RIGHT);
+      fathom_sb_f64_pad(&t, ns_per_point, 2, 9, ' ', FATHOM_SB_PAD_LEFT);
+      fathom_sb_s8(&t, " ns/point mismatches ");
+      fathom_sb_i32(&t, (i32)distance_mismatches);
+      fathom_sb_s8(&t, " / ");
+      fathom_sb_i32(&t, (i32)material_mismatches);
+      fathom_sb_s8(&t, " max error ");
+      fathom_sb_f64(&t, (f64)max_error, 6);
+      fathom_sb_s8(&t, method == 3 || (method == 5 && !native) ? " (interpreter)\n" : "\n");
+      api->io_print(t.buffer);
+
+      fathom_sb_s8(&csv, LINUX_BENCHMARK_REVISION);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_s8(&csv, scene_name);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)store.primitive_count);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)program.instruction_count);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)native);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)faster);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_s8(&csv, names[method]);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)points);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_f64(&csv, ns_per_point, 3);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)distance_mismatches);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_i32(&csv, (i32)material_mismatches);
+      fathom_sb_s8(&csv, ",");
+      fathom_sb_f64(&csv, (f64)max_error, 6);
+      fathom_sb_s8(&csv, "\n");
+    }
+
+    api->io_print("[benchmark] jit ");
+    api->io_print(scene_name);
+    api->io_print(faster ? ": fathom_sdf_jit_faster picks the code\n" : ": fathom_sdf_jit_faster picks the scene batch\n");
+  }
+
+  /* The points of the last scene */
+  linux_benchmark_jit_original(api, &csv, x, y, z, points, reference, reference_materials, distances, materials);
+
+  linux_memory_free(store.arena_data);
+  linux_memory_free(x);
+  linux_memory_free(y);
+  linux_memory_free(z);
+  linux_memory_free(reference);
+  linux_memory_free(distances);
+  linux_memory_free(reference_materials);
+  linux_memory_free(materials);
+
+  written = linux_file_write(filename, (u8 *)csv.buffer, csv.length);
+  api->io_print(written ? "[benchmark] jit results written to " : "[ERROR] Could not write the jit benchmark results to ");
+  api->io_print(filename);
+  api->io_print("\n");
+
+  return written;
+}
+
+/* #############################################################################
+ * # [SECTION] Main
+ * #############################################################################
+ */
+/* Leading decimal digits of s, 0 if there are none */
+FATHOM_API u32 linux_parse_u32(u8 *s)
+{
+  u32 value = 0;
+
+  while (*s >= '0' && *s <= '9')
+  {
+    value = (value * 10) + (u32)(*s++ - '0');
+  }
+
+  return value;
+}
+
+FATHOM_API i32 start(i32 argc, u8 **argv)
+{
+  static fathom_job_system job_system;
+  fathom_platform_api api = {0};
+  fathom_platform_window window = {0};
+  fathom_platform_input input = {0};
+  u8 result = 1;
+
+  api.io_print = linux_print;
+  api.io_file_size = linux_file_size;
+  api.io_file_read = linux_file_read;
+  api.processor_count = linux_processor_count;
+  api.thread_create = linux_thread_create;
+  api.thread_sleep = linux_thread_sleep;
+
+  fathom_job_system_initialize(&job_system, api.processor_count(), api.thread_create, api.thread_sleep);
+  api.job_system = &job_system;
+
+  /* linux_fathom grid [max cells] [results file] [bvh]: the grid build benchmark instead of the session */
+  if (argc > 1 && fathom_profiler_string_equals((s8 *)argv[1], "grid"))
+  {
+    u32 max_cells = argc > 2 ? linux_parse_u32(argv[2]) : 0;
+    s8 *filename = argc > 3 ? (s8 *)argv[3] : LINUX_BENCHMARK_GRID_FILE;
+    u8 bvh_enabled = argc > 4 && fathom_profiler_string_equals((s8 *)argv[4], "bvh");
+
+    result = linux_benchmark_grid(&api, max_cells > 0 ? max_cells : LINUX_BENCHMARK_GRID_CELLS_MAX, filename, bvh_enabled);
+  }
+  else if (argc > 1 && fathom_profiler_string_equals((s8 *)argv[1], "traversal"))
+  {
+    /* linux_fathom traversal [cells] [results file]: the traversal benchmark of the shader variants */
+    u32 cells = argc > 2 ? linux_parse_u32(argv[2]) : 0;
+    s8 *filename = argc > 3 ? (s8 *)argv[3] : LINUX_BENCHMARK_TRAVERSAL_FILE;
+
+    result = linux_benchmark_traversal(&api, cells > 0 ? cells : LINUX_BENCHMARK_TRAVERSAL_CELLS, filename);
+  }
+  else if (argc > 1 && fathom_profiler_string_equals((s8 *)argv[1], "jit"))
+  {
+    /* linux_fathom jit [points] [results file]: the SDF JIT against the VM and the scene functions */
+    u32 points = argc > 2 ? linux_parse_u32(argv[2]) : 0;
+    s8 *filename = argc > 3 ? (s8 *)argv[3] : LINUX_BENCHMARK_JIT_FILE;
+
+    result = linux_benchmark_jit(&api, points > 0 ? points : LINUX_BENCHMARK_JIT_POINTS, filename);
+  }
+  else
+  {
+    /* linux_fathom [frames]: optional frame count of the session */
+    if (argc > 1 && linux_parse_u32(argv[1]) > 0)
+    {
+      linux_session_frame_count = linux_parse_u32(argv[1]);
+    }
+
+    /* The raymarcher renders at the window size */
+    window.window_width = 320;
+    window.window_height = 180;
+
+    fathom_update = linux_session_update;
+
+    while (fathom_update(&api, &window, &input))
+    {
+    }
+  }
+
+  fathom_job_system_shutdown(&job_system);
+
+  return result ? 0 : 1;
+}
+
+/* #############################################################################
+ * # [SECTION] nostdlib entry point
+ * #############################################################################
+ */
+
+/* The kernel enters with argc, argv and the environment on the stack, the stack is
+ * aligned to 16 bytes for the call into linux_start
+ */
+__asm__(
+    ".text\n"
+    ".globl _start\n"
+    "_start:\n"
+    "  xor %ebp, %ebp\n"
+    "  mov %rsp, %rdi\n"
+    "  and $-16, %rsp\n"
+    "  call linux_start\n"
+    "  hlt\n");
+
+#ifdef __clang__
+#elif __GNUC__
+__attribute((externally_visible))
+#endif
+void linux_start(long *stack)
+{
+  i32 argc = (i32)stack[0];
+  u8 **argv = (u8 **)(stack + 1);
+
+  /* Exit every thread of the process, the job system workers never return */
+  linux_syscall1(LINUX_SYS_EXIT_GROUP, start(argc, argv));
+}
+
+/*
+   ------------------------------------------------------------------------------
+   This software is available under 2 licenses -- choose whichever you prefer.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE A - MIT License
+   Copyright (c) 2026 nickscha
+   Permission is hereby granted, free of charge, to any person obtaining a copy of
+   this software and associated documentation files (the "Software"), to deal in
+   the Software without restriction, including without limitation the rights to
+   use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+   of the Software, and to permit persons to whom the Software is furnished to do
+   so, subject to the following conditions:
+   The above copyright notice and this permission notice shall be included in all
+   copies or substantial portions of the Software.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+   ------------------------------------------------------------------------------
+   ALTERNATIVE B - Public Domain (www.unlicense.org)
+   This is free and unencumbered software released into the public domain.
+   Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+   software, either in source code form or as a compiled binary, for any purpose,
+   commercial or non-commercial, and by any means.
+   In jurisdictions that recognize copyright laws, the author or authors of this
+   software dedicate any and all copyright interest in the software to the public
+   domain. We make this dedication for the benefit of the public at large and to
+   the detriment of our heirs and successors. We intend this dedication to be an
+   overt act of relinquishment in perpetuity of all present and future rights to
+   this software under copyright law.
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+   ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+   WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+   ------------------------------------------------------------------------------
+*/
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Compiles the headless benchmark without the C standard library
+
+PLATFORM_NAME=linux_fathom
+
+DEF_COMPILER_FLAGS="-march=native -mtune=native \
+-std=c89 -pedantic -nodefaultlibs -nostdlib -static -fno-pie -no-pie -fno-stack-protector \
+-fno-builtin -ffreestanding -fno-asynchronous-unwind-tables -fno-math-errno -fno-trapping-math \
+-Wall -Wextra -Werror -Wvla -Wconversion -Wdouble-promotion -Wsign-conversion \
+-Wmissing-field-initializers -Wuninitialized -Winit-self -Wunused -Wunused-macros -Wunused-local-typedefs"
+
+# Benchmark results name the revision they were measured at
+REVISION=$(git describe --always --dirty 2>/dev/null || echo unknown)
+
+cc -s -O2 $DEF_COMPILER_FLAGS "-DLINUX_BENCHMARK_REVISION=\"$REVISION\"" $PLATFORM_NAME.c -o $PLATFORM_NAME || exit 1
+./$PLATFORM_NAME "$@"
@@ -7,13 +7,17 @@ LICENSE
 
 */
 #include "fathom_types.h"
+#include "fathom.h"
 #include "fathom_font.h"
 #include "fathom_string_builder.h"
 #include "fathom_ui.h"
 #include "fathom_color.h"
 #include "fathom_profiler.h"
+#include "fathom_job.h"
 #include "fathom_opengl.h"
 #include "fathom_sdf_scene.h"
+#include "fathom_sdf_jit.h"
+#include "fathom_sdf_bvh.h"
 #include "win32_fathom_opengl.h"
 #include "win32_fathom_api.h"
 #include "win32_fathom_xinput.h"
@@ -142,6 +146,54 @@ FATHOM_API u8 *win32_file_read(s8 *filename, u32 *file_size_out)
   return buffer;
 }
 
+/* fathom_platform_api callbacks */
+FATHOM_API u8 win32_io_print(s8 *string)
+{
+  win32_print(string);
+  return 1;
+}
+
+FATHOM_API u8 win32_io_file_size(s8 *filename, u32 *file_size)
+{
+  void *hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  u32 size;
+
+  if (hFile == INVALID_HANDLE)
+  {
+    return 0;
+  }
+
+  size = GetFileSize(hFile, 0);
+  CloseHandle(hFile);
+
+  if (size == INVALID_FILE_SIZE)
+  {
+    return 0;
+  }
+
+  *file_size = size;
+
+  return 1;
+}
+
+/* Reads the file into buffer, at most buffer_size bytes */
+FATHOM_API u8 win32_io_file_read(s8 *filename, u8 *buffer, u32 buffer_size)
+{
+  void *hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+  u32 bytesRead = 0;
+  u8 result;
+
+  if (hFile == INVALID_HANDLE)
+  {
+    return 0;
+  }
+
+  result = ReadFile(hFile, buffer, buffer_size, &bytesRead, 0) ? 1 : 0;
+  CloseHandle(hFile);
+
+  return result;
+}
+
 FATHOM_API FATHOM_INLINE FILETIME win32_file_mod_time(s8 *file)
 {
   static FILETIME empty = {0, 0};
@@ -288,6 +340,73 @@ FATHOM_API i32 win32_process_thread_count(void)
   return count;
 }
 
+/* #############################################################################
+ * # [SECTION] WIN32 Threading (job system platform callbacks)
+ * #############################################################################
+ */
+typedef struct win32_thread_start
+{
+  fathom_job_thread_function function;
+  void *argument;
+
+} win32_thread_start;
+
+static win32_thread_start win32_thread_starts[FATHOM_JOB_MAX_WORKERS];
+static u32 win32_thread_starts_count;
+
+FATHOM_API u32 __stdcall win32_thread_proc(void *parameter)
+{
+  win32_thread_start *start = (win32_thread_start *)parameter;
+  return start->function(start->argument);
+}
+
+FATHOM_API u8 win32_thread_create(fathom_job_thread_function function, void *argument)
+{
+  win32_thread_start *start;
+  void *thread;
+
+  if (win32_thread_starts_count >= FATHOM_JOB_MAX_WORKERS)
+  {
+    return 0;
+  }
+
+  start = &win32_thread_starts[win32_thread_starts_count++];
+  start->function = function;
+  start->argument = argument;
+
+  /* Commit the whole stack like the main thread (see /STACK in the build script), we compile without stack probes */
+  thread = CreateThread(0, 0x100000, win32_thread_proc, start, 0, 0);
+
+  if (!thread)
+  {
+    win32_thread_starts_count--;
+    return 0;
+  }
+
+  CloseHandle(thread);
+
+  return 1;
+}
+
+FATHOM_API void win32_thread_sleep(u32 milliseconds)
+{
+  if (milliseconds == 0)
+  {
+    SwitchToThread();
+  }
+  else
+  {
+    Sleep(milliseconds);
+  }
+}
+
+FATHOM_API u32 win32_processor_count(void)
+{
+  SYSTEM_INFO info = {0};
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
 typedef struct win32_controller_state
 {
 
@@ -412,6 +531,15 @@ typedef struct win32_fathom_state
   u8 window_size_changed;
 
   u8 shader_paused;
+  u8 grid_animate;
+  u8 grid_jit_enabled;
+  u8 grid_jit_current;  /* fathom_grid_jit holds the scene as it is now */
+  u8 grid_jit_native;   /* 0 if the interpreter runs the scene program */
+  u8 grid_jit_faster;   /* 1 if the code beats fathom_sdf_scene_batch on the scene, see fathom_sdf_jit_faster */
+  u8 grid_jit_measured; /* grid_jit_faster holds for the scene since the last J */
+  u8 grid_bvh_enabled;
+  u8 grid_bvh_current; /* fathom_grid_bvh holds the scene as it is now */
+  u8 grid_raymarch;    /* Render the next frame with the CPU raymarcher as well (K) */
   u8 ui_enabled;
   u8 fullscreen_enabled;
   u8 borderless_enabled;
@@ -459,10 +587,24 @@ typedef struct win32_fathom_state
   s8 *gl_vendor;
   i32 gl_max_3d_texture_size;
 
+  fathom_platform_api api; /* Platform callbacks and the job system, filled like the linux platform layer does */
+
   u32 mem_brick_map_bytes;
+  u32 mem_brick_map_dense_bytes; /* What a dense map of the same grids would take */
   u32 mem_atlas_bytes;
+  u32 mem_material_bytes; /* Material atlas of the mixed bricks and one material entry per atlas slot */
   u32 grid_active_brick_count;
   fathom_vec3 grid_atlas_dimensions;
+  u32 grid_sdf_calls_pass_01;
+  u32 grid_sdf_calls_pass_02;
+  u32 grid_sdf_skipped_pass_02; /* Voxels filled by the sub-block skip */
+  u32 grid_interval_culled_pass_00; /* Blocks and bricks only the distance range culled */
+  u32 grid_interval_culled_pass_01;
+  u32 grid_tape_length_pass_02; /* Pruned tape instructions summed over the bricks of pass 2 */
+  u32 grid_tape_bricks_pass_02;
+  u32 grid_level_count;
+  u32 grid_scroll_sdf_calls; /* Distance function evaluations of the last clipmap scroll */
+  fathom_sparse_grid_atlas_stats grid_atlas_stats;
 
 } win32_fathom_state;
 
@@ -843,19 +985,28 @@ typedef struct shader_main
   i32 loc_iController;
 
   i32 loc_brick_map_texture;
+  i32 loc_block_map_texture;
+  i32 loc_air_distance_texture;
   i32 loc_atlas_texture;
   i32 loc_material_texture;
+  i32 loc_brick_material_texture;
   i32 loc_palette_texture;
 
+  i32 loc_level_count;
   i32 loc_brick_map_dim;
-  i32 loc_atlas_brick_dim;
+  i32 loc_brick_map_offset;
+  i32 loc_brick_map_index_bits;
+  i32 loc_atlas_bricks_per_row;
+  i32 loc_atlas_bricks_per_column;
+  i32 loc_atlas_layer_start;
+  i32 loc_material_layer_start;
 
   i32 loc_inverse_atlas_size;
+  i32 loc_inverse_material_size;
   i32 loc_grid_start;
   i32 loc_cell_size;
   i32 loc_cell_diagonal;
   i32 loc_truncation;
-  i32 loc_cell_size_inverse;
 
   /* Camera */
   i32 loc_camera_position;
@@ -1185,16 +1336,25 @@ FATHOM_API void opengl_shader_load_shader_main(shader_main *shader, s8 *shader_f
     shader->loc_iController = glGetUniformLocation(shader->header.program, "iController");
 
     shader->loc_brick_map_texture = glGetUniformLocation(shader->header.program, "uBrickMap");
+    shader->loc_block_map_texture = glGetUniformLocation(shader->header.program, "uBlockMap");
+    shader->loc_air_distance_texture = glGetUniformLocation(shader->header.program, "uAirDistance");
     shader->loc_atlas_texture = glGetUniformLocation(shader->header.program, "uAtlas");
     shader->loc_material_texture = glGetUniformLocation(shader->header.program, "uMaterial");
+    shader->loc_brick_material_texture = glGetUniformLocation(shader->header.program, "uBrickMaterial");
     shader->loc_palette_texture = glGetUniformLocation(shader->header.program, "uPalette");
 
+    shader->loc_level_count = glGetUniformLocation(shader->header.program, "uLevelCount");
     shader->loc_brick_map_dim = glGetUniformLocation(shader->header.program, "uBrickMapDim");
-    shader->loc_atlas_brick_dim = glGetUniformLocation(shader->header.program, "uAtlasBrickDim");
+    shader->loc_brick_map_offset = glGetUniformLocation(shader->header.program, "uBrickMapOffset");
+    shader->loc_brick_map_index_bits = glGetUniformLocation(shader->header.program, "uBrickMapIndexBits");
+    shader->loc_atlas_bricks_per_row = glGetUniformLocation(shader->header.program, "uAtlasBricksPerRow");
+    shader->loc_atlas_bricks_per_column = glGetUniformLocation(shader->header.program, "uAtlasBricksPerColumn");
+    shader->loc_atlas_layer_start = glGetUniformLocation(shader->header.program, "uAtlasLayerStart");
+    shader->loc_material_layer_start = glGetUniformLocation(shader->header.program, "uMaterialLayerStart");
     shader->loc_inverse_atlas_size = glGetUniformLocation(shader->header.program, "uInvAtlasSize");
+    shader->loc_inverse_material_size = glGetUniformLocation(shader->header.program, "uInvMaterialSize");
     shader->loc_grid_start = glGetUniformLocation(shader->header.program, "uGridStart");
     shader->loc_cell_size = glGetUniformLocation(shader->header.program, "uCellSize");
-    shader->loc_cell_size_inverse = glGetUniformLocation(shader->header.program, "uInvCellSize");
     shader->loc_cell_diagonal = glGetUniformLocation(shader->header.program, "uCellDiagonal");
     shader->loc_truncation = glGetUniformLocation(shader->header.program, "uTruncation");
 
@@ -1234,93 +1394,1362 @@ FATHOM_API void opengl_shader_load_shader_font(shader_font *shader)
       "vC=vec3((K>>11&31u)/31.,(K>>5&63u)/63.,(K&31u)/31.);"
       "}";
 
-  static s8 *shader_font_code_fragment =
-      "#version 330 core\n"
-      "in vec2 vUV;"
-      "in vec3 vC;"
-      "flat in uint b;"
-      "uniform sampler2D iTexture;"
-      "uniform float iTime;"
-      "out vec4 F;"
-      "void main(){"
-      "float a=texture(iTexture,vUV).r;"
-      "if(b==1u&&fract(iTime)<.5)a=0.;" /* Blink Support */
-      "F=vec4(vC,a);"
-      "}";
+  static s8 *shader_font_code_fragment =
+      "#version 330 core\n"
+      "in vec2 vUV;"
+      "in vec3 vC;"
+      "flat in uint b;"
+      "uniform sampler2D iTexture;"
+      "uniform float iTime;"
+      "out vec4 F;"
+      "void main(){"
+      "float a=texture(iTexture,vUV).r;"
+      "if(b==1u&&fract(iTime)<.5)a=0.;" /* Blink Support */
+      "F=vec4(vC,a);"
+      "}";
+
+  if (opengl_shader_load(&shader->header, shader_font_code_vertex, shader_font_code_fragment))
+  {
+    shader->loc_iResolution = glGetUniformLocation(shader->header.program, "r");
+    shader->loc_iTextureInfo = glGetUniformLocation(shader->header.program, "t");
+    shader->loc_iFontScale = glGetUniformLocation(shader->header.program, "s");
+    shader->loc_iTime = glGetUniformLocation(shader->header.program, "iTime");
+    shader->loc_iTexture = glGetUniformLocation(shader->header.program, "iTexture");
+  }
+}
+
+FATHOM_API void opengl_shader_load_shader_recording(shader_recording *shader)
+{
+  static s8 *shader_code_fragment =
+      "#version 330 core\n"
+      "out vec4 FragColor;"
+      "uniform float iTime;"
+      "uniform vec3 iRes;"
+      "void main()"
+      "{"
+      "float r=10.0;"
+      "float m=10.0;"
+      "vec2 p=gl_FragCoord.xy;"
+      "vec2 c=vec2(iRes.x-r-m, r+m);"
+      "float d=length(p-c);"
+      "float blink=0.5+0.5*sin(iTime*12.0);"
+      "float b=4.0;"
+      "if ((d<=r&&blink>0.5)||(p.x<b||p.y<b||p.x>=iRes.x-b||p.y>=iRes.y-b))"
+      " FragColor=vec4(1.0,0.0,0.0,blink);"
+      "else"
+      " discard;"
+      "}";
+
+  if (opengl_shader_load(&shader->header, shader_code_vertex, shader_code_fragment))
+  {
+    shader->loc_iResolution = glGetUniformLocation(shader->header.program, "iRes");
+    shader->loc_iTime = glGetUniformLocation(shader->header.program, "iTime");
+  }
+}
+
+#include "fathom_sparse_grid.h"
+#include "fathom_clipmap.h"
+#include "fathom_raymarch.h"
+
+/* Compiles program into *code (allocated on first use, read and write while compiling, then executable only).
+ * Returns 0 and leaves the program to the interpreter if it does not compile.
+ */
+FATHOM_API u8 fathom_jit_compile(fathom_sdf_jit_program *jit, fathom_sdf_vm_program *program, u8 **code)
+{
+  u32 protect;
+
+  if (!*code)
+  {
+    *code = (u8 *)VirtualAlloc(0, FATHOM_SDF_JIT_CODE_BYTES, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  }
+  else if (!VirtualProtect(*code, FATHOM_SDF_JIT_CODE_BYTES, PAGE_READWRITE, &protect))
+  {
+    return fathom_sdf_jit_compile(jit, program, FATHOM_NULL, 0);
+  }
+
+  if (!fathom_sdf_jit_compile(jit, program, *code, FATHOM_SDF_JIT_CODE_BYTES) || !VirtualProtect(*code, FATHOM_SDF_JIT_CODE_BYTES, PAGE_EXECUTE_READ, &protect))
+  {
+    return fathom_sdf_jit_compile(jit, program, FATHOM_NULL, 0);
+  }
+
+  return 1;
+}
+
+/* The scene of the grid passes, its arena is allocated with the first grid */
+#define FATHOM_GRID_SCENE_CAPACITY 1024
+static fathom_sdf_scene_store fathom_grid_scene;
+static u32 fathom_grid_scene_sphere; /* Handle of the animated primitive (G) */
+
+/* The scene program and its code for the grid passes (J) */
+static fathom_sdf_vm_program fathom_grid_program;
+static fathom_sdf_jit_program fathom_grid_jit;
+static u8 *fathom_grid_jit_code;
+
+FATHOM_API void fathom_grid_jit_scene(win32_fathom_state *state)
+{
+  if (!fathom_sdf_scene_compile(&fathom_grid_program, &fathom_grid_scene))
+  {
+    win32_print("[grid] scene program does not fit, staying on the scene functions\n");
+    state->grid_jit_enabled = 0;
+    return;
+  }
+
+  state->grid_jit_native = fathom_jit_compile(&fathom_grid_jit, &fathom_grid_program, &fathom_grid_jit_code);
+  state->grid_jit_current = 1;
+
+  /* Once per J, the animated primitive does not change which one is faster */
+  if (!state->grid_jit_measured)
+  {
+    state->grid_jit_faster = fathom_sdf_jit_faster(&fathom_grid_jit, fathom_sdf_scene_batch, &fathom_grid_scene, &fathom_grid_scene.bounds);
+    state->grid_jit_measured = 1;
+
+    if (!state->grid_jit_faster)
+    {
+      win32_print("[grid] scene code is not faster than the scene batch, staying on the scene functions\n");
+    }
+  }
+}
+
+/* The hierarchy over the scene for the grid passes (N), its memory is allocated with the first build */
+static fathom_sdf_bvh_tree fathom_grid_bvh;
+
+FATHOM_API void fathom_grid_bvh_scene(win32_fathom_state *state)
+{
+  if (!fathom_grid_bvh.node_data)
+  {
+    fathom_sdf_bvh_initialize(&fathom_grid_bvh, &fathom_grid_scene);
+    fathom_grid_bvh.node_data = VirtualAlloc(0, fathom_grid_bvh.node_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    fathom_grid_bvh.index_data = VirtualAlloc(0, fathom_grid_bvh.index_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    fathom_grid_bvh.bound_data = VirtualAlloc(0, fathom_grid_bvh.bound_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+    if (!fathom_grid_bvh.node_data || !fathom_grid_bvh.index_data || !fathom_grid_bvh.bound_data)
+    {
+      win32_print("[grid] no memory for the scene hierarchy, staying on the scene functions\n");
+      state->grid_bvh_enabled = 0;
+      return;
+    }
+  }
+
+  fathom_sdf_bvh_build(&fathom_grid_bvh);
+  state->grid_bvh_current = 1;
+}
+
+/* fathom_grid_distance_function_interval, _prune and _tape of the compiled scene, user_data is the jit */
+FATHOM_API void fathom_grid_jit_interval(fathom_vec3 box_min, fathom_vec3 box_max, f32 *distance_min, f32 *distance_max, void *user_data)
+{
+  (void)user_data;
+
+  fathom_sdf_scene_interval(box_min, box_max, distance_min, distance_max, &fathom_grid_scene);
+}
+
+FATHOM_API u8 fathom_grid_jit_prune(fathom_vec3 box_min, fathom_vec3 box_max, fathom_grid_tape *tape, void *user_data)
+{
+  (void)user_data;
+
+  return fathom_sdf_scene_prune(box_min, box_max, tape, &fathom_grid_scene);
+}
+
+FATHOM_API void fathom_grid_jit_tape(f32 *x, f32 *y, f32 *z, u32 count, f32 *distances, u8 *materials, fathom_grid_tape *tape, void *user_data)
+{
+  (void)user_data;
+
+  fathom_sdf_scene_batch_tape(x, y, z, count, distances, materials, tape, &fathom_grid_scene);
+}
+
+FATHOM_API fathom_grid_distance fathom_grid_distance_scene(win32_fathom_state *state)
+{
+  fathom_grid_distance distance;
+
+  if (state->grid_jit_enabled && !state->grid_jit_current)
+  {
+    fathom_grid_jit_scene(state);
+  }
+
+  /* Compiled scene where it is faster: same distances bit for bit. The code has no brick tapes,
+   * the bricks whose pruned tape fits run the tape of the scene.
+   */
+  if (state->grid_jit_enabled && state->grid_jit_faster)
+  {
+    distance.function = fathom_sdf_jit;
+    distance.function_batch = fathom_sdf_jit_batch;
+    distance.function_interval = fathom_grid_jit_interval;
+    distance.function_prune = fathom_grid_jit_prune;
+    distance.function_tape = fathom_grid_jit_tape;
+    distance.user_data = &fathom_grid_jit;
+
+    return distance;
+  }
+
+  if (state->grid_bvh_enabled && !state->grid_bvh_current)
+  {
+    fathom_grid_bvh_scene(state);
+  }
+
+  /* Hierarchy for the point queries: same distances bit for bit, the passes over the whole grid run the batches of the scene */
+  if (state->grid_bvh_enabled)
+  {
+    return fathom_sdf_bvh_distance(&fathom_grid_bvh);
+  }
+
+  distance.function = fathom_sdf_scene;
+  distance.function_batch = fathom_sdf_scene_batch;
+  distance.function_interval = fathom_sdf_scene_interval;
+  distance.function_prune = fathom_sdf_scene_prune;
+  distance.function_tape = fathom_sdf_scene_batch_tape;
+  distance.user_data = &fathom_grid_scene;
+
+  return distance;
+}
+
+/* Allocates and fills a grid placed with fathom_sparse_grid_initialize or fathom_clipmap_level_initialize.
+ * Returns 0 if the brick map index width or the atlas texture limit cannot hold all active bricks.
+ */
+FATHOM_API u8 fathom_create_grid(win32_fathom_state *state, fathom_sparse_grid *grid)
+{
+  fathom_grid_distance distance = fathom_grid_distance_scene(state);
+  u32 atlas_bytes;
+  u32 committed_bytes;
+  u8 fits;
+
+  grid->brick_map_top_data = VirtualAlloc(0, grid->brick_map_top_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+  FATHOM_PROFILER_BEGIN(sparse_grid_pass_00);
+  fathom_sparse_grid_pass_00_fill_top_map(grid, &distance, state->api.job_system);
+  FATHOM_PROFILER_END(sparse_grid_pass_00);
+
+  grid->brick_map_data = VirtualAlloc(0, grid->brick_map_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->brick_map_leaf_free_data = VirtualAlloc(0, grid->brick_map_leaf_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->air_distance_data = VirtualAlloc(0, grid->air_distance_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->air_distance_scratch_data = VirtualAlloc(0, grid->air_distance_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+  FATHOM_PROFILER_BEGIN(sparse_grid_pass_01);
+  fits = fathom_sparse_grid_pass_01_fill_brick_map(grid, &distance, state->api.job_system);
+  FATHOM_PROFILER_END(sparse_grid_pass_01);
+
+  if (!fits)
+  {
+    if (grid->brick_map_active_bricks_count > fathom_sparse_grid_atlas_slot_limit(grid))
+    {
+      win32_print("[ERROR] Sparse grid has more active bricks than its brick map index can address, use FATHOM_SPARSE_GRID_INDEX_32\n");
+    }
+    else
+    {
+      win32_print("[ERROR] Sparse grid has more active bricks than the atlas fits into GL_MAX_3D_TEXTURE_SIZE\n");
+    }
+    return 0;
+  }
+
+  atlas_bytes = grid->atlas_bytes;
+  grid->atlas_data = VirtualAlloc(0, grid->atlas_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->material_data = VirtualAlloc(0, grid->atlas_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->atlas_slot_owner_data = VirtualAlloc(0, grid->atlas_slot_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->atlas_slot_ref_data = VirtualAlloc(0, grid->atlas_slot_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->atlas_free_slot_data = VirtualAlloc(0, grid->atlas_slot_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->atlas_slot_hash_data = VirtualAlloc(0, grid->atlas_slot_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->atlas_dedup_table_data = VirtualAlloc(0, grid->atlas_slot_bytes * 2, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->atlas_slot_material_data = VirtualAlloc(0, grid->atlas_slot_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+  grid->material_free_slot_data = VirtualAlloc(0, grid->atlas_slot_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+  FATHOM_PROFILER_BEGIN(sparse_grid_pass_02);
+  fathom_sparse_grid_pass_02_fill_atlas(grid, &distance, state->api.job_system);
+  FATHOM_PROFILER_END(sparse_grid_pass_02);
+
+  /* Deduplication may have dropped atlas layers: give the pages past the smaller atlas back */
+  committed_bytes = (grid->atlas_bytes + 0xFFFu) & ~0xFFFu;
+
+  if (committed_bytes < atlas_bytes)
+  {
+    VirtualFree(grid->atlas_data + committed_bytes, atlas_bytes - committed_bytes, MEM_DECOMMIT);
+    VirtualFree(grid->material_data + committed_bytes, atlas_bytes - committed_bytes, MEM_DECOMMIT);
+  }
+
+  return 1;
+}
+
+FATHOM_API void fathom_destroy_grid(fathom_sparse_grid *grid)
+{
+  VirtualFree(grid->brick_map_top_data, 0, MEM_RELEASE);
+  VirtualFree(grid->brick_map_data, 0, MEM_RELEASE);
+  VirtualFree(grid->brick_map_leaf_free_data, 0, MEM_RELEASE);
+  VirtualFree(grid->air_distance_data, 0, MEM_RELEASE);
+  VirtualFree(grid->air_distance_scratch_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_data, 0, MEM_RELEASE);
+  VirtualFree(grid->material_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_slot_owner_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_slot_ref_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_free_slot_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_slot_hash_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_dedup_table_data, 0, MEM_RELEASE);
+  VirtualFree(grid->atlas_slot_material_data, 0, MEM_RELEASE);
+  VirtualFree(grid->material_free_slot_data, 0, MEM_RELEASE);
+
+  grid->brick_map_top_data = 0;
+  grid->brick_map_data = 0;
+  grid->brick_map_leaf_free_data = 0;
+  grid->air_distance_data = 0;
+  grid->air_distance_scratch_data = 0;
+  grid->atlas_data = 0;
+  grid->material_data = 0;
+  grid->atlas_slot_owner_data = 0;
+  grid->atlas_slot_ref_data = 0;
+  grid->atlas_free_slot_data = 0;
+  grid->atlas_slot_hash_data = 0;
+  grid->atlas_dedup_table_data = 0;
+  grid->atlas_slot_material_data = 0;
+  grid->material_free_slot_data = 0;
+}
+
+/* Totals over all clipmap levels for the overlay */
+FATHOM_API void fathom_grid_stats_update(win32_fathom_state *state, fathom_clipmap *clipmap)
+{
+  u32 level;
+
+  state->mem_brick_map_bytes = 0;
+  state->mem_brick_map_dense_bytes = 0;
+  state->mem_atlas_bytes = 0;
+  state->mem_material_bytes = 0;
+  state->grid_active_brick_count = 0;
+  state->grid_sdf_calls_pass_01 = 0;
+  state->grid_sdf_calls_pass_02 = 0;
+  state->grid_sdf_skipped_pass_02 = 0;
+  state->grid_interval_culled_pass_00 = 0;
+  state->grid_interval_culled_pass_01 = 0;
+  state->grid_tape_length_pass_02 = 0;
+  state->grid_tape_bricks_pass_02 = 0;
+  state->grid_atlas_stats.capacity = 0;
+  state->grid_atlas_stats.live = 0;
+  state->grid_atlas_stats.free = 0;
+  state->grid_atlas_stats.high_water = 0;
+  state->grid_atlas_stats.shared = 0;
+
+  for (level = 0; level < clipmap->level_count; ++level)
+  {
+    fathom_sparse_grid *grid = &clipmap->levels[level];
+    fathom_sparse_grid_atlas_stats stats;
+
+    fathom_sparse_grid_atlas_stats_get(grid, &stats);
+
+    state->mem_brick_map_bytes += grid->brick_map_top_bytes + grid->brick_map_bytes + grid->brick_map_leaf_bytes;
+    state->mem_brick_map_dense_bytes += grid->brick_map_dimensions * grid->brick_map_dimensions * grid->brick_map_dimensions * grid->brick_map_index_bytes;
+    state->mem_atlas_bytes += grid->atlas_bytes;
+    state->mem_material_bytes += (u32)(grid->material_dimensions.x * grid->material_dimensions.y * grid->material_dimensions.z);
+    state->mem_material_bytes += grid->atlas_bricks_per_row * grid->atlas_bricks_per_column * grid->atlas_brick_layers * (u32)sizeof(u32);
+    state->grid_active_brick_count += grid->brick_map_active_bricks_count;
+    state->grid_sdf_calls_pass_01 += grid->sdf_calls_pass_01;
+    state->grid_sdf_calls_pass_02 += grid->sdf_calls_pass_02;
+    state->grid_sdf_skipped_pass_02 += grid->sdf_skipped_pass_02;
+    state->grid_interval_culled_pass_00 += grid->interval_culled_pass_00;
+    state->grid_interval_culled_pass_01 += grid->interval_culled_pass_01;
+    state->grid_tape_length_pass_02 += grid->tape_length_pass_02;
+    state->grid_tape_bricks_pass_02 += grid->tape_bricks_pass_02;
+    state->grid_atlas_stats.capacity += stats.capacity;
+    state->grid_atlas_stats.live += stats.live;
+    state->grid_atlas_stats.free += stats.free;
+    state->grid_atlas_stats.high_water += stats.high_water;
+    state->grid_atlas_stats.shared += stats.shared;
+  }
+
+  state->grid_level_count = clipmap->level_count;
+  state->grid_atlas_stats.occupancy = state->grid_atlas_stats.capacity ? (f32)state->grid_atlas_stats.live / (f32)state->grid_atlas_stats.capacity : 0.0f;
+  state->grid_atlas_stats.fragmentation = state->grid_atlas_stats.high_water ? (f32)state->grid_atlas_stats.free / (f32)state->grid_atlas_stats.high_water : 0.0f;
+  state->grid_atlas_stats.waste = state->mem_atlas_bytes ? 1.0f - ((f32)state->grid_atlas_stats.live * (f32)FATHOM_BRICK_TOTAL_VOXELS) / (f32)state->mem_atlas_bytes : 0.0f;
+  state->grid_atlas_stats.dedup_ratio = state->grid_atlas_stats.live ? (f32)state->grid_active_brick_count / (f32)state->grid_atlas_stats.live : 1.0f;
+}
+
+/* Builds a grid around the scene once per brick map layout and casts the same rays through both on the CPU (B).
+ * Prints the ray throughput and the misses of the traversal cache model per layout.
+ */
+FATHOM_API void fathom_benchmark_grid_traversal(win32_fathom_state *state)
+{
+  static fathom_sparse_grid grid;
+  static fathom_sparse_grid_trace_stats stats;
+  u32 layouts[2] = {FATHOM_SPARSE_GRID_LAYOUT_LINEAR, FATHOM_SPARSE_GRID_LAYOUT_MORTON};
+  s8 *layout_names[2] = {"linear", "morton"};
+  u32 resolution = 256;
+  u32 view_count = 4;
+  u32 layout;
+
+  for (layout = 0; layout < 2; ++layout)
+  {
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 time_start;
+    f64 time_ms;
+    u32 view;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    fathom_sparse_grid_initialize(&grid, fathom_vec3_zero, 256, 1.0f / 32.0f, FATHOM_SPARSE_GRID_INDEX_AUTO);
+    grid.brick_map_layout = layouts[layout];
+
+    if (!fathom_create_grid(state, &grid))
+    {
+      fathom_destroy_grid(&grid);
+      return;
+    }
+
+    fathom_sparse_grid_trace_stats_reset(&stats);
+    time_start = fathom_profiler_time_ms();
+
+    /* The orbit of the render camera, seen from view_count directions */
+    for (view = 0; view < view_count; ++view)
+    {
+      f32 angle = (f32)view * (6.2831853f / (f32)view_count);
+      fathom_vec3 position = fathom_vec3_init(fathom_sinf(angle) * 3.5f, 1.5f, fathom_cosf(angle) * 3.5f);
+      fathom_vec3 forward = fathom_vec3_normalize(fathom_vec3_sub(fathom_vec3_zero, position));
+      fathom_vec3 right = fathom_vec3_normalize(fathom_vec3_cross(forward, fathom_vec3_init(0.0f, 1.0f, 0.0f)));
+      fathom_vec3 up = fathom_vec3_normalize(fathom_vec3_cross(right, forward));
+      u32 x, y;
+
+      for (y = 0; y < resolution; ++y)
+      {
+        for (x = 0; x < resolution; ++x)
+        {
+          f32 u = (2.0f * ((f32)x + 0.5f) / (f32)resolution) - 1.0f;
+          f32 v = (2.0f * ((f32)y + 0.5f) / (f32)resolution) - 1.0f;
+          fathom_vec3 direction = fathom_vec3_add(fathom_vec3_add(fathom_vec3_mulf(right, u), fathom_vec3_mulf(up, v)), fathom_vec3_mulf(forward, 1.5f));
+
+          fathom_sparse_grid_trace(&grid, position, fathom_vec3_normalize(direction), &stats);
+        }
+      }
+    }
+
+    time_ms = fathom_profiler_time_ms() - time_start;
+
+    fathom_sb_s8(&t, "[benchmark] traversal ");
+    fathom_sb_s8(&t, layout_names[layout]);
+    fathom_sb_s8(&t, ": ");
+    fathom_sb_i32(&t, (i32)stats.rays);
+    fathom_sb_s8(&t, " rays ");
+    fathom_sb_f64(&t, time_ms, 2);
+    fathom_sb_s8(&t, " ms ");
+    fathom_sb_f64(&t, time_ms > 0.0 ? (f64)stats.rays / (time_ms * 1000.0) : 0.0, 2);
+    fathom_sb_s8(&t, " Mrays/s hits ");
+    fathom_sb_i32(&t, (i32)stats.hits);
+    fathom_sb_s8(&t, " samples/ray ");
+    fathom_sb_f64(&t, (f64)stats.samples / (f64)stats.rays, 2);
+    fathom_sb_s8(&t, " cache misses ");
+    fathom_sb_i32(&t, (i32)stats.misses);
+    fathom_sb_s8(&t, "/");
+    fathom_sb_i32(&t, (i32)stats.accesses);
+    fathom_sb_s8(&t, " (");
+    fathom_sb_f64(&t, stats.accesses ? (f64)stats.misses / (f64)stats.accesses : 0.0, 4);
+    fathom_sb_s8(&t, ")\n");
+
+    win32_print(t.buffer);
+
+    fathom_destroy_grid(&grid);
+  }
+}
+
+/* Samples a lattice over the scene with the hand written scene functions and with their programs on the VM and compiled (V).
+ * Prints the time per sample and how many distances differ from the hand written version.
+ */
+FATHOM_API void fathom_benchmark_sdf_vm(void)
+{
+  static fathom_sdf_vm_program scene_program;
+  static fathom_sdf_vm_program original_program;
+  static fathom_sdf_jit_program scene_jit;
+  static fathom_sdf_jit_program original_jit;
+  static u8 *scene_code;
+  static u8 *original_code;
+  static f32 reference[64 * 64 * 64];
+  static f32 distances[64 * 64 * 64];
+  static u8 materials[64 * 64 * 64];
+  s8 *names[10] = {"scene", "scene batch", "vm", "vm x4", "vm x8", "jit x8", "original", "vm original", "vm original x8", "jit original x8"};
+  u32 dimension = 64;
+  u32 count = dimension * dimension * dimension;
+  u32 method;
+
+  if (!fathom_sdf_scene_compile(&scene_program, &fathom_grid_scene) || !fathom_sdf_scene_original_compile(&original_program))
+  {
+    win32_print("[benchmark] sdf vm: program does not fit\n");
+    return;
+  }
+
+  if (!fathom_jit_compile(&scene_jit, &scene_program, &scene_code) || !fathom_jit_compile(&original_jit, &original_program, &original_code))
+  {
+    win32_print("[benchmark] sdf jit: no code, the jit rows run on the interpreter\n");
+  }
+
+  for (method = 0; method < 10; ++method)
+  {
+    fathom_sdf_vm_program *program = method < 6 ? &scene_program : &original_program;
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 time_start;
+    f64 time_ms;
+    f32 max_error = 0.0f;
+    u32 mismatches = 0;
+    u32 i, x, y, z;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    time_start = fathom_profiler_time_ms();
+
+    for (z = 0; z < dimension; ++z)
+    {
+      for (y = 0; y < dimension; ++y)
+      {
+        f32 x_row[64];
+        f32 y_row[64];
+        f32 z_row[64];
+        u32 row = (y + z * dimension) * dimension;
+
+        for (x = 0; x < dimension; ++x)
+        {
+          x_row[x] = -2.5f + 5.0f * ((f32)x + 0.5f) / (f32)dimension;
+          y_row[x] = -1.0f + 3.5f * ((f32)y + 0.5f) / (f32)dimension;
+          z_row[x] = -2.5f + 5.0f * ((f32)z + 0.5f) / (f32)dimension;
+        }
+
+        switch (method)
+        {
+        case 0:
+        case 2:
+        case 6:
+        case 7:
+          for (x = 0; x < dimension; ++x)
+          {
+            fathom_vec3 position = fathom_vec3_init(x_row[x], y_row[x], z_row[x]);
+            fathom_grid_data data = method == 0 ? fathom_sdf_scene(position, &fathom_grid_scene) : (method == 6 ? fathom_sdf_scene_original(position, FATHOM_NULL) : fathom_sdf_vm(position, program));
+
+            distances[row + x] = data.distance;
+            materials[row + x] = data.material;
+          }
+          break;
+        case 1:
+          fathom_sdf_scene_batch(x_row, y_row, z_row, dimension, distances + row, materials + row, &fathom_grid_scene);
+          break;
+        case 3:
+          fathom_sdf_vm_evaluate_batch(program, x_row, y_row, z_row, dimension, distances + row, materials + row, 1);
+          break;
+        case 5:
+        case 9:
+          fathom_sdf_jit_evaluate_batch(method == 5 ? &scene_jit : &original_jit, x_row, y_row, z_row, dimension, distances + row, materials + row);
+          break;
+        default:
+          fathom_sdf_vm_batch(x_row, y_row, z_row, dimension, distances + row, materials + row, program);
+          break;
+        }
+      }
+    }
+
+    time_ms = fathom_profiler_time_ms() - time_start;
+
+    /* The first run of each scene is the reference */
+    for (i = 0; i < count; ++i)
+    {
+      if (method == 0 || method == 6)
+      {
+        reference[i] = distances[i];
+      }
+      else if (distances[i] != reference[i])
+      {
+        f32 error = fathom_absf(distances[i] - reference[i]);
+        max_error = error > max_error ? error : max_error;
+        ++mismatches;
+      }
+    }
+
+    fathom_sb_s8(&t, "[benchmark] sdf ");
+    fathom_sb_s8(&t, names[method]);
+    fathom_sb_s8(&t, ": ");
+    fathom_sb_f64(&t, time_ms * 1000000.0 / (f64)count, 2);
+    fathom_sb_s8(&t, " ns/sample mismatches ");
+    fathom_sb_i32(&t, (i32)mismatches);
+    fathom_sb_s8(&t, " max error ");
+    fathom_sb_f64(&t, (f64)max_error, 6);
+    fathom_sb_s8(&t, "\n");
+
+    win32_print(t.buffer);
+  }
+}
+
+/* Fills store with count primitives of every type scattered over a square of constant density (about 2 per unit of area) */
+FATHOM_API void fathom_benchmark_sdf_bvh_scene(fathom_sdf_scene_store *store, u32 count, u32 *seed)
+{
+  f32 side = 1.5f * fathom_sqrtf((f32)count);
+  u32 i;
+
+  fathom_sdf_scene_store_clear(store);
+
+  for (i = 0; i < count; ++i)
+  {
+    fathom_sdf_primitive primitive_data = {0};
+    fathom_sdf_primitive *primitive = &primitive_data;
+    f32 random[6];
+    u32 j;
+
+    for (j = 0; j < 6; ++j)
+    {
+      *seed = *seed * 1664525u + 1013904223u;
+      random[j] = (f32)(*seed >> 8) / 16777216.0f;
+    }
+
+    primitive->primitive_id = (u8)(i % FATHOM_SDF_PRIMITIVE_COUNT);
+    primitive->material_id = (u8)(1 + i % 4);
+    primitive->operation_id = (u8)(i % 7 == 0 ? FATHOM_SDF_OPERATION_UNION : FATHOM_SDF_OPERATION_UNION_SMOOTH);
+    primitive->transform.position = fathom_vec3_init((random[0] - 0.5f) * side, random[1], (random[2] - 0.5f) * side);
+
+    switch (primitive->primitive_id)
+    {
+    case FATHOM_SDF_PRIMITIVE_SPHERE:
+      primitive->attributes.sphere.radius = 0.1f + 0.3f * random[3];
+      break;
+    case FATHOM_SDF_PRIMITIVE_BOX:
+      primitive->attributes.box.base = fathom_vec3_init(0.1f + 0.3f * random[3], 0.1f + 0.3f * random[4], 0.1f + 0.3f * random[5]);
+      break;
+    case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+      primitive->attributes.box_frame.base = fathom_vec3_initf(0.1f + 0.3f * random[3]);
+      primitive->attributes.box_frame.edge_thickness = 0.03f;
+      break;
+    case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+      primitive->attributes.ellipsoid.radius = fathom_vec3_init(0.1f + 0.3f * random[3], 0.05f + 0.2f * random[4], 0.05f + 0.35f * random[5]);
+      break;
+    default:
+      primitive->attributes.octahedron.scale = 0.1f + 0.3f * random[3];
+      break;
+    }
+
+    fathom_sdf_scene_store_add(store, primitive);
+  }
+}
+
+/* Queries scenes of 10 to 10000 primitives with the hierarchy and with the scene function (every primitive) (H).
+ * Prints the time per query, the nodes and primitives one query visits, the queries that fell back to the store
+ * order, the distances and materials that differ and the time to move 16 primitives to the end of the store and
+ * rebuild the hierarchy.
+ */
+FATHOM_API void fathom_benchmark_sdf_bvh(void)
+{
+  fathom_sdf_scene_store store;
+  u32 counts[4] = {10, 100, 1000, 10000};
+  u32 query_count = 1024;
+  u32 seed = 1;
+  u32 test;
+
+  fathom_sdf_scene_store_initialize(&store, 10000);
+  store.arena_data = VirtualAlloc(0, store.arena_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+  for (test = 0; test < 4; ++test)
+  {
+    fathom_sdf_bvh_tree bvh;
+    fathom_sdf_bvh_query_stats stats = {0};
+    f32 side = 1.5f * fathom_sqrtf((f32)counts[test]) + 2.0f;
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 time_start;
+    f64 time_build_ms;
+    f64 time_bvh_ms = 0.0;
+    f64 time_scene_ms = 0.0;
+    f64 time_edit_ms;
+    f32 max_error = 0.0f;
+    u32 mismatches = 0;
+    u32 i;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    fathom_benchmark_sdf_bvh_scene(&store, counts[test], &seed);
+    fathom_sdf_bvh_initialize(&bvh, &store);
+    bvh.node_data = VirtualAlloc(0, bvh.node_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    bvh.index_data = VirtualAlloc(0, bvh.index_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    bvh.bound_data = VirtualAlloc(0, bvh.bound_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+    time_start = fathom_profiler_time_ms();
+    fathom_sdf_bvh_build(&bvh);
+    time_build_ms = fathom_profiler_time_ms() - time_start;
+
+    for (i = 0; i < query_count; ++i)
+    {
+      fathom_vec3 position;
+      fathom_grid_data bvh_data;
+      fathom_grid_data scene_data;
+
+      seed = seed * 1664525u + 1013904223u;
+      position.x = ((f32)(seed >> 8) / 16777216.0f - 0.5f) * side;
+      seed = seed * 1664525u + 1013904223u;
+      position.y = -0.5f + 2.5f * (f32)(seed >> 8) / 16777216.0f;
+      seed = seed * 1664525u + 1013904223u;
+      position.z = ((f32)(seed >> 8) / 16777216.0f - 0.5f) * side;
+
+      time_start = fathom_profiler_time_ms();
+      bvh_data = fathom_sdf_bvh(position, &bvh);
+      time_bvh_ms += fathom_profiler_time_ms() - time_start;
+
+      time_start = fathom_profiler_time_ms();
+      scene_data = fathom_sdf_scene(position, &store);
+      time_scene_ms += fathom_profiler_time_ms() - time_start;
+
+      fathom_sdf_bvh_evaluate(&bvh, position, &stats);
+
+      if (bvh_data.distance != scene_data.distance || bvh_data.material != scene_data.material)
+      {
+        f32 error = fathom_absf(bvh_data.distance - scene_data.distance);
+        max_error = error > max_error ? error : max_error;
+        ++mismatches;
+      }
+    }
+
+    /* Edits: the first 16 primitives move to the end of the store */
+    time_start = fathom_profiler_time_ms();
+    for (i = 0; i < 16 && i < counts[test]; ++i)
+    {
+      fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(&store, 0);
+
+      fathom_sdf_scene_store_remove(&store, store.index_handle[0]);
+      fathom_sdf_scene_store_add(&store, &primitive);
+    }
+    fathom_sdf_bvh_build(&bvh);
+    time_edit_ms = fathom_profiler_time_ms() - time_start;
+
+    VirtualFree(bvh.node_data, 0, MEM_RELEASE);
+    VirtualFree(bvh.index_data, 0, MEM_RELEASE);
+    VirtualFree(bvh.bound_data, 0, MEM_RELEASE);
+
+    fathom_sb_s8(&t, "[benchmark] sdf bvh ");
+    fathom_sb_i32(&t, (i32)counts[test]);
+    fathom_sb_s8(&t, " primitives: build ");
+    fathom_sb_f64(&t, time_build_ms, 3);
+    fathom_sb_s8(&t, " ms depth ");
+    fathom_sb_i32(&t, (i32)bvh.node_depth);
+    fathom_sb_s8(&t, " scene ");
+    fathom_sb_f64(&t, time_scene_ms * 1000000.0 / (f64)query_count, 1);
+    fathom_sb_s8(&t, " ns/query bvh ");
+    fathom_sb_f64(&t, time_bvh_ms * 1000000.0 / (f64)query_count, 1);
+    fathom_sb_s8(&t, " ns/query nodes ");
+    fathom_sb_f64(&t, (f64)stats.nodes / (f64)query_count, 1);
+    fathom_sb_s8(&t, " primitives ");
+    fathom_sb_f64(&t, (f64)stats.primitives / (f64)query_count, 1);
+    fathom_sb_s8(&t, " fallbacks ");
+    fathom_sb_i32(&t, (i32)stats.fallbacks);
+    fathom_sb_s8(&t, " mismatches ");
+    fathom_sb_i32(&t, (i32)mismatches);
+    fathom_sb_s8(&t, " max error ");
+    fathom_sb_f64(&t, (f64)max_error, 6);
+    fathom_sb_s8(&t, " edit ");
+    fathom_sb_f64(&t, time_edit_ms, 3);
+    fathom_sb_s8(&t, " ms\n");
+
+    win32_print(t.buffer);
+  }
+
+  VirtualFree(store.arena_data, 0, MEM_RELEASE);
+}
+
+/* fathom_sdf_scene with the rotation of every primitive rebuilt from its angles for every sample, the way
+ * fathom_sdf_scene_original rotates its box. The baseline of the inverse transforms the store precomputes.
+ */
+FATHOM_API fathom_grid_data fathom_benchmark_sdf_transform_per_sample(fathom_sdf_scene_store *store, fathom_vec3 position)
+{
+  f32 ground = position.y - (-0.25f);
+  fathom_grid_data d;
+
+  d.distance = ground;
+  d.material = 0;
+
+  if (store->primitive_count && fathom_sdf_aabb_distance(position, &store->bounds) <= ground)
+  {
+    f32 primitive_distance_total = 1e30f;
+    u8 primitive_material_total = 0;
+    u32 i;
+
+    for (i = 0; i < store->primitive_count; ++i)
+    {
+      fathom_vec3 p = fathom_vec3_sub(position, fathom_vec3_init(store->position_x[i], store->position_y[i], store->position_z[i]));
+      fathom_vec3 attribute = fathom_vec3_init(store->attribute_x[i], store->attribute_y[i], store->attribute_z[i]);
+      f32 scale = store->scale[i];
+      f32 distance = ground;
+      f32 s, c;
+
+      /* Inverse of rz * ry * rx: undo z, then y, then x */
+      fathom_sdf_scene_transform_sincos(store->rotation_z[i], &s, &c);
+      fathom_vec2_mul_mat2x2(&p.x, &p.y, fathom_mat2x2_init(c, -s, s, c));
+      fathom_sdf_scene_transform_sincos(store->rotation_y[i], &s, &c);
+      fathom_vec2_mul_mat2x2(&p.z, &p.x, fathom_mat2x2_init(c, -s, s, c));
+      fathom_sdf_scene_transform_sincos(store->rotation_x[i], &s, &c);
+      fathom_vec2_mul_mat2x2(&p.y, &p.z, fathom_mat2x2_init(c, -s, s, c));
+      p = fathom_vec3_divf(p, scale);
+
+      switch (store->primitive_ids[i])
+      {
+      case FATHOM_SDF_PRIMITIVE_SPHERE:
+        distance = fathom_sdf_sphere(p, attribute.x) * scale;
+        break;
+      case FATHOM_SDF_PRIMITIVE_BOX:
+        distance = fathom_sdf_box(p, attribute) * scale;
+        break;
+      case FATHOM_SDF_PRIMITIVE_BOX_FRAME:
+        distance = fathom_sdf_box_frame(p, attribute, store->attribute_w[i]) * scale;
+        break;
+      case FATHOM_SDF_PRIMITIVE_ELLIPSOID:
+        distance = fathom_sdf_ellipsoid(p, attribute) * scale;
+        break;
+      case FATHOM_SDF_PRIMITIVE_OCTAHEDRON:
+        distance = fathom_sdf_octahedron(p, attribute.x) * scale;
+        break;
+      default:
+        break;
+      }
+
+      fathom_sdf_scene_combine(&primitive_distance_total, &primitive_material_total, store, i, distance);
+    }
+
+    if (ground < primitive_distance_total)
+    {
+      primitive_material_total = 0;
+    }
+
+    d.distance = fathom_sdf_op_union_smooth(ground, primitive_distance_total, FATHOM_SDF_SCENE_GROUND_BLEND);
+    d.material = primitive_material_total;
+  }
+
+  return d;
+}
+
+/* Gives the primitives of the 64 primitive benchmark scene a random rotation and scale and samples a lattice over
+ * them with the inverse transforms of the store (per sample and 4 at a time) and with the rotations rebuilt for
+ * every sample (T). Prints the time to compile the transforms, the time per sample and the largest difference.
+ */
+FATHOM_API void fathom_benchmark_sdf_transform(void)
+{
+  static f32 reference[32 * 32 * 32];
+  static f32 distances[32 * 32 * 32];
+  static u8 materials[32 * 32 * 32];
+  s8 *names[3] = {"inverse", "inverse batch", "per sample"};
+  fathom_sdf_scene_store store;
+  u32 dimension = 32;
+  u32 count = dimension * dimension * dimension;
+  u32 primitive_count = 64;
+  f32 side = 1.5f * fathom_sqrtf((f32)primitive_count) + 1.0f;
+  u32 seed = 7;
+  f64 time_start;
+  f64 time_compile_ms;
+  u32 method;
+  u32 i;
+
+  fathom_sdf_scene_store_initialize(&store, primitive_count);
+  store.arena_data = VirtualAlloc(0, store.arena_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+
+  fathom_benchmark_sdf_bvh_scene(&store, primitive_count, &seed);
+
+  /* One edit per primitive, each compiles its inverse transform */
+  time_start = fathom_profiler_time_ms();
+  for (i = 0; i < primitive_count; ++i)
+  {
+    fathom_sdf_primitive primitive = fathom_sdf_scene_store_primitive(&store, i);
+    f32 random[4];
+    u32 j;
+
+    for (j = 0; j < 4; ++j)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      random[j] = (f32)(seed >> 8) / 16777216.0f;
+    }
+
+    primitive.transform.rotation = fathom_vec3_init((random[0] - 0.5f) * FATHOM_PI2, (random[1] - 0.5f) * FATHOM_PI2, (random[2] - 0.5f) * FATHOM_PI2);
+    primitive.transform.scale = 0.5f + random[3];
+
+    fathom_sdf_scene_store_update(&store, store.index_handle[i], &primitive);
+  }
+  time_compile_ms = fathom_profiler_time_ms() - time_start;
+
+  for (method = 0; method < 3; ++method)
+  {
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 time_ms;
+    f32 max_error = 0.0f;
+    u32 x, y, z;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    time_start = fathom_profiler_time_ms();
+
+    for (z = 0; z < dimension; ++z)
+    {
+      for (y = 0; y < dimension; ++y)
+      {
+        f32 x_row[32];
+        f32 y_row[32];
+        f32 z_row[32];
+        u32 row = (y + z * dimension) * dimension;
+
+        for (x = 0; x < dimension; ++x)
+        {
+          x_row[x] = side * (((f32)x + 0.5f) / (f32)dimension - 0.5f);
+          y_row[x] = -0.5f + 2.5f * ((f32)y + 0.5f) / (f32)dimension;
+          z_row[x] = side * (((f32)z + 0.5f) / (f32)dimension - 0.5f);
+        }
+
+        if (method == 1)
+        {
+          fathom_sdf_scene_batch(x_row, y_row, z_row, dimension, distances + row, materials + row, &store);
+          continue;
+        }
+
+        for (x = 0; x < dimension; ++x)
+        {
+          fathom_vec3 position = fathom_vec3_init(x_row[x], y_row[x], z_row[x]);
+          fathom_grid_data data = method == 0 ? fathom_sdf_scene(position, &store) : fathom_benchmark_sdf_transform_per_sample(&store, position);
+
+          distances[row + x] = data.distance;
+          materials[row + x] = data.material;
+        }
+      }
+    }
+
+    time_ms = fathom_profiler_time_ms() - time_start;
+
+    for (i = 0; i < count; ++i)
+    {
+      if (method == 0)
+      {
+        reference[i] = distances[i];
+      }
+      else
+      {
+        f32 error = fathom_absf(distances[i] - reference[i]);
+        max_error = error > max_error ? error : max_error;
+      }
+    }
+
+    fathom_sb_s8(&t, "[benchmark] sdf transform ");
+    fathom_sb_s8(&t, names[method]);
+    fathom_sb_s8(&t, ": compile ");
+    fathom_sb_f64(&t, method < 2 ? time_compile_ms : 0.0, 3);
+    fathom_sb_s8(&t, " ms ");
+    fathom_sb_f64(&t, time_ms * 1000000.0 / (f64)count, 2);
+    fathom_sb_s8(&t, " ns/sample max error ");
+    fathom_sb_f64(&t, (f64)max_error, 6);
+    fathom_sb_s8(&t, "\n");
+
+    win32_print(t.buffer);
+  }
+
+  VirtualFree(store.arena_data, 0, MEM_RELEASE);
+}
+
+/* Framebuffer of the CPU raymarcher */
+#define FATHOM_RAYMARCH_BENCHMARK_WIDTH 640
+#define FATHOM_RAYMARCH_BENCHMARK_HEIGHT 360
+
+static u8 fathom_raymarch_pixels[2][FATHOM_RAYMARCH_BENCHMARK_WIDTH * FATHOM_RAYMARCH_BENCHMARK_HEIGHT * 3];
+static f32 fathom_raymarch_t_hit[2][FATHOM_RAYMARCH_BENCHMARK_WIDTH * FATHOM_RAYMARCH_BENCHMARK_HEIGHT];
+
+/* Renders the clipmap as the shader sees it this frame with the CPU raymarcher (K): single rays on this thread,
+ * 2x2 packets on this thread and packets on the job system. Prints the ray throughput per variant and how many
+ * pixels of the packet images differ from the single ray image.
+ * Then traces the same rays with the traversal variants of the shaders (the prototypes only see the first level)
+ * and prints their work per ray and how many rays disagree with fathom.fs.
+ */
+FATHOM_API void fathom_benchmark_raymarch(win32_fathom_state *state, fathom_clipmap *clipmap, fathom_raymarch_camera *camera)
+{
+  static fathom_raymarch raymarch;
+  s8 *names[3] = {"rays", "packets", "packets jobs"};
+  u32 pixel_count = FATHOM_RAYMARCH_BENCHMARK_WIDTH * FATHOM_RAYMARCH_BENCHMARK_HEIGHT;
+  u32 variant;
+
+  for (variant = 0; variant < 3; ++variant)
+  {
+    s8 buffer[256];
+    fathom_sb t = {0};
+    u32 mismatches = 0;
+    f64 time_start;
+    f64 time_ms;
+    u32 i;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    fathom_raymarch_initialize(&raymarch, clipmap, fathom_raymarch_pixels[variant ? 1 : 0], FATHOM_RAYMARCH_BENCHMARK_WIDTH, FATHOM_RAYMARCH_BENCHMARK_HEIGHT);
+    raymarch.camera = *camera;
+    raymarch.packets = variant > 0;
+
+    time_start = fathom_profiler_time_ms();
+    fathom_raymarch_render(&raymarch, variant == 2 ? state->api.job_system : FATHOM_NULL);
+    time_ms = fathom_profiler_time_ms() - time_start;
+
+    for (i = 0; variant && i < pixel_count * 3; i += 3)
+    {
+      mismatches += fathom_raymarch_pixels[0][i] != fathom_raymarch_pixels[1][i] ||
+                    fathom_raymarch_pixels[0][i + 1] != fathom_raymarch_pixels[1][i + 1] ||
+                    fathom_raymarch_pixels[0][i + 2] != fathom_raymarch_pixels[1][i + 2];
+    }
+
+    fathom_sb_s8(&t, "[benchmark] raymarch ");
+    fathom_sb_s8(&t, names[variant]);
+    fathom_sb_s8(&t, ": ");
+    fathom_sb_i32(&t, (i32)raymarch.stats.rays);
+    fathom_sb_s8(&t, " rays ");
+    fathom_sb_f64(&t, time_ms, 2);
+    fathom_sb_s8(&t, " ms ");
+    fathom_sb_f64(&t, time_ms > 0.0 ? (f64)raymarch.stats.rays / (time_ms * 1000.0) : 0.0, 2);
+    fathom_sb_s8(&t, " Mrays/s hits ");
+    fathom_sb_i32(&t, (i32)raymarch.stats.hits);
+    fathom_sb_s8(&t, " bricks/ray ");
+    fathom_sb_f64(&t, (f64)raymarch.stats.bricks / (f64)raymarch.stats.rays, 2);
+    fathom_sb_s8(&t, " samples/ray ");
+    fathom_sb_f64(&t, (f64)raymarch.stats.samples / (f64)raymarch.stats.rays, 2);
+    fathom_sb_s8(&t, " differing pixels ");
+    fathom_sb_i32(&t, (i32)mismatches);
+    fathom_sb_s8(&t, "\n");
+
+    win32_print(t.buffer);
+  }
+
+  for (variant = 0; variant < FATHOM_RAYMARCH_TRAVERSAL_COUNT; ++variant)
+  {
+    fathom_raymarch_stats stats;
+    s8 buffer[256];
+    fathom_sb t = {0};
+    f64 time_start;
+    f64 time_ms;
+    u32 disagreements;
+
+    t.size = sizeof(buffer);
+    t.buffer = buffer;
+
+    fathom_raymarch_stats_reset(&stats);
+
+    time_start = fathom_profiler_time_ms();
+    fathom_raymarch_traversal_run(&raymarch, fathom_raymarch_traversals[variant], fathom_raymarch_t_hit[variant ? 1 : 0], &stats);
+    time_ms = fathom_profiler_time_ms() - time_start;
+
+    disagreements = variant ? fathom_raymarch_traversal_disagreements(fathom_raymarch_t_hit[1], fathom_raymarch_t_hit[0], pixel_count, clipmap->levels[0].cell_size) : 0;
+
+    fathom_sb_s8(&t, "[benchmark] traversal ");
+    fathom_sb_s8(&t, fathom_raymarch_traversal_names[variant]);
+    fathom_sb_s8(&t, ": ");
+    fathom_sb_f64(&t, time_ms > 0.0 ? (f64)stats.rays / (time_ms * 1000.0) : 0.0, 2);
+    fathom_sb_s8(&t, " Mrays/s hits ");
+    fathom_sb_i32(&t, (i32)stats.hits);
+    fathom_sb_s8(&t, " bricks/ray ");
+    fathom_sb_f64(&t, (f64)stats.bricks / (f64)stats.rays, 2);
+    fathom_sb_s8(&t, " samples/ray ");
+    fathom_sb_f64(&t, (f64)stats.samples / (f64)stats.rays, 2);
+    fathom_sb_s8(&t, " brick limits ");
+    fathom_sb_i32(&t, (i32)stats.brick_limits);
+    fathom_sb_s8(&t, " sphere limits ");
+    fathom_sb_i32(&t, (i32)stats.sphere_limits);
+    fathom_sb_s8(&t, " disagreements ");
+    fathom_sb_i32(&t, (i32)disagreements);
+    fathom_sb_s8(&t, "\n");
+
+    win32_print(t.buffer);
+  }
+}
+
+/* Staging for the flattened brick map: one storage slice of the largest grid (u16 or u32 entries, or block bytes) */
+static u32 fathom_brick_map_upload_slice[FATHOM_SPARSE_GRID_MAX_DIMENSION * FATHOM_SPARSE_GRID_MAX_DIMENSION];
+
+/* Expands the storage box [box->brick_min, box->brick_max) of the two level brick map into the dense brick map texture, slice by slice */
+FATHOM_API void fathom_upload_brick_map_box(fathom_sparse_grid *grid, u32 level, fathom_sparse_grid_region *box, u32 brickMapTex)
+{
+  u32 brick_map_type = grid->brick_map_index_bytes == FATHOM_SPARSE_GRID_INDEX_32 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+  u32 sz;
+
+  glBindTexture(GL_TEXTURE_3D, brickMapTex);
+
+  for (sz = box->brick_min[2]; sz < box->brick_max[2]; ++sz)
+  {
+    fathom_sparse_grid_brick_map_flatten(grid, box, sz, fathom_brick_map_upload_slice);
+
+    glTexSubImage3D(GL_TEXTURE_3D, 0,
+                    (i32)box->brick_min[0], (i32)box->brick_min[1], (i32)(sz + (level * grid->brick_map_dimensions)),
+                    (i32)(box->brick_max[0] - box->brick_min[0]),
+                    (i32)(box->brick_max[1] - box->brick_min[1]),
+                    1,
+                    GL_RED_INTEGER, brick_map_type, fathom_brick_map_upload_slice);
+  }
+}
+
+/* Empty (all air) flags of every block, the shader skips such blocks as a whole */
+FATHOM_API void fathom_upload_block_map(fathom_sparse_grid *grid, u32 level, u32 blockMapTex)
+{
+  u32 top_dim = grid->brick_map_top_dimensions;
+  u32 tz;
+
+  glBindTexture(GL_TEXTURE_3D, blockMapTex);
+
+  for (tz = 0; tz < top_dim; ++tz)
+  {
+    fathom_sparse_grid_brick_map_flatten_blocks(grid, tz, (u8 *)fathom_brick_map_upload_slice);
+
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, (i32)(tz + (level * top_dim)), (i32)top_dim, (i32)top_dim, 1,
+                    GL_RED_INTEGER, GL_UNSIGNED_BYTE, fathom_brick_map_upload_slice);
+  }
+}
+
+/* Air distances of the storage box [box->brick_min, box->brick_max), straight out of the dense air distance map */
+FATHOM_API void fathom_upload_air_distance_box(fathom_sparse_grid *grid, u32 level, fathom_sparse_grid_region *box, u32 airDistanceTex)
+{
+  u32 dim = grid->brick_map_dimensions;
+
+  glBindTexture(GL_TEXTURE_3D, airDistanceTex);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, (i32)dim);
+  glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, (i32)dim);
+
+  glTexSubImage3D(GL_TEXTURE_3D, 0,
+                  (i32)box->brick_min[0], (i32)box->brick_min[1], (i32)(box->brick_min[2] + (level * dim)),
+                  (i32)(box->brick_max[0] - box->brick_min[0]),
+                  (i32)(box->brick_max[1] - box->brick_min[1]),
+                  (i32)(box->brick_max[2] - box->brick_min[2]),
+                  GL_RED_INTEGER, GL_UNSIGNED_BYTE, &grid->air_distance_data[box->brick_min[0] + (box->brick_min[1] * dim) + (box->brick_min[2] * dim * dim)]);
+
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+}
+
+/* Uploads the per voxel materials of the mixed bricks among the atlas slots [slot_min, slot_max) into their
+ * material slots, one brick at a time straight out of material_data. Uniform bricks only have their entry.
+ */
+FATHOM_API void fathom_upload_grid_materials(fathom_sparse_grid *grid, u32 material_layer, u32 slot_min, u32 slot_max, u32 materialTex)
+{
+  u32 bricks_per_row = grid->atlas_bricks_per_row;
+  u32 bricks_per_column = grid->atlas_bricks_per_column;
+  u32 slot;
+
+  glBindTexture(GL_TEXTURE_3D, materialTex);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, (i32)(bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE));
+  glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, (i32)(bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE));
+
+  for (slot = slot_min; slot < slot_max; ++slot)
+  {
+    u32 entry = grid->atlas_slot_material_data[slot];
+    u32 material_slot = entry & ~FATHOM_SPARSE_GRID_MATERIAL_MIXED;
+    u32 row = material_slot / bricks_per_row;
+    u32 layer = row / bricks_per_column;
+
+    if (!(entry & FATHOM_SPARSE_GRID_MATERIAL_MIXED))
+    {
+      continue;
+    }
+
+    glTexSubImage3D(GL_TEXTURE_3D, 0,
+                    (i32)((material_slot - (row * bricks_per_row)) * FATHOM_PHYSICAL_BRICK_SIZE),
+                    (i32)((row - (layer * bricks_per_column)) * FATHOM_PHYSICAL_BRICK_SIZE),
+                    (i32)((material_layer + layer) * FATHOM_PHYSICAL_BRICK_SIZE),
+                    FATHOM_PHYSICAL_BRICK_SIZE, FATHOM_PHYSICAL_BRICK_SIZE, FATHOM_PHYSICAL_BRICK_SIZE,
+                    GL_RED, GL_UNSIGNED_BYTE, &grid->material_data[fathom_sparse_grid_atlas_slot_base(grid, slot)]);
+  }
+
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+}
+
+/* The clipmap levels are stacked along z: level l owns the brick map slices [l * dim, (l + 1) * dim),
+ * the block map slices [l * dim / FATHOM_SPARSE_GRID_LEAF_SIZE, (l + 1) * dim / FATHOM_SPARSE_GRID_LEAF_SIZE),
+ * the air distance slices [l * dim, (l + 1) * dim),
+ * the atlas_brick_layers brick layers of the atlas starting at atlas_layer (see fathom_upload_clipmap)
+ * and the material_brick_layers brick layers of the material atlas starting at material_layer.
+ * Every level keeps its own atlas layout in the x/y corner of its layers. The material entries have
+ * one texel per atlas brick, stacked like the atlas bricks.
+ */
+FATHOM_API void fathom_upload_grid(fathom_sparse_grid *grid, u32 level, u32 atlas_layer, u32 material_layer, u32 brickMapTex, u32 blockMapTex, u32 airDistanceTex, u32 atlasTex, u32 materialTex, u32 brickMaterialTex)
+{
+  fathom_sparse_grid_region box;
+
+  box.brick_min[0] = box.brick_min[1] = box.brick_min[2] = 0;
+  box.brick_max[0] = box.brick_max[1] = box.brick_max[2] = grid->brick_map_dimensions;
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  fathom_upload_brick_map_box(grid, level, &box, brickMapTex);
+  fathom_upload_block_map(grid, level, blockMapTex);
+  fathom_upload_air_distance_box(grid, level, &box, airDistanceTex);
+
+  glBindTexture(GL_TEXTURE_3D, atlasTex);
+  glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, (i32)(atlas_layer * FATHOM_PHYSICAL_BRICK_SIZE),
+                  (i32)grid->atlas_dimensions.x, (i32)grid->atlas_dimensions.y, (i32)grid->atlas_dimensions.z,
+                  GL_RED, GL_BYTE, grid->atlas_data);
+
+  glBindTexture(GL_TEXTURE_3D, brickMaterialTex);
+  glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, (i32)atlas_layer,
+                  (i32)grid->atlas_bricks_per_row, (i32)grid->atlas_bricks_per_column, (i32)grid->atlas_brick_layers,
+                  GL_RED_INTEGER, GL_UNSIGNED_INT, grid->atlas_slot_material_data);
+
+  fathom_upload_grid_materials(grid, material_layer, 0, grid->atlas_slot_count, materialTex);
+}
+
+/* (Re)specifies the brick map, block map, air distance, atlas and material textures large enough for every level and uploads all levels.
+ * The atlas layers of the levels follow each other along z, atlas_layer receives the first brick layer of every level.
+ * The material atlas stacks the levels the same way (material_layer), with only as many layers as their mixed bricks need.
+ */
+FATHOM_API void fathom_upload_clipmap(fathom_clipmap *clipmap, fathom_vec3 *atlas_texture_dimensions, u32 *atlas_layer, fathom_vec3 *material_texture_dimensions, u32 *material_layer,
+                                      u32 brickMapTex, u32 blockMapTex, u32 airDistanceTex, u32 atlasTex, u32 materialTex, u32 brickMaterialTex)
+{
+  u32 dim = clipmap->levels[0].brick_map_dimensions;
+  u32 top_dim = clipmap->levels[0].brick_map_top_dimensions;
+  u8 index_32 = clipmap->levels[0].brick_map_index_bytes == FATHOM_SPARSE_GRID_INDEX_32;
+  u32 width = 0;
+  u32 height = 0;
+  u32 layers = 0;
+  u32 material_layers = 0;
+  u32 level;
+
+  for (level = 0; level < clipmap->level_count; ++level)
+  {
+    width = (u32)clipmap->levels[level].atlas_dimensions.x > width ? (u32)clipmap->levels[level].atlas_dimensions.x : width;
+    height = (u32)clipmap->levels[level].atlas_dimensions.y > height ? (u32)clipmap->levels[level].atlas_dimensions.y : height;
+
+    atlas_layer[level] = layers;
+    layers += clipmap->levels[level].atlas_brick_layers;
 
-  if (opengl_shader_load(&shader->header, shader_font_code_vertex, shader_font_code_fragment))
+    material_layer[level] = material_layers;
+    material_layers += clipmap->levels[level].material_brick_layers;
+  }
+
+  *atlas_texture_dimensions = fathom_vec3_init((f32)width, (f32)height, (f32)(layers * FATHOM_PHYSICAL_BRICK_SIZE));
+  *material_texture_dimensions = fathom_vec3_init((f32)width, (f32)height, (f32)(material_layers * FATHOM_PHYSICAL_BRICK_SIZE));
+
+  glBindTexture(GL_TEXTURE_3D, brickMapTex);
+  glTexImage3D(GL_TEXTURE_3D, 0, index_32 ? GL_R32UI : GL_R16UI, (i32)dim, (i32)dim, (i32)(dim * clipmap->level_count), 0, GL_RED_INTEGER, index_32 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT, 0);
+
+  glBindTexture(GL_TEXTURE_3D, blockMapTex);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R8UI, (i32)top_dim, (i32)top_dim, (i32)(top_dim * clipmap->level_count), 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 0);
+
+  glBindTexture(GL_TEXTURE_3D, airDistanceTex);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R8UI, (i32)dim, (i32)dim, (i32)(dim * clipmap->level_count), 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 0);
+
+  glBindTexture(GL_TEXTURE_3D, atlasTex);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R8_SNORM, (i32)width, (i32)height, (i32)atlas_texture_dimensions->z, 0, GL_RED, GL_BYTE, 0);
+
+  glBindTexture(GL_TEXTURE_3D, materialTex);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, (i32)width, (i32)height, (i32)material_texture_dimensions->z, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+
+  glBindTexture(GL_TEXTURE_3D, brickMaterialTex);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_R32UI, (i32)(width / FATHOM_PHYSICAL_BRICK_SIZE), (i32)(height / FATHOM_PHYSICAL_BRICK_SIZE), (i32)layers, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+
+  for (level = 0; level < clipmap->level_count; ++level)
   {
-    shader->loc_iResolution = glGetUniformLocation(shader->header.program, "r");
-    shader->loc_iTextureInfo = glGetUniformLocation(shader->header.program, "t");
-    shader->loc_iFontScale = glGetUniformLocation(shader->header.program, "s");
-    shader->loc_iTime = glGetUniformLocation(shader->header.program, "iTime");
-    shader->loc_iTexture = glGetUniformLocation(shader->header.program, "iTexture");
+    fathom_upload_grid(&clipmap->levels[level], level, atlas_layer[level], material_layer[level], brickMapTex, blockMapTex, airDistanceTex, atlasTex, materialTex, brickMaterialTex);
   }
 }
 
-FATHOM_API void opengl_shader_load_shader_recording(shader_recording *shader)
+/* Uploads only the brick map box, air distance box and atlas rows touched by fathom_sparse_grid_update or fathom_sparse_grid_scroll.
+ * The block map of the level is small and always uploaded as a whole.
+ */
+FATHOM_API void fathom_upload_grid_dirty(fathom_sparse_grid *grid, u32 level, u32 atlas_layer, u32 material_layer, fathom_sparse_grid_dirty *dirty,
+                                         u32 brickMapTex, u32 blockMapTex, u32 airDistanceTex, u32 atlasTex, u32 materialTex, u32 brickMaterialTex)
 {
-  static s8 *shader_code_fragment =
-      "#version 330 core\n"
-      "out vec4 FragColor;"
-      "uniform float iTime;"
-      "uniform vec3 iRes;"
-      "void main()"
-      "{"
-      "float r=10.0;"
-      "float m=10.0;"
-      "vec2 p=gl_FragCoord.xy;"
-      "vec2 c=vec2(iRes.x-r-m, r+m);"
-      "float d=length(p-c);"
-      "float blink=0.5+0.5*sin(iTime*12.0);"
-      "float b=4.0;"
-      "if ((d<=r&&blink>0.5)||(p.x<b||p.y<b||p.x>=iRes.x-b||p.y>=iRes.y-b))"
-      " FragColor=vec4(1.0,0.0,0.0,blink);"
-      "else"
-      " discard;"
-      "}";
+  fathom_sparse_grid_region *region = &dirty->region;
+  u32 atlas_width = grid->atlas_bricks_per_row * FATHOM_PHYSICAL_BRICK_SIZE;
+  u32 atlas_height = grid->atlas_bricks_per_column * FATHOM_PHYSICAL_BRICK_SIZE;
 
-  if (opengl_shader_load(&shader->header, shader_code_vertex, shader_code_fragment))
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  if (region->brick_min[0] < region->brick_max[0] && region->brick_min[1] < region->brick_max[1] && region->brick_min[2] < region->brick_max[2])
   {
-    shader->loc_iResolution = glGetUniformLocation(shader->header.program, "iRes");
-    shader->loc_iTime = glGetUniformLocation(shader->header.program, "iTime");
+    if (grid->brick_map_offset[0] || grid->brick_map_offset[1] || grid->brick_map_offset[2])
+    {
+      /* A scrolled map wraps around in storage: the region is not one box anymore */
+      fathom_sparse_grid_region box;
+
+      box.brick_min[0] = box.brick_min[1] = box.brick_min[2] = 0;
+      box.brick_max[0] = box.brick_max[1] = box.brick_max[2] = grid->brick_map_dimensions;
+
+      fathom_upload_brick_map_box(grid, level, &box, brickMapTex);
+    }
+    else
+    {
+      /* Storage and local positions are the same */
+      fathom_upload_brick_map_box(grid, level, region, brickMapTex);
+    }
+
+    fathom_upload_block_map(grid, level, blockMapTex);
   }
-}
 
-#include "fathom_sparse_grid.h"
+  if (dirty->air_distance_region.brick_min[0] < dirty->air_distance_region.brick_max[0] &&
+      dirty->air_distance_region.brick_min[1] < dirty->air_distance_region.brick_max[1] &&
+      dirty->air_distance_region.brick_min[2] < dirty->air_distance_region.brick_max[2])
+  {
+    if (grid->brick_map_offset[0] || grid->brick_map_offset[1] || grid->brick_map_offset[2])
+    {
+      fathom_sparse_grid_region box;
 
-FATHOM_API void fathom_create_grid(win32_fathom_state *state, fathom_sparse_grid *grid, fathom_vec3 grid_center, u32 grid_cell_count, f32 grid_cell_size)
-{
-  fathom_sparse_grid_initialize(grid, grid_center, grid_cell_count, grid_cell_size);
+      box.brick_min[0] = box.brick_min[1] = box.brick_min[2] = 0;
+      box.brick_max[0] = box.brick_max[1] = box.brick_max[2] = grid->brick_map_dimensions;
 
-  grid->brick_map_data = VirtualAlloc(0, grid->brick_map_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+      fathom_upload_air_distance_box(grid, level, &box, airDistanceTex);
+    }
+    else
+    {
+      fathom_upload_air_distance_box(grid, level, &dirty->air_distance_region, airDistanceTex);
+    }
+  }
 
-  FATHOM_PROFILER_BEGIN(sparse_grid_pass_01);
-  fathom_sparse_grid_pass_01_fill_brick_map(grid, fathom_sdf_scene, state);
-  FATHOM_PROFILER_END(sparse_grid_pass_01);
+  if (dirty->atlas_brick_row_min < dirty->atlas_brick_row_max)
+  {
+    /* The dirty rows count on through the layers: one full width band of brick rows per touched layer */
+    u32 layer_first = dirty->atlas_brick_row_min / grid->atlas_bricks_per_column;
+    u32 layer_last = (dirty->atlas_brick_row_max - 1) / grid->atlas_bricks_per_column;
+    u32 layer;
 
-  grid->atlas_data = VirtualAlloc(0, grid->atlas_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-  grid->material_data = VirtualAlloc(0, grid->atlas_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, (i32)atlas_height);
+
+    for (layer = layer_first; layer <= layer_last; ++layer)
+    {
+      u32 row_min = layer * grid->atlas_bricks_per_column;
+      u32 row_max = row_min + grid->atlas_bricks_per_column;
+      u32 y;
+      u32 height;
+      u32 z = (atlas_layer + layer) * FATHOM_PHYSICAL_BRICK_SIZE;
+      u32 offset;
+
+      row_min = dirty->atlas_brick_row_min > row_min ? dirty->atlas_brick_row_min : row_min;
+      row_max = dirty->atlas_brick_row_max < row_max ? dirty->atlas_brick_row_max : row_max;
+
+      y = (row_min - (layer * grid->atlas_bricks_per_column)) * FATHOM_PHYSICAL_BRICK_SIZE;
+      height = (row_max - row_min) * FATHOM_PHYSICAL_BRICK_SIZE;
+      offset = (layer * FATHOM_PHYSICAL_BRICK_SIZE * atlas_height * atlas_width) + (y * atlas_width);
+
+      glBindTexture(GL_TEXTURE_3D, atlasTex);
+      glTexSubImage3D(GL_TEXTURE_3D, 0, 0, (i32)y, (i32)z, (i32)atlas_width, (i32)height, FATHOM_PHYSICAL_BRICK_SIZE,
+                      GL_RED, GL_BYTE, &grid->atlas_data[offset]);
+
+      glBindTexture(GL_TEXTURE_3D, brickMaterialTex);
+      glTexSubImage3D(GL_TEXTURE_3D, 0, 0, (i32)(row_min - (layer * grid->atlas_bricks_per_column)), (i32)(atlas_layer + layer),
+                      (i32)grid->atlas_bricks_per_row, (i32)(row_max - row_min), 1,
+                      GL_RED_INTEGER, GL_UNSIGNED_INT, &grid->atlas_slot_material_data[row_min * grid->atlas_bricks_per_row]);
+    }
 
-  state->mem_brick_map_bytes = grid->brick_map_bytes;
-  state->mem_atlas_bytes = grid->atlas_bytes;
-  state->grid_active_brick_count = grid->brick_map_active_bricks_count;
-  state->grid_atlas_dimensions = grid->atlas_dimensions;
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
 
-  FATHOM_PROFILER_BEGIN(sparse_grid_pass_02);
-  fathom_sparse_grid_pass_02_fill_atlas(grid, fathom_sdf_scene, state);
-  FATHOM_PROFILER_END(sparse_grid_pass_02);
+    fathom_upload_grid_materials(grid, material_layer, dirty->atlas_brick_row_min * grid->atlas_bricks_per_row,
+                                 dirty->atlas_brick_row_max * grid->atlas_bricks_per_row, materialTex);
+  }
 }
 
 FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_shader, u32 main_vao)
 {
   static u8 grid_initialized = 0;
-  static fathom_sparse_grid grid_lod0 = {0};
+  static fathom_clipmap clipmap = {0};
+  static fathom_vec3 atlas_texture_dimensions;
+  static fathom_vec3 material_texture_dimensions;
   static u32 brickMapTex;
+  static u32 blockMapTex;
+  static u32 airDistanceTex;
   static u32 atlasTex;
   static u32 materialTex;
+  static u32 brickMaterialTex;
   static u32 paletteTex;
-  static f32 cell_size_inverse = 0.0f;
+
+  /* Per level shader uniforms */
+  static f32 level_grid_start[FATHOM_CLIPMAP_MAX_LEVELS * 3];
+  static f32 level_cell_size[FATHOM_CLIPMAP_MAX_LEVELS];
+  static f32 level_truncation[FATHOM_CLIPMAP_MAX_LEVELS];
+  static i32 level_atlas_bricks_per_row[FATHOM_CLIPMAP_MAX_LEVELS];
+  static i32 level_atlas_bricks_per_column[FATHOM_CLIPMAP_MAX_LEVELS];
+  static u32 level_atlas_layer[FATHOM_CLIPMAP_MAX_LEVELS]; /* First atlas brick layer of every level, see fathom_upload_clipmap */
+  static i32 level_atlas_layer_start[FATHOM_CLIPMAP_MAX_LEVELS];
+  static u32 level_material_layer[FATHOM_CLIPMAP_MAX_LEVELS]; /* First material atlas brick layer of every level */
+  static i32 level_material_layer_start[FATHOM_CLIPMAP_MAX_LEVELS];
+  static i32 level_brick_map_offset[FATHOM_CLIPMAP_MAX_LEVELS * 3];
 
   /* Camera */
   static fathom_vec3 camera_position;
@@ -1330,31 +2759,75 @@ FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_
   static fathom_vec3 camera_forward_scaled;
   static f32 camera_fov = 1.5f;
 
+  u8 clipmap_rebuild = 0;
+  u32 level;
+
+  /* Camera Setup: orbits the scene so the clipmap has to follow it */
+  {
+    fathom_vec3 world_up = fathom_vec3_init(0.0f, 1.0f, 0.0f);
+    fathom_vec3 camera_look_at = fathom_vec3_zero;
+    f32 camera_angle = (f32)state->iTime * 0.2f;
+
+    camera_position = fathom_vec3_init(fathom_sinf(camera_angle) * 4.0f, 1.5f, fathom_cosf(camera_angle) * 4.0f);
+    camera_forward = fathom_vec3_normalize(fathom_vec3_sub(camera_look_at, camera_position)); /* Z-Axis */
+    camera_right = fathom_vec3_normalize(fathom_vec3_cross(camera_forward, world_up));        /* X-Axis */
+    camera_up = fathom_vec3_normalize(fathom_vec3_cross(camera_right, camera_forward));       /* Y-Axis */
+    camera_fov = 1.5f;
+    camera_forward_scaled = fathom_vec3_mulf(camera_forward, camera_fov);
+  }
+
   if (!grid_initialized)
   {
+    u32 grid_level_count = 4;
     u32 grid_cell_count = 128;
     f32 grid_cell_size = 1.0f / 16.0f;
 
     FATHOM_PROFILER_BEGIN(sdf_scene_build);
-    fathom_sdf_scene_build();
+    fathom_sdf_scene_store_initialize(&fathom_grid_scene, FATHOM_GRID_SCENE_CAPACITY);
+    fathom_grid_scene.arena_data = VirtualAlloc(0, fathom_grid_scene.arena_bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    fathom_sdf_scene_store_clear(&fathom_grid_scene);
+    fathom_grid_scene_sphere = fathom_sdf_scene_build(&fathom_grid_scene);
     FATHOM_PROFILER_END(sdf_scene_build);
 
-    FATHOM_PROFILER_BEGIN(sparse_grid_create_lod0);
-    fathom_create_grid(state, &grid_lod0, fathom_vec3_zero, grid_cell_count, grid_cell_size); /* LOD 0 */
-    FATHOM_PROFILER_END(sparse_grid_create_lod0);
+    /* LOD 0 covers 8 units around the camera, every further level twice the previous one */
+    fathom_clipmap_initialize(&clipmap, grid_level_count, grid_cell_count, grid_cell_size, FATHOM_SPARSE_GRID_INDEX_AUTO, (u32)state->gl_max_3d_texture_size);
+
+    FATHOM_PROFILER_BEGIN(sparse_grid_create_clipmap);
+    for (level = 0; level < clipmap.level_count; ++level)
+    {
+      fathom_clipmap_level_initialize(&clipmap, level, camera_position);
 
-    cell_size_inverse = 1.0f / grid_lod0.cell_size;
+      if (!fathom_create_grid(state, &clipmap.levels[level]))
+      {
+        state->running = 0;
+        return;
+      }
+    }
+    FATHOM_PROFILER_END(sparse_grid_create_clipmap);
 
     /* Brick Map */
     glGenTextures(1, &brickMapTex);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glBindTexture(GL_TEXTURE_3D, brickMapTex);
 
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16UI,
-                 (i32)grid_lod0.brick_map_dimensions,
-                 (i32)grid_lod0.brick_map_dimensions,
-                 (i32)grid_lod0.brick_map_dimensions,
-                 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, grid_lod0.brick_map_data);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    /* Block Map: one empty flag per block of the brick map */
+    glGenTextures(1, &blockMapTex);
+    glBindTexture(GL_TEXTURE_3D, blockMapTex);
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    /* Air Distance: one Chebyshev distance to the nearest brick that is not air per brick, laid out like the brick map */
+    glGenTextures(1, &airDistanceTex);
+    glBindTexture(GL_TEXTURE_3D, airDistanceTex);
 
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -1365,12 +2838,6 @@ FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_
     /* Atlas Texture */
     glGenTextures(1, &atlasTex);
     glBindTexture(GL_TEXTURE_3D, atlasTex);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8_SNORM,
-                 (i32)grid_lod0.atlas_dimensions.x,
-                 (i32)grid_lod0.atlas_dimensions.y,
-                 (i32)grid_lod0.atlas_dimensions.z,
-                 0, GL_RED, GL_BYTE, grid_lod0.atlas_data);
 
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -1387,18 +2854,23 @@ FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_
 
     glGenTextures(1, &materialTex);
     glBindTexture(GL_TEXTURE_3D, materialTex);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8,
-                 (i32)grid_lod0.atlas_dimensions.x,
-                 (i32)grid_lod0.atlas_dimensions.y,
-                 (i32)grid_lod0.atlas_dimensions.z,
-                 0, GL_RED, GL_UNSIGNED_BYTE, grid_lod0.material_data);
+
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+    /* Brick Material Texture: material id or material slot per atlas brick */
+    glGenTextures(1, &brickMaterialTex);
+    glBindTexture(GL_TEXTURE_3D, brickMaterialTex);
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
     /* Palette Texture */
     glGenTextures(1, &paletteTex);
     glBindTexture(GL_TEXTURE_1D, paletteTex);
@@ -1407,20 +2879,136 @@ FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 
+    clipmap_rebuild = 1;
     grid_initialized = 1;
   }
 
-  /* Camera Setup */
+  /* Follow the camera: every level only evaluates the bricks that scrolled into it */
+  FATHOM_PROFILER_BEGIN(sparse_grid_clipmap_scroll);
+  for (level = 0; level < clipmap.level_count; ++level)
   {
-    fathom_vec3 world_up = fathom_vec3_init(0.0f, 1.0f, 0.0f);
-    fathom_vec3 camera_look_at = fathom_vec3_zero;
+    fathom_grid_distance distance = fathom_grid_distance_scene(state);
+    fathom_sparse_grid_dirty dirty;
+    u8 result = fathom_clipmap_level_update(&clipmap, level, &distance, camera_position, state->api.job_system, &dirty);
 
-    camera_position = fathom_vec3_init(fathom_sinf((f32)state->iTime) * 0.5f, 1.0f, 2.0f);
-    camera_forward = fathom_vec3_normalize(fathom_vec3_sub(camera_look_at, camera_position)); /* Z-Axis */
-    camera_right = fathom_vec3_normalize(fathom_vec3_cross(camera_forward, world_up));        /* X-Axis */
-    camera_up = fathom_vec3_normalize(fathom_vec3_cross(camera_right, camera_forward));       /* Y-Axis */
-    camera_fov = 1.5f;
-    camera_forward_scaled = fathom_vec3_mulf(camera_forward, camera_fov);
+    if (result == FATHOM_CLIPMAP_LEVEL_SCROLLED)
+    {
+      fathom_upload_grid_dirty(&clipmap.levels[level], level, level_atlas_layer[level], level_material_layer[level], &dirty, brickMapTex, blockMapTex, airDistanceTex, atlasTex, materialTex, brickMaterialTex);
+      state->grid_scroll_sdf_calls = dirty.sdf_calls;
+    }
+    else if (result == FATHOM_CLIPMAP_LEVEL_REBUILD)
+    {
+      /* Atlas slots or brick map leaves ran out even with the headroom: full rebuild of this level */
+      fathom_destroy_grid(&clipmap.levels[level]);
+      fathom_clipmap_level_initialize(&clipmap, level, camera_position);
+
+      if (!fathom_create_grid(state, &clipmap.levels[level]))
+      {
+        state->running = 0;
+        return;
+      }
+
+      clipmap_rebuild = 1;
+    }
+  }
+  FATHOM_PROFILER_END(sparse_grid_clipmap_scroll);
+
+  /* Animated primitive: rebuild only the bricks around it in every level (G) */
+  if (state->grid_animate)
+  {
+    fathom_sdf_primitive sphere;
+    fathom_sdf_aabb bounds_old;
+    fathom_sdf_aabb bounds_new;
+    fathom_grid_distance distance;
+
+    fathom_sdf_scene_store_get(&fathom_grid_scene, fathom_grid_scene_sphere, &sphere);
+    bounds_old = fathom_sdf_scene_primitive_aabb(&sphere);
+
+    sphere.transform.position.y = 0.375f + 0.375f * fathom_sinf((f32)state->iTime * 2.0f);
+    bounds_new = fathom_sdf_scene_primitive_aabb(&sphere);
+    fathom_sdf_scene_store_update(&fathom_grid_scene, fathom_grid_scene_sphere, &sphere);
+
+    /* The compiled scene has the old position folded into its constants, the hierarchy bounds it */
+    state->grid_jit_current = 0;
+    state->grid_bvh_current = 0;
+    distance = fathom_grid_distance_scene(state);
+
+    FATHOM_PROFILER_BEGIN(sparse_grid_update);
+    for (level = 0; level < clipmap.level_count; ++level)
+    {
+      fathom_sparse_grid *grid = &clipmap.levels[level];
+      fathom_sparse_grid_dirty dirty;
+      fathom_sparse_grid_atlas_stats stats;
+
+      if (!fathom_sparse_grid_update(grid, &distance, bounds_old.min, bounds_old.max, bounds_new.min, bounds_new.max, FATHOM_SDF_SCENE_GROUND_BLEND, state->api.job_system, &dirty))
+      {
+        /* Atlas slots or brick map leaves ran out even with the headroom: full rebuild of this level */
+        fathom_destroy_grid(grid);
+        fathom_clipmap_level_initialize(&clipmap, level, camera_position);
+
+        if (!fathom_create_grid(state, grid))
+        {
+          state->running = 0;
+          return;
+        }
+
+        clipmap_rebuild = 1;
+        continue;
+      }
+
+      fathom_sparse_grid_atlas_stats_get(grid, &stats);
+
+      /* Too many holes: move the live bricks together and upload the level once */
+      if (stats.fragmentation > 0.25f && fathom_sparse_grid_atlas_compact(grid))
+      {
+        fathom_upload_grid(grid, level, level_atlas_layer[level], level_material_layer[level], brickMapTex, blockMapTex, airDistanceTex, atlasTex, materialTex, brickMaterialTex);
+      }
+      else
+      {
+        fathom_upload_grid_dirty(grid, level, level_atlas_layer[level], level_material_layer[level], &dirty, brickMapTex, blockMapTex, airDistanceTex, atlasTex, materialTex, brickMaterialTex);
+      }
+    }
+    FATHOM_PROFILER_END(sparse_grid_update);
+  }
+
+  /* A rebuilt level can have a larger atlas than the textures: specify them again */
+  if (clipmap_rebuild)
+  {
+    fathom_upload_clipmap(&clipmap, &atlas_texture_dimensions, level_atlas_layer, &material_texture_dimensions, level_material_layer, brickMapTex, blockMapTex, airDistanceTex, atlasTex, materialTex, brickMaterialTex);
+    state->grid_atlas_dimensions = atlas_texture_dimensions;
+  }
+
+  fathom_grid_stats_update(state, &clipmap);
+
+  if (state->grid_raymarch)
+  {
+    fathom_raymarch_camera camera;
+
+    camera.position = camera_position;
+    camera.right = camera_right;
+    camera.up = camera_up;
+    camera.forward_scaled = camera_forward_scaled;
+
+    fathom_benchmark_raymarch(state, &clipmap, &camera);
+    state->grid_raymarch = 0;
+  }
+
+  for (level = 0; level < clipmap.level_count; ++level)
+  {
+    fathom_sparse_grid *grid = &clipmap.levels[level];
+
+    level_grid_start[(level * 3) + 0] = grid->start.x;
+    level_grid_start[(level * 3) + 1] = grid->start.y;
+    level_grid_start[(level * 3) + 2] = grid->start.z;
+    level_cell_size[level] = grid->cell_size;
+    level_truncation[level] = grid->truncation_distance;
+    level_atlas_bricks_per_row[level] = (i32)grid->atlas_bricks_per_row;
+    level_atlas_bricks_per_column[level] = (i32)grid->atlas_bricks_per_column;
+    level_atlas_layer_start[level] = (i32)level_atlas_layer[level];
+    level_material_layer_start[level] = (i32)level_material_layer[level];
+    level_brick_map_offset[(level * 3) + 0] = (i32)grid->brick_map_offset[0];
+    level_brick_map_offset[(level * 3) + 1] = (i32)grid->brick_map_offset[1];
+    level_brick_map_offset[(level * 3) + 2] = (i32)grid->brick_map_offset[2];
   }
 
   /******************************/
@@ -1441,14 +3029,20 @@ FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_
   glUniform3f(main_shader->loc_camera_up, camera_up.x, camera_up.y, camera_up.z);
   glUniform3f(main_shader->loc_camera_forward_scaled, camera_forward_scaled.x, camera_forward_scaled.y, camera_forward_scaled.z);
 
-  /* Grid uniforms */
-  glUniform3f(main_shader->loc_brick_map_dim, (f32)grid_lod0.brick_map_dimensions * FATHOM_BRICK_SIZE, (f32)grid_lod0.brick_map_dimensions * FATHOM_BRICK_SIZE, (f32)grid_lod0.brick_map_dimensions * FATHOM_BRICK_SIZE);
-  glUniform3i(main_shader->loc_atlas_brick_dim, (i32)grid_lod0.atlas_bricks_per_row, (i32)0, (i32)0);
-  glUniform3f(main_shader->loc_inverse_atlas_size, grid_lod0.atlas_dimensions_inverse.x, grid_lod0.atlas_dimensions_inverse.y, grid_lod0.atlas_dimensions_inverse.z);
-  glUniform3f(main_shader->loc_grid_start, grid_lod0.start.x, grid_lod0.start.y, grid_lod0.start.z);
-  glUniform1f(main_shader->loc_cell_size, grid_lod0.cell_size);
-  glUniform3f(main_shader->loc_cell_size_inverse, cell_size_inverse, cell_size_inverse, cell_size_inverse);
-  glUniform1f(main_shader->loc_truncation, grid_lod0.truncation_distance);
+  /* Grid uniforms (one array entry per clipmap level) */
+  glUniform1i(main_shader->loc_level_count, (i32)clipmap.level_count);
+  glUniform1i(main_shader->loc_brick_map_dim, (i32)clipmap.levels[0].brick_map_dimensions);
+  glUniform1i(main_shader->loc_brick_map_index_bits, (i32)clipmap.levels[0].brick_map_index_bytes * 8);
+  glUniform3f(main_shader->loc_inverse_atlas_size, 1.0f / atlas_texture_dimensions.x, 1.0f / atlas_texture_dimensions.y, 1.0f / atlas_texture_dimensions.z);
+  glUniform3f(main_shader->loc_inverse_material_size, 1.0f / material_texture_dimensions.x, 1.0f / material_texture_dimensions.y, 1.0f / material_texture_dimensions.z);
+  glUniform3fv(main_shader->loc_grid_start, (i32)clipmap.level_count, level_grid_start);
+  glUniform1fv(main_shader->loc_cell_size, (i32)clipmap.level_count, level_cell_size);
+  glUniform1fv(main_shader->loc_truncation, (i32)clipmap.level_count, level_truncation);
+  glUniform1iv(main_shader->loc_atlas_bricks_per_row, (i32)clipmap.level_count, level_atlas_bricks_per_row);
+  glUniform1iv(main_shader->loc_atlas_bricks_per_column, (i32)clipmap.level_count, level_atlas_bricks_per_column);
+  glUniform1iv(main_shader->loc_atlas_layer_start, (i32)clipmap.level_count, level_atlas_layer_start);
+  glUniform1iv(main_shader->loc_material_layer_start, (i32)clipmap.level_count, level_material_layer_start);
+  glUniform3iv(main_shader->loc_brick_map_offset, (i32)clipmap.level_count, level_brick_map_offset);
 
   /* Bind textures to texture units */
   glActiveTexture(GL_TEXTURE0);
@@ -1467,6 +3061,18 @@ FATHOM_API void fathom_render_grid(win32_fathom_state *state, shader_main *main_
   glBindTexture(GL_TEXTURE_1D, paletteTex);
   glUniform1i(main_shader->loc_palette_texture, 3);
 
+  glActiveTexture(GL_TEXTURE4);
+  glBindTexture(GL_TEXTURE_3D, blockMapTex);
+  glUniform1i(main_shader->loc_block_map_texture, 4);
+
+  glActiveTexture(GL_TEXTURE5);
+  glBindTexture(GL_TEXTURE_3D, brickMaterialTex);
+  glUniform1i(main_shader->loc_brick_material_texture, 5);
+
+  glActiveTexture(GL_TEXTURE6);
+  glBindTexture(GL_TEXTURE_3D, airDistanceTex);
+  glUniform1i(main_shader->loc_air_distance_texture, 6);
+
   glBindVertexArray(main_vao);
   glDrawArrays(GL_TRIANGLES, 0, 3);
 
@@ -1695,6 +3301,7 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
   (void)GL_TEXTURE_3D;
   (void)GL_TEXTURE_WRAP_R;
   (void)GL_R16UI;
+  (void)fathom_update; /* The win32 layer runs its own frame loop, only the platform api of fathom.h is used */
 
   /******************************/
   /* Set Process Priorities     */
@@ -1704,6 +3311,23 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
     win32_print("[WARNING] Failed to set high priority process\n");
   }
 
+  /******************************/
+  /* Start Job System Workers   */
+  /******************************/
+  {
+    static fathom_job_system job_system;
+
+    state.api.io_print = win32_io_print;
+    state.api.io_file_size = win32_io_file_size;
+    state.api.io_file_read = win32_io_file_read;
+    state.api.processor_count = win32_processor_count;
+    state.api.thread_create = win32_thread_create;
+    state.api.thread_sleep = win32_thread_sleep;
+
+    fathom_job_system_initialize(&job_system, state.api.processor_count(), state.api.thread_create, state.api.thread_sleep);
+    state.api.job_system = &job_system;
+  }
+
   /******************************/
   /* Set DPI aware mode         */
   /******************************/
@@ -2060,6 +3684,76 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
         state.shader_paused = !state.shader_paused;
       }
 
+      /******************************/
+      /* Animate Grid Primitive (G) */
+      /******************************/
+      if (state.keys_is_down[0x47] && !state.keys_was_down[0x47]) /* G */
+      {
+        state.grid_animate = !state.grid_animate;
+      }
+
+      /******************************/
+      /* Traversal Benchmark (B)    */
+      /******************************/
+      if (state.keys_is_down[0x42] && !state.keys_was_down[0x42]) /* B */
+      {
+        fathom_benchmark_grid_traversal(&state);
+      }
+
+      /******************************/
+      /* SDF VM Benchmark (V)       */
+      /******************************/
+      if (state.keys_is_down[0x56] && !state.keys_was_down[0x56]) /* V */
+      {
+        fathom_benchmark_sdf_vm();
+      }
+
+      /******************************/
+      /* SDF BVH Benchmark (H)      */
+      /******************************/
+      if (state.keys_is_down[0x48] && !state.keys_was_down[0x48]) /* H */
+      {
+        fathom_benchmark_sdf_bvh();
+      }
+
+      /******************************/
+      /* Transform Benchmark (T)    */
+      /******************************/
+      if (state.keys_is_down[0x54] && !state.keys_was_down[0x54]) /* T */
+      {
+        fathom_benchmark_sdf_transform();
+      }
+
+      /******************************/
+      /* Raymarch Benchmark (K)     */
+      /******************************/
+      if (state.keys_is_down[0x4B] && !state.keys_was_down[0x4B]) /* K */
+      {
+        /* Runs in fathom_render_grid once the clipmap and camera of this frame are set */
+        state.grid_raymarch = 1;
+      }
+
+      /******************************/
+      /* Compiled Grid Scene (J)    */
+      /******************************/
+      if (state.keys_is_down[0x4A] && !state.keys_was_down[0x4A]) /* J */
+      {
+        /* Only the bricks built from now on use the other evaluation */
+        state.grid_jit_enabled = !state.grid_jit_enabled;
+        state.grid_jit_current = 0;
+        state.grid_jit_measured = 0;
+      }
+
+      /******************************/
+      /* Grid Scene Hierarchy (N)   */
+      /******************************/
+      if (state.keys_is_down[0x4E] && !state.keys_was_down[0x4E]) /* N */
+      {
+        /* Only the bricks built from now on use the other evaluation, the compiled scene (J) goes first */
+        state.grid_bvh_enabled = !state.grid_bvh_enabled;
+        state.grid_bvh_current = 0;
+      }
+
       /******************************/
       /* Reset Timer (R)            */
       /******************************/
@@ -2094,7 +3788,7 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
         static u16 offset_x = 0;
         static u16 offset_y = 0;
         static u8 glyph_initialized = 0;
-        static s8 tmp[128];
+        static s8 tmp[256];
         static u32 handle_count = 0;
         static process_memory_info mem = {0};
         static f32 font_scale = 2.0f;
@@ -2343,15 +4037,35 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
 
           glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "MEM BRICK MAP: \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
           glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "MEM ATLAS    : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "MEM MATERIAL : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
           glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "BRICK COUNT  : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
           glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "ATLAS DIM    : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
-          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "MAX 3D TEXRES: ", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "MAX 3D TEXRES: \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "SDF CALLS P1 : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "SDF CALLS P2 : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "SDF CALLS/BRK: \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "SDF SKIPPED  : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "IA CULLED    : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "TAPE LENGTH  : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "ATLAS SLOTS  : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "ATLAS OCC/FRG: \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "ATLAS WASTE  : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "ATLAS DEDUP  : \n", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
+          glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, "CLIPMAP LV/SC: ", &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
 
           t.length = 0;
-          fathom_sb_f64(&t, (f64)state.mem_brick_map_bytes / 1024.0 / 1024.0, 4);
+          /* Two level map / dense map of the same grids */
+          fathom_sb_f64(&t, (f64)state.mem_brick_map_bytes / 1024.0 / 1024.0, 3);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_f64(&t, (f64)state.mem_brick_map_dense_bytes / 1024.0 / 1024.0, 3);
           fathom_sb_s8(&t, "\n");
           fathom_sb_f64(&t, (f64)state.mem_atlas_bytes / 1024.0 / 1024.0, 4);
           fathom_sb_s8(&t, "\n");
+          /* Material atlas and entries / one material voxel per atlas voxel */
+          fathom_sb_f64(&t, (f64)state.mem_material_bytes / 1024.0 / 1024.0, 4);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_f64(&t, (f64)state.mem_atlas_bytes / 1024.0 / 1024.0, 4);
+          fathom_sb_s8(&t, "\n");
           fathom_sb_i32(&t, (i32)state.grid_active_brick_count);
           fathom_sb_s8(&t, "\n");
           fathom_sb_i32(&t, (i32)state.grid_atlas_dimensions.x);
@@ -2361,6 +4075,47 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
           fathom_sb_i32(&t, (i32)state.grid_atlas_dimensions.z);
           fathom_sb_s8(&t, "\n");
           fathom_sb_i32(&t, (i32)state.gl_max_3d_texture_size);
+          fathom_sb_s8(&t, "\n");
+          fathom_sb_i32(&t, (i32)state.grid_sdf_calls_pass_01);
+          fathom_sb_s8(&t, "\n");
+          fathom_sb_i32(&t, (i32)state.grid_sdf_calls_pass_02);
+          fathom_sb_s8(&t, "\n");
+          /* After apron sharing / before (every physical voxel evaluated) */
+          fathom_sb_f64(&t, state.grid_active_brick_count ? (f64)state.grid_sdf_calls_pass_02 / (f64)state.grid_active_brick_count : 0.0, 1);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_i32(&t, FATHOM_BRICK_TOTAL_VOXELS);
+          fathom_sb_s8(&t, "\n");
+          /* Saturated voxels of pass 2 filled without an evaluation */
+          fathom_sb_i32(&t, (i32)state.grid_sdf_skipped_pass_02);
+          fathom_sb_s8(&t, "\n");
+          /* Blocks of pass 0 / bricks of pass 1 culled by the distance range but not by their center */
+          fathom_sb_i32(&t, (i32)state.grid_interval_culled_pass_00);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_i32(&t, (i32)state.grid_interval_culled_pass_01);
+          fathom_sb_s8(&t, "\n");
+          /* Average pruned tape of a brick / whole scene */
+          fathom_sb_f64(&t, state.grid_tape_bricks_pass_02 ? (f64)state.grid_tape_length_pass_02 / (f64)state.grid_tape_bricks_pass_02 : 0.0, 2);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_i32(&t, (i32)fathom_grid_scene.primitive_count);
+          fathom_sb_s8(&t, "\n");
+          fathom_sb_i32(&t, (i32)state.grid_atlas_stats.live);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_i32(&t, (i32)state.grid_atlas_stats.capacity);
+          fathom_sb_s8(&t, "\n");
+          fathom_sb_f64(&t, (f64)state.grid_atlas_stats.occupancy, 2);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_f64(&t, (f64)state.grid_atlas_stats.fragmentation, 2);
+          fathom_sb_s8(&t, "\n");
+          fathom_sb_f64(&t, (f64)state.grid_atlas_stats.waste, 2);
+          fathom_sb_s8(&t, "\n");
+          /* Active bricks per live slot / distance and material bytes the shared bricks don't need */
+          fathom_sb_f64(&t, (f64)state.grid_atlas_stats.dedup_ratio, 2);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_f64(&t, (f64)state.grid_atlas_stats.shared * (f64)(FATHOM_BRICK_TOTAL_VOXELS * 2) / 1024.0 / 1024.0, 3);
+          fathom_sb_s8(&t, "\n");
+          fathom_sb_i32(&t, (i32)state.grid_level_count);
+          fathom_sb_s8(&t, "/");
+          fathom_sb_i32(&t, (i32)state.grid_scroll_sdf_calls);
 
           offset_memory_y = 10;
           glyph_add(glyph_buffer, GLYPH_BUFFER_SIZE, &glyph_buffer_count, t.buffer, &offset_memory_x, &offset_memory_y, pack_rgb565(255, 255, 255), GLYPH_STATE_NONE, font_scale);
@@ -2541,6 +4296,11 @@ FATHOM_API i32 start(i32 argc, u8 **argv)
     }
   }
 
+  /******************************/
+  /* Stop Job System Workers    */
+  /******************************/
+  fathom_job_system_shutdown(state.api.job_system);
+
   return 0;
 }
 
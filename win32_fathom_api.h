@@ -49,8 +49,10 @@ WIN32_FATHOM_API_TYPES_STATIC_ASSERT(sizeof(i64) == 8, i64_size_must_be_8);
 
 #define MEM_COMMIT 0x00001000
 #define MEM_RESERVE 0x00002000
+#define MEM_DECOMMIT 0x00004000
 #define MEM_RELEASE 0x00008000
 #define PAGE_READWRITE 0x04
+#define PAGE_EXECUTE_READ 0x20
 
 #define WM_ERASEBKGND 0x0014
 #define WM_CREATE 0x0001
@@ -329,6 +331,23 @@ typedef struct MONITORINFO
     u32 dwFlags;
 } MONITORINFO;
 
+typedef struct SYSTEM_INFO
+{
+    u16 wProcessorArchitecture;
+    u16 wReserved;
+    u32 dwPageSize;
+    void *lpMinimumApplicationAddress;
+    void *lpMaximumApplicationAddress;
+    u64 dwActiveProcessorMask;
+    u32 dwNumberOfProcessors;
+    u32 dwProcessorType;
+    u32 dwAllocationGranularity;
+    u16 wProcessorLevel;
+    u16 wProcessorRevision;
+} SYSTEM_INFO;
+
+typedef u32(__stdcall *LPTHREAD_START_ROUTINE)(void *lpThreadParameter);
+
 /* clang-format off */
 WIN32_API(void *) GetStdHandle(u32 nStdHandle);
 WIN32_API(i32)    CloseHandle(void *hObject);
@@ -338,6 +357,7 @@ WIN32_API(void *) GetProcAddress(void *hModule, char *lpProcName);
 WIN32_API(i32)    SetProcessDPIAware(void);
 WIN32_API(void *) VirtualAlloc(void *lpAddress, u32 dwSize, u32 flAllocationType, u32 flProtect);
 WIN32_API(i32)    VirtualFree(void *lpAddress, u32 dwSize, u32 dwFreeType);
+WIN32_API(i32)    VirtualProtect(void *lpAddress, u32 dwSize, u32 flNewProtect, u32 *lpflOldProtect);
 WIN32_API(void *) CreateFileA(s8 *lpFileName, u32 dwDesiredAccess, u32 dwShareMode, void *, u32 dwCreationDisposition, u32 dwFlagsAndAttributes, void *hTemplateFile);
 WIN32_API(u32)    GetFileSize(void *hFile, u32 *lpFileSizeHigh);
 WIN32_API(i32)    ReadFile(void *hFile, void *lpBuffer, u32 nNumberOfBytesToRead, u32 *lpNumberOfBytesRead, void *lpOverlapped);
@@ -393,6 +413,9 @@ WIN32_API(i32)    GetProcessHandleCount(void* hProcess, u32* pdwHandleCount);
 WIN32_API(void *) CreateToolhelp32Snapshot(u32 dwFlags, u32 th32ProcessID);
 WIN32_API(i32)    Thread32First(void* hSnapshot, THREADENTRY32* lpte);
 WIN32_API(i32)    Thread32Next(void* hSnapshot, THREADENTRY32* lpte);
+WIN32_API(void *) CreateThread(void *lpThreadAttributes, u64 dwStackSize, LPTHREAD_START_ROUTINE lpStartAddress, void *lpParameter, u32 dwCreationFlags, u32 *lpThreadId);
+WIN32_API(void)   GetSystemInfo(SYSTEM_INFO *lpSystemInfo);
+WIN32_API(i32)    SwitchToThread(void);
 /* clang-format on */
 
-#endif /* WIN32_FATHOM_API_H */
\ No newline at end of file
+#endif /* WIN32_FATHOM_API_H */
\ No newline at end of file